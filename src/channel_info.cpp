@@ -18,6 +18,8 @@
 
 #include "channel_info.h"
 
+#include "serializer/json_reader.h"
+
 #define CHANNEL_INFO_EPG_FIELD "epg"
 #define CHANNEL_INFO_VIDEO_ENABLE_FIELD "video"
 #define CHANNEL_INFO_AUDIO_ENABLE_FIELD "audio"
@@ -45,7 +47,7 @@ stream_id ChannelInfo::GetId() const {
   return epg_.GetChannelId();
 }
 
-EpgInfo ChannelInfo::GetEpg() const {
+const EpgInfo& ChannelInfo::GetEpg() const {
   return epg_;
 }
 
@@ -116,6 +118,59 @@ common::Error ChannelInfo::DeSerialize(const serialize_type& serialized, Channel
   return common::Error();
 }
 
+common::Error ChannelInfo::DeSerialize(JsonReader* reader, ChannelInfo* obj) {
+  if (!reader || !obj) {
+    return common::make_error_inval();
+  }
+
+  common::Error err = reader->EnterObject();
+  if (err) {
+    return err;
+  }
+
+  EpgInfo epg;
+  common::Error epg_err = common::make_error_inval();  // required
+  bool enable_audio = true;
+  bool enable_video = true;
+  std::string key;
+  bool has_next = false;
+  while (true) {
+    err = reader->NextField(&key, &has_next);
+    if (err) {
+      return err;
+    }
+    if (!has_next) {
+      break;
+    }
+
+    if (key == CHANNEL_INFO_EPG_FIELD) {
+      epg_err = EpgInfo::DeSerialize(reader, &epg);
+      err = reader->IsFailed() ? epg_err : common::Error();
+    } else if (key == CHANNEL_INFO_AUDIO_ENABLE_FIELD) {
+      err = reader->ReadBool(&enable_audio);
+    } else if (key == CHANNEL_INFO_VIDEO_ENABLE_FIELD) {
+      err = reader->ReadBool(&enable_video);
+    } else {
+      err = reader->SkipValue();
+    }
+    if (err) {
+      return err;
+    }
+  }
+
+  if (epg_err) {
+    return epg_err;
+  }
+
+  fastotv::ChannelInfo url(epg, enable_audio, enable_video);
+  if (!url.IsValid()) {
+    return common::make_error_inval();
+  }
+
+  *obj = url;
+  return common::Error();
+}
+
 bool ChannelInfo::Equals(const ChannelInfo& url) const {
   return epg_ == url.epg_ && enable_audio_ == url.enable_audio_ && enable_video_ == url.enable_video_;
 }
@@ -33,12 +33,13 @@ class ChannelInfo : public JsonSerializerEx {
   common::uri::Url GetUrl() const;
   std::string GetName() const;
   stream_id GetId() const;
-  EpgInfo GetEpg() const;
+  const EpgInfo& GetEpg() const;
 
   bool IsEnableAudio() const;
   bool IsEnableVideo() const;
 
   static common::Error DeSerialize(const serialize_type& serialized, ChannelInfo* obj) WARN_UNUSED_RESULT;
+  static common::Error DeSerialize(JsonReader* reader, ChannelInfo* obj) WARN_UNUSED_RESULT;
 
   bool Equals(const ChannelInfo& url) const;
 
@@ -0,0 +1,267 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "channels_delta_info.h"
+
+#include <algorithm>  // for find
+
+#include "serializer/json_reader.h"
+
+namespace fastotv {
+
+ChannelsDeltaInfo::ChannelsDeltaInfo()
+    : type_(FULL), version_(invalid_channels_version), added_(), modified_(), removed_() {}
+
+ChannelsDeltaInfo::ChannelsDeltaInfo(Type type,
+                                     const channels_version_t& version,
+                                     const ChannelsInfo& added,
+                                     const ChannelsInfo& modified,
+                                     const removed_t& removed)
+    : type_(type), version_(version), added_(added), modified_(modified), removed_(removed) {}
+
+ChannelsDeltaInfo ChannelsDeltaInfo::MakeUnchanged(const channels_version_t& version) {
+  return ChannelsDeltaInfo(UNCHANGED, version, ChannelsInfo(), ChannelsInfo(), removed_t());
+}
+
+ChannelsDeltaInfo ChannelsDeltaInfo::MakeFull(const channels_version_t& version, const ChannelsInfo& channels) {
+  return ChannelsDeltaInfo(FULL, version, channels, ChannelsInfo(), removed_t());
+}
+
+bool ChannelsDeltaInfo::IsValid() const {
+  return version_ != invalid_channels_version;
+}
+
+ChannelsDeltaInfo::Type ChannelsDeltaInfo::GetType() const {
+  return type_;
+}
+
+channels_version_t ChannelsDeltaInfo::GetVersion() const {
+  return version_;
+}
+
+ChannelsInfo ChannelsDeltaInfo::GetAdded() const {
+  return added_;
+}
+
+ChannelsInfo ChannelsDeltaInfo::GetModified() const {
+  return modified_;
+}
+
+ChannelsDeltaInfo::removed_t ChannelsDeltaInfo::GetRemoved() const {
+  return removed_;
+}
+
+void ChannelsDeltaInfo::ApplyTo(ChannelsInfo* channels) const {
+  if (!channels || type_ == UNCHANGED) {
+    return;
+  }
+
+  if (type_ == FULL) {
+    *channels = added_;
+    return;
+  }
+
+  const ChannelsInfo::channels_t modified = modified_.GetChannels();
+  ChannelsInfo result;
+  for (const ChannelInfo& channel : channels->GetChannels()) {
+    const stream_id sid = channel.GetId();
+    if (std::find(removed_.begin(), removed_.end(), sid) != removed_.end()) {
+      continue;
+    }
+
+    auto mod = std::find_if(modified.begin(), modified.end(),
+                            [sid](const ChannelInfo& changed) { return changed.GetId() == sid; });
+    result.AddChannel(mod == modified.end() ? channel : *mod);
+  }
+
+  for (const ChannelInfo& channel : added_.GetChannels()) {
+    result.AddChannel(channel);
+  }
+  *channels = result;
+}
+
+common::Error ChannelsDeltaInfo::SerializeFields(json_object* obj) const {
+  if (!IsValid()) {
+    return common::make_error_inval();
+  }
+
+  json_object* jadded = NULL;
+  common::Error err = added_.Serialize(&jadded);
+  if (err) {
+    return err;
+  }
+
+  json_object* jmodified = NULL;
+  err = modified_.Serialize(&jmodified);
+  if (err) {
+    json_object_put(jadded);
+    return err;
+  }
+
+  json_object* jremoved = json_object_new_array();
+  for (const stream_id& sid : removed_) {
+    json_object_array_add(jremoved, json_object_new_string(sid.c_str()));
+  }
+
+  json_object_object_add(obj, CHANNELS_DELTA_INFO_TYPE_FIELD, json_object_new_int(type_));
+  json_object_object_add(obj, CHANNELS_DELTA_INFO_VERSION_FIELD, json_object_new_string(version_.c_str()));
+  json_object_object_add(obj, CHANNELS_DELTA_INFO_ADDED_FIELD, jadded);
+  json_object_object_add(obj, CHANNELS_DELTA_INFO_MODIFIED_FIELD, jmodified);
+  json_object_object_add(obj, CHANNELS_DELTA_INFO_REMOVED_FIELD, jremoved);
+  return common::Error();
+}
+
+common::Error ChannelsDeltaInfo::DeSerialize(const serialize_type& serialized, ChannelsDeltaInfo* obj) {
+  if (!serialized || !obj) {
+    return common::make_error_inval();
+  }
+
+  json_object* jversion = NULL;
+  json_bool jversion_exists = json_object_object_get_ex(serialized, CHANNELS_DELTA_INFO_VERSION_FIELD, &jversion);
+  if (!jversion_exists) {
+    return common::make_error_inval();
+  }
+
+  json_object* jtype = NULL;
+  json_bool jtype_exists = json_object_object_get_ex(serialized, CHANNELS_DELTA_INFO_TYPE_FIELD, &jtype);
+  if (!jtype_exists) {
+    return common::make_error_inval();
+  }
+
+  const int type = json_object_get_int(jtype);
+  if (type < UNCHANGED || type > FULL) {
+    return common::make_error_inval();
+  }
+
+  ChannelsDeltaInfo inf;
+  inf.type_ = static_cast<Type>(type);
+  inf.version_ = json_object_get_string(jversion);
+
+  json_object* jadded = NULL;
+  json_bool jadded_exists = json_object_object_get_ex(serialized, CHANNELS_DELTA_INFO_ADDED_FIELD, &jadded);
+  if (jadded_exists) {
+    common::Error err = ChannelsInfo::DeSerialize(jadded, &inf.added_);
+    if (err) {
+      return err;
+    }
+  }
+
+  json_object* jmodified = NULL;
+  json_bool jmodified_exists = json_object_object_get_ex(serialized, CHANNELS_DELTA_INFO_MODIFIED_FIELD, &jmodified);
+  if (jmodified_exists) {
+    common::Error err = ChannelsInfo::DeSerialize(jmodified, &inf.modified_);
+    if (err) {
+      return err;
+    }
+  }
+
+  json_object* jremoved = NULL;
+  json_bool jremoved_exists = json_object_object_get_ex(serialized, CHANNELS_DELTA_INFO_REMOVED_FIELD, &jremoved);
+  if (jremoved_exists) {
+    if (!json_object_is_type(jremoved, json_type_array)) {
+      return common::make_error_inval();
+    }
+
+    size_t len = json_object_array_length(jremoved);
+    for (size_t i = 0; i < len; ++i) {
+      json_object* jsid = json_object_array_get_idx(jremoved, i);
+      if (!json_object_is_type(jsid, json_type_string)) {
+        return common::make_error_inval();
+      }
+      inf.removed_.push_back(json_object_get_string(jsid));
+    }
+  }
+
+  if (!inf.IsValid()) {
+    return common::make_error_inval();
+  }
+
+  *obj = inf;
+  return common::Error();
+}
+
+common::Error ChannelsDeltaInfo::DeSerialize(JsonReader* reader, ChannelsDeltaInfo* obj) {
+  if (!reader || !obj) {
+    return common::make_error_inval();
+  }
+
+  common::Error err = reader->EnterObject();
+  if (err) {
+    return err;
+  }
+
+  ChannelsDeltaInfo inf;
+  int type = -1;
+  bool version_exists = false;
+  std::string key;
+  bool has_next = false;
+  while (true) {
+    err = reader->NextField(&key, &has_next);
+    if (err) {
+      return err;
+    }
+    if (!has_next) {
+      break;
+    }
+
+    if (key == CHANNELS_DELTA_INFO_VERSION_FIELD) {
+      version_exists = true;
+      err = reader->ReadString(&inf.version_);
+    } else if (key == CHANNELS_DELTA_INFO_TYPE_FIELD) {
+      err = reader->ReadInt(&type);
+    } else if (key == CHANNELS_DELTA_INFO_ADDED_FIELD) {
+      err = ChannelsInfo::DeSerialize(reader, &inf.added_);
+    } else if (key == CHANNELS_DELTA_INFO_MODIFIED_FIELD) {
+      err = ChannelsInfo::DeSerialize(reader, &inf.modified_);
+    } else if (key == CHANNELS_DELTA_INFO_REMOVED_FIELD) {
+      err = reader->EnterArray();
+      bool has_sid = false;
+      while (!err) {
+        err = reader->NextElement(&has_sid);
+        if (err || !has_sid) {
+          break;
+        }
+
+        stream_id sid;
+        err = reader->ReadString(&sid);
+        if (!err) {
+          inf.removed_.push_back(sid);
+        }
+      }
+    } else {
+      err = reader->SkipValue();
+    }
+    if (err) {
+      return err;
+    }
+  }
+
+  if (!version_exists || type < UNCHANGED || type > FULL) {
+    return common::make_error_inval();
+  }
+
+  inf.type_ = static_cast<Type>(type);
+  if (!inf.IsValid()) {
+    return common::make_error_inval();
+  }
+
+  *obj = inf;
+  return common::Error();
+}
+
+}  // namespace fastotv
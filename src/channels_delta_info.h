@@ -0,0 +1,78 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "channels_info.h"
+
+#define CHANNELS_DELTA_INFO_TYPE_FIELD "type"
+#define CHANNELS_DELTA_INFO_VERSION_FIELD "version"
+#define CHANNELS_DELTA_INFO_ADDED_FIELD "added"
+#define CHANNELS_DELTA_INFO_MODIFIED_FIELD "modified"
+#define CHANNELS_DELTA_INFO_REMOVED_FIELD "removed"
+
+namespace fastotv {
+
+typedef std::string channels_version_t;
+static const channels_version_t invalid_channels_version = channels_version_t();
+
+// answer on versioned get_channels: channel list relative to the version cached by client
+class ChannelsDeltaInfo : public JsonSerializerEx {
+ public:
+  enum Type { UNCHANGED = 0, DELTA, FULL };
+  typedef std::vector<stream_id> removed_t;
+
+  ChannelsDeltaInfo();
+  ChannelsDeltaInfo(Type type,
+                    const channels_version_t& version,
+                    const ChannelsInfo& added,
+                    const ChannelsInfo& modified,
+                    const removed_t& removed);
+
+  static ChannelsDeltaInfo MakeUnchanged(const channels_version_t& version);
+  static ChannelsDeltaInfo MakeFull(const channels_version_t& version, const ChannelsInfo& channels);
+
+  bool IsValid() const;
+
+  Type GetType() const;
+  channels_version_t GetVersion() const;
+  ChannelsInfo GetAdded() const;  // all channels for FULL
+  ChannelsInfo GetModified() const;
+  removed_t GetRemoved() const;
+
+  // updates cached list of version for which delta was made
+  void ApplyTo(ChannelsInfo* channels) const;
+
+  static common::Error DeSerialize(const serialize_type& serialized, ChannelsDeltaInfo* obj) WARN_UNUSED_RESULT;
+  static common::Error DeSerialize(JsonReader* reader, ChannelsDeltaInfo* obj) WARN_UNUSED_RESULT;
+
+ protected:
+  virtual common::Error SerializeFields(json_object* obj) const override;
+
+ private:
+  Type type_;
+  channels_version_t version_;
+  ChannelsInfo added_;
+  ChannelsInfo modified_;
+  removed_t removed_;
+};
+
+}  // namespace fastotv
@@ -20,6 +20,8 @@
 
 #include <common/sprintf.h>
 
+#include "serializer/json_reader.h"
+
 namespace fastotv {
 
 ChannelsInfo::ChannelsInfo() : channels_() {}
@@ -80,4 +82,40 @@ common::Error ChannelsInfo::DeSerialize(const serialize_type& serialized, Channe
   return common::Error();
 }
 
+common::Error ChannelsInfo::DeSerialize(JsonReader* reader, ChannelsInfo* obj) {
+  if (!reader || !obj) {
+    return common::make_error_inval();
+  }
+
+  common::Error err = reader->EnterArray();
+  if (err) {
+    return err;
+  }
+
+  channels_t chan;
+  bool has_next = false;
+  while (true) {
+    err = reader->NextElement(&has_next);
+    if (err) {
+      return err;
+    }
+    if (!has_next) {
+      break;
+    }
+
+    ChannelInfo url;
+    err = ChannelInfo::DeSerialize(reader, &url);
+    if (err) {
+      if (reader->IsFailed()) {
+        return err;
+      }
+      continue;
+    }
+    chan.push_back(url);
+  }
+
+  (*obj).channels_.swap(chan);
+  return common::Error();
+}
+
 }  // namespace fastotv
@@ -28,6 +28,7 @@ class ChannelsInfo : public JsonSerializer {
   ChannelsInfo();
 
   static common::Error DeSerialize(const serialize_type& serialized, ChannelsInfo* obj) WARN_UNUSED_RESULT;
+  static common::Error DeSerialize(JsonReader* reader, ChannelsInfo* obj) WARN_UNUSED_RESULT;
 
   void AddChannel(const ChannelInfo& channel);
   channels_t GetChannels() const;
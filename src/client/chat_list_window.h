@@ -18,6 +18,8 @@
 
 #pragma once
 
+#include <deque>
+
 #include <player/gui/widgets/list_box.h>
 
 #include "chat_message.h"
@@ -29,7 +31,7 @@ class ChatListWindow : public fastoplayer::gui::IListBox {
  public:
   enum { login_field_width = 240, space_width = 10 };
   typedef fastoplayer::gui::IListBox base_class;
-  typedef std::vector<ChatMessage> messages_t;
+  typedef std::deque<ChatMessage> messages_t;
   ChatListWindow(const SDL_Color& back_ground_color);
 
   virtual size_t GetRowCount() const override;
@@ -18,6 +18,8 @@
 
 #pragma once
 
+#include <deque>
+
 #include <player/draw/font.h>
 #include <player/gui/widgets/window.h>
 
@@ -38,7 +40,7 @@ class ChatListWindow;
 class ChatWindow : public fastoplayer::gui::Window {
  public:
   typedef fastoplayer::gui::Window base_class;
-  typedef std::vector<ChatMessage> messages_t;
+  typedef std::deque<ChatMessage> messages_t;
   enum { login_field_width = 240, space_width = 10, post_button_width = 100 };
   static const SDL_Color text_background_color;
 
@@ -31,6 +31,7 @@
 
 // get_channels
 #define CLIENT_GET_CHANNELS_REQ GENERATE_REQUEST_FMT(CLIENT_GET_CHANNELS)
+#define CLIENT_GET_CHANNELS_REQ_1E GENERATE_REQUEST_FMT_ARGS(CLIENT_GET_CHANNELS, "'%s'")
 #define CLIENT_GET_CHANNELS_APPROVE_FAIL_1E GENEATATE_FAIL_FMT(CLIENT_GET_CHANNELS, "'%s'")
 #define CLIENT_GET_CHANNELS_APPROVE_SUCCESS GENEATATE_SUCCESS_FMT(CLIENT_GET_CHANNELS, "")
 
@@ -39,6 +40,11 @@
 #define CLIENT_GET_RUNTIME_CHANNEL_INFO_APPROVE_FAIL_1E GENEATATE_FAIL_FMT(CLIENT_GET_RUNTIME_CHANNEL_INFO, "'%s'")
 #define CLIENT_GET_RUNTIME_CHANNEL_INFO_APPROVE_SUCCESS GENEATATE_SUCCESS_FMT(CLIENT_GET_RUNTIME_CHANNEL_INFO, "")
 
+// get_programmes
+#define CLIENT_GET_PROGRAMMES_REQ_1E GENERATE_REQUEST_FMT_ARGS(CLIENT_GET_PROGRAMMES, "'%s'")
+#define CLIENT_GET_PROGRAMMES_APPROVE_FAIL_1E GENEATATE_FAIL_FMT(CLIENT_GET_PROGRAMMES, "'%s'")
+#define CLIENT_GET_PROGRAMMES_APPROVE_SUCCESS GENEATATE_SUCCESS_FMT(CLIENT_GET_PROGRAMMES, "")
+
 // send_chat_message
 #define CLIENT_SEND_CHAT_MESSAGE_REQ_1E GENERATE_REQUEST_FMT_ARGS(CLIENT_SEND_CHAT_MESSAGE, "'%s'")
 #define CLIENT_SEND_CHAT_MESSAGE_APPROVE_FAIL_1E GENEATATE_FAIL_FMT(CLIENT_SEND_CHAT_MESSAGE, "'%s'")
@@ -102,6 +108,12 @@ common::protocols::three_way_handshake::cmd_request_t GetChannelsRequest(
   return common::protocols::three_way_handshake::MakeRequest(id, CLIENT_GET_CHANNELS_REQ);
 }
 
+common::protocols::three_way_handshake::cmd_request_t GetChannelsRequest(
+    common::protocols::three_way_handshake::cmd_seq_t id,
+    const channels_version_t& version) {
+  return common::protocols::three_way_handshake::MakeRequest(id, CLIENT_GET_CHANNELS_REQ_1E, version);
+}
+
 common::protocols::three_way_handshake::cmd_approve_t GetChannelsApproveResponceSuccsess(
     common::protocols::three_way_handshake::cmd_seq_t id) {
   return common::protocols::three_way_handshake::MakeApproveResponce(id, CLIENT_GET_CHANNELS_APPROVE_SUCCESS);
@@ -133,6 +145,24 @@ common::protocols::three_way_handshake::cmd_approve_t GetRuntimeChannelInfoAppro
       id, CLIENT_GET_RUNTIME_CHANNEL_INFO_APPROVE_FAIL_1E, error_text);
 }
 
+common::protocols::three_way_handshake::cmd_request_t GetProgrammesRequest(
+    common::protocols::three_way_handshake::cmd_seq_t id,
+    const serializet_t& request) {
+  return common::protocols::three_way_handshake::MakeRequest(id, CLIENT_GET_PROGRAMMES_REQ_1E, request);
+}
+
+common::protocols::three_way_handshake::cmd_approve_t GetProgrammesApproveResponceSuccsess(
+    common::protocols::three_way_handshake::cmd_seq_t id) {
+  return common::protocols::three_way_handshake::MakeApproveResponce(id, CLIENT_GET_PROGRAMMES_APPROVE_SUCCESS);
+}
+
+common::protocols::three_way_handshake::cmd_approve_t GetProgrammesApproveResponceFail(
+    common::protocols::three_way_handshake::cmd_seq_t id,
+    const std::string& error_text) {
+  return common::protocols::three_way_handshake::MakeApproveResponce(id, CLIENT_GET_PROGRAMMES_APPROVE_FAIL_1E,
+                                                                     error_text);
+}
+
 common::protocols::three_way_handshake::cmd_request_t SendChatMessageRequest(
     common::protocols::three_way_handshake::cmd_seq_t id,
     const serializet_t& msg) {
@@ -20,6 +20,7 @@
 
 #include <string>  // for string
 
+#include "channels_delta_info.h"  // for channels_version_t
 #include "client_server_types.h"
 
 #include "commands/commands.h"
@@ -48,6 +49,9 @@ common::protocols::three_way_handshake::cmd_approve_t GetServerInfoApproveRespon
 // get_channels
 common::protocols::three_way_handshake::cmd_request_t GetChannelsRequest(
     common::protocols::three_way_handshake::cmd_seq_t id);
+common::protocols::three_way_handshake::cmd_request_t GetChannelsRequest(
+    common::protocols::three_way_handshake::cmd_seq_t id,
+    const channels_version_t& version);  // server answers with ChannelsDeltaInfo
 common::protocols::three_way_handshake::cmd_approve_t GetChannelsApproveResponceSuccsess(
     common::protocols::three_way_handshake::cmd_seq_t id);
 common::protocols::three_way_handshake::cmd_approve_t GetChannelsApproveResponceFail(
@@ -64,6 +68,16 @@ common::protocols::three_way_handshake::cmd_approve_t GetRuntimeChannelInfoAppro
     common::protocols::three_way_handshake::cmd_seq_t id,
     const std::string& error_text);
 
+// get_programmes
+common::protocols::three_way_handshake::cmd_request_t GetProgrammesRequest(
+    common::protocols::three_way_handshake::cmd_seq_t id,
+    const serializet_t& request);  // ProgrammesRequestInfo, server answers with ProgrammesInfo
+common::protocols::three_way_handshake::cmd_approve_t GetProgrammesApproveResponceSuccsess(
+    common::protocols::three_way_handshake::cmd_seq_t id);
+common::protocols::three_way_handshake::cmd_approve_t GetProgrammesApproveResponceFail(
+    common::protocols::three_way_handshake::cmd_seq_t id,
+    const std::string& error_text);
+
 // send_chat_message
 common::protocols::three_way_handshake::cmd_request_t SendChatMessageRequest(
     common::protocols::three_way_handshake::cmd_seq_t id,
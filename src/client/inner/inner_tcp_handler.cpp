@@ -18,6 +18,8 @@
 
 #include "client/inner/inner_tcp_handler.h"
 
+#include <stdlib.h>  // for strtoul
+
 #include <algorithm>
 
 #include <common/application/application.h>  // for fApp
@@ -25,18 +27,23 @@
 #include <common/net/net.h>                  // for connect
 #include <common/system_info/cpu_info.h>     // for CurrentCpuInfo
 #include <common/system_info/system_info.h>  // for AmountOfAvailable...
+#include <common/time.h>                     // for current_mstime
 
 #include "client/bandwidth/tcp_bandwidth_client.h"  // for TcpBandwidthClient
 #include "client/commands.h"
 #include "client/events/network_events.h"  // for BandwidtInfo, Con...
 
-#include "inner/inner_client.h"  // for InnerClient
+#include "inner/binary_commands.h"  // for MakeBinaryRequest
+#include "inner/inner_client.h"     // for InnerClient
 
-#include "channels_info.h"  // for ChannelsInfo
-#include "client_info.h"    // for ClientInfo
-#include "ping_info.h"      // for ClientPingInfo
+#include "channels_info.h"            // for ChannelsInfo
+#include "client_info.h"              // for ClientInfo
+#include "ping_info.h"                // for ClientPingInfo
+#include "programmes_info.h"          // for ProgrammesInfo
+#include "programmes_request_info.h"  // for ProgrammesRequestInfo
 #include "runtime_channel_info.h"
-#include "server_info.h"  // for ServerInfo
+#include "serializer/json_reader.h"  // for DeSerializeFromString
+#include "server_info.h"             // for ServerInfo
 
 namespace fastotv {
 namespace client {
@@ -49,7 +56,9 @@ InnerTcpHandler::InnerTcpHandler(const StartConfig& config)
       bandwidth_requests_(),
       ping_server_id_timer_(INVALID_TIMER_ID),
       config_(config),
-      current_bandwidth_(0) {}
+      current_bandwidth_(0),
+      channels_cache_(),
+      channels_version_(invalid_channels_version) {}
 
 InnerTcpHandler::~InnerTcpHandler() {
   CHECK(bandwidth_requests_.empty());
@@ -104,9 +113,8 @@ void InnerTcpHandler::Closed(common::libev::IoClient* client) {
 
 void InnerTcpHandler::DataReceived(common::libev::IoClient* client) {
   if (client == inner_connection_) {
-    std::string buff;
     fastotv::inner::InnerClient* iclient = static_cast<fastotv::inner::InnerClient*>(client);
-    common::Error err = iclient->ReadCommand(&buff);
+    common::Error err = iclient->ReadData();
     if (err) {
       DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
       client->Close();
@@ -114,7 +122,22 @@ void InnerTcpHandler::DataReceived(common::libev::IoClient* client) {
       return;
     }
 
-    HandleInnerDataReceived(iclient, buff);
+    while (client == inner_connection_) {  // reset in Closed
+      const std::string* command = nullptr;
+      err = iclient->NextCommand(&command);
+      if (err) {
+        DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+        client->Close();
+        delete client;
+        return;
+      }
+
+      if (!command) {
+        return;
+      }
+
+      HandleInnerDataReceived(iclient, *command);
+    }
     return;
   }
 
@@ -134,7 +157,15 @@ void InnerTcpHandler::DataReceived(common::libev::IoClient* client) {
 }
 
 void InnerTcpHandler::DataReadyToWrite(common::libev::IoClient* client) {
-  UNUSED(client);
+  if (client == inner_connection_) {
+    fastotv::inner::InnerClient* iclient = static_cast<fastotv::inner::InnerClient*>(client);
+    common::Error err = iclient->Flush();
+    if (err) {
+      DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+      client->Close();
+      delete client;
+    }
+  }
 }
 
 void InnerTcpHandler::PostLooped(common::libev::IoLoop* server) {
@@ -156,7 +187,10 @@ void InnerTcpHandler::PostLooped(common::libev::IoLoop* server) {
 void InnerTcpHandler::TimerEmited(common::libev::IoLoop* server, common::libev::timer_id_t id) {
   UNUSED(server);
   if (id == ping_server_id_timer_ && inner_connection_) {
-    const common::protocols::three_way_handshake::cmd_request_t ping_request = PingRequest(NextRequestID());
+    const common::protocols::three_way_handshake::cmd_request_t ping_request =
+        inner_connection_->IsPeerSupport(fastotv::inner::InnerClient::BINARY_COMMANDS_FEATURE)
+            ? fastotv::inner::MakeBinaryRequest(NextRequestID(inner_connection_), CLIENT_PING)
+            : PingRequest(NextRequestID(inner_connection_));
     fastotv::inner::InnerClient* client = inner_connection_;
     common::Error err = client->Write(ping_request);
     if (err) {
@@ -180,7 +214,8 @@ void InnerTcpHandler::RequestServerInfo() {
     return;
   }
 
-  const common::protocols::three_way_handshake::cmd_request_t channels_request = GetServerInfoRequest(NextRequestID());
+  const common::protocols::three_way_handshake::cmd_request_t channels_request =
+      GetServerInfoRequest(NextRequestID(inner_connection_));
   fastotv::inner::InnerClient* client = inner_connection_;
   common::Error err = client->Write(channels_request);
   if (err) {
@@ -195,7 +230,8 @@ void InnerTcpHandler::RequestChannels() {
     return;
   }
 
-  const common::protocols::three_way_handshake::cmd_request_t channels_request = GetChannelsRequest(NextRequestID());
+  const common::protocols::three_way_handshake::cmd_request_t channels_request =
+      GetChannelsRequest(NextRequestID(inner_connection_), channels_version_);
   fastotv::inner::InnerClient* client = inner_connection_;
   common::Error err = client->Write(channels_request);
   if (err) {
@@ -210,6 +246,20 @@ void InnerTcpHandler::PostMessageToChat(const ChatMessage& msg) {
     return;
   }
 
+  fastotv::inner::InnerClient* client = inner_connection_;
+  if (client->IsPeerSupport(fastotv::inner::InnerClient::BINARY_COMMANDS_FEATURE)) {
+    std::string msg_bin;
+    fastotv::inner::BinarySerialize(msg, &msg_bin);
+    common::Error err = client->Write(
+        fastotv::inner::MakeBinaryRequest(NextRequestID(client), CLIENT_SEND_CHAT_MESSAGE, msg_bin));
+    if (err) {
+      DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+      client->Close();
+      delete client;
+    }
+    return;
+  }
+
   serializet_t msg_ser;
   common::Error err = msg.SerializeToString(&msg_ser);
   if (err) {
@@ -218,8 +268,7 @@ void InnerTcpHandler::PostMessageToChat(const ChatMessage& msg) {
   }
 
   const common::protocols::three_way_handshake::cmd_request_t channels_request =
-      SendChatMessageRequest(NextRequestID(), msg_ser);
-  fastotv::inner::InnerClient* client = inner_connection_;
+      SendChatMessageRequest(NextRequestID(client), msg_ser);
   err = client->Write(channels_request);
   if (err) {
     DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
@@ -234,7 +283,9 @@ void InnerTcpHandler::RequesRuntimeChannelInfo(stream_id sid) {
   }
 
   const common::protocols::three_way_handshake::cmd_request_t channels_request =
-      GetRuntimeChannelInfoRequest(NextRequestID(), sid);
+      inner_connection_->IsPeerSupport(fastotv::inner::InnerClient::BINARY_COMMANDS_FEATURE)
+          ? fastotv::inner::MakeBinaryRequest(NextRequestID(inner_connection_), CLIENT_GET_RUNTIME_CHANNEL_INFO, sid)
+          : GetRuntimeChannelInfoRequest(NextRequestID(inner_connection_), sid);
   fastotv::inner::InnerClient* client = inner_connection_;
   common::Error err = client->Write(channels_request);
   if (err) {
@@ -244,6 +295,23 @@ void InnerTcpHandler::RequesRuntimeChannelInfo(stream_id sid) {
   }
 }
 
+void InnerTcpHandler::RequestProgrammes(const std::vector<stream_id>& channels,
+                                        timestamp_t from,
+                                        timestamp_t to,
+                                        size_t limit) {
+  if (!inner_connection_) {
+    return;
+  }
+
+  fastotv::inner::InnerClient* client = inner_connection_;
+  common::Error err = WriteProgrammesRequest(client, channels, from, to, limit);
+  if (err) {
+    DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+    client->Close();
+    delete client;
+  }
+}
+
 void InnerTcpHandler::Connect(common::libev::IoLoop* server) {
   if (!server) {
     return;
@@ -312,6 +380,17 @@ void InnerTcpHandler::HandleInnerRequestCommand(fastotv::inner::InnerClient* con
 
   if (IS_EQUAL_COMMAND(command, SERVER_PING)) {
     ServerPingInfo ping;
+    if (IsBinaryCommand()) {
+      std::string ping_bin;
+      fastotv::inner::BinarySerialize(ping, &ping_bin);
+      common::Error err =
+          connection->Write(fastotv::inner::MakeBinaryResponce(id, SUCCESS_COMMAND, SERVER_PING, ping_bin));
+      if (err) {
+        DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+      }
+      return;
+    }
+
     json_object* jping = NULL;
     common::Error err = ping.Serialize(&jping);
     if (err) {
@@ -332,6 +411,8 @@ void InnerTcpHandler::HandleInnerRequestCommand(fastotv::inner::InnerClient* con
       DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
       return;
     }
+    json_object_object_add(jauth, PROTOCOL_FEATURES_FIELD,
+                           json_object_new_int(fastotv::inner::InnerClient::supported_features));
 
     std::string auth_str = json_object_get_string(jauth);
     json_object_put(jauth);
@@ -355,6 +436,17 @@ void InnerTcpHandler::HandleInnerRequestCommand(fastotv::inner::InnerClient* con
     std::string os = common::MemSPrintf("%s %s(%s)", os_name, os_version, os_arch);
 
     ClientInfo info(config_.ainf.GetLogin(), os, brand, ram_total, ram_free, current_bandwidth_);
+    if (IsBinaryCommand()) {
+      std::string info_bin;
+      fastotv::inner::BinarySerialize(info, &info_bin);
+      common::Error err =
+          connection->Write(fastotv::inner::MakeBinaryResponce(id, SUCCESS_COMMAND, SERVER_GET_CLIENT_INFO, info_bin));
+      if (err) {
+        DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+      }
+      return;
+    }
+
     serializet_t info_json_string;
     common::Error err = info.SerializeToString(&info_json_string);
     if (err) {
@@ -369,30 +461,23 @@ void InnerTcpHandler::HandleInnerRequestCommand(fastotv::inner::InnerClient* con
     }
     return;
   } else if (IS_EQUAL_COMMAND(command, SERVER_SEND_CHAT_MESSAGE)) {
-    if (argc < 2 || !argv[1]) {
-      common::Error parse_err = common::make_error_inval();
-      DEBUG_MSG_ERROR(parse_err, common::logging::LOG_LEVEL_ERR);
-      return;
-    }
-
-    json_object* jmsg = json_tokener_parse(argv[1]);
-    if (!jmsg) {
-      common::Error parse_err = common::make_error_inval();
-      DEBUG_MSG_ERROR(parse_err, common::logging::LOG_LEVEL_ERR);
-      return;
-    }
-
     ChatMessage msg;
-    common::Error err = ChatMessage::DeSerialize(jmsg, &msg);
-    std::string msg_str = json_object_get_string(jmsg);
-    json_object_put(jmsg);
+    common::Error err = ParseArgument(argc, argv, 1, &msg);
     if (err) {
+      DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
       return;
     }
 
     fApp->PostEvent(new events::ReceiveChatMessageEvent(this, msg));
-    common::protocols::three_way_handshake::cmd_responce_t resp = SystemInfoResponceSuccsess(id, msg_str);
-    err = connection->Write(resp);
+    if (IsBinaryCommand()) {
+      std::string msg_bin;
+      fastotv::inner::BinarySerialize(msg, &msg_bin);
+      err = connection->Write(
+          fastotv::inner::MakeBinaryResponce(id, SUCCESS_COMMAND, SERVER_SEND_CHAT_MESSAGE, msg_bin));
+    } else {
+      common::protocols::three_way_handshake::cmd_responce_t resp = SystemInfoResponceSuccsess(id, argv[1]);
+      err = connection->Write(resp);
+    }
     if (err) {
       DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
     }
@@ -437,6 +522,9 @@ void InnerTcpHandler::HandleInnerApproveCommand(fastotv::inner::InnerClient* con
       const char* okrespcommand = argv[1];
       if (IS_EQUAL_COMMAND(okrespcommand, SERVER_PING)) {
       } else if (IS_EQUAL_COMMAND(okrespcommand, SERVER_WHO_ARE_YOU)) {
+        if (argc > 2) {  // old servers don't send features
+          connection->SetPeerFeatures(strtoul(argv[2], NULL, 10));
+        }
         connection->SetName(config_.ainf.GetLogin());
         fApp->PostEvent(new events::ClientAuthorizedEvent(this, config_.ainf));
       } else if (IS_EQUAL_COMMAND(okrespcommand, SERVER_GET_CLIENT_INFO)) {
@@ -468,23 +556,17 @@ common::Error InnerTcpHandler::HandleInnerSuccsessResponceCommand(fastotv::inner
                                                                   char* argv[]) {
   char* command = argv[1];
   if (IS_EQUAL_COMMAND(command, CLIENT_PING)) {
-    json_object* obj = NULL;
-    common::Error parse_err = ParserResponceResponceCommand(argc, argv, &obj);
-    if (parse_err) {
-      common::protocols::three_way_handshake::cmd_approve_t resp =
-          PingApproveResponceFail(id, parse_err->GetDescription());
-      common::Error write_err = connection->Write(resp);
-      UNUSED(write_err);
-      return parse_err;
-    }
-
     ClientPingInfo ping_info;
-    common::Error err = ClientPingInfo::DeSerialize(obj, &ping_info);
-    json_object_put(obj);
+    common::Error err = ParseArgument(argc, argv, 2, &ping_info);
     if (err) {
+      common::protocols::three_way_handshake::cmd_approve_t resp = PingApproveResponceFail(id, err->GetDescription());
+      common::Error write_err = connection->Write(resp);
+      UNUSED(write_err);
       return err;
     }
-    common::protocols::three_way_handshake::cmd_approve_t resp = PingApproveResponceSuccsess(id);
+    common::protocols::three_way_handshake::cmd_approve_t resp =
+        IsBinaryCommand() ? fastotv::inner::MakeBinaryApprove(id, SUCCESS_COMMAND, CLIENT_PING)
+                          : PingApproveResponceSuccsess(id);
     return connection->Write(resp);
   } else if (IS_EQUAL_COMMAND(command, CLIENT_GET_SERVER_INFO)) {
     json_object* obj = NULL;
@@ -521,67 +603,82 @@ common::Error InnerTcpHandler::HandleInnerSuccsessResponceCommand(fastotv::inner
     server->RegisterClient(band_connection);
     return common::Error();
   } else if (IS_EQUAL_COMMAND(command, CLIENT_GET_CHANNELS)) {
-    json_object* obj = NULL;
-    common::Error parse_err = ParserResponceResponceCommand(argc, argv, &obj);
-    if (parse_err) {
+    const char* channels_str = argc > 2 ? argv[2] : NULL;
+    common::Error err = channels_str ? UpdateChannelsCache(channels_str) : common::make_error_inval();
+    if (err) {
       common::protocols::three_way_handshake::cmd_approve_t resp =
-          GetChannelsApproveResponceFail(id, parse_err->GetDescription());
+          GetChannelsApproveResponceFail(id, err->GetDescription());
       common::Error write_err = connection->Write(resp);
       UNUSED(write_err);
-      return parse_err;
+      return err;
     }
 
-    ChannelsInfo chan;
-    common::Error err = ChannelsInfo::DeSerialize(obj, &chan);
-    json_object_put(obj);
+    fApp->PostEvent(new events::ReceiveChannelsEvent(this, channels_cache_));
+    const common::protocols::three_way_handshake::cmd_approve_t resp = GetChannelsApproveResponceSuccsess(id);
+    err = connection->Write(resp);
     if (err) {
       return err;
     }
 
-    fApp->PostEvent(new events::ReceiveChannelsEvent(this, chan));
-    const common::protocols::three_way_handshake::cmd_approve_t resp = GetChannelsApproveResponceSuccsess(id);
-    return connection->Write(resp);
+    // list came without programmes, fetch only now and next, the rest is paged in by the player
+    std::vector<stream_id> sids;
+    for (const ChannelInfo& channel : channels_cache_.GetChannels()) {
+      sids.push_back(channel.GetId());
+    }
+    const timestamp_t now = common::time::current_mstime();
+    return WriteProgrammesRequest(connection, sids, now, now + programmes_window_msec, now_next_programmes_limit);
   } else if (IS_EQUAL_COMMAND(command, CLIENT_GET_RUNTIME_CHANNEL_INFO)) {
-    json_object* obj = NULL;
-    common::Error parse_err = ParserResponceResponceCommand(argc, argv, &obj);
-    if (parse_err) {
+    RuntimeChannelInfo chan;
+    common::Error err = ParseArgument(argc, argv, 2, &chan);
+    if (err) {
       common::protocols::three_way_handshake::cmd_approve_t resp =
-          GetRuntimeChannelInfoApproveResponceFail(id, parse_err->GetDescription());
+          GetRuntimeChannelInfoApproveResponceFail(id, err->GetDescription());
       common::Error write_err = connection->Write(resp);
       UNUSED(write_err);
-      return parse_err;
-    }
-
-    RuntimeChannelInfo chan;
-    common::Error err = RuntimeChannelInfo::DeSerialize(obj, &chan);
-    json_object_put(obj);
-    if (err) {
       return err;
     }
 
     fApp->PostEvent(new events::ReceiveRuntimeChannelEvent(this, chan));
-    const common::protocols::three_way_handshake::cmd_approve_t resp = GetRuntimeChannelInfoApproveResponceSuccsess(id);
+    const common::protocols::three_way_handshake::cmd_approve_t resp =
+        IsBinaryCommand() ? fastotv::inner::MakeBinaryApprove(id, SUCCESS_COMMAND, CLIENT_GET_RUNTIME_CHANNEL_INFO)
+                          : GetRuntimeChannelInfoApproveResponceSuccsess(id);
     return connection->Write(resp);
-  } else if (IS_EQUAL_COMMAND(command, CLIENT_SEND_CHAT_MESSAGE)) {
+  } else if (IS_EQUAL_COMMAND(command, CLIENT_GET_PROGRAMMES)) {
     json_object* obj = NULL;
-    common::Error parse_err = ParserResponceResponceCommand(argc, argv, &obj);
-    if (parse_err) {
+    common::Error err = ParserResponceResponceCommand(argc, argv, &obj);
+    if (!err) {
+      ProgrammesInfo programmes;
+      err = ProgrammesInfo::DeSerialize(obj, &programmes);
+      json_object_put(obj);
+      if (!err) {
+        fApp->PostEvent(new events::ReceiveProgrammesEvent(this, programmes));
+      }
+    }
+    if (err) {
       common::protocols::three_way_handshake::cmd_approve_t resp =
-          SendChatMessageApproveResponceFail(id, parse_err->GetDescription());
+          GetProgrammesApproveResponceFail(id, err->GetDescription());
       common::Error write_err = connection->Write(resp);
       UNUSED(write_err);
-      return parse_err;
+      return err;
     }
 
+    const common::protocols::three_way_handshake::cmd_approve_t resp = GetProgrammesApproveResponceSuccsess(id);
+    return connection->Write(resp);
+  } else if (IS_EQUAL_COMMAND(command, CLIENT_SEND_CHAT_MESSAGE)) {
     ChatMessage msg;
-    common::Error err = ChatMessage::DeSerialize(obj, &msg);
-    json_object_put(obj);
+    common::Error err = ParseArgument(argc, argv, 2, &msg);
     if (err) {
+      common::protocols::three_way_handshake::cmd_approve_t resp =
+          SendChatMessageApproveResponceFail(id, err->GetDescription());
+      common::Error write_err = connection->Write(resp);
+      UNUSED(write_err);
       return err;
     }
 
     fApp->PostEvent(new events::SendChatMessageEvent(this, msg));
-    const common::protocols::three_way_handshake::cmd_approve_t resp = SendChatMessageApproveResponceSuccsess(id);
+    const common::protocols::three_way_handshake::cmd_approve_t resp =
+        IsBinaryCommand() ? fastotv::inner::MakeBinaryApprove(id, SUCCESS_COMMAND, CLIENT_SEND_CHAT_MESSAGE)
+                          : SendChatMessageApproveResponceSuccsess(id);
     return connection->Write(resp);
   }
 
@@ -622,6 +719,60 @@ common::Error InnerTcpHandler::ParserResponceResponceCommand(int argc, char* arg
   return common::Error();
 }
 
+common::Error InnerTcpHandler::WriteProgrammesRequest(fastotv::inner::InnerClient* connection,
+                                                      const std::vector<stream_id>& channels,
+                                                      timestamp_t from,
+                                                      timestamp_t to,
+                                                      size_t limit) {
+  if (!connection) {
+    return common::make_error_inval();
+  }
+
+  if (!connection->IsPeerSupport(fastotv::inner::InnerClient::PROGRAMMES_FEATURE) || channels.empty()) {
+    return common::Error();
+  }
+
+  serializet_t req_str;
+  common::Error err = ProgrammesRequestInfo(channels, from, to, limit).SerializeToString(&req_str);
+  if (err) {
+    return err;
+  }
+
+  const common::protocols::three_way_handshake::cmd_request_t programmes_request =
+      GetProgrammesRequest(NextRequestID(connection), req_str);
+  return connection->Write(programmes_request);
+}
+
+common::Error InnerTcpHandler::UpdateChannelsCache(const std::string& data) {
+  const size_t first = data.find_first_not_of(" \t\r\n");
+  if (first != std::string::npos && data[first] == '[') {  // server without versions support
+    ChannelsInfo chan;
+    common::Error err = DeSerializeFromString(data, &chan);
+    if (err) {
+      return err;
+    }
+
+    channels_cache_ = chan;
+    channels_version_ = invalid_channels_version;
+    return common::Error();
+  }
+
+  ChannelsDeltaInfo delta;
+  common::Error err = DeSerializeFromString(data, &delta);
+  if (err) {
+    channels_version_ = invalid_channels_version;
+    return err;
+  }
+
+  if (delta.GetType() != ChannelsDeltaInfo::FULL && channels_version_ == invalid_channels_version) {
+    return common::make_error("Channels delta without cached base version");
+  }
+
+  delta.ApplyTo(&channels_cache_);
+  channels_version_ = delta.GetVersion();
+  return common::Error();
+}
+
 }  // namespace inner
 }  // namespace client
 }  // namespace fastotv
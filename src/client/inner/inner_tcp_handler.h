@@ -23,6 +23,8 @@
 
 #include "auth_info.h"  // for AuthInfo
 
+#include "channels_delta_info.h"  // for channels_version_t
+#include "channels_info.h"        // for ChannelsInfo
 #include "chat_message.h"
 #include "client/types.h"         // for BandwidthHostType
 #include "client_server_types.h"  // for bandwidth_t
@@ -45,7 +47,9 @@ struct StartConfig {
 class InnerTcpHandler : public fastotv::inner::InnerServerCommandSeqParser, public common::libev::IoLoopObserver {
  public:
   enum {
-    ping_timeout_server = 30  // sec
+    ping_timeout_server = 30,                       // sec
+    programmes_window_msec = 24 * 60 * 60 * 1000,  // programmes fetched ahead
+    now_next_programmes_limit = 2                   // per channel at startup
   };
 
   explicit InnerTcpHandler(const StartConfig& config);
@@ -57,6 +61,8 @@ class InnerTcpHandler : public fastotv::inner::InnerServerCommandSeqParser, publ
   void PostMessageToChat(const ChatMessage& msg);  // should be execute in network thread
   void Connect(common::libev::IoLoop* server);     // should be execute in network thread
   void DisConnect(common::Error err);              // should be execute in network thread
+  // programmes intersecting [from, to), at most limit per channel (0 - all), should be execute in network thread
+  void RequestProgrammes(const std::vector<stream_id>& channels, timestamp_t from, timestamp_t to, size_t limit);
 
   virtual void PreLooped(common::libev::IoLoop* server) override;
   virtual void Accepted(common::libev::IoClient* client) override;
@@ -100,6 +106,14 @@ class InnerTcpHandler : public fastotv::inner::InnerServerCommandSeqParser, publ
                                                  char* argv[]) WARN_UNUSED_RESULT;
 
   common::Error ParserResponceResponceCommand(int argc, char* argv[], json_object** out) WARN_UNUSED_RESULT;
+  // parses get_channels answer with the configured json backend
+  common::Error UpdateChannelsCache(const std::string& data) WARN_UNUSED_RESULT;
+  // nothing is written if server doesn't serve get_programmes
+  common::Error WriteProgrammesRequest(fastotv::inner::InnerClient* connection,
+                                       const std::vector<stream_id>& channels,
+                                       timestamp_t from,
+                                       timestamp_t to,
+                                       size_t limit) WARN_UNUSED_RESULT;
 
   fastotv::inner::InnerClient* inner_connection_;
   std::vector<bandwidth::TcpBandwidthClient*> bandwidth_requests_;
@@ -108,6 +122,10 @@ class InnerTcpHandler : public fastotv::inner::InnerServerCommandSeqParser, publ
   const StartConfig config_;
 
   bandwidth_t current_bandwidth_;
+
+  // last received channels, survive reconnects so server can answer with delta
+  ChannelsInfo channels_cache_;
+  channels_version_t channels_version_;
 };
 
 }  // namespace inner
@@ -180,6 +180,17 @@ void IoService::RequesRuntimeChannelInfo(stream_id sid) const {
   }
 }
 
+void IoService::RequestProgrammes(const std::vector<stream_id>& channels,
+                                  timestamp_t from,
+                                  timestamp_t to,
+                                  size_t limit) const {
+  PrivateHandler* handler = static_cast<PrivateHandler*>(handler_);
+  if (handler) {
+    auto cb = [handler, channels, from, to, limit]() { handler->RequestProgrammes(channels, from, to, limit); };
+    ExecInLoopThread(cb);
+  }
+}
+
 void IoService::PostMessageToChat(const ChatMessage& msg) const {
   PrivateHandler* handler = static_cast<PrivateHandler*>(handler_);
   if (handler) {
@@ -19,6 +19,7 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 
 #include <common/libev/io_loop.h>           // for IoLoop
 #include <common/libev/io_loop_observer.h>  // for IoLoopObserver
@@ -51,6 +52,7 @@ class IoService : public common::libev::ILoopController {
   void RequestServerInfo() const;
   void RequestChannels() const;
   void RequesRuntimeChannelInfo(stream_id sid) const;
+  void RequestProgrammes(const std::vector<stream_id>& channels, timestamp_t from, timestamp_t to, size_t limit) const;
   void PostMessageToChat(const ChatMessage& msg) const;
 
  private:
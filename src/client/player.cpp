@@ -24,6 +24,7 @@
 #include <common/file_system/file_system.h>
 #include <common/file_system/string_path_utils.h>
 #include <common/threads/thread_manager.h>
+#include <common/time.h>
 #include <common/utils.h>
 
 #include <player/draw/surface_saver.h>
@@ -37,6 +38,8 @@
 #include "client/ioservice.h"  // for IoService
 #include "client/utils.h"
 
+#include "epg/epg_file.h"  // for EpgFile
+
 #include "client/chat_window.h"
 #include "client/programs_window.h"
 
@@ -49,10 +52,13 @@
 #define IMG_DOWN_BUTTON_PATH_RELATIVE "share/resources/down_arrow.png"
 
 #define CACHE_FOLDER_NAME "cache"
+#define GUIDE_FILE_NAME "guide.epg"  // optional programme guide in cache folder
 
 #define FOOTER_HIDE_DELAY_MSEC 2000  // 2 sec
 #define KEYPAD_HIDE_DELAY_MSEC 3000  // 3 sec
 
+#define PROGRAMMES_PAGE_MSEC 86400000  // programmes of current channel fetched ahead, 24 hours
+
 namespace fastotv {
 namespace client {
 
@@ -112,6 +118,7 @@ Player::Player(const std::string& app_directory_absolute_path,
   fApp->Subscribe(this, events::ClientConfigChangeEvent::EventType);
   fApp->Subscribe(this, events::ReceiveChannelsEvent::EventType);
   fApp->Subscribe(this, events::ReceiveRuntimeChannelEvent::EventType);
+  fApp->Subscribe(this, events::ReceiveProgrammesEvent::EventType);
   fApp->Subscribe(this, events::SendChatMessageEvent::EventType);
   fApp->Subscribe(this, events::ReceiveChatMessageEvent::EventType);
 
@@ -242,6 +249,9 @@ void Player::HandleEvent(event_t* event) {
   } else if (event->GetEventType() == events::ReceiveRuntimeChannelEvent::EventType) {
     events::ReceiveRuntimeChannelEvent* channel_event = static_cast<events::ReceiveRuntimeChannelEvent*>(event);
     HandleReceiveRuntimeChannelEvent(channel_event);
+  } else if (event->GetEventType() == events::ReceiveProgrammesEvent::EventType) {
+    events::ReceiveProgrammesEvent* programmes_event = static_cast<events::ReceiveProgrammesEvent*>(event);
+    HandleReceiveProgrammesEvent(programmes_event);
   } else if (event->GetEventType() == events::SendChatMessageEvent::EventType) {
     events::SendChatMessageEvent* chat_msg_event = static_cast<events::SendChatMessageEvent*>(event);
     HandleSendChatMessageEvent(chat_msg_event);
@@ -453,8 +463,23 @@ void Player::HandleReceiveChannelsEvent(events::ReceiveChannelsEvent* event) {
     }
   }
 
+  epg::EpgFile guide;
+  const std::string guide_path = common::file_system::make_path(cache_dir, GUIDE_FILE_NAME);
+  if (common::file_system::is_file_exist(guide_path)) {
+    common::Error err = guide.Open(guide_path);
+    if (err) {
+      DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_WARNING);
+    }
+  }
+  const timestamp_t now = common::time::current_mstime();
+
   for (const ChannelInfo& ch : channels) {
     PlaylistEntry entry = PlaylistEntry(cache_dir, ch);
+    if (guide.IsOpen()) {  // fills channels received without programmes until get_programmes answers
+      epg::EpgFile::programmes_t programmes;
+      guide.FindProgrammes(ch.GetId(), now, now + PROGRAMMES_PAGE_MSEC, 0, &programmes);
+      entry.AddProgrammes(programmes);
+    }
     const std::string icon_path = entry.GetIconPath();
     fastoplayer::draw::SurfaceSaver* surf = fastoplayer::draw::MakeSurfaceFromPath(icon_path);
     channel_icon_t shared_surface(surf);
@@ -558,6 +583,26 @@ void Player::HandleReceiveRuntimeChannelEvent(events::ReceiveRuntimeChannelEvent
   }
 }
 
+void Player::HandleReceiveProgrammesEvent(events::ReceiveProgrammesEvent* event) {
+  // programmes come grouped by channel
+  const ProgrammesInfo::programmes_t programmes = event->GetInfo().GetProgrammes();
+  for (size_t first = 0; first < programmes.size();) {
+    const stream_id sid = programmes[first].GetChannel();
+    size_t last = first + 1;
+    while (last < programmes.size() && programmes[last].GetChannel() == sid) {
+      ++last;
+    }
+
+    for (size_t i = 0; i < play_list_.size(); ++i) {
+      if (play_list_[i].GetChannelInfo().GetId() == sid) {
+        play_list_[i].AddProgrammes(EpgInfo::programs_t(programmes.begin() + first, programmes.begin() + last));
+        break;
+      }
+    }
+    first = last;
+  }
+}
+
 void Player::HandleSendChatMessageEvent(events::SendChatMessageEvent* event) {
   UNUSED(event);
 }
@@ -974,6 +1019,8 @@ fastoplayer::media::VideoState* Player::CreateStream(stream_id sid,
                                                      fastoplayer::media::AppOptions opt,
                                                      fastoplayer::media::ComplexOptions copt) {
   controller_->RequesRuntimeChannelInfo(sid);
+  const timestamp_t now = common::time::current_mstime();
+  controller_->RequestProgrammes(std::vector<stream_id>(1, sid), now, now + PROGRAMMES_PAGE_MSEC, 0);
   return base_class::CreateStream(sid, uri, opt, copt);
 }
 
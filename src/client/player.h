@@ -75,6 +75,7 @@ class Player : public fastoplayer::ISimplePlayer {
   virtual void HandleClientConfigChangeEvent(events::ClientConfigChangeEvent* event);
   virtual void HandleReceiveChannelsEvent(events::ReceiveChannelsEvent* event);
   virtual void HandleReceiveRuntimeChannelEvent(events::ReceiveRuntimeChannelEvent* event);
+  virtual void HandleReceiveProgrammesEvent(events::ReceiveProgrammesEvent* event);
   virtual void HandleSendChatMessageEvent(events::SendChatMessageEvent* event);
   virtual void HandleReceiveChatMessageEvent(events::ReceiveChatMessageEvent* event);
 
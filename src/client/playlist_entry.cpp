@@ -18,20 +18,31 @@
 
 #include "client/playlist_entry.h"
 
+#include <algorithm>  // for stable_sort
+#include <limits>     // for numeric_limits
+
 #include <common/file_system/string_path_utils.h>
 #include <common/time.h>
 
 #define IMG_UNKNOWN_CHANNEL_PATH_RELATIVE "share/resources/unknown_channel.png"
 
 #define ICON_FILE_NAME "icon"
+#define NO_PROGRAMME_TITLE "N/A"
 
 namespace fastotv {
 namespace client {
 
-PlaylistEntry::PlaylistEntry() : info_(), icon_(), cache_dir_() {}
+PlaylistEntry::PlaylistEntry()
+    : info_(), icon_(), cache_dir_(), current_checked_(0), current_until_(0), current_title_(NO_PROGRAMME_TITLE) {}
 
 PlaylistEntry::PlaylistEntry(const std::string& cache_root_dir, const ChannelInfo& info)
-    : info_(info), rinfo_(), icon_(), cache_dir_() {
+    : info_(info),
+      rinfo_(),
+      icon_(),
+      cache_dir_(),
+      current_checked_(0),
+      current_until_(0),
+      current_title_(NO_PROGRAMME_TITLE) {
   std::string id = info_.GetId();
   cache_dir_ = common::file_system::make_path(cache_root_dir, id);
 }
@@ -53,15 +64,12 @@ std::string PlaylistEntry::GetIconPath() const {
 }
 
 ChannelDescription PlaylistEntry::GetChannelDescription() const {
-  std::string decr = "N/A";
-  ChannelInfo url = GetChannelInfo();
-  EpgInfo epg = url.GetEpg();
-  ProgrammeInfo prog;
-  if (epg.FindProgrammeByTime(common::time::current_mstime(), &prog)) {
-    decr = prog.GetTitle();
+  const timestamp_t now = common::time::current_mstime();
+  if (now < current_checked_ || now >= current_until_) {
+    UpdateCurrentProgramme(now);
   }
 
-  return {url.GetName(), decr, GetIcon()};
+  return {info_.GetName(), current_title_, GetIcon()};
 }
 
 void PlaylistEntry::SetIcon(channel_icon_t icon) {
@@ -76,6 +84,53 @@ ChannelInfo PlaylistEntry::GetChannelInfo() const {
   return info_;
 }
 
+void PlaylistEntry::AddProgrammes(const EpgInfo::programs_t& programmes) {
+  if (programmes.empty()) {
+    return;
+  }
+
+  EpgInfo epg = info_.GetEpg();
+  const EpgInfo::programs_t current = epg.GetPrograms();  // sorted by start
+  EpgInfo::programs_t fresh = programmes;
+  std::stable_sort(fresh.begin(), fresh.end(), [](const ProgrammeInfo& lhs, const ProgrammeInfo& rhs) {
+    return lhs.GetStart() < rhs.GetStart();
+  });
+
+  EpgInfo::programs_t merged;
+  merged.reserve(current.size() + fresh.size());
+  size_t i = 0;
+  for (size_t j = 0; j < fresh.size(); ++j) {
+    if (j + 1 < fresh.size() && fresh[j + 1].GetStart() == fresh[j].GetStart()) {  // last one wins
+      continue;
+    }
+    for (; i < current.size() && current[i].GetStart() <= fresh[j].GetStart(); ++i) {
+      if (current[i].GetStart() != fresh[j].GetStart()) {  // fresh ones replace programmes with same start
+        merged.push_back(current[i]);
+      }
+    }
+    merged.push_back(fresh[j]);
+  }
+  merged.insert(merged.end(), current.begin() + i, current.end());
+
+  epg.SetPrograms(merged);
+  info_ = ChannelInfo(epg, info_.IsEnableAudio(), info_.IsEnableVideo());
+  ResetCurrentProgramme();
+}
+
+void PlaylistEntry::UpdateCurrentProgramme(timestamp_t now) const {
+  const EpgInfo& epg = info_.GetEpg();
+  ProgrammeInfo prog;
+  timestamp_t until = std::numeric_limits<timestamp_t>::max();
+  current_title_ = epg.FindProgrammeByTime(now, &prog, &until) ? prog.GetTitle() : NO_PROGRAMME_TITLE;
+  current_checked_ = now;
+  current_until_ = until;
+}
+
+void PlaylistEntry::ResetCurrentProgramme() {
+  current_checked_ = 0;
+  current_until_ = 0;
+}
+
 void PlaylistEntry::AddChatMessage(const ChatMessage& msg) {
   rinfo_.AddMessage(msg);
 }
@@ -47,6 +47,9 @@ class PlaylistEntry {
 
   ChannelInfo GetChannelInfo() const;
 
+  // programmes fetched by get_programmes, merged by start time
+  void AddProgrammes(const EpgInfo::programs_t& programmes);
+
   void AddChatMessage(const ChatMessage& msg);
 
   void SetRuntimeChannelInfo(const RuntimeChannelInfo& rinfo);
@@ -58,14 +61,23 @@ class PlaylistEntry {
   std::string GetCacheDir() const;
   std::string GetIconPath() const;
 
+  // called per visible row on every frame, epg is searched only when the current programme ends
   ChannelDescription GetChannelDescription() const;
 
  private:
+  void UpdateCurrentProgramme(timestamp_t now) const;
+  void ResetCurrentProgramme();
+
   ChannelInfo info_;
   RuntimeChannelInfo rinfo_;
 
   channel_icon_t icon_;
   std::string cache_dir_;
+
+  // current programme cursor, title is valid in [current_checked_, current_until_)
+  mutable timestamp_t current_checked_;
+  mutable timestamp_t current_until_;
+  mutable std::string current_title_;
 };
 
 }  // namespace client
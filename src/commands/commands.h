@@ -26,6 +26,7 @@
 #define CLIENT_GET_CHANNELS "get_channels"
 #define CLIENT_GET_RUNTIME_CHANNEL_INFO "get_runtime_channel_info"
 #define CLIENT_SEND_CHAT_MESSAGE "client_send_chat_message"
+#define CLIENT_GET_PROGRAMMES "get_programmes"
 
 // server commands
 #define SERVER_PING "server_ping"  // ping client
@@ -0,0 +1,450 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "epg/epg_file.h"
+
+#include <fcntl.h>     // for open, O_RDONLY
+#include <stdio.h>     // for FILE, fopen, fwrite, rename
+#include <string.h>    // for memcmp
+#include <sys/stat.h>  // for stat, fstat
+#if !defined(_WIN32)
+#include <sys/mman.h>  // for mmap, munmap
+#include <unistd.h>    // for close
+#endif
+
+#include <algorithm>   // for stable_sort, lower_bound, upper_bound
+#include <functional>  // for hash
+#include <limits>      // for numeric_limits
+
+#include <common/sprintf.h>  // for MemSPrintf
+
+#include "epg/xmltv_parser.h"  // for XmltvParser
+
+#define EPG_FILE_MAGIC "FEPG"
+#define EPG_FILE_VERSION 1
+#define EPG_FILE_BYTE_ORDER 0x01020304
+
+namespace fastotv {
+namespace epg {
+
+struct EpgFile::Header {
+  char magic[4];
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t channels_count;
+  uint32_t programmes_count;
+  uint32_t strings_size;
+  uint64_t source_size;
+  int64_t source_mtime;
+};
+
+struct EpgFile::ChannelRecord {
+  uint32_t id_offset;
+  uint32_t id_size;
+  uint32_t first_programme;
+  uint32_t programmes_count;
+};
+
+struct EpgFile::ProgrammeRecord {
+  int64_t start;
+  int64_t stop;
+  uint32_t title_offset;
+  uint32_t title_size;
+};
+
+EpgFile::EpgFile()
+    : map_(NULL),
+      map_size_(0),
+      buffer_(),
+      header_(NULL),
+      channels_(NULL),
+      programmes_(NULL),
+      strings_(NULL) {}
+
+EpgFile::~EpgFile() {
+  Close();
+}
+
+common::Error EpgFile::Open(const std::string& path) {
+  Close();
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0) {
+    return common::make_error(common::MemSPrintf("Can't open EPG file %s", path));
+  }
+  if (static_cast<uint64_t>(st.st_size) < sizeof(Header)) {
+    return common::make_error(common::MemSPrintf("Invalid EPG file %s", path));
+  }
+
+  const size_t size = st.st_size;
+#if defined(_WIN32)
+  FILE* file = fopen(path.c_str(), "rb");
+  if (!file) {
+    return common::make_error(common::MemSPrintf("Can't open EPG file %s", path));
+  }
+  buffer_.resize(size);
+  const size_t nread = fread(&buffer_[0], 1, size, file);
+  fclose(file);
+  if (nread != size) {
+    buffer_.clear();
+    return common::make_error(common::MemSPrintf("Can't read EPG file %s", path));
+  }
+  const char* data = buffer_.data();
+#else
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd == -1) {
+    return common::make_error(common::MemSPrintf("Can't open EPG file %s", path));
+  }
+  void* map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    return common::make_error(common::MemSPrintf("Can't map EPG file %s", path));
+  }
+  map_ = map;
+  map_size_ = size;
+  const char* data = static_cast<const char*>(map);
+#endif
+
+  const Header* header = reinterpret_cast<const Header*>(data);
+  const uint64_t tables_size = static_cast<uint64_t>(header->channels_count) * sizeof(ChannelRecord) +
+                               static_cast<uint64_t>(header->programmes_count) * sizeof(ProgrammeRecord);
+  if (memcmp(header->magic, EPG_FILE_MAGIC, sizeof(header->magic)) != 0 || header->version != EPG_FILE_VERSION ||
+      header->byte_order != EPG_FILE_BYTE_ORDER || sizeof(Header) + tables_size + header->strings_size != size) {
+    Close();
+    return common::make_error(common::MemSPrintf("Invalid EPG file %s", path));
+  }
+
+  const ChannelRecord* channels = reinterpret_cast<const ChannelRecord*>(data + sizeof(Header));
+  for (uint32_t i = 0; i < header->channels_count; ++i) {
+    const ChannelRecord& chan = channels[i];
+    if (static_cast<uint64_t>(chan.id_offset) + chan.id_size > header->strings_size ||
+        static_cast<uint64_t>(chan.first_programme) + chan.programmes_count > header->programmes_count) {
+      Close();
+      return common::make_error(common::MemSPrintf("Invalid EPG file %s", path));
+    }
+  }
+
+  header_ = header;
+  channels_ = channels;
+  programmes_ = reinterpret_cast<const ProgrammeRecord*>(channels + header->channels_count);
+  strings_ = reinterpret_cast<const char*>(programmes_ + header->programmes_count);
+  return common::Error();
+}
+
+void EpgFile::Close() {
+#if !defined(_WIN32)
+  if (map_) {
+    munmap(map_, map_size_);
+  }
+#endif
+  map_ = NULL;
+  map_size_ = 0;
+  buffer_.clear();
+  header_ = NULL;
+  channels_ = NULL;
+  programmes_ = NULL;
+  strings_ = NULL;
+}
+
+bool EpgFile::IsOpen() const {
+  return header_ != NULL;
+}
+
+size_t EpgFile::GetChannelsCount() const {
+  return header_ ? header_->channels_count : 0;
+}
+
+size_t EpgFile::GetProgrammesCount() const {
+  return header_ ? header_->programmes_count : 0;
+}
+
+uint64_t EpgFile::GetSourceSize() const {
+  return header_ ? header_->source_size : 0;
+}
+
+int64_t EpgFile::GetSourceMtime() const {
+  return header_ ? header_->source_mtime : 0;
+}
+
+stream_id EpgFile::GetChannelId(size_t index) const {
+  if (index >= GetChannelsCount()) {
+    return invalid_stream_id;
+  }
+
+  const ChannelRecord& chan = channels_[index];
+  return stream_id(strings_ + chan.id_offset, chan.id_size);
+}
+
+bool EpgFile::HasChannel(const stream_id& channel) const {
+  return FindChannel(channel) != NULL;
+}
+
+void EpgFile::FindProgrammes(const stream_id& channel,
+                             timestamp_t from,
+                             timestamp_t to,
+                             size_t limit,
+                             programmes_t* out) const {
+  if (!out || from >= to) {
+    return;
+  }
+
+  const ChannelRecord* chan = FindChannel(channel);
+  if (!chan) {
+    return;
+  }
+
+  const ProgrammeRecord* first = programmes_ + chan->first_programme;
+  const ProgrammeRecord* last = first + chan->programmes_count;
+  const ProgrammeRecord* lo = std::upper_bound(
+      first, last, from, [](timestamp_t value, const ProgrammeRecord& prog) { return value < prog.stop; });
+  const ProgrammeRecord* hi =
+      std::lower_bound(lo, last, to, [](const ProgrammeRecord& prog, timestamp_t value) { return prog.start < value; });
+  if (limit != 0 && static_cast<size_t>(hi - lo) > limit) {
+    hi = lo + limit;
+  }
+  for (const ProgrammeRecord* prog = lo; prog != hi; ++prog) {
+    if (static_cast<uint64_t>(prog->title_offset) + prog->title_size > header_->strings_size) {
+      continue;
+    }
+    out->push_back(
+        ProgrammeInfo(channel, prog->start, prog->stop, std::string(strings_ + prog->title_offset, prog->title_size)));
+  }
+}
+
+const EpgFile::ChannelRecord* EpgFile::FindChannel(const stream_id& channel) const {
+  if (!header_) {
+    return NULL;
+  }
+
+  const char* strings = strings_;
+  const ChannelRecord* last = channels_ + header_->channels_count;
+  const ChannelRecord* it =
+      std::lower_bound(channels_, last, channel, [strings](const ChannelRecord& chan, const stream_id& id) {
+        return id.compare(0, id.size(), strings + chan.id_offset, chan.id_size) > 0;
+      });
+  if (it == last || channel.compare(0, channel.size(), strings + it->id_offset, it->id_size) != 0) {
+    return NULL;
+  }
+  return it;
+}
+
+EpgFileWriter::EpgFileWriter()
+    : interned_(), strings_(), channels_(), programmes_count_(0), source_size_(0), source_mtime_(0) {}
+
+void EpgFileWriter::SetSource(uint64_t size, int64_t mtime) {
+  source_size_ = size;
+  source_mtime_ = mtime;
+}
+
+void EpgFileWriter::AddProgramme(const ProgrammeInfo& programme) {
+  const stream_id sid = programme.GetChannel();
+  if (sid == invalid_stream_id) {
+    return;
+  }
+
+  auto it = channels_.find(sid);
+  if (it == channels_.end()) {
+    it = channels_.insert(std::make_pair(sid, Channel())).first;
+    it->second.id_offset = Intern(sid);
+  }
+
+  const std::string title = programme.GetTitle();
+  Entry entry;
+  entry.start = programme.GetStart();
+  entry.stop = programme.GetStop();
+  entry.title_offset = Intern(title);
+  entry.title_size = static_cast<uint32_t>(title.size());
+  it->second.entries.push_back(entry);
+  programmes_count_++;
+}
+
+size_t EpgFileWriter::GetChannelsCount() const {
+  return channels_.size();
+}
+
+size_t EpgFileWriter::GetProgrammesCount() const {
+  return programmes_count_;
+}
+
+void EpgFileWriter::MergeHistory(const EpgFile& previous, timestamp_t keep_from) {
+  for (size_t i = 0; i < previous.GetChannelsCount(); ++i) {
+    const stream_id sid = previous.GetChannelId(i);
+    timestamp_t until = std::numeric_limits<timestamp_t>::max();
+    auto it = channels_.find(sid);
+    if (it != channels_.end()) {
+      for (const Entry& entry : it->second.entries) {
+        until = std::min(until, entry.start);
+      }
+    }
+
+    EpgFile::programmes_t kept;
+    previous.FindProgrammes(sid, keep_from, until, 0, &kept);
+    for (const ProgrammeInfo& prog : kept) {
+      AddProgramme(prog);
+    }
+  }
+}
+
+common::Error EpgFileWriter::Write(const std::string& path) const {
+  typedef EpgFile::ChannelRecord ChannelRecord;
+  typedef EpgFile::ProgrammeRecord ProgrammeRecord;
+
+  std::vector<ChannelRecord> channel_records;
+  std::vector<ProgrammeRecord> programme_records;
+  channel_records.reserve(channels_.size());
+  programme_records.reserve(programmes_count_);
+  for (const auto& chan : channels_) {  // ordered by id
+    std::vector<Entry> entries = chan.second.entries;
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const Entry& lhs, const Entry& rhs) { return lhs.start < rhs.start; });
+    ChannelRecord record;
+    record.id_offset = chan.second.id_offset;
+    record.id_size = static_cast<uint32_t>(chan.first.size());
+    record.first_programme = static_cast<uint32_t>(programme_records.size());
+    for (size_t i = 0; i < entries.size(); ++i) {
+      const Entry& entry = entries[i];
+      timestamp_t stop = entry.stop;
+      if (i + 1 < entries.size() && (stop == 0 || entries[i + 1].start < stop)) {
+        stop = entries[i + 1].start;
+      }
+      if (stop <= entry.start) {  // unknown, broken or replaced by the next one with same start
+        continue;
+      }
+
+      ProgrammeRecord prog;
+      prog.start = entry.start;
+      prog.stop = stop;
+      prog.title_offset = entry.title_offset;
+      prog.title_size = entry.title_size;
+      programme_records.push_back(prog);
+    }
+    record.programmes_count = static_cast<uint32_t>(programme_records.size() - record.first_programme);
+    if (record.programmes_count) {
+      channel_records.push_back(record);
+    }
+  }
+
+  if (strings_.size() > std::numeric_limits<uint32_t>::max() ||
+      programme_records.size() > std::numeric_limits<uint32_t>::max()) {
+    return common::make_error("EPG is too big");
+  }
+
+  EpgFile::Header header;
+  memcpy(header.magic, EPG_FILE_MAGIC, sizeof(header.magic));
+  header.version = EPG_FILE_VERSION;
+  header.byte_order = EPG_FILE_BYTE_ORDER;
+  header.channels_count = static_cast<uint32_t>(channel_records.size());
+  header.programmes_count = static_cast<uint32_t>(programme_records.size());
+  header.strings_size = static_cast<uint32_t>(strings_.size());
+  header.source_size = source_size_;
+  header.source_mtime = source_mtime_;
+
+  const std::string tmp_path = path + ".tmp";
+  FILE* file = fopen(tmp_path.c_str(), "wb");
+  if (!file) {
+    return common::make_error(common::MemSPrintf("Can't create EPG file %s", tmp_path));
+  }
+
+  bool written = fwrite(&header, sizeof(header), 1, file) == 1;
+  if (written && !channel_records.empty()) {
+    written = fwrite(channel_records.data(), sizeof(ChannelRecord), channel_records.size(), file) ==
+             channel_records.size();
+  }
+  if (written && !programme_records.empty()) {
+    written = fwrite(programme_records.data(), sizeof(ProgrammeRecord), programme_records.size(), file) ==
+             programme_records.size();
+  }
+  if (written && !strings_.empty()) {
+    written = fwrite(strings_.data(), 1, strings_.size(), file) == strings_.size();
+  }
+  written = fclose(file) == 0 && written;
+  if (!written) {
+    remove(tmp_path.c_str());
+    return common::make_error(common::MemSPrintf("Can't write EPG file %s", tmp_path));
+  }
+
+#if defined(_WIN32)
+  remove(path.c_str());
+#endif
+  if (rename(tmp_path.c_str(), path.c_str()) != 0) {  // opened mappings keep the old file
+    remove(tmp_path.c_str());
+    return common::make_error(common::MemSPrintf("Can't replace EPG file %s", path));
+  }
+  return common::Error();
+}
+
+uint32_t EpgFileWriter::Intern(const std::string& str) {
+  const size_t hash = std::hash<std::string>()(str);
+  auto range = interned_.equal_range(hash);
+  for (auto it = range.first; it != range.second; ++it) {
+    const Interned& interned = it->second;
+    if (interned.size == str.size() && strings_.compare(interned.offset, interned.size, str) == 0) {
+      return interned.offset;
+    }
+  }
+
+  const Interned interned = {static_cast<uint32_t>(strings_.size()), static_cast<uint32_t>(str.size())};
+  strings_ += str;
+  interned_.insert(std::make_pair(hash, interned));
+  return interned.offset;
+}
+
+common::Error IngestXmltv(const std::string& xmltv_path,
+                          const std::string& epg_path,
+                          timestamp_t keep_from,
+                          bool* updated) {
+  if (updated) {
+    *updated = false;
+  }
+
+  struct stat st;
+  if (stat(xmltv_path.c_str(), &st) != 0) {
+    return common::make_error(common::MemSPrintf("Can't open XMLTV file %s", xmltv_path));
+  }
+
+  EpgFile previous;
+  common::Error err = previous.Open(epg_path);  // missing or broken one is rebuilt from scratch
+  const bool has_previous = !err;
+  if (has_previous && previous.GetSourceSize() == static_cast<uint64_t>(st.st_size) &&
+      previous.GetSourceMtime() == static_cast<int64_t>(st.st_mtime)) {
+    return common::Error();
+  }
+
+  EpgFileWriter writer;
+  writer.SetSource(st.st_size, st.st_mtime);
+  XmltvParser parser([&writer](const ProgrammeInfo& programme) { writer.AddProgramme(programme); });
+  err = parser.ParseFile(xmltv_path);
+  if (err) {
+    return err;
+  }
+
+  if (has_previous) {
+    writer.MergeHistory(previous, keep_from);
+    previous.Close();
+  }
+  err = writer.Write(epg_path);
+  if (err) {
+    return err;
+  }
+
+  if (updated) {
+    *updated = true;
+  }
+  return common::Error();
+}
+
+}  // namespace epg
+}  // namespace fastotv
@@ -0,0 +1,144 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <stddef.h>  // for size_t
+#include <stdint.h>  // for uint32_t, uint64_t, int64_t
+
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <common/error.h>   // for Error
+#include <common/macros.h>  // for WARN_UNUSED_RESULT, DISALLOW_COPY_AND_ASSIGN
+
+#include "programmes_info.h"  // for ProgrammesInfo::programmes_t
+
+namespace fastotv {
+namespace epg {
+
+// Compact guide file: header, channel records sorted by id, programme records grouped by channel and sorted
+// by start, then one blob of interned channel ids and titles. Stops are cut at the next start, so a [from, to)
+// window is found by two binary searches right in the mapping; opening checks the channel table only.
+// Integers are in host byte order, a file of other order is rejected.
+class EpgFile {
+ public:
+  typedef ProgrammesInfo::programmes_t programmes_t;
+
+  EpgFile();
+  ~EpgFile();
+
+  common::Error Open(const std::string& path) WARN_UNUSED_RESULT;
+  void Close();
+  bool IsOpen() const;
+
+  size_t GetChannelsCount() const;
+  size_t GetProgrammesCount() const;
+  uint64_t GetSourceSize() const;  // of the xmltv guide the file is built from
+  int64_t GetSourceMtime() const;
+
+  stream_id GetChannelId(size_t index) const;
+  bool HasChannel(const stream_id& channel) const;
+  // programmes intersecting [from, to) ordered by start, at most limit (0 - all)
+  void FindProgrammes(const stream_id& channel,
+                      timestamp_t from,
+                      timestamp_t to,
+                      size_t limit,
+                      programmes_t* out) const;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(EpgFile);
+
+  friend class EpgFileWriter;  // shares records layout
+
+  struct Header;
+  struct ChannelRecord;
+  struct ProgrammeRecord;
+
+  const ChannelRecord* FindChannel(const stream_id& channel) const;
+
+  void* map_;
+  size_t map_size_;
+  std::string buffer_;  // file contents where mapping is not available
+  const Header* header_;
+  const ChannelRecord* channels_;
+  const ProgrammeRecord* programmes_;
+  const char* strings_;
+};
+
+// Collects programmes and writes them as EpgFile. Channel ids and titles are interned, one programme costs
+// a fixed size entry however often its title repeats. Programmes without stop last till the next one.
+class EpgFileWriter {
+ public:
+  EpgFileWriter();
+
+  void SetSource(uint64_t size, int64_t mtime);
+  void AddProgramme(const ProgrammeInfo& programme);
+
+  size_t GetChannelsCount() const;
+  size_t GetProgrammesCount() const;
+
+  // carries over programmes of previous file stopping after keep_from, which are not replaced by the added ones:
+  // all of channels missing now, programmes before the first added one of others
+  void MergeHistory(const EpgFile& previous, timestamp_t keep_from);
+
+  common::Error Write(const std::string& path) const WARN_UNUSED_RESULT;  // replaces path atomically
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(EpgFileWriter);
+
+  struct Entry {
+    timestamp_t start;
+    timestamp_t stop;
+    uint32_t title_offset;
+    uint32_t title_size;
+  };
+  struct Channel {
+    Channel() : id_offset(0), entries() {}
+
+    uint32_t id_offset;
+    std::vector<Entry> entries;
+  };
+
+  struct Interned {
+    uint32_t offset;  // in strings_
+    uint32_t size;
+  };
+  // hash of string to its place in strings_, text is kept only there
+  typedef std::unordered_multimap<size_t, Interned> interned_t;
+
+  uint32_t Intern(const std::string& str);
+
+  interned_t interned_;
+  std::string strings_;
+  std::map<stream_id, Channel> channels_;
+  size_t programmes_count_;
+  uint64_t source_size_;
+  int64_t source_mtime_;
+};
+
+// Rebuilds epg_path from the xmltv guide, unless it is built from the same guide already (same size and mtime).
+// History of the previous file since keep_from is preserved. updated can be NULL.
+common::Error IngestXmltv(const std::string& xmltv_path,
+                          const std::string& epg_path,
+                          timestamp_t keep_from,
+                          bool* updated) WARN_UNUSED_RESULT;
+
+}  // namespace epg
+}  // namespace fastotv
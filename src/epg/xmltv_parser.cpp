@@ -0,0 +1,421 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "epg/xmltv_parser.h"
+
+#include <stdint.h>  // for uint32_t
+#include <stdio.h>   // for FILE, fopen, fread
+#include <stdlib.h>  // for strtoul
+#include <string.h>  // for memchr
+
+#include <common/sprintf.h>  // for MemSPrintf
+
+#define XMLTV_PROGRAMME_TAG "programme"
+#define XMLTV_TITLE_TAG "title"
+#define XMLTV_CHANNEL_ATTRIBUTE "channel"
+#define XMLTV_START_ATTRIBUTE "start"
+#define XMLTV_STOP_ATTRIBUTE "stop"
+
+#define XML_WHITESPACES " \t\r\n"
+
+namespace fastotv {
+namespace epg {
+namespace {
+
+bool tag_name_is(const std::string& tag, size_t begin, size_t end, const char* name) {
+  return tag.compare(begin, end - begin, name) == 0;
+}
+
+// days since 1970-01-01 of proleptic gregorian date
+int64_t days_from_civil(int64_t y, unsigned m, unsigned d) {
+  y -= m <= 2;
+  const int64_t era = (y >= 0 ? y : y - 399) / 400;
+  const unsigned yoe = static_cast<unsigned>(y - era * 400);
+  const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+bool read_digits(const char** pos, const char* end, size_t count, unsigned* out) {
+  unsigned value = 0;
+  for (size_t i = 0; i < count; ++i) {
+    const char* cur = *pos + i;
+    if (cur >= end || *cur < '0' || *cur > '9') {
+      return false;
+    }
+    value = value * 10 + static_cast<unsigned>(*cur - '0');
+  }
+  *pos += count;
+  *out = value;
+  return true;
+}
+
+void append_utf8(uint32_t code, std::string* out) {
+  if (code < 0x80) {
+    *out += static_cast<char>(code);
+  } else if (code < 0x800) {
+    *out += static_cast<char>(0xC0 | (code >> 6));
+    *out += static_cast<char>(0x80 | (code & 0x3F));
+  } else if (code < 0x10000) {
+    *out += static_cast<char>(0xE0 | (code >> 12));
+    *out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+    *out += static_cast<char>(0x80 | (code & 0x3F));
+  } else {
+    *out += static_cast<char>(0xF0 | (code >> 18));
+    *out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+    *out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+    *out += static_cast<char>(0x80 | (code & 0x3F));
+  }
+}
+
+bool decode_entity(const std::string& entity, std::string* out) {
+  if (entity == "amp") {
+    *out += '&';
+  } else if (entity == "lt") {
+    *out += '<';
+  } else if (entity == "gt") {
+    *out += '>';
+  } else if (entity == "quot") {
+    *out += '"';
+  } else if (entity == "apos") {
+    *out += '\'';
+  } else if (entity.size() > 1 && entity[0] == '#') {
+    const bool hex = entity[1] == 'x' || entity[1] == 'X';
+    const char* digits = entity.c_str() + (hex ? 2 : 1);
+    char* digits_end = NULL;
+    const unsigned long code = strtoul(digits, &digits_end, hex ? 16 : 10);
+    if (digits_end == digits || *digits_end != 0 || code == 0 || code > 0x10FFFF ||
+        (code >= 0xD800 && code <= 0xDFFF)) {
+      return false;
+    }
+    append_utf8(static_cast<uint32_t>(code), out);
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// unknown or broken references are left as is
+std::string decode_entities(const std::string& text) {
+  if (text.find('&') == std::string::npos) {
+    return text;
+  }
+
+  static const size_t max_entity_size = 10;
+  std::string decoded;
+  decoded.reserve(text.size());
+  for (size_t i = 0; i < text.size(); ++i) {
+    if (text[i] != '&') {
+      decoded += text[i];
+      continue;
+    }
+
+    const size_t semicolon = text.find(';', i + 1);
+    if (semicolon == std::string::npos || semicolon - i - 1 > max_entity_size ||
+        !decode_entity(text.substr(i + 1, semicolon - i - 1), &decoded)) {
+      decoded += '&';
+      continue;
+    }
+    i = semicolon;
+  }
+  return decoded;
+}
+
+}  // namespace
+
+XmltvParser::XmltvParser(programme_callback_t callback)
+    : callback_(callback),
+      state_(STATE_TEXT),
+      tag_(),
+      quote_(0),
+      raw_text_(),
+      tail_(),
+      in_programme_(false),
+      in_title_(false),
+      has_title_(false),
+      programme_(),
+      valid_start_(false),
+      programmes_count_(0),
+      skipped_count_(0) {}
+
+common::Error XmltvParser::Feed(const char* data, size_t size) {
+  if (!data && size) {
+    return common::make_error_inval();
+  }
+
+  const char* pos = data;
+  const char* end = data + size;
+  while (pos < end) {
+    if (state_ == STATE_TEXT) {
+      const char* open = static_cast<const char*>(memchr(pos, '<', end - pos));
+      const char* text_end = open ? open : end;
+      if (in_title_) {
+        AppendTitle(pos, text_end - pos, false);
+      }
+      if (!open) {
+        break;
+      }
+      pos = open + 1;
+      state_ = STATE_TAG;
+      tag_.clear();
+      quote_ = 0;
+    } else if (state_ == STATE_TAG) {
+      for (; pos < end && state_ == STATE_TAG; ++pos) {
+        const char c = *pos;
+        if (quote_) {
+          if (c == quote_) {
+            quote_ = 0;
+          }
+        } else if (c == '"' || c == '\'') {
+          quote_ = c;
+        } else if (c == '>') {
+          state_ = STATE_TEXT;
+          common::Error err = HandleTag();
+          if (err) {
+            return err;
+          }
+          continue;
+        }
+
+        tag_ += c;
+        if (tag_.size() > max_tag_size) {
+          return common::make_error(common::MemSPrintf("XMLTV tag is longer than %d bytes", max_tag_size));
+        }
+        if (tag_.size() == 3 && tag_ == "!--") {
+          state_ = STATE_COMMENT;
+          tail_.clear();
+        } else if (tag_.size() == 8 && tag_ == "![CDATA[") {
+          state_ = STATE_CDATA;
+          tail_.clear();
+        }
+      }
+    } else if (state_ == STATE_COMMENT) {
+      for (; pos < end && state_ == STATE_COMMENT; ++pos) {
+        const char c = *pos;
+        if (c == '>' && tail_.size() >= 2) {
+          state_ = STATE_TEXT;
+        } else if (c == '-') {
+          if (tail_.size() < 2) {
+            tail_ += c;
+          }
+        } else {
+          tail_.clear();
+        }
+      }
+    } else {  // STATE_CDATA, closing "]]" is held in tail_ until it is clear whether '>' follows
+      for (; pos < end && state_ == STATE_CDATA; ++pos) {
+        const char c = *pos;
+        if (c == '>' && tail_.size() == 2) {
+          state_ = STATE_TEXT;
+        } else if (c == ']') {
+          tail_ += c;
+          if (tail_.size() > 2) {
+            AppendTitle(tail_.data(), 1, true);
+            tail_.erase(0, 1);
+          }
+        } else {
+          AppendTitle(tail_.data(), tail_.size(), true);
+          AppendTitle(&c, 1, true);
+          tail_.clear();
+        }
+      }
+    }
+  }
+  return common::Error();
+}
+
+common::Error XmltvParser::Finish() {
+  if (state_ != STATE_TEXT || in_programme_) {
+    return common::make_error("Unexpected end of XMLTV document");
+  }
+  return common::Error();
+}
+
+common::Error XmltvParser::ParseFile(const std::string& path) {
+  FILE* file = fopen(path.c_str(), "rb");
+  if (!file) {
+    return common::make_error(common::MemSPrintf("Can't open XMLTV file %s", path));
+  }
+
+  std::string buffer(read_chunk_size, 0);
+  common::Error err;
+  while (!err) {
+    const size_t nread = fread(&buffer[0], 1, buffer.size(), file);
+    if (nread == 0) {
+      if (ferror(file)) {
+        err = common::make_error(common::MemSPrintf("Can't read XMLTV file %s", path));
+      }
+      break;
+    }
+    err = Feed(buffer.data(), nread);
+  }
+  fclose(file);
+  if (err) {
+    return err;
+  }
+  return Finish();
+}
+
+size_t XmltvParser::GetProgrammesCount() const {
+  return programmes_count_;
+}
+
+size_t XmltvParser::GetSkippedCount() const {
+  return skipped_count_;
+}
+
+bool XmltvParser::ParseTime(const std::string& time, timestamp_t* out) {
+  if (!out) {
+    return false;
+  }
+
+  const char* pos = time.c_str();
+  const char* end = pos + time.size();
+  unsigned year, month, day, hour = 0, minute = 0, second = 0;
+  if (!read_digits(&pos, end, 4, &year) || !read_digits(&pos, end, 2, &month) || !read_digits(&pos, end, 2, &day)) {
+    return false;
+  }
+  if (read_digits(&pos, end, 2, &hour) && read_digits(&pos, end, 2, &minute)) {
+    read_digits(&pos, end, 2, &second);
+  }
+  if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60) {
+    return false;
+  }
+
+  while (pos < end && *pos == ' ') {
+    pos++;
+  }
+  int64_t offset_sec = 0;
+  if (pos < end && (*pos == '+' || *pos == '-')) {
+    const bool negative = *pos == '-';
+    pos++;
+    unsigned offset_hour, offset_minute;
+    if (!read_digits(&pos, end, 2, &offset_hour) || !read_digits(&pos, end, 2, &offset_minute)) {
+      return false;
+    }
+    offset_sec = static_cast<int64_t>(offset_hour * 3600 + offset_minute * 60);
+    if (negative) {
+      offset_sec = -offset_sec;
+    }
+  }
+  if (pos != end) {
+    return false;
+  }
+
+  const int64_t utc_sec = days_from_civil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second - offset_sec;
+  *out = utc_sec * 1000;
+  return true;
+}
+
+common::Error XmltvParser::HandleTag() {
+  if (tag_.empty() || tag_[0] == '?' || tag_[0] == '!') {  // declarations
+    return common::Error();
+  }
+
+  const bool closing = tag_[0] == '/';
+  const size_t name_begin = closing ? 1 : 0;
+  size_t name_end = tag_.find_first_of(XML_WHITESPACES "/", name_begin);
+  if (name_end == std::string::npos) {
+    name_end = tag_.size();
+  }
+
+  if (closing) {
+    if (in_title_ && tag_name_is(tag_, name_begin, name_end, XMLTV_TITLE_TAG)) {
+      programme_.SetTitle(decode_entities(raw_text_));
+      raw_text_.clear();
+      in_title_ = false;
+      has_title_ = true;
+    } else if (in_programme_ && tag_name_is(tag_, name_begin, name_end, XMLTV_PROGRAMME_TAG)) {
+      EmitProgramme();
+    }
+    return common::Error();
+  }
+
+  const bool self_closing = tag_[tag_.size() - 1] == '/';
+  if (tag_name_is(tag_, name_begin, name_end, XMLTV_PROGRAMME_TAG)) {
+    if (in_programme_) {  // previous one is not closed
+      EmitProgramme();
+    }
+
+    programme_ = ProgrammeInfo();
+    valid_start_ = false;
+    has_title_ = false;
+    in_title_ = false;
+    raw_text_.clear();
+    in_programme_ = true;
+    size_t pos = name_end;
+    while (true) {
+      pos = tag_.find_first_not_of(XML_WHITESPACES "/", pos);
+      const size_t eq = pos == std::string::npos ? pos : tag_.find('=', pos);
+      const size_t quote = eq == std::string::npos ? eq : tag_.find_first_of("\"'", eq + 1);
+      const size_t quote_end = quote == std::string::npos ? quote : tag_.find(tag_[quote], quote + 1);
+      if (quote_end == std::string::npos) {
+        break;
+      }
+
+      const size_t attr_end = tag_.find_last_not_of(XML_WHITESPACES, eq - 1) + 1;
+      const std::string value = decode_entities(tag_.substr(quote + 1, quote_end - quote - 1));
+      timestamp_t time;
+      if (tag_name_is(tag_, pos, attr_end, XMLTV_CHANNEL_ATTRIBUTE)) {
+        programme_.SetChannel(value);
+      } else if (tag_name_is(tag_, pos, attr_end, XMLTV_START_ATTRIBUTE)) {
+        valid_start_ = ParseTime(value, &time);
+        programme_.SetStart(valid_start_ ? time : 0);
+      } else if (tag_name_is(tag_, pos, attr_end, XMLTV_STOP_ATTRIBUTE)) {
+        programme_.SetStop(ParseTime(value, &time) ? time : 0);
+      }
+      pos = quote_end + 1;
+    }
+    if (self_closing) {
+      EmitProgramme();
+    }
+  } else if (in_programme_ && !has_title_ && !in_title_ && tag_name_is(tag_, name_begin, name_end, XMLTV_TITLE_TAG)) {
+    in_title_ = !self_closing;
+    has_title_ = self_closing;
+    raw_text_.clear();
+  }
+  return common::Error();
+}
+
+void XmltvParser::AppendTitle(const char* data, size_t size, bool cdata) {
+  if (!in_title_) {
+    return;
+  }
+
+  for (size_t i = 0; i < size && raw_text_.size() < max_title_size; ++i) {
+    if (cdata && data[i] == '&') {  // raw_text_ is decoded as a whole later
+      raw_text_ += "&amp;";
+    } else {
+      raw_text_ += data[i];
+    }
+  }
+}
+
+void XmltvParser::EmitProgramme() {
+  in_programme_ = false;
+  in_title_ = false;
+  if (!valid_start_ || !programme_.IsValid()) {
+    skipped_count_++;
+    return;
+  }
+
+  programmes_count_++;
+  callback_(programme_);
+}
+
+}  // namespace epg
+}  // namespace fastotv
@@ -0,0 +1,79 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <stddef.h>  // for size_t
+
+#include <functional>  // for function
+#include <string>
+
+#include <common/error.h>   // for Error
+#include <common/macros.h>  // for WARN_UNUSED_RESULT
+
+#include "programme_info.h"  // for ProgrammeInfo
+
+namespace fastotv {
+namespace epg {
+
+// Push parser for XMLTV guides: text is fed in chunks of any size and every complete <programme> with
+// a title is passed to the callback, nothing else of the document is kept, so memory does not grow with the guide.
+// Only what ProgrammeInfo holds is read: channel, start, stop (0 if absent) and the first <title>.
+// Times are converted to utc msec. Oversized tags fail the parse, oversized titles are truncated.
+class XmltvParser {
+ public:
+  enum { max_tag_size = 64 * 1024, max_title_size = 4 * 1024, read_chunk_size = 64 * 1024 };
+  typedef std::function<void(const ProgrammeInfo& programme)> programme_callback_t;
+
+  explicit XmltvParser(programme_callback_t callback);
+
+  common::Error Feed(const char* data, size_t size) WARN_UNUSED_RESULT;
+  common::Error Finish() WARN_UNUSED_RESULT;  // document must not end inside a tag or programme
+  common::Error ParseFile(const std::string& path) WARN_UNUSED_RESULT;  // Feed file by chunks then Finish
+
+  size_t GetProgrammesCount() const;
+  size_t GetSkippedCount() const;  // programmes without channel, valid start or title
+
+  // "20170613010000 +0000", trailing fields and zone may be omitted
+  static bool ParseTime(const std::string& time, timestamp_t* out);
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(XmltvParser);
+
+  enum State { STATE_TEXT, STATE_TAG, STATE_COMMENT, STATE_CDATA };
+
+  common::Error HandleTag() WARN_UNUSED_RESULT;
+  void AppendTitle(const char* data, size_t size, bool cdata);  // cdata text is escaped for decoding
+  void EmitProgramme();
+
+  const programme_callback_t callback_;
+  State state_;
+  std::string tag_;       // markup between '<' and '>'
+  char quote_;            // inside attribute value of tag_
+  std::string raw_text_;  // title text not decoded yet
+  std::string tail_;      // last characters of comment or cdata to find its end
+  bool in_programme_;
+  bool in_title_;
+  bool has_title_;
+  ProgrammeInfo programme_;
+  bool valid_start_;
+  size_t programmes_count_;
+  size_t skipped_count_;
+};
+
+}  // namespace epg
+}  // namespace fastotv
@@ -18,6 +18,11 @@
 
 #include "epg_info.h"
 
+#include <algorithm>  // for is_sorted, stable_sort, upper_bound
+#include <limits>     // for numeric_limits
+
+#include "serializer/json_reader.h"
+
 /*
 <channel id="id">
   <display-name lang="ru"></display-name>
@@ -34,6 +39,54 @@
 
 namespace fastotv {
 
+namespace {
+
+bool programme_start_less(const ProgrammeInfo& lhs, const ProgrammeInfo& rhs) {
+  return lhs.GetStart() < rhs.GetStart();
+}
+
+void sort_programs(EpgInfo::programs_t* progs) {
+  if (!std::is_sorted(progs->begin(), progs->end(), programme_start_less)) {
+    std::stable_sort(progs->begin(), progs->end(), programme_start_less);
+  }
+}
+
+// invalid programmes are skipped like in json-c backend
+common::Error read_programs(JsonReader* reader, EpgInfo::programs_t* progs) {
+  common::Error err = reader->EnterArray();
+  if (err) {
+    progs->clear();
+    return reader->IsFailed() ? err : common::Error();
+  }
+
+  EpgInfo::programs_t lprogs;
+  bool has_next = false;
+  while (true) {
+    err = reader->NextElement(&has_next);
+    if (err) {
+      return err;
+    }
+    if (!has_next) {
+      break;
+    }
+
+    ProgrammeInfo prog;
+    err = ProgrammeInfo::DeSerialize(reader, &prog);
+    if (err) {
+      if (reader->IsFailed()) {
+        return err;
+      }
+      continue;
+    }
+    lprogs.push_back(prog);
+  }
+
+  progs->swap(lprogs);
+  return common::Error();
+}
+
+}  // namespace
+
 EpgInfo::EpgInfo()
     : channel_id_(invalid_stream_id), uri_(), display_name_(), icon_src_(GetUnknownIconUrl()), programs_() {}
 
@@ -44,20 +97,32 @@ bool EpgInfo::IsValid() const {
   return channel_id_ != invalid_stream_id && uri_.IsValid() && !display_name_.empty();
 }
 
-bool EpgInfo::FindProgrammeByTime(timestamp_t time, ProgrammeInfo* inf) const {
+bool EpgInfo::FindProgrammeByTime(timestamp_t time, ProgrammeInfo* inf, timestamp_t* valid_until) const {
   if (!inf || !IsValid()) {
     return false;
   }
 
-  for (size_t i = 0; i < programs_.size(); ++i) {
-    ProgrammeInfo pr = programs_[i];
-    if (time >= pr.GetStart() && time <= pr.GetStop()) {
-      *inf = pr;
-      return true;
+  programs_t::const_iterator next = std::upper_bound(
+      programs_.begin(), programs_.end(), time, [](timestamp_t value, const ProgrammeInfo& prog) {
+        return value < prog.GetStart();
+      });
+  timestamp_t until = next == programs_.end() ? std::numeric_limits<timestamp_t>::max() : next->GetStart();
+  bool found = false;
+  // previous one has usually not ended yet, earlier ones are checked when it has, they can enclose it
+  for (programs_t::const_iterator it = next; it != programs_.begin();) {
+    const ProgrammeInfo& prog = *(--it);
+    if (time < prog.GetStop()) {
+      *inf = prog;
+      found = true;
+      until = std::min(until, prog.GetStop());
+      break;
     }
   }
 
-  return false;
+  if (valid_until) {
+    *valid_until = until;
+  }
+  return found;
 }
 
 void EpgInfo::SetUrl(const common::uri::Url& url) {
@@ -90,9 +155,10 @@ void EpgInfo::SetIconUrl(const common::uri::Url& url) {
 
 void EpgInfo::SetPrograms(const programs_t& progs) {
   programs_ = progs;
+  sort_programs(&programs_);
 }
 
-EpgInfo::programs_t EpgInfo::GetPrograms() const {
+const EpgInfo::programs_t& EpgInfo::GetPrograms() const {
   return programs_;
 }
 
@@ -187,9 +253,82 @@ common::Error EpgInfo::DeSerialize(const serialize_type& serialized, EpgInfo* ob
       }
       progs.push_back(prog);
     }
-    url.programs_ = progs;
+    sort_programs(&progs);
+    url.programs_.swap(progs);
+  }
+
+  *obj = url;
+  return common::Error();
+}
+
+common::Error EpgInfo::DeSerialize(JsonReader* reader, EpgInfo* obj) {
+  if (!reader || !obj) {
+    return common::make_error_inval();
+  }
+
+  common::Error err = reader->EnterObject();
+  if (err) {
+    return err;
+  }
+
+  stream_id id;
+  std::string url_str;
+  std::string name;
+  std::string icon_str;
+  programs_t progs;
+  bool id_exists = false, url_exists = false, name_exists = false, icon_exists = false;
+  std::string key;
+  bool has_next = false;
+  while (true) {
+    err = reader->NextField(&key, &has_next);
+    if (err) {
+      return err;
+    }
+    if (!has_next) {
+      break;
+    }
+
+    if (key == EPG_INFO_ID_FIELD) {
+      id_exists = true;
+      err = reader->ReadString(&id);
+    } else if (key == EPG_INFO_URL_FIELD) {
+      url_exists = true;
+      err = reader->ReadString(&url_str);
+    } else if (key == EPG_INFO_NAME_FIELD) {
+      name_exists = true;
+      err = reader->ReadString(&name);
+    } else if (key == EPG_INFO_ICON_FIELD) {
+      icon_exists = true;
+      err = reader->ReadString(&icon_str);
+    } else if (key == EPG_INFO_PROGRAMS_FIELD) {
+      err = read_programs(reader, &progs);
+    } else {
+      err = reader->SkipValue();
+    }
+    if (err) {
+      return err;
+    }
+  }
+
+  if (!id_exists || !url_exists || !name_exists || id == invalid_stream_id || name.empty()) {
+    return common::make_error_inval();
+  }
+
+  common::uri::Url uri(url_str);
+  if (!uri.IsValid()) {
+    return common::make_error_inval();
   }
 
+  fastotv::EpgInfo url(id, uri, name);
+  if (!url.IsValid()) {
+    return common::make_error_inval();
+  }
+
+  if (icon_exists) {
+    url.icon_src_ = common::uri::Url(icon_str);
+  }
+  sort_programs(&progs);
+  url.programs_.swap(progs);
   *obj = url;
   return common::Error();
 }
@@ -32,7 +32,10 @@ class EpgInfo : public JsonSerializerEx {
   EpgInfo(stream_id id, const common::uri::Url& uri, const std::string& name);  // required args
 
   bool IsValid() const;
-  bool FindProgrammeByTime(timestamp_t time, ProgrammeInfo* inf) const;
+  // programme going at time, [start, stop), by binary search over programmes sorted by start, the latest started
+  // one wins, so a programme nested in a longer one is found while it lasts and the enclosing one after it;
+  // valid_until gets the time the answer changes at: stop of found one or start of the next one
+  bool FindProgrammeByTime(timestamp_t time, ProgrammeInfo* inf, timestamp_t* valid_until = NULL) const;
 
   void SetUrl(const common::uri::Url& url);
   common::uri::Url GetUrl() const;
@@ -46,10 +49,11 @@ class EpgInfo : public JsonSerializerEx {
   void SetIconUrl(const common::uri::Url& url);
   common::uri::Url GetIconUrl() const;
 
-  void SetPrograms(const programs_t& progs);
-  programs_t GetPrograms() const;
+  void SetPrograms(const programs_t& progs);  // kept sorted by start
+  const programs_t& GetPrograms() const;
 
   static common::Error DeSerialize(const serialize_type& serialized, EpgInfo* obj) WARN_UNUSED_RESULT;
+  static common::Error DeSerialize(JsonReader* reader, EpgInfo* obj) WARN_UNUSED_RESULT;
 
   bool Equals(const EpgInfo& url) const;
 
@@ -0,0 +1,411 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "inner/binary_commands.h"
+
+#include <string.h>  // for memcpy
+
+#include <common/sys_byteorder.h>
+
+namespace fastotv {
+namespace inner {
+
+namespace {
+
+void write_header(BinaryWriter* writer,
+                  common::protocols::three_way_handshake::cmd_id_t seq,
+                  common::protocols::three_way_handshake::cmd_seq_t id,
+                  uint8_t argc) {
+  writer->WriteU8(binary_command_marker);
+  writer->WriteU8(seq);
+  writer->WriteString(id);
+  writer->WriteU8(argc);
+}
+
+void write_chat_message(BinaryWriter* writer, const ChatMessage& msg) {
+  writer->WriteString(msg.GetChannelId());
+  writer->WriteString(msg.GetLogin());
+  writer->WriteString(msg.GetMessage());
+  writer->WriteU8(msg.GetType());
+}
+
+bool read_chat_message(BinaryReader* reader, ChatMessage* msg) {
+  std::string channel;
+  login_t login;
+  std::string message;
+  uint8_t type;
+  if (!reader->ReadString(&channel) || !reader->ReadString(&login) || !reader->ReadString(&message) ||
+      !reader->ReadU8(&type)) {
+    return false;
+  }
+
+  if (type > ChatMessage::MESSAGE) {
+    return false;
+  }
+
+  *msg = ChatMessage(channel, login, message, static_cast<ChatMessage::Type>(type));
+  return true;
+}
+
+}  // namespace
+
+bool IsBinaryEncoded(const std::string& data) {
+  return !data.empty() && static_cast<uint8_t>(data[0]) == binary_command_marker;
+}
+
+BinaryWriter::BinaryWriter(std::string* out) : out_(out) {}
+
+void BinaryWriter::WriteU8(uint8_t value) {
+  out_->push_back(static_cast<char>(value));
+}
+
+void BinaryWriter::WriteU32(uint32_t value) {
+  const uint32_t stabled = common::HostToNet32(value);
+  out_->append(reinterpret_cast<const char*>(&stabled), sizeof(stabled));
+}
+
+void BinaryWriter::WriteU64(uint64_t value) {
+  const uint64_t stabled = common::HostToNet64(value);
+  out_->append(reinterpret_cast<const char*>(&stabled), sizeof(stabled));
+}
+
+void BinaryWriter::WriteString(const std::string& value) {
+  WriteU32(value.size());
+  out_->append(value);
+}
+
+BinaryReader::BinaryReader(const char* data, size_t size) : data_(data), size_(size), pos_(0) {}
+
+bool BinaryReader::ReadU8(uint8_t* value) {
+  if (size_ - pos_ < sizeof(uint8_t)) {
+    return false;
+  }
+
+  *value = static_cast<uint8_t>(data_[pos_]);
+  pos_ += sizeof(uint8_t);
+  return true;
+}
+
+bool BinaryReader::ReadU32(uint32_t* value) {
+  if (size_ - pos_ < sizeof(uint32_t)) {
+    return false;
+  }
+
+  uint32_t stabled;
+  memcpy(&stabled, data_ + pos_, sizeof(uint32_t));
+  *value = common::NetToHost32(stabled);
+  pos_ += sizeof(uint32_t);
+  return true;
+}
+
+bool BinaryReader::ReadU64(uint64_t* value) {
+  if (size_ - pos_ < sizeof(uint64_t)) {
+    return false;
+  }
+
+  uint64_t stabled;
+  memcpy(&stabled, data_ + pos_, sizeof(uint64_t));
+  *value = common::NetToHost64(stabled);
+  pos_ += sizeof(uint64_t);
+  return true;
+}
+
+bool BinaryReader::ReadString(std::string* value) {
+  const char* data = NULL;
+  size_t size = 0;
+  if (!ReadSlice(&data, &size)) {
+    return false;
+  }
+
+  value->assign(data, size);
+  return true;
+}
+
+bool BinaryReader::ReadSlice(const char** data, size_t* size) {
+  uint32_t len;
+  if (!ReadU32(&len)) {
+    return false;
+  }
+
+  if (size_ - pos_ < len) {
+    return false;
+  }
+
+  *data = data_ + pos_;
+  *size = len;
+  pos_ += len;
+  return true;
+}
+
+bool BinaryReader::IsEnd() const {
+  return pos_ == size_;
+}
+
+common::protocols::three_way_handshake::cmd_request_t MakeBinaryRequest(
+    common::protocols::three_way_handshake::cmd_seq_t id,
+    const std::string& command) {
+  std::string data;
+  BinaryWriter writer(&data);
+  write_header(&writer, REQUEST_COMMAND, id, 1);
+  writer.WriteString(command);
+  return common::protocols::three_way_handshake::cmd_request_t(id, data);
+}
+
+common::protocols::three_way_handshake::cmd_request_t MakeBinaryRequest(
+    common::protocols::three_way_handshake::cmd_seq_t id,
+    const std::string& command,
+    const std::string& arg) {
+  std::string data;
+  BinaryWriter writer(&data);
+  write_header(&writer, REQUEST_COMMAND, id, 2);
+  writer.WriteString(command);
+  writer.WriteString(arg);
+  return common::protocols::three_way_handshake::cmd_request_t(id, data);
+}
+
+common::protocols::three_way_handshake::cmd_responce_t MakeBinaryResponce(
+    common::protocols::three_way_handshake::cmd_seq_t id,
+    const std::string& state,
+    const std::string& command,
+    const std::string& arg) {
+  std::string data;
+  BinaryWriter writer(&data);
+  write_header(&writer, RESPONCE_COMMAND, id, 3);
+  writer.WriteString(state);
+  writer.WriteString(command);
+  writer.WriteString(arg);
+  return common::protocols::three_way_handshake::cmd_responce_t(id, data);
+}
+
+common::protocols::three_way_handshake::cmd_approve_t MakeBinaryApprove(
+    common::protocols::three_way_handshake::cmd_seq_t id,
+    const std::string& state,
+    const std::string& command) {
+  std::string data;
+  BinaryWriter writer(&data);
+  write_header(&writer, APPROVE_COMMAND, id, 2);
+  writer.WriteString(state);
+  writer.WriteString(command);
+  return common::protocols::three_way_handshake::cmd_approve_t(id, data);
+}
+
+common::Error DecodeBinaryCommand(const std::string& data,
+                                  common::protocols::three_way_handshake::cmd_id_t* seq,
+                                  common::protocols::three_way_handshake::cmd_seq_t* id,
+                                  std::vector<char>* storage,
+                                  std::vector<char*>* argv,
+                                  std::vector<size_t>* args_size) {
+  if (!seq || !id || !storage || !argv || !args_size || !IsBinaryEncoded(data)) {
+    return common::make_error_inval();
+  }
+
+  BinaryReader reader(data.data(), data.size());
+  uint8_t marker;
+  uint8_t lseq;
+  std::string lid;
+  uint8_t argc;
+  if (!reader.ReadU8(&marker) || !reader.ReadU8(&lseq) || !reader.ReadString(&lid) || !reader.ReadU8(&argc)) {
+    return common::make_error("Invalid binary command header");
+  }
+
+  if (argc == 0) {
+    return common::make_error("Binary command without arguments");
+  }
+
+  // first pass validates and sizes storage, so argv pointers stay valid
+  BinaryReader args_reader = reader;
+  size_t total = 0;
+  for (uint8_t i = 0; i < argc; ++i) {
+    const char* arg = NULL;
+    size_t arg_size = 0;
+    if (!args_reader.ReadSlice(&arg, &arg_size)) {
+      return common::make_error("Invalid binary command argument");
+    }
+    total += arg_size + 1;
+  }
+
+  if (!args_reader.IsEnd()) {
+    return common::make_error("Invalid binary command size");
+  }
+
+  storage->resize(total);
+  argv->clear();
+  args_size->clear();
+  char* out = storage->data();
+  for (uint8_t i = 0; i < argc; ++i) {
+    const char* arg = NULL;
+    size_t arg_size = 0;
+    if (!reader.ReadSlice(&arg, &arg_size)) {
+      return common::make_error("Invalid binary command argument");
+    }
+
+    memcpy(out, arg, arg_size);
+    out[arg_size] = 0;
+    argv->push_back(out);
+    args_size->push_back(arg_size);
+    out += arg_size + 1;
+  }
+
+  *seq = lseq;
+  *id = lid;
+  return common::Error();
+}
+
+void BinarySerialize(const ServerPingInfo& ping, std::string* out) {
+  BinaryWriter writer(out);
+  writer.WriteU64(ping.GetTimeStamp());
+}
+
+void BinarySerialize(const ClientPingInfo& ping, std::string* out) {
+  BinaryWriter writer(out);
+  writer.WriteU64(ping.GetTimeStamp());
+}
+
+void BinarySerialize(const ChatMessage& msg, std::string* out) {
+  BinaryWriter writer(out);
+  write_chat_message(&writer, msg);
+}
+
+void BinarySerialize(const RuntimeChannelInfo& info, std::string* out) {
+  BinaryWriter writer(out);
+  writer.WriteString(info.GetChannelId());
+  writer.WriteU64(info.GetWatchersCount());
+  writer.WriteU8(info.GetChannelType());
+  writer.WriteU8(info.IsChatEnabled());
+  writer.WriteU8(info.IsChatReadOnly());
+  const RuntimeChannelInfo::messages_t msgs = info.GetMessages();
+  writer.WriteU32(msgs.size());
+  for (const ChatMessage& msg : msgs) {
+    write_chat_message(&writer, msg);
+  }
+}
+
+void BinarySerialize(const ClientInfo& info, std::string* out) {
+  BinaryWriter writer(out);
+  writer.WriteString(info.GetLogin());
+  writer.WriteString(info.GetOs());
+  writer.WriteString(info.GetCpuBrand());
+  writer.WriteU64(info.GetRamTotal());
+  writer.WriteU64(info.GetRamFree());
+  writer.WriteU64(info.GetBandwidth());
+}
+
+common::Error BinaryDeSerialize(const char* data, size_t size, ServerPingInfo* ping) {
+  if (!data || !ping) {
+    return common::make_error_inval();
+  }
+
+  BinaryReader reader(data, size);
+  uint64_t timestamp;
+  if (!reader.ReadU64(&timestamp) || !reader.IsEnd()) {
+    return common::make_error_inval();
+  }
+
+  *ping = ServerPingInfo(timestamp);
+  return common::Error();
+}
+
+common::Error BinaryDeSerialize(const char* data, size_t size, ClientPingInfo* ping) {
+  if (!data || !ping) {
+    return common::make_error_inval();
+  }
+
+  BinaryReader reader(data, size);
+  uint64_t timestamp;
+  if (!reader.ReadU64(&timestamp) || !reader.IsEnd()) {
+    return common::make_error_inval();
+  }
+
+  *ping = ClientPingInfo(timestamp);
+  return common::Error();
+}
+
+common::Error BinaryDeSerialize(const char* data, size_t size, ChatMessage* msg) {
+  if (!data || !msg) {
+    return common::make_error_inval();
+  }
+
+  BinaryReader reader(data, size);
+  if (!read_chat_message(&reader, msg) || !reader.IsEnd()) {
+    return common::make_error_inval();
+  }
+
+  return common::Error();
+}
+
+common::Error BinaryDeSerialize(const char* data, size_t size, RuntimeChannelInfo* info) {
+  if (!data || !info) {
+    return common::make_error_inval();
+  }
+
+  BinaryReader reader(data, size);
+  std::string channel;
+  uint64_t watchers;
+  uint8_t type;
+  uint8_t chat_enabled;
+  uint8_t read_only;
+  uint32_t msgs_count;
+  if (!reader.ReadString(&channel) || !reader.ReadU64(&watchers) || !reader.ReadU8(&type) ||
+      !reader.ReadU8(&chat_enabled) || !reader.ReadU8(&read_only) || !reader.ReadU32(&msgs_count)) {
+    return common::make_error_inval();
+  }
+
+  if (type > PRIVATE_CHANNEL) {
+    return common::make_error_inval();
+  }
+
+  RuntimeChannelInfo linfo(channel, watchers, static_cast<ChannelType>(type), chat_enabled, read_only);
+  for (uint32_t i = 0; i < msgs_count; ++i) {
+    ChatMessage msg;
+    if (!read_chat_message(&reader, &msg)) {
+      return common::make_error_inval();
+    }
+    linfo.AddMessage(msg);
+  }
+
+  if (!reader.IsEnd()) {
+    return common::make_error_inval();
+  }
+
+  *info = linfo;
+  return common::Error();
+}
+
+common::Error BinaryDeSerialize(const char* data, size_t size, ClientInfo* info) {
+  if (!data || !info) {
+    return common::make_error_inval();
+  }
+
+  BinaryReader reader(data, size);
+  login_t login;
+  std::string os;
+  std::string cpu_brand;
+  uint64_t ram_total;
+  uint64_t ram_free;
+  uint64_t bandwidth;
+  if (!reader.ReadString(&login) || !reader.ReadString(&os) || !reader.ReadString(&cpu_brand) ||
+      !reader.ReadU64(&ram_total) || !reader.ReadU64(&ram_free) || !reader.ReadU64(&bandwidth) || !reader.IsEnd()) {
+    return common::make_error_inval();
+  }
+
+  *info = ClientInfo(login, os, cpu_brand, ram_total, ram_free, bandwidth);
+  return common::Error();
+}
+
+}  // namespace inner
+}  // namespace fastotv
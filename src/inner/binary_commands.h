@@ -0,0 +1,113 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>  // for uint8_t, uint32_t, uint64_t
+
+#include <string>
+#include <vector>
+
+#include "commands/commands.h"
+
+#include "chat_message.h"
+#include "client_info.h"
+#include "ping_info.h"
+#include "runtime_channel_info.h"
+
+namespace fastotv {
+namespace inner {
+
+// Binary encoding of commands, used instead of text when peer supports BINARY_COMMANDS_FEATURE:
+// marker, seq, id, argc, args; strings are prefixed by u32 length, integers are in network byte order.
+// Arguments are the same as in text commands, objects of hot commands are encoded by typed fields, not json.
+static const uint8_t binary_command_marker = 0xFB;  // text commands start with seq digit
+
+bool IsBinaryEncoded(const std::string& data);
+
+class BinaryWriter {
+ public:
+  explicit BinaryWriter(std::string* out);
+
+  void WriteU8(uint8_t value);
+  void WriteU32(uint32_t value);
+  void WriteU64(uint64_t value);
+  void WriteString(const std::string& value);
+
+ private:
+  std::string* out_;
+};
+
+class BinaryReader {
+ public:
+  BinaryReader(const char* data, size_t size);
+
+  bool ReadU8(uint8_t* value) WARN_UNUSED_RESULT;
+  bool ReadU32(uint32_t* value) WARN_UNUSED_RESULT;
+  bool ReadU64(uint64_t* value) WARN_UNUSED_RESULT;
+  bool ReadString(std::string* value) WARN_UNUSED_RESULT;
+  bool ReadSlice(const char** data, size_t* size) WARN_UNUSED_RESULT;  // string without copy
+
+  bool IsEnd() const;
+
+ private:
+  const char* data_;
+  size_t size_;
+  size_t pos_;
+};
+
+common::protocols::three_way_handshake::cmd_request_t MakeBinaryRequest(
+    common::protocols::three_way_handshake::cmd_seq_t id,
+    const std::string& command);
+common::protocols::three_way_handshake::cmd_request_t MakeBinaryRequest(
+    common::protocols::three_way_handshake::cmd_seq_t id,
+    const std::string& command,
+    const std::string& arg);
+common::protocols::three_way_handshake::cmd_responce_t MakeBinaryResponce(
+    common::protocols::three_way_handshake::cmd_seq_t id,
+    const std::string& state,  // SUCCESS_COMMAND or FAIL_COMMAND
+    const std::string& command,
+    const std::string& arg);
+common::protocols::three_way_handshake::cmd_approve_t MakeBinaryApprove(
+    common::protocols::three_way_handshake::cmd_seq_t id,
+    const std::string& state,
+    const std::string& command);
+
+// argv points into storage, every argument is null terminated, args_size are sizes without terminator
+common::Error DecodeBinaryCommand(const std::string& data,
+                                  common::protocols::three_way_handshake::cmd_id_t* seq,
+                                  common::protocols::three_way_handshake::cmd_seq_t* id,
+                                  std::vector<char>* storage,
+                                  std::vector<char*>* argv,
+                                  std::vector<size_t>* args_size) WARN_UNUSED_RESULT;
+
+// typed fields of hot commands objects
+void BinarySerialize(const ServerPingInfo& ping, std::string* out);
+void BinarySerialize(const ClientPingInfo& ping, std::string* out);
+void BinarySerialize(const ChatMessage& msg, std::string* out);
+void BinarySerialize(const RuntimeChannelInfo& info, std::string* out);
+void BinarySerialize(const ClientInfo& info, std::string* out);
+
+common::Error BinaryDeSerialize(const char* data, size_t size, ServerPingInfo* ping) WARN_UNUSED_RESULT;
+common::Error BinaryDeSerialize(const char* data, size_t size, ClientPingInfo* ping) WARN_UNUSED_RESULT;
+common::Error BinaryDeSerialize(const char* data, size_t size, ChatMessage* msg) WARN_UNUSED_RESULT;
+common::Error BinaryDeSerialize(const char* data, size_t size, RuntimeChannelInfo* info) WARN_UNUSED_RESULT;
+common::Error BinaryDeSerialize(const char* data, size_t size, ClientInfo* info) WARN_UNUSED_RESULT;
+
+}  // namespace inner
+}  // namespace fastotv
@@ -18,6 +18,14 @@
 
 #include "inner/inner_client.h"
 
+#include <errno.h>
+#include <string.h>      // for memcpy
+#include <sys/socket.h>  // for shutdown
+
+#include <algorithm>  // for min
+
+#include <common/logger.h>   // for WARNING_LOG
+#include <common/net/net.h>  // for write_to_socket
 #include <common/sys_byteorder.h>
 
 #include <common/text_decoders/compress_snappy_edcoder.h>
@@ -25,10 +33,110 @@
 namespace fastotv {
 namespace inner {
 
+namespace {
+const size_t fragment_wire_size = sizeof(InnerClient::protocoled_size_t) + InnerClient::MAX_COMMAND_SIZE;
+
+// frames keep compressed data only, size prefixes of fragments are produced while writing
+size_t frame_wire_size(size_t data_size) {
+  const size_t fragments = (data_size + InnerClient::MAX_COMMAND_SIZE - 1) / InnerClient::MAX_COMMAND_SIZE;
+  return data_size + fragments * sizeof(InnerClient::protocoled_size_t);
+}
+
+common::Error check_frame_size(size_t data_size, bool allow_chunked) {
+  if (data_size <= InnerClient::MAX_COMMAND_SIZE) {
+    return common::Error();
+  }
+
+  // peer reassembles whole message before decoding, so chunked messages are limited too
+  const size_t limit = allow_chunked ? InnerClient::MAX_MESSAGE_SIZE : InnerClient::MAX_COMMAND_SIZE;
+  if (data_size > limit) {
+    WARNING_LOG() << "Refused to send message of " << data_size << " compressed bytes, limit: " << limit;
+    return common::make_error(common::MemSPrintf("Reached limit of command size: %lu", data_size));
+  }
+  return common::Error();
+}
+
+common::Error compress_message(common::IEDcoder* compressor,
+                               const std::string& message,
+                               bool allow_chunked,
+                               std::string* out) {
+  if (message.empty()) {
+    return common::make_error_inval();
+  }
+
+  common::Error err = compressor->Encode(message, out);
+  if (err) {
+    return err;
+  }
+
+  return check_frame_size(out->size(), allow_chunked);
+}
+
+// snappy raw format: varint of uncompressed size, then literal and copy elements,
+// copies refer back by distance, so elements of separately compressed part stay valid after any literal
+void append_snappy_varint(size_t value, std::string* out) {
+  while (value >= 0x80) {
+    out->push_back(static_cast<char>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  out->push_back(static_cast<char>(value));
+}
+
+bool skip_snappy_varint(const std::string& data, size_t* value, size_t* pos) {
+  size_t result = 0;
+  for (size_t shift = 0; *pos < data.size() && shift < 35; shift += 7) {
+    const unsigned char byte = data[(*pos)++];
+    result |= static_cast<size_t>(byte & 0x7F) << shift;
+    if (!(byte & 0x80)) {
+      *value = result;
+      return true;
+    }
+  }
+  return false;
+}
+
+void append_snappy_literal(const std::string& literal, std::string* out) {
+  if (literal.empty()) {
+    return;
+  }
+
+  const size_t len = literal.size() - 1;
+  if (len < 60) {
+    out->push_back(static_cast<char>(len << 2));
+  } else {
+    size_t bytes = 0;
+    for (size_t rest = len; rest; rest >>= 8) {
+      bytes++;
+    }
+    out->push_back(static_cast<char>((59 + bytes) << 2));
+    for (size_t i = 0; i < bytes; ++i) {
+      out->push_back(static_cast<char>((len >> (i * 8)) & 0xFF));
+    }
+  }
+  out->append(literal);
+}
+}  // namespace
+
+const InnerClient::protocoled_size_t InnerClient::chunk_flag;
+
 InnerClient::InnerClient(common::libev::IoLoop* server, const common::net::socket_info& info)
-    : common::libev::tcp::TcpClient(server, info), compressor_(new common::CompressSnappyEDcoder) {}
+    : common::libev::tcp::TcpClient(server, info),
+      compressor_(new common::CompressSnappyEDcoder),
+      read_buffer_((MAX_COMMAND_SIZE + sizeof(protocoled_size_t)) * 2),
+      read_start_(0),
+      read_end_(0),
+      decoded_command_(),
+      chunked_message_(),
+      peer_features_(0),
+      traffic_stats_(NULL),
+      write_queue_(),
+      write_queue_size_(0),
+      write_queue_high_watermark_(default_write_queue_high_watermark),
+      dropped_messages_(0),
+      evicted_(false) {}
 
 InnerClient::~InnerClient() {
+  SetWriteQueueSize(0);
   destroy(&compressor_);
 }
 
@@ -36,6 +144,21 @@ const char* InnerClient::ClassName() const {
   return "InnerClient";
 }
 
+void InnerClient::SetPeerFeatures(uint32_t features) {
+  peer_features_ = features;
+}
+
+bool InnerClient::IsPeerSupport(protocol_feature_t feature) const {
+  return (peer_features_ & feature) == feature;
+}
+
+void InnerClient::SetTrafficStats(TrafficStats* stats) {
+  const size_t queued = write_queue_size_;
+  SetWriteQueueSize(0);  // move queued bytes to new stats
+  traffic_stats_ = stats;
+  SetWriteQueueSize(queued);
+}
+
 common::Error InnerClient::Write(const common::protocols::three_way_handshake::cmd_request_t& request) {
   return WriteMessage(request.GetCmd());
 }
@@ -48,122 +171,387 @@ common::Error InnerClient::Write(const common::protocols::three_way_handshake::c
   return WriteMessage(approve.GetCmd());
 }
 
-common::Error InnerClient::ReadDataSize(protocoled_size_t* sz) {
-  if (!sz) {
-    return common::make_error_inval();
+common::Error InnerClient::ReadData() {
+  if (evicted_) {
+    return common::make_error("Evicted by write queue overflow");
+  }
+
+  if (read_start_ == read_end_) {
+    read_start_ = read_end_ = 0;
+  } else if (read_start_ != 0) {  // move tail of partial frame to the beginning
+    memmove(read_buffer_.data(), read_buffer_.data() + read_start_, read_end_ - read_start_);
+    read_end_ -= read_start_;
+    read_start_ = 0;
+  }
+
+  const size_t free_space = read_buffer_.size() - read_end_;
+  if (free_space == 0) {  // can't happen while frames are limited by MAX_COMMAND_SIZE
+    return common::make_error("Read buffer overflow");
   }
 
-  protocoled_size_t lsz = 0;
   size_t nread = 0;
-  common::Error err = Read(reinterpret_cast<char*>(&lsz), sizeof(protocoled_size_t), &nread);
+  common::Error err = Read(read_buffer_.data() + read_end_, free_space, &nread);
   if (err) {
     return err;
   }
 
-  if (nread != sizeof(protocoled_size_t)) {  // connection closed
-    if (nread == 0) {
-      return common::make_error("Connection closed");
+  if (nread == 0) {
+    return common::make_error("Connection closed");
+  }
+
+  read_end_ += nread;
+  if (traffic_stats_) {
+    traffic_stats_->wire_bytes_in.fetch_add(nread, std::memory_order_relaxed);
+  }
+  return common::Error();
+}
+
+common::Error InnerClient::NextCommand(const std::string** command) {
+  if (!command) {
+    return common::make_error_inval();
+  }
+
+  *command = NULL;
+  while (true) {
+    const size_t available = read_end_ - read_start_;
+    if (available < sizeof(protocoled_size_t)) {
+      return common::Error();
     }
-    return common::make_error(common::MemSPrintf("Error when reading needed to read: %lu bytes, but readed: %lu",
-                                                 sizeof(protocoled_size_t), nread));
+
+    protocoled_size_t message_size;
+    memcpy(&message_size, read_buffer_.data() + read_start_, sizeof(protocoled_size_t));
+    message_size = common::NetToHost32(message_size);  // stable
+    const bool is_last = !(message_size & chunk_flag);
+    message_size &= ~chunk_flag;
+    if (message_size > MAX_COMMAND_SIZE) {
+      return common::make_error(common::MemSPrintf("Reached limit of command size: %u", message_size));
+    }
+
+    if (message_size == 0) {
+      return common::make_error_inval();
+    }
+
+    if (available < sizeof(protocoled_size_t) + message_size) {  // wait rest of frame
+      return common::Error();
+    }
+
+    const char* data = read_buffer_.data() + read_start_ + sizeof(protocoled_size_t);
+    read_start_ += sizeof(protocoled_size_t) + message_size;
+    if (!is_last || !chunked_message_.empty()) {
+      if (chunked_message_.size() + message_size > MAX_MESSAGE_SIZE) {
+        return common::make_error(
+            common::MemSPrintf("Reached limit of message size: %lu", chunked_message_.size() + message_size));
+      }
+
+      chunked_message_.append(data, message_size);
+      if (!is_last) {
+        continue;
+      }
+
+      std::string compressed;
+      compressed.swap(chunked_message_);  // release memory of big message after decode
+      common::Error err = compressor_->Decode(compressed, &decoded_command_);
+      if (err) {
+        return err;
+      }
+
+      if (traffic_stats_) {
+        traffic_stats_->bytes_in.fetch_add(decoded_command_.size(), std::memory_order_relaxed);
+      }
+      *command = &decoded_command_;
+      return common::Error();
+    }
+
+    const common::StringPiece compressed(data, message_size);
+    common::Error err = compressor_->Decode(compressed, &decoded_command_);
+    if (err) {
+      return err;
+    }
+
+    if (traffic_stats_) {
+      traffic_stats_->bytes_in.fetch_add(decoded_command_.size(), std::memory_order_relaxed);
+    }
+    *command = &decoded_command_;
+    return common::Error();
   }
+}
 
-  *sz = lsz;
+common::Error InnerClient::MakeFrame(const common::protocols::three_way_handshake::cmd_request_t& request,
+                                     frame_t* frame) {
+  if (!frame) {
+    return common::make_error_inval();
+  }
+
+  common::CompressSnappyEDcoder compressor;
+  std::shared_ptr<std::string> compressed = std::make_shared<std::string>();
+  common::Error err = compress_message(&compressor, request.GetCmd(), false, compressed.get());
+  if (err) {
+    return err;
+  }
+
+  *frame = compressed;
   return common::Error();
 }
 
-common::Error InnerClient::ReadMessage(char* out, protocoled_size_t size) {
-  if (!out || size == 0) {
+bool InnerClient::IsFitFrame(const std::string& message) {
+  common::CompressSnappyEDcoder compressor;
+  std::string compressed;
+  common::Error err = compressor.Encode(message, &compressed);
+  return !err && compressed.size() <= MAX_COMMAND_SIZE;
+}
+
+common::Error InnerClient::CompressPart(const std::string& part, CompressedPart* out) {
+  if (part.empty() || !out) {
     return common::make_error_inval();
   }
 
-  size_t nread;
-  common::Error err = Read(out, size, &nread);
+  common::CompressSnappyEDcoder compressor;
+  std::string compressed;
+  common::Error err = compressor.Encode(part, &compressed);
   if (err) {
     return err;
   }
 
-  if (nread != size) {  // connection closed
-    if (nread == 0) {
-      return common::make_error("Connection closed");
-    }
-    return common::make_error(
-        common::MemSPrintf("Error when reading needed to read: %lu bytes, but readed: %lu", size, nread));
+  size_t size = 0;
+  size_t pos = 0;
+  if (!skip_snappy_varint(compressed, &size, &pos) || size != part.size()) {
+    return common::make_error("Unexpected compressed stream header");
   }
 
+  out->data = compressed.substr(pos);
+  out->size = size;
   return common::Error();
 }
 
-common::Error InnerClient::ReadCommand(std::string* out) {
-  if (!out) {
+common::Error InnerClient::MakeFrame(const std::string& prefix,
+                                     const CompressedPart& part,
+                                     const std::string& suffix,
+                                     bool allow_chunked,
+                                     frame_t* frame) {
+  if (!frame || part.data.empty()) {
     return common::make_error_inval();
   }
 
-  protocoled_size_t message_size;
-  common::Error err = ReadDataSize(&message_size);
+  std::shared_ptr<std::string> compressed = std::make_shared<std::string>();
+  compressed->reserve(prefix.size() + part.data.size() + suffix.size() + 16);
+  append_snappy_varint(prefix.size() + part.size + suffix.size(), compressed.get());
+  append_snappy_literal(prefix, compressed.get());
+  compressed->append(part.data);
+  append_snappy_literal(suffix, compressed.get());
+  common::Error err = check_frame_size(compressed->size(), allow_chunked);
   if (err) {
     return err;
   }
 
-  message_size = common::NetToHost32(message_size);  // stable
-  if (message_size > MAX_COMMAND_SIZE) {
-    return common::make_error(common::MemSPrintf("Reached limit of command size: %u", message_size));
+  *frame = compressed;
+  return common::Error();
+}
+
+common::Error InnerClient::WriteFrame(const frame_t& frame, write_priority_t priority) {
+  if (!frame || frame->empty()) {
+    return common::make_error_inval();
+  }
+
+  return WriteProtocoledData(frame, priority);
+}
+
+common::Error InnerClient::Flush() {
+  while (!write_queue_.empty()) {
+    OutboundFrame& front = write_queue_.front();
+    const size_t offset = front.offset;
+    common::Error err = SendFrame(&front);
+    SetWriteQueueSize(write_queue_size_ - (front.offset - offset));
+    if (err) {
+      return err;
+    }
+
+    if (front.offset != frame_wire_size(front.frame->size())) {  // wait next write event
+      return common::Error();
+    }
+    write_queue_.pop_front();
+  }
+
+  SetEvents(EV_READ);
+  return common::Error();
+}
+
+void InnerClient::SetWriteQueueHighWatermark(size_t bytes) {
+  write_queue_high_watermark_ = bytes;
+}
+
+size_t InnerClient::GetWriteQueueSize() const {
+  return write_queue_size_;
+}
+
+size_t InnerClient::GetDroppedMessagesCount() const {
+  return dropped_messages_;
+}
+
+bool InnerClient::IsEvicted() const {
+  return evicted_;
+}
+
+common::Error InnerClient::WriteMessage(const std::string& message) {
+  std::shared_ptr<std::string> compressed = std::make_shared<std::string>();
+  common::Error err = compress_message(compressor_, message, IsPeerSupport(CHUNKED_FEATURE), compressed.get());
+  if (err) {
+    return err;
+  }
+
+  if (traffic_stats_) {
+    traffic_stats_->bytes_out.fetch_add(message.size(), std::memory_order_relaxed);
+  }
+  return WriteProtocoledData(compressed, HIGH_PRIORITY);
+}
+
+common::Error InnerClient::WriteProtocoledData(const frame_t& frame, write_priority_t priority) {
+  if (evicted_) {
+    return common::make_error("Evicted by write queue overflow");
   }
 
-  char* msg = static_cast<char*>(malloc(message_size));
-  err = ReadMessage(msg, message_size);
+  common::Error err = check_frame_size(frame->size(), IsPeerSupport(CHUNKED_FEATURE));
   if (err) {
-    free(msg);
     return err;
   }
 
-  const common::StringPiece compressed(msg, message_size);
-  std::string un_compressed;
-  err = compressor_->Decode(compressed, &un_compressed);
-  free(msg);
+  if (!write_queue_.empty()) {  // keep order
+    return Enqueue(frame, 0, priority);
+  }
+
+  OutboundFrame out = {frame, 0, priority};
+  err = SendFrame(&out);
   if (err) {
     return err;
   }
 
-  *out = un_compressed;
+  if (out.offset == frame_wire_size(frame->size())) {
+    return common::Error();
+  }
+
+  return Enqueue(frame, out.offset, priority);
+}
+
+common::Error InnerClient::SendFrame(OutboundFrame* out) {
+  const std::string& data = *out->frame;
+  const size_t wire_size = frame_wire_size(data.size());
+  while (out->offset < wire_size) {
+    const size_t pos = out->offset % fragment_wire_size;
+    const size_t data_offset = out->offset / fragment_wire_size * MAX_COMMAND_SIZE;
+    const size_t data_size = std::min(data.size() - data_offset, static_cast<size_t>(MAX_COMMAND_SIZE));
+    const size_t left = sizeof(protocoled_size_t) + data_size - pos;
+    size_t nwrite = 0;
+    common::Error err;
+    if (pos < sizeof(protocoled_size_t)) {  // glue size prefix with fragment to send them at once
+      const bool last = data_offset + data_size == data.size();
+      const protocoled_size_t prefix = common::HostToNet32(last ? data_size : (data_size | chunk_flag));  // stable
+      char fragment[fragment_wire_size];
+      memcpy(fragment, &prefix, sizeof(protocoled_size_t));
+      memcpy(fragment + sizeof(protocoled_size_t), data.data() + data_offset, data_size);
+      err = SendData(fragment + pos, left, &nwrite);
+    } else {
+      err = SendData(data.data() + data_offset + pos - sizeof(protocoled_size_t), left, &nwrite);
+    }
+    if (err) {
+      return err;
+    }
+
+    out->offset += nwrite;
+    if (nwrite != left) {  // socket buffer is full
+      return common::Error();
+    }
+  }
+
   return common::Error();
 }
 
-common::Error InnerClient::WriteMessage(const std::string& message) {
-  if (message.empty()) {
-    return common::make_error_inval();
+common::Error InnerClient::SendData(const char* data, size_t size, size_t* nwrite) {
+  size_t lnwrite = 0;
+  common::ErrnoError errn = common::net::write_to_socket(GetFd(), data, size, &lnwrite);
+  if (errn) {
+    const int code = errn->GetErrorCode();  // global errno can be overwritten already
+    if (code != EAGAIN && code != EWOULDBLOCK) {
+      return common::make_error_from_errno(errn);
+    }
+    lnwrite = 0;
   }
 
-  std::string compressed;
-  common::Error err = compressor_->Encode(message, &compressed);
-  if (err) {
-    return err;
+  // socket buffer can be full, rest is written on next write event
+  *nwrite = lnwrite;
+  if (traffic_stats_) {
+    traffic_stats_->wire_bytes_out.fetch_add(lnwrite, std::memory_order_relaxed);
   }
+  return common::Error();
+}
+
+common::Error InnerClient::Enqueue(const frame_t& frame, size_t offset, write_priority_t priority) {
+  const size_t size = frame_wire_size(frame->size()) - offset;
+  if (write_queue_size_ + size > write_queue_high_watermark_) {
+    if (priority == LOW_PRIORITY && offset == 0) {  // partially written frame can't be dropped
+      dropped_messages_++;
+      if (traffic_stats_) {
+        traffic_stats_->dropped_messages.fetch_add(1, std::memory_order_relaxed);
+      }
+      return common::Error();
+    }
+
+    DropLowPriorityMessages();
+    if (write_queue_size_ + size > write_queue_high_watermark_) {  // peer doesn't read, answers would be lost
+      const size_t queued = write_queue_size_;
+      Evict();
+      return common::make_error(common::MemSPrintf("Write queue overflow: %lu bytes queued", queued));
+    }
+  }
+
+  OutboundFrame out = {frame, offset, priority};
+  write_queue_.push_back(out);
+  SetWriteQueueSize(write_queue_size_ + size);
+  SetEvents(EV_READ | EV_WRITE);
+  return common::Error();
+}
 
-  const char* data_ptr = compressed.data();
-  const size_t size = compressed.size();
+void InnerClient::DropLowPriorityMessages() {
+  for (auto it = write_queue_.begin(); it != write_queue_.end();) {
+    if (it->priority == LOW_PRIORITY && it->offset == 0) {  // partially written must be finished
+      SetWriteQueueSize(write_queue_size_ - frame_wire_size(it->frame->size()));
+      dropped_messages_++;
+      if (traffic_stats_) {
+        traffic_stats_->dropped_messages.fetch_add(1, std::memory_order_relaxed);
+      }
+      it = write_queue_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
 
-  const protocoled_size_t data_size = size;
-  if (data_size > MAX_COMMAND_SIZE) {
-    return common::make_error(common::MemSPrintf("Reached limit of command size: %u", data_size));
+void InnerClient::Evict() {
+  if (evicted_) {
+    return;
   }
 
-  const protocoled_size_t message_size = common::HostToNet32(data_size);  // stable
-  const size_t protocoled_data_len = size + sizeof(protocoled_size_t);
+  WARNING_LOG() << "Client[" << GetFormatedName() << "] is over write queue limit, disconnecting.";
+  evicted_ = true;
+  write_queue_.clear();
+  SetWriteQueueSize(0);
+  ::shutdown(GetFd(), SHUT_RDWR);  // peer gets eof, loop reports socket readable and closes client on read error
+  SetEvents(EV_READ);
+}
 
-  char* protocoled_data = static_cast<char*>(malloc(protocoled_data_len));
-  memcpy(protocoled_data, &message_size, sizeof(protocoled_size_t));
-  memcpy(protocoled_data + sizeof(protocoled_size_t), data_ptr, data_size);
-  size_t nwrite = 0;
-  err = TcpClient::Write(protocoled_data, protocoled_data_len, &nwrite);
-  if (nwrite != protocoled_data_len) {  // connection closed
-    free(protocoled_data);
-    return common::make_error(
-        common::MemSPrintf("Error when writing needed to write: %lu, but writed: %lu", protocoled_data_len, nwrite));
+void InnerClient::SetEvents(common::libev::flags_t flags) {
+  if (GetServer()) {  // standalone clients (tests, benchmarks) are not watched by loop
+    SetFlags(flags);
   }
+}
 
-  free(protocoled_data);
-  return err;
+void InnerClient::SetWriteQueueSize(size_t size) {
+  if (traffic_stats_) {
+    if (size > write_queue_size_) {
+      traffic_stats_->queued_bytes.fetch_add(size - write_queue_size_, std::memory_order_relaxed);
+    } else {
+      traffic_stats_->queued_bytes.fetch_sub(write_queue_size_ - size, std::memory_order_relaxed);
+    }
+  }
+  write_queue_size_ = size;
 }
 
 }  // namespace inner
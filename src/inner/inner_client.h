@@ -18,10 +18,18 @@
 
 #pragma once
 
+#include <atomic>
+#include <deque>
+#include <memory>  // for shared_ptr
+#include <string>
+#include <vector>
+
 #include <common/libev/tcp/tcp_client.h>  // for TcpClient
 
 #include "commands/commands.h"
 
+#define PROTOCOL_FEATURES_FIELD "features"  // announced by client in who_are_you responce, by server in approve
+
 namespace common {
 class IEDcoder;
 }
@@ -32,28 +40,127 @@ namespace inner {
 class InnerClient : public common::libev::tcp::TcpClient {
  public:
   typedef uint32_t protocoled_size_t;  // sizeof 4 byte
-  enum { MAX_COMMAND_SIZE = 1024 * 8 };
+  typedef std::shared_ptr<const std::string> frame_t;  // compressed command ready to send, immutable
+  enum {
+    MAX_COMMAND_SIZE = 1024 * 8,         // compressed size of one frame
+    MAX_MESSAGE_SIZE = 1024 * 1024 * 2,  // compressed size of chunked message, receiver reassembles it in memory
+    default_write_queue_high_watermark = 1024 * 1024 * 4
+  };
+  enum write_priority_t { HIGH_PRIORITY = 0, LOW_PRIORITY };  // low priority messages can be dropped
+
+  // messages bigger than MAX_COMMAND_SIZE are split into MAX_COMMAND_SIZE fragments while written,
+  // every fragment except last has chunk_flag in size prefix
+  static const protocoled_size_t chunk_flag = 0x80000000;
+  enum protocol_feature_t {
+    CHUNKED_FEATURE = 1 << 0,
+    COMPACT_REQUEST_ID_FEATURE = 1 << 1,
+    BINARY_COMMANDS_FEATURE = 1 << 2,
+    PROGRAMMES_FEATURE = 1 << 3  // get_programmes served, channel lists can come without programmes
+  };
+  enum {
+    supported_features =
+        CHUNKED_FEATURE | COMPACT_REQUEST_ID_FEATURE | BINARY_COMMANDS_FEATURE | PROGRAMMES_FEATURE
+  };
+
+  // traffic counters, can be shared by connections of different loops
+  struct TrafficStats {
+    std::atomic<uint64_t> bytes_in;  // decompressed commands
+    std::atomic<uint64_t> bytes_out;
+    std::atomic<uint64_t> wire_bytes_in;  // socket level
+    std::atomic<uint64_t> wire_bytes_out;
+    std::atomic<uint64_t> queued_bytes;  // not yet sent bytes in write queues of living connections
+    std::atomic<uint64_t> dropped_messages;
+  };
+
   InnerClient(common::libev::IoLoop* server, const common::net::socket_info& info);
   virtual ~InnerClient();
 
   const char* ClassName() const override;
 
+  // features of other side, chunked messages and compact request ids are sent only if peer supports them
+  void SetPeerFeatures(uint32_t features);
+  bool IsPeerSupport(protocol_feature_t feature) const;
+
+  // not owned, NULL disables accounting; prebuilt frames (WriteFrame) are counted on wire only
+  void SetTrafficStats(TrafficStats* stats);
+
   common::Error Write(const common::protocols::three_way_handshake::cmd_request_t& request) WARN_UNUSED_RESULT;
   common::Error Write(const common::protocols::three_way_handshake::cmd_responce_t& responce) WARN_UNUSED_RESULT;
   common::Error Write(const common::protocols::three_way_handshake::cmd_approve_t& approve) WARN_UNUSED_RESULT;
 
-  common::Error ReadCommand(std::string* out) WARN_UNUSED_RESULT;
+  // compressed message fits into one frame, bigger ones can be sent only to peers with chunked support
+  static bool IsFitFrame(const std::string& message);
+
+  // encode once, write to many clients
+  static common::Error MakeFrame(const common::protocols::three_way_handshake::cmd_request_t& request,
+                                 frame_t* frame) WARN_UNUSED_RESULT;
+
+  // big argument compressed once and spliced into frames of different commands without recompression
+  struct CompressedPart {
+    std::string data;  // compressed elements without stream header
+    size_t size;       // uncompressed size
+  };
+  static common::Error CompressPart(const std::string& part, CompressedPart* out) WARN_UNUSED_RESULT;
+  // frame of message prefix + part + suffix, messages bigger than MAX_COMMAND_SIZE need chunked support
+  static common::Error MakeFrame(const std::string& prefix,
+                                 const CompressedPart& part,
+                                 const std::string& suffix,
+                                 bool allow_chunked,
+                                 frame_t* frame) WARN_UNUSED_RESULT;
+  common::Error WriteFrame(const frame_t& frame, write_priority_t priority = HIGH_PRIORITY) WARN_UNUSED_RESULT;
+
+  // not sent data is queued and written when socket ready to write (Flush),
+  // over high watermark low priority messages are dropped, then client is evicted:
+  // its socket is shut down, writes and ReadData fail, so read path of the loop closes it
+  common::Error Flush() WARN_UNUSED_RESULT;
+  void SetWriteQueueHighWatermark(size_t bytes);
+  size_t GetWriteQueueSize() const;  // bytes
+  size_t GetDroppedMessagesCount() const;
+  bool IsEvicted() const;
+
+  // incoming frames can be split or glued by tcp, ReadData appends available bytes into connection buffer,
+  // NextCommand decodes complete frames one by one (*command is NULL when more data needed),
+  // decoded command is owned by client and valid until next NextCommand call
+  common::Error ReadData() WARN_UNUSED_RESULT;
+  common::Error NextCommand(const std::string** command) WARN_UNUSED_RESULT;
 
  private:
-  common::Error ReadDataSize(protocoled_size_t* sz) WARN_UNUSED_RESULT;
-  common::Error ReadMessage(char* out, protocoled_size_t size) WARN_UNUSED_RESULT;
-
   common::Error WriteMessage(const std::string& message) WARN_UNUSED_RESULT;
+  common::Error WriteProtocoledData(const frame_t& frame, write_priority_t priority) WARN_UNUSED_RESULT;
+  common::Error SendData(const char* data, size_t size, size_t* nwrite) WARN_UNUSED_RESULT;
+  struct OutboundFrame;
+  common::Error SendFrame(OutboundFrame* out) WARN_UNUSED_RESULT;
+  common::Error Enqueue(const frame_t& frame, size_t offset, write_priority_t priority) WARN_UNUSED_RESULT;
+  void DropLowPriorityMessages();
+  void SetWriteQueueSize(size_t size);
+  void Evict();
+  void SetEvents(common::libev::flags_t flags);
   using common::libev::tcp::TcpClient::Read;
   using common::libev::tcp::TcpClient::Write;
 
  private:
+  struct OutboundFrame {
+    frame_t frame;
+    size_t offset;  // already written bytes, size prefixes included
+    write_priority_t priority;
+  };
+
   common::IEDcoder* compressor_;
+
+  std::vector<char> read_buffer_;
+  size_t read_start_;  // first not decoded byte
+  size_t read_end_;    // end of received data
+  std::string decoded_command_;
+  std::string chunked_message_;  // fragments received so far
+
+  uint32_t peer_features_;
+  TrafficStats* traffic_stats_;
+
+  std::deque<OutboundFrame> write_queue_;
+  size_t write_queue_size_;
+  size_t write_queue_high_watermark_;
+  size_t dropped_messages_;
+  bool evicted_;
 };
 
 }  // namespace inner
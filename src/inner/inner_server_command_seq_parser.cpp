@@ -18,8 +18,6 @@
 
 #include "inner/inner_server_command_seq_parser.h"
 
-#include <algorithm>
-
 #include <common/convert2string.h>
 #include <common/sys_byteorder.h>
 
@@ -36,12 +34,21 @@ namespace fastotv {
 namespace inner {
 
 RequestCallback::RequestCallback(common::protocols::three_way_handshake::cmd_seq_t request_id, callback_t cb)
-    : request_id_(request_id), cb_(cb) {}
+    : request_id_(request_id), command_("null"), cb_(cb) {}
+
+RequestCallback::RequestCallback(common::protocols::three_way_handshake::cmd_seq_t request_id,
+                                 const std::string& command,
+                                 callback_t cb)
+    : request_id_(request_id), command_(command), cb_(cb) {}
 
 common::protocols::three_way_handshake::cmd_seq_t RequestCallback::GetRequestID() const {
   return request_id_;
 }
 
+std::string RequestCallback::GetCommand() const {
+  return command_;
+}
+
 void RequestCallback::Execute(int argc, char* argv[]) {
   if (!cb_) {
     return;
@@ -50,9 +57,20 @@ void RequestCallback::Execute(int argc, char* argv[]) {
   return cb_(request_id_, argc, argv);
 }
 
-InnerServerCommandSeqParser::InnerServerCommandSeqParser() : id_() {}
+InnerServerCommandSeqParser::InnerServerCommandSeqParser()
+    : id_(),
+      subscribed_requests_(),
+      wheel_(default_request_timeout + 1),
+      current_tick_(0),
+      request_timeout_(default_request_timeout),
+      binary_command_(false),
+      binary_storage_(),
+      binary_argv_(),
+      binary_args_size_() {}
 
-InnerServerCommandSeqParser::~InnerServerCommandSeqParser() {}
+InnerServerCommandSeqParser::~InnerServerCommandSeqParser() {
+  FailAllRequests("shutdown");
+}
 
 common::protocols::three_way_handshake::cmd_seq_t InnerServerCommandSeqParser::NextRequestID() {
   const seq_id_t next_id = id_++;
@@ -64,35 +82,144 @@ common::protocols::three_way_handshake::cmd_seq_t InnerServerCommandSeqParser::N
   return hexed;
 }
 
-namespace {
-
-bool exec_reqest(RequestCallback req,
-                 common::protocols::three_way_handshake::cmd_seq_t request_id,
-                 int argc,
-                 char* argv[]) {
-  if (request_id == req.GetRequestID()) {
-    req.Execute(argc, argv);
-    return true;
+common::protocols::three_way_handshake::cmd_seq_t InnerServerCommandSeqParser::NextRequestID(
+    const InnerClient* connection) {
+  if (!connection || !connection->IsPeerSupport(InnerClient::COMPACT_REQUEST_ID_FEATURE)) {
+    return NextRequestID();
   }
 
-  return false;
+  const seq_id_t next_id = id_++;
+  return common::ConvertToString(next_id);
 }
 
-}  // namespace
+bool InnerServerCommandSeqParser::PendingKey::operator==(const PendingKey& other) const {
+  return connection == other.connection && request_id == other.request_id;
+}
 
-void InnerServerCommandSeqParser::ProcessRequest(common::protocols::three_way_handshake::cmd_seq_t request_id,
+size_t InnerServerCommandSeqParser::PendingKeyHash::operator()(const PendingKey& key) const {
+  return std::hash<common::protocols::three_way_handshake::cmd_seq_t>()(key.request_id) ^
+         (std::hash<const InnerClient*>()(key.connection) << 1);
+}
+
+void InnerServerCommandSeqParser::ProcessRequest(const InnerClient* connection,
+                                                 common::protocols::three_way_handshake::cmd_seq_t request_id,
                                                  int argc,
                                                  char* argv[]) {
-  subscribed_requests_.erase(std::remove_if(subscribed_requests_.begin(), subscribed_requests_.end(),
-                                            std::bind(&exec_reqest, std::placeholders::_1, request_id, argc, argv)),
-                             subscribed_requests_.end());
+  const PendingKey key = {connection, request_id};
+  auto range = subscribed_requests_.equal_range(key);
+  if (range.first == range.second) {
+    return;
+  }
+
+  std::vector<RequestCallback> answered;
+  for (auto it = range.first; it != range.second; ++it) {
+    answered.push_back(it->second.req);
+  }
+  subscribed_requests_.erase(range.first, range.second);  // wheel slot entry is skipped lazily
+
+  for (RequestCallback& req : answered) {
+    req.Execute(argc, argv);
+  }
+}
+
+void InnerServerCommandSeqParser::SubscribeRequest(const InnerClient* connection, const RequestCallback& req) {
+  const size_t expire_tick = current_tick_ + request_timeout_;
+  const PendingKey key = {connection, req.GetRequestID()};
+  PendingRequest pending = {req, expire_tick};
+  subscribed_requests_.insert(std::make_pair(key, pending));
+  ScheduleExpire(key, expire_tick);
+}
+
+void InnerServerCommandSeqParser::FailRequests(const InnerClient* connection, const std::string& cause) {
+  std::vector<RequestCallback> failed;
+  for (auto it = subscribed_requests_.begin(); it != subscribed_requests_.end();) {
+    if (it->first.connection == connection) {  // wheel slot entry is skipped lazily
+      failed.push_back(it->second.req);
+      it = subscribed_requests_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  for (RequestCallback& req : failed) {
+    FailRequest(&req, cause);
+  }
+}
+
+void InnerServerCommandSeqParser::FailAllRequests(const std::string& cause) {
+  std::vector<RequestCallback> failed;
+  for (auto& pending : subscribed_requests_) {
+    failed.push_back(pending.second.req);
+  }
+  subscribed_requests_.clear();
+  for (wheel_slot_t& slot : wheel_) {
+    slot.clear();
+  }
+
+  for (RequestCallback& req : failed) {
+    FailRequest(&req, cause);
+  }
+}
+
+void InnerServerCommandSeqParser::SetRequestTimeout(size_t ticks) {
+  request_timeout_ = ticks ? ticks : 1;
+  wheel_ = std::vector<wheel_slot_t>(request_timeout_ + 1);
+  for (auto& pending : subscribed_requests_) {
+    size_t expire_tick = pending.second.expire_tick;
+    if (expire_tick > current_tick_ + request_timeout_) {
+      expire_tick = current_tick_ + request_timeout_;
+      pending.second.expire_tick = expire_tick;
+    }
+    ScheduleExpire(pending.first, expire_tick);
+  }
 }
 
-void InnerServerCommandSeqParser::SubscribeRequest(const RequestCallback& req) {
-  subscribed_requests_.push_back(req);
+size_t InnerServerCommandSeqParser::GetPendingRequestsCount() const {
+  return subscribed_requests_.size();
+}
+
+void InnerServerCommandSeqParser::ExpireRequests() {
+  current_tick_++;
+  wheel_slot_t slot;
+  slot.swap(wheel_[current_tick_ % wheel_.size()]);
+
+  std::vector<RequestCallback> expired;
+  for (const PendingKey& key : slot) {
+    auto range = subscribed_requests_.equal_range(key);
+    for (auto it = range.first; it != range.second;) {
+      if (it->second.expire_tick <= current_tick_) {
+        expired.push_back(it->second.req);
+        it = subscribed_requests_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  for (RequestCallback& req : expired) {
+    WARNING_LOG() << "Request id: " << req.GetRequestID() << ", command: " << req.GetCommand() << " timed out.";
+    FailRequest(&req, "timeout");
+  }
+}
+
+void InnerServerCommandSeqParser::ScheduleExpire(const PendingKey& key, size_t expire_tick) {
+  wheel_[expire_tick % wheel_.size()].push_back(key);
+}
+
+void InnerServerCommandSeqParser::FailRequest(RequestCallback* req, const std::string& cause) {
+  std::string state = FAIL_COMMAND;
+  std::string command = req->GetCommand();
+  std::string jcause = common::MemSPrintf("{\"cause\": \"%s\"}", cause);
+  char* argv[] = {&state[0], &command[0], &jcause[0]};
+  req->Execute(SIZEOFMASS(argv), argv);
 }
 
 void InnerServerCommandSeqParser::HandleInnerDataReceived(InnerClient* connection, const std::string& input_command) {
+  if (IsBinaryEncoded(input_command)) {
+    HandleInnerBinaryDataReceived(connection, input_command);
+    return;
+  }
+
   common::protocols::three_way_handshake::cmd_id_t seq;
   common::protocols::three_way_handshake::cmd_seq_t id;
   std::string cmd_str;
@@ -117,10 +244,51 @@ void InnerServerCommandSeqParser::HandleInnerDataReceived(InnerClient* connectio
     return;
   }
 
-  ProcessRequest(id, argc, argv);
   INFO_LOG() << "HANDLE INNER COMMAND client[" << connection->GetFormatedName()
              << "] seq: " << common::protocols::three_way_handshake::CmdIdToString(seq) << ", id:" << id
              << ", cmd: " << cmd_str;
+  binary_command_ = false;
+  DispatchCommand(connection, seq, id, argc, argv);
+  sdsfreesplitres(argv, argc);
+}
+
+bool InnerServerCommandSeqParser::IsBinaryCommand() const {
+  return binary_command_;
+}
+
+void InnerServerCommandSeqParser::HandleInnerBinaryDataReceived(InnerClient* connection,
+                                                                const std::string& input_command) {
+  common::protocols::three_way_handshake::cmd_id_t seq;
+  common::protocols::three_way_handshake::cmd_seq_t id;
+  common::Error err =
+      DecodeBinaryCommand(input_command, &seq, &id, &binary_storage_, &binary_argv_, &binary_args_size_);
+  if (err) {
+    WARNING_LOG() << err->GetDescription();
+    err = connection->Close();
+    DCHECK(!err);
+    delete connection;
+    return;
+  }
+
+  // arguments can be binary, log command name only
+  const int argc = binary_argv_.size();
+  const char* command = seq == REQUEST_COMMAND || argc < 2 ? binary_argv_[0] : binary_argv_[1];
+  INFO_LOG() << "HANDLE INNER BINARY COMMAND client[" << connection->GetFormatedName()
+             << "] seq: " << common::protocols::three_way_handshake::CmdIdToString(seq) << ", id:" << id
+             << ", cmd: " << command;
+  binary_command_ = true;
+  DispatchCommand(connection, seq, id, argc, binary_argv_.data());
+  binary_command_ = false;
+}
+
+void InnerServerCommandSeqParser::DispatchCommand(InnerClient* connection,
+                                                  common::protocols::three_way_handshake::cmd_id_t seq,
+                                                  common::protocols::three_way_handshake::cmd_seq_t id,
+                                                  int argc,
+                                                  char* argv[]) {
+  if (seq == RESPONCE_COMMAND || seq == APPROVE_COMMAND) {  // requests of peer have ids of its own
+    ProcessRequest(connection, id, argc, argv);
+  }
   if (seq == REQUEST_COMMAND) {
     HandleInnerRequestCommand(connection, id, argc, argv);
   } else if (seq == RESPONCE_COMMAND) {
@@ -129,11 +297,10 @@ void InnerServerCommandSeqParser::HandleInnerDataReceived(InnerClient* connectio
     HandleInnerApproveCommand(connection, id, argc, argv);
   } else {
     DNOTREACHED();
-    err = connection->Close();
+    common::Error err = connection->Close();
     DCHECK(!err);
     delete connection;
   }
-  sdsfreesplitres(argv, argc);
 }
 
 }  // namespace inner
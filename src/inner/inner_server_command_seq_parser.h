@@ -20,8 +20,14 @@
 
 #include <atomic>
 #include <functional>
+#include <string>  // for string
+#include <unordered_map>
+#include <vector>
+
+#include <json-c/json_tokener.h>  // for json_tokener_parse
 
 #include "commands/commands.h"
+#include "inner/binary_commands.h"
 
 namespace fastotv {
 namespace inner {
@@ -37,30 +43,57 @@ class RequestCallback {
   typedef std::function<void(common::protocols::three_way_handshake::cmd_seq_t request_id, int argc, char* argv[])>
       callback_t;
   RequestCallback(common::protocols::three_way_handshake::cmd_seq_t request_id, callback_t cb);
+  RequestCallback(common::protocols::three_way_handshake::cmd_seq_t request_id,
+                  const std::string& command,
+                  callback_t cb);  // command is reported in timeout answer
   common::protocols::three_way_handshake::cmd_seq_t GetRequestID() const;
+  std::string GetCommand() const;
   void Execute(int argc, char* argv[]);
 
  private:
   common::protocols::three_way_handshake::cmd_seq_t request_id_;
+  std::string command_;
   callback_t cb_;
 };
 
 class InnerServerCommandSeqParser {
  public:
   typedef uint64_t seq_id_t;
+  enum { default_request_timeout = 30 };  // in ticks of ExpireRequests
 
   InnerServerCommandSeqParser();
-  virtual ~InnerServerCommandSeqParser();
+  virtual ~InnerServerCommandSeqParser();  // fails still pending requests with "shutdown" cause
 
-  void SubscribeRequest(const RequestCallback& req);
+  // callback is executed once: with responce or approve which came by connection the request was written to,
+  // or with FAIL after request timeout, connection close or shutdown
+  void SubscribeRequest(const InnerClient* connection, const RequestCallback& req);
+  void FailRequests(const InnerClient* connection, const std::string& cause);  // e.g. connection closed
+  void FailAllRequests(const std::string& cause);
+  void SetRequestTimeout(size_t ticks);  // pending requests don't wait longer than new timeout
+  size_t GetPendingRequestsCount() const;
 
  protected:
+  void ExpireRequests();  // should be called periodically, one call is one tick
+
   void HandleInnerDataReceived(InnerClient* connection, const std::string& input_command);
 
-  common::protocols::three_way_handshake::cmd_seq_t NextRequestID();  // for requests
+  // dispatched command came in binary encoding, answer should be binary too
+  bool IsBinaryCommand() const;
+  // object argument argv[pos] of dispatched command: typed fields if binary, otherwise json
+  template <typename T>
+  common::Error ParseArgument(int argc, char* argv[], int pos, T* out) const WARN_UNUSED_RESULT;
+
+  // ids of own requests come from one counter, so answers are never confused with answers of external requests,
+  // those are written with own id too
+  common::protocols::three_way_handshake::cmd_seq_t NextRequestID();  // for requests, hex encoded
+  // decimal counter if connection supports compact ids, short enough to avoid heap allocation
+  common::protocols::three_way_handshake::cmd_seq_t NextRequestID(const InnerClient* connection);
 
  private:
-  void ProcessRequest(common::protocols::three_way_handshake::cmd_seq_t request_id, int argc, char* argv[]);
+  void ProcessRequest(const InnerClient* connection,
+                      common::protocols::three_way_handshake::cmd_seq_t request_id,
+                      int argc,
+                      char* argv[]);
 
   virtual void HandleInnerRequestCommand(InnerClient* connection,
                                          common::protocols::three_way_handshake::cmd_seq_t id,
@@ -76,9 +109,64 @@ class InnerServerCommandSeqParser {
                                          int argc,
                                          char* argv[]) = 0;  // called when argv not NULL and argc > 0
 
+  struct PendingRequest {
+    RequestCallback req;
+    size_t expire_tick;
+  };
+  // peers number their requests independently, so same id can be pending on different connections
+  struct PendingKey {
+    const InnerClient* connection;
+    common::protocols::three_way_handshake::cmd_seq_t request_id;
+
+    bool operator==(const PendingKey& other) const;
+  };
+  struct PendingKeyHash {
+    size_t operator()(const PendingKey& key) const;
+  };
+  typedef std::unordered_multimap<PendingKey, PendingRequest, PendingKeyHash> pending_t;
+  typedef std::vector<PendingKey> wheel_slot_t;
+
+  void ScheduleExpire(const PendingKey& key, size_t expire_tick);
+  static void FailRequest(RequestCallback* req, const std::string& cause);  // executes with FAIL answer
+  void DispatchCommand(InnerClient* connection,
+                       common::protocols::three_way_handshake::cmd_id_t seq,
+                       common::protocols::three_way_handshake::cmd_seq_t id,
+                       int argc,
+                       char* argv[]);
+  void HandleInnerBinaryDataReceived(InnerClient* connection, const std::string& input_command);
+
   std::atomic<seq_id_t> id_;
-  std::vector<RequestCallback> subscribed_requests_;
+  pending_t subscribed_requests_;
+  std::vector<wheel_slot_t> wheel_;  // slot is tick modulo size, size is more than timeout
+  size_t current_tick_;
+  size_t request_timeout_;
+
+  bool binary_command_;
+  // decoded binary command, reused between commands
+  std::vector<char> binary_storage_;
+  std::vector<char*> binary_argv_;
+  std::vector<size_t> binary_args_size_;
 };
 
+template <typename T>
+common::Error InnerServerCommandSeqParser::ParseArgument(int argc, char* argv[], int pos, T* out) const {
+  if (pos >= argc || !argv[pos] || !out) {
+    return common::make_error_inval();
+  }
+
+  if (binary_command_) {
+    return BinaryDeSerialize(argv[pos], binary_args_size_[pos], out);
+  }
+
+  json_object* obj = json_tokener_parse(argv[pos]);
+  if (!obj) {
+    return common::make_error_inval();
+  }
+
+  common::Error err = T::DeSerialize(obj, out);
+  json_object_put(obj);
+  return err;
+}
+
 }  // namespace inner
 }  // namespace fastotv
@@ -0,0 +1,95 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "load_generator/load_client.h"
+
+namespace fastotv {
+namespace load {
+
+LoadClient::LoadClient(common::libev::IoLoop* server, const common::net::socket_info& info)
+    : InnerClient(server, info),
+      ainf_(),
+      connect_start_usec_(0),
+      connecting_(false),
+      authorized_(false),
+      channels_(),
+      current_channel_(invalid_stream_id),
+      next_action_usec_() {}
+
+const char* LoadClient::ClassName() const {
+  return "LoadClient";
+}
+
+void LoadClient::SetAuthInfo(const AuthInfo& ainf) {
+  ainf_ = ainf;
+}
+
+AuthInfo LoadClient::GetAuthInfo() const {
+  return ainf_;
+}
+
+void LoadClient::SetConnectStart(uint64_t usec) {
+  connect_start_usec_ = usec;
+}
+
+uint64_t LoadClient::GetConnectStart() const {
+  return connect_start_usec_;
+}
+
+void LoadClient::SetConnecting(bool connecting) {
+  connecting_ = connecting;
+}
+
+bool LoadClient::IsConnecting() const {
+  return connecting_;
+}
+
+void LoadClient::SetAuthorized(bool authorized) {
+  authorized_ = authorized;
+}
+
+bool LoadClient::IsAuthorized() const {
+  return authorized_;
+}
+
+void LoadClient::SetChannels(const channels_t& channels) {
+  channels_ = channels;
+}
+
+const LoadClient::channels_t& LoadClient::GetChannels() const {
+  return channels_;
+}
+
+void LoadClient::SetCurrentChannel(const stream_id& sid) {
+  current_channel_ = sid;
+}
+
+stream_id LoadClient::GetCurrentChannel() const {
+  return current_channel_;
+}
+
+void LoadClient::SetNextAction(action_t action, uint64_t usec) {
+  next_action_usec_[action] = usec;
+}
+
+uint64_t LoadClient::GetNextAction(action_t action) const {
+  return next_action_usec_[action];
+}
+
+}  // namespace load
+}  // namespace fastotv
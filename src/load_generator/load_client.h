@@ -0,0 +1,78 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>  // for uint64_t
+
+#include <vector>
+
+#include "auth_info.h"            // for AuthInfo
+#include "client_server_types.h"  // for stream_id
+#include "inner/inner_client.h"   // for InnerClient
+
+namespace fastotv {
+namespace load {
+
+// Simulated set-top box connection, keeps what the box remembers between commands.
+class LoadClient : public fastotv::inner::InnerClient {
+ public:
+  typedef std::vector<stream_id> channels_t;
+
+  LoadClient(common::libev::IoLoop* server, const common::net::socket_info& info);
+
+  const char* ClassName() const override;
+
+  void SetAuthInfo(const AuthInfo& ainf);
+  AuthInfo GetAuthInfo() const;
+
+  void SetConnectStart(uint64_t usec);
+  uint64_t GetConnectStart() const;
+
+  // non-blocking connect is in progress, socket becomes writable when it completes
+  void SetConnecting(bool connecting);
+  bool IsConnecting() const;
+
+  // authorized by server, periodic actions are scheduled only for authorized clients
+  void SetAuthorized(bool authorized);
+  bool IsAuthorized() const;
+
+  void SetChannels(const channels_t& channels);
+  const channels_t& GetChannels() const;
+
+  void SetCurrentChannel(const stream_id& sid);
+  stream_id GetCurrentChannel() const;
+
+  // deadlines of periodic actions in LoadStats::NowUsec units, 0 is not scheduled
+  enum action_t { ZAP = 0, CHAT, PING };
+  enum { actions_count = PING + 1 };
+  void SetNextAction(action_t action, uint64_t usec);
+  uint64_t GetNextAction(action_t action) const;
+
+ private:
+  AuthInfo ainf_;
+  uint64_t connect_start_usec_;
+  bool connecting_;
+  bool authorized_;
+  channels_t channels_;
+  stream_id current_channel_;
+  uint64_t next_action_usec_[actions_count];
+};
+
+}  // namespace load
+}  // namespace fastotv
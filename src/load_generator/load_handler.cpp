@@ -0,0 +1,643 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "load_generator/load_handler.h"
+
+#include <errno.h>
+#include <netdb.h>   // for getaddrinfo
+#include <stdlib.h>  // for strtoul
+#include <string.h>  // for memcpy, strerror
+#include <unistd.h>  // for close
+
+#include <algorithm>
+#include <string>
+
+#include <common/convert2string.h>            // for ConvertToString
+#include <common/file_system/file_system.h>  // for set_blocking_descriptor
+#include <common/libev/io_loop.h>             // for IoLoop
+#include <common/sprintf.h>                   // for MemSPrintf
+
+#include "client/commands.h"
+#include "inner/binary_commands.h"  // for MakeBinaryRequest
+
+#include "load_generator/load_client.h"
+#include "load_generator/redis_stand_in.h"  // for RedisStandIn::MakeAuth
+
+#include "channels_info.h"  // for ChannelsInfo
+#include "chat_message.h"   // for ChatMessage
+#include "client_info.h"    // for ClientInfo
+#include "ping_info.h"      // for ServerPingInfo
+#include "runtime_channel_info.h"
+
+namespace fastotv {
+namespace load {
+
+LoadConfig::LoadConfig()
+    : server_host(),
+      clients(1000),
+      loops(1),
+      users(100),
+      ramp_up_rate(100),
+      zap_interval(60),
+      chat_interval(120) {}
+
+LoadHandler::LoadHandler(const LoadConfig& config, size_t first_client, size_t step, LoadStats* stats)
+    : fastotv::inner::InnerServerCommandSeqParser(),
+      common::libev::IoLoopObserver(),
+      config_(config),
+      first_client_(first_client),
+      step_(step),
+      stats_(stats),
+      server_addr_(),
+      server_addr_len_(0),
+      next_client_(first_client),
+      ramp_start_usec_(0),
+      tick_timer_(INVALID_TIMER_ID),
+      clients_(),
+      dispatching_client_(nullptr),
+      pending_(),
+      random_(static_cast<std::mt19937::result_type>(first_client + 1)) {}
+
+LoadHandler::~LoadHandler() {
+  CHECK(clients_.empty());
+}
+
+void LoadHandler::PreLooped(common::libev::IoLoop* server) {
+  common::Error err = ResolveServer();
+  if (err) {  // every connect is counted as failed
+    DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+  }
+  ramp_start_usec_ = LoadStats::NowUsec();
+  tick_timer_ = server->CreateTimer(tick_msec / 1000.0, true);
+}
+
+void LoadHandler::Accepted(common::libev::IoClient* client) {
+  UNUSED(client);
+}
+
+void LoadHandler::Moved(common::libev::IoLoop* server, common::libev::IoClient* client) {
+  UNUSED(server);
+  UNUSED(client);
+}
+
+void LoadHandler::Closed(common::libev::IoClient* client) {
+  LoadClient* lclient = static_cast<LoadClient*>(client);
+  auto it = std::find(clients_.begin(), clients_.end(), lclient);
+  if (it == clients_.end()) {
+    return;
+  }
+
+  clients_.erase(it);
+  if (lclient == dispatching_client_) {
+    dispatching_client_ = nullptr;
+  }
+  if (!lclient->IsConnecting()) {
+    stats_->ClientDisconnected();
+  }
+}
+
+void LoadHandler::DataReceived(common::libev::IoClient* client) {
+  LoadClient* lclient = static_cast<LoadClient*>(client);
+  if (lclient->IsConnecting() && !FinishConnect(lclient)) {
+    return;
+  }
+
+  common::Error err = lclient->ReadData();
+  if (err) {
+    DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+    CloseClient(lclient);
+    return;
+  }
+
+  // handle all received commands, client can be closed by any of them
+  dispatching_client_ = lclient;
+  while (dispatching_client_) {
+    const std::string* command = NULL;
+    err = lclient->NextCommand(&command);
+    if (err) {
+      DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+      CloseClient(lclient);
+      break;
+    }
+
+    if (!command) {
+      break;
+    }
+
+    HandleInnerDataReceived(lclient, *command);
+  }
+  dispatching_client_ = nullptr;
+}
+
+void LoadHandler::DataReadyToWrite(common::libev::IoClient* client) {
+  LoadClient* lclient = static_cast<LoadClient*>(client);
+  if (lclient->IsConnecting() && !FinishConnect(lclient)) {
+    return;
+  }
+
+  common::Error err = lclient->Flush();
+  if (err) {
+    DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+    CloseClient(lclient);
+  }
+}
+
+void LoadHandler::PostLooped(common::libev::IoLoop* server) {
+  if (tick_timer_ != INVALID_TIMER_ID) {
+    server->RemoveTimer(tick_timer_);
+    tick_timer_ = INVALID_TIMER_ID;
+  }
+
+  std::vector<LoadClient*> copy = clients_;
+  for (LoadClient* client : copy) {
+    CloseClient(client);
+  }
+  CHECK(clients_.empty());
+  pending_.clear();
+}
+
+void LoadHandler::TimerEmited(common::libev::IoLoop* server, common::libev::timer_id_t id) {
+  if (id != tick_timer_) {
+    return;
+  }
+
+  const uint64_t now = LoadStats::NowUsec();
+  RampUp(server, now);
+  RunActions(now);
+  ExpirePending(now);
+  ExpireConnecting(now);
+}
+
+#if LIBEV_CHILD_ENABLE
+void LoadHandler::ChildStatusChanged(common::libev::IoLoop* server, pid_t id, int status) {
+  UNUSED(server);
+  UNUSED(id);
+  UNUSED(status);
+}
+#endif
+
+common::Error LoadHandler::ResolveServer() {
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+
+  const std::string host_str = config_.server_host.GetHost();
+  const std::string port_str = common::ConvertToString(config_.server_host.GetPort());
+  struct addrinfo* result = NULL;
+  int res = getaddrinfo(host_str.c_str(), port_str.c_str(), &hints, &result);
+  if (res != 0) {
+    return common::make_error(common::MemSPrintf("getaddrinfo failed: %s", gai_strerror(res)));
+  }
+
+  if (result->ai_addrlen > sizeof(server_addr_)) {
+    freeaddrinfo(result);
+    return common::make_error_inval();
+  }
+
+  memcpy(&server_addr_, result->ai_addr, result->ai_addrlen);
+  server_addr_len_ = result->ai_addrlen;
+  freeaddrinfo(result);
+  return common::Error();
+}
+
+void LoadHandler::RampUp(common::libev::IoLoop* server, uint64_t now) {
+  size_t target = config_.clients;  // index bound
+  if (config_.ramp_up_rate > 0) {
+    // this loop opens every step-th connection, so its share of the rate is rate / step
+    const double elapsed_sec = (now - ramp_start_usec_) / 1000000.0;
+    const size_t opened = static_cast<size_t>(elapsed_sec * config_.ramp_up_rate / step_) + 1;
+    target = std::min(target, first_client_ + opened * step_);
+  }
+
+  for (size_t i = 0; next_client_ < target && i < max_connects_per_tick; ++i) {
+    ConnectClient(server, next_client_);
+    next_client_ += step_;
+  }
+}
+
+void LoadHandler::ConnectClient(common::libev::IoLoop* server, size_t index) {
+  const uint64_t start = LoadStats::NowUsec();
+  if (!server_addr_len_) {
+    stats_->AddFailure(LoadStats::CONNECT);
+    return;
+  }
+
+  // blocking connect would stall every client of this loop for a round trip, completion comes as write event
+  const struct sockaddr* addr = reinterpret_cast<const struct sockaddr*>(&server_addr_);
+  int fd = socket(addr->sa_family, SOCK_STREAM, 0);
+  if (fd == -1) {
+    DEBUG_MSG_ERROR(common::make_error(common::MemSPrintf("socket failed: %s", strerror(errno))),
+                    common::logging::LOG_LEVEL_ERR);
+    stats_->AddFailure(LoadStats::CONNECT);
+    return;
+  }
+
+  common::ErrnoError errn = common::file_system::set_blocking_descriptor(fd, false);
+  if (errn) {
+    DEBUG_MSG_ERROR(common::make_error_from_errno(errn), common::logging::LOG_LEVEL_ERR);
+    close(fd);
+    stats_->AddFailure(LoadStats::CONNECT);
+    return;
+  }
+
+  if (::connect(fd, addr, server_addr_len_) == -1 && errno != EINPROGRESS) {
+    DEBUG_MSG_ERROR(common::make_error(common::MemSPrintf("connect failed: %s", strerror(errno))),
+                    common::logging::LOG_LEVEL_ERR);
+    close(fd);
+    stats_->AddFailure(LoadStats::CONNECT);
+    return;
+  }
+
+  LoadClient* client = new LoadClient(server, common::net::socket_info(fd));
+  client->SetAuthInfo(RedisStandIn::MakeAuth(index, config_.users));
+  client->SetConnectStart(start);
+  client->SetConnecting(true);
+  client->SetTrafficStats(stats_->GetTrafficStats());
+  clients_.push_back(client);
+  server->RegisterClient(client);
+  client->SetFlags(EV_READ | EV_WRITE);
+}
+
+bool LoadHandler::FinishConnect(LoadClient* client) {
+  int error = 0;
+  socklen_t len = sizeof(error);
+  if (getsockopt(client->GetFd(), SOL_SOCKET, SO_ERROR, &error, &len) == -1) {
+    error = errno;
+  }
+
+  if (error) {
+    DEBUG_MSG_ERROR(common::make_error(common::MemSPrintf("connect failed: %s", strerror(error))),
+                    common::logging::LOG_LEVEL_ERR);
+    stats_->AddFailure(LoadStats::CONNECT);
+    CloseClient(client);
+    return false;
+  }
+
+  client->SetConnecting(false);
+  stats_->ClientConnected();
+  return true;
+}
+
+void LoadHandler::ExpireConnecting(uint64_t now) {
+  const uint64_t timeout_usec = request_timeout * 1000000ULL;
+  std::vector<LoadClient*> copy = clients_;
+  for (LoadClient* client : copy) {
+    if (client->IsConnecting() && now - client->GetConnectStart() >= timeout_usec) {
+      stats_->AddFailure(LoadStats::CONNECT);
+      CloseClient(client);
+    }
+  }
+}
+
+void LoadHandler::RunActions(uint64_t now) {
+  std::vector<LoadClient*> copy = clients_;  // actions can close clients
+  for (LoadClient* client : copy) {
+    if (!client->IsAuthorized() || std::find(clients_.begin(), clients_.end(), client) == clients_.end()) {
+      continue;
+    }
+
+    const uint64_t zap = client->GetNextAction(LoadClient::ZAP);
+    if (zap && zap <= now) {
+      client->SetNextAction(LoadClient::ZAP, NextDeadline(now, config_.zap_interval));
+      Zap(client);
+      continue;  // one action per tick is enough for a set-top box
+    }
+
+    const uint64_t chat = client->GetNextAction(LoadClient::CHAT);
+    if (chat && chat <= now) {
+      client->SetNextAction(LoadClient::CHAT, NextDeadline(now, config_.chat_interval));
+      SendChat(client);
+      continue;
+    }
+
+    const uint64_t ping = client->GetNextAction(LoadClient::PING);
+    if (ping && ping <= now) {
+      client->SetNextAction(LoadClient::PING, now + ping_interval * 1000000ULL);
+      SendPing(client);
+    }
+  }
+}
+
+void LoadHandler::ExpirePending(uint64_t now) {
+  const uint64_t timeout_usec = request_timeout * 1000000ULL;
+  for (auto it = pending_.begin(); it != pending_.end();) {
+    if (now - it->second.start_usec >= timeout_usec) {
+      stats_->AddFailure(it->second.kind);
+      it = pending_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+uint64_t LoadHandler::NextDeadline(uint64_t now, double mean_interval) {
+  if (mean_interval <= 0) {
+    return 0;
+  }
+
+  // exponential intervals, boxes act independently of each other
+  std::exponential_distribution<double> dist(1.0 / mean_interval);
+  return now + static_cast<uint64_t>(dist(random_) * 1000000.0) + 1;
+}
+
+void LoadHandler::Zap(LoadClient* client) {
+  const LoadClient::channels_t& channels = client->GetChannels();
+  if (channels.empty()) {
+    return;
+  }
+
+  std::uniform_int_distribution<size_t> dist(0, channels.size() - 1);
+  const stream_id sid = channels[dist(random_)];
+  client->SetCurrentChannel(sid);
+  const common::protocols::three_way_handshake::cmd_request_t request =
+      client->IsPeerSupport(fastotv::inner::InnerClient::BINARY_COMMANDS_FEATURE)
+          ? fastotv::inner::MakeBinaryRequest(NextRequestID(client), CLIENT_GET_RUNTIME_CHANNEL_INFO, sid)
+          : fastotv::client::GetRuntimeChannelInfoRequest(NextRequestID(client), sid);
+  WriteTracked(client, request, LoadStats::RUNTIME_INFO);
+}
+
+void LoadHandler::SendChat(LoadClient* client) {
+  const stream_id sid = client->GetCurrentChannel();
+  if (sid == invalid_stream_id) {
+    return;
+  }
+
+  const ChatMessage msg(sid, client->GetAuthInfo().GetLogin(), "load test message", ChatMessage::MESSAGE);
+  if (client->IsPeerSupport(fastotv::inner::InnerClient::BINARY_COMMANDS_FEATURE)) {
+    std::string msg_bin;
+    fastotv::inner::BinarySerialize(msg, &msg_bin);
+    WriteTracked(client, fastotv::inner::MakeBinaryRequest(NextRequestID(client), CLIENT_SEND_CHAT_MESSAGE, msg_bin),
+                 LoadStats::CHAT);
+    return;
+  }
+
+  serializet_t msg_ser;
+  common::Error err = msg.SerializeToString(&msg_ser);
+  if (err) {
+    DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+    return;
+  }
+
+  WriteTracked(client, fastotv::client::SendChatMessageRequest(NextRequestID(client), msg_ser), LoadStats::CHAT);
+}
+
+void LoadHandler::SendPing(LoadClient* client) {
+  const common::protocols::three_way_handshake::cmd_request_t request =
+      client->IsPeerSupport(fastotv::inner::InnerClient::BINARY_COMMANDS_FEATURE)
+          ? fastotv::inner::MakeBinaryRequest(NextRequestID(client), CLIENT_PING)
+          : fastotv::client::PingRequest(NextRequestID(client));
+  WriteTracked(client, request, LoadStats::PING);
+}
+
+void LoadHandler::WriteTracked(LoadClient* client,
+                               const common::protocols::three_way_handshake::cmd_request_t& request,
+                               LoadStats::sample_t kind) {
+  // ids of this parser are unique between its connections, server requests can reuse them,
+  // so answers are matched here by responce id and connection instead of SubscribeRequest
+  common::Error err = client->Write(request);
+  if (err) {
+    DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+    stats_->AddFailure(kind);
+    CloseClient(client);
+    return;
+  }
+
+  PendingCommand pending = {client, kind, LoadStats::NowUsec()};
+  pending_[request.GetId()] = pending;
+}
+
+void LoadHandler::FinishTracked(LoadClient* client,
+                                const common::protocols::three_way_handshake::cmd_seq_t& id,
+                                bool success) {
+  auto it = pending_.find(id);
+  if (it == pending_.end() || it->second.client != client) {
+    return;
+  }
+
+  if (success) {
+    stats_->AddSample(it->second.kind, LoadStats::NowUsec() - it->second.start_usec);
+  } else {
+    stats_->AddFailure(it->second.kind);
+  }
+  pending_.erase(it);
+}
+
+template <typename T>
+void LoadHandler::WriteOrClose(LoadClient* client, const T& command) {
+  common::Error err = client->Write(command);
+  if (err) {
+    DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+    CloseClient(client);
+  }
+}
+
+void LoadHandler::CloseClient(LoadClient* client) {
+  common::Error err = client->Close();
+  DCHECK(!err);
+  delete client;
+}
+
+void LoadHandler::HandleInnerRequestCommand(fastotv::inner::InnerClient* connection,
+                                            common::protocols::three_way_handshake::cmd_seq_t id,
+                                            int argc,
+                                            char* argv[]) {
+  LoadClient* client = static_cast<LoadClient*>(connection);
+  char* command = argv[0];
+
+  if (IS_EQUAL_COMMAND(command, SERVER_PING)) {
+    ServerPingInfo ping;
+    if (IsBinaryCommand()) {
+      std::string ping_bin;
+      fastotv::inner::BinarySerialize(ping, &ping_bin);
+      WriteOrClose(client, fastotv::inner::MakeBinaryResponce(id, SUCCESS_COMMAND, SERVER_PING, ping_bin));
+      return;
+    }
+
+    serializet_t ping_str;
+    common::Error err = ping.SerializeToString(&ping_str);
+    if (err) {
+      DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+      return;
+    }
+    WriteOrClose(client, fastotv::client::PingResponceSuccsess(id, ping_str));
+    return;
+  } else if (IS_EQUAL_COMMAND(command, SERVER_WHO_ARE_YOU)) {
+    json_object* jauth = NULL;
+    common::Error err = client->GetAuthInfo().Serialize(&jauth);
+    if (err) {
+      DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+      return;
+    }
+    json_object_object_add(jauth, PROTOCOL_FEATURES_FIELD,
+                           json_object_new_int(fastotv::inner::InnerClient::supported_features));
+
+    const std::string auth_str = json_object_get_string(jauth);
+    json_object_put(jauth);
+    WriteOrClose(client, fastotv::client::WhoAreYouResponceSuccsess(id, auth_str));
+    return;
+  } else if (IS_EQUAL_COMMAND(command, SERVER_GET_CLIENT_INFO)) {
+    const ClientInfo info(client->GetAuthInfo().GetLogin(), "Load generator", "Simulated", 0, 0, 0);
+    if (IsBinaryCommand()) {
+      std::string info_bin;
+      fastotv::inner::BinarySerialize(info, &info_bin);
+      WriteOrClose(client, fastotv::inner::MakeBinaryResponce(id, SUCCESS_COMMAND, SERVER_GET_CLIENT_INFO, info_bin));
+      return;
+    }
+
+    serializet_t info_json_string;
+    common::Error err = info.SerializeToString(&info_json_string);
+    if (err) {
+      DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+      return;
+    }
+    WriteOrClose(client, fastotv::client::SystemInfoResponceSuccsess(id, info_json_string));
+    return;
+  } else if (IS_EQUAL_COMMAND(command, SERVER_SEND_CHAT_MESSAGE)) {
+    ChatMessage msg;
+    common::Error err = ParseArgument(argc, argv, 1, &msg);
+    if (err) {
+      DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+      return;
+    }
+
+    if (IsBinaryCommand()) {
+      std::string msg_bin;
+      fastotv::inner::BinarySerialize(msg, &msg_bin);
+      WriteOrClose(client, fastotv::inner::MakeBinaryResponce(id, SUCCESS_COMMAND, SERVER_SEND_CHAT_MESSAGE, msg_bin));
+      return;
+    }
+    WriteOrClose(client, fastotv::client::SendChatMessageResponceSuccsess(id, argv[1]));
+    return;
+  }
+
+  WARNING_LOG() << "UNKNOWN REQUEST COMMAND: " << command;
+}
+
+void LoadHandler::HandleInnerResponceCommand(fastotv::inner::InnerClient* connection,
+                                             common::protocols::three_way_handshake::cmd_seq_t id,
+                                             int argc,
+                                             char* argv[]) {
+  LoadClient* client = static_cast<LoadClient*>(connection);
+  char* state_command = argv[0];
+  if (argc < 2) {
+    WARNING_LOG() << "UNKNOWN STATE COMMAND: " << state_command;
+    return;
+  }
+
+  const bool success = IS_EQUAL_COMMAND(state_command, SUCCESS_COMMAND);
+  FinishTracked(client, id, success);
+  if (!success) {
+    return;
+  }
+
+  char* command = argv[1];
+  if (IS_EQUAL_COMMAND(command, CLIENT_PING)) {
+    WriteOrClose(client, IsBinaryCommand() ? fastotv::inner::MakeBinaryApprove(id, SUCCESS_COMMAND, CLIENT_PING)
+                                           : fastotv::client::PingApproveResponceSuccsess(id));
+  } else if (IS_EQUAL_COMMAND(command, CLIENT_GET_CHANNELS)) {
+    common::Error err = HandleChannelsResponce(client, argc, argv);
+    if (err) {
+      WriteOrClose(client, fastotv::client::GetChannelsApproveResponceFail(id, err->GetDescription()));
+      return;
+    }
+    WriteOrClose(client, fastotv::client::GetChannelsApproveResponceSuccsess(id));
+  } else if (IS_EQUAL_COMMAND(command, CLIENT_GET_RUNTIME_CHANNEL_INFO)) {
+    RuntimeChannelInfo chan;
+    common::Error err = ParseArgument(argc, argv, 2, &chan);
+    if (err) {
+      WriteOrClose(client, fastotv::client::GetRuntimeChannelInfoApproveResponceFail(id, err->GetDescription()));
+      return;
+    }
+    WriteOrClose(client, IsBinaryCommand()
+                             ? fastotv::inner::MakeBinaryApprove(id, SUCCESS_COMMAND, CLIENT_GET_RUNTIME_CHANNEL_INFO)
+                             : fastotv::client::GetRuntimeChannelInfoApproveResponceSuccsess(id));
+  } else if (IS_EQUAL_COMMAND(command, CLIENT_SEND_CHAT_MESSAGE)) {
+    WriteOrClose(client, IsBinaryCommand()
+                             ? fastotv::inner::MakeBinaryApprove(id, SUCCESS_COMMAND, CLIENT_SEND_CHAT_MESSAGE)
+                             : fastotv::client::SendChatMessageApproveResponceSuccsess(id));
+  }
+}
+
+void LoadHandler::HandleInnerApproveCommand(fastotv::inner::InnerClient* connection,
+                                            common::protocols::three_way_handshake::cmd_seq_t id,
+                                            int argc,
+                                            char* argv[]) {
+  UNUSED(id);
+  LoadClient* client = static_cast<LoadClient*>(connection);
+  char* command = argv[0];
+  if (argc < 2 || !IS_EQUAL_COMMAND(argv[1], SERVER_WHO_ARE_YOU)) {
+    return;
+  }
+
+  if (!IS_EQUAL_COMMAND(command, SUCCESS_COMMAND)) {
+    WARNING_LOG() << "Client " << client->GetAuthInfo().GetLogin()
+                  << " not authorized: " << (argc > 2 ? argv[2] : "Unknown");
+    stats_->AddFailure(LoadStats::CONNECT);
+    CloseClient(client);
+    return;
+  }
+
+  if (argc > 2) {  // old servers don't send features
+    client->SetPeerFeatures(strtoul(argv[2], NULL, 10));
+  }
+  client->SetName(client->GetAuthInfo().GetLogin());
+  stats_->AddSample(LoadStats::CONNECT, LoadStats::NowUsec() - client->GetConnectStart());
+  client->SetAuthorized(true);
+
+  // startup sequence of the player
+  WriteTracked(client, fastotv::client::GetServerInfoRequest(NextRequestID(client)), LoadStats::SERVER_INFO);
+  if (client != dispatching_client_) {
+    return;
+  }
+  WriteTracked(client, fastotv::client::GetChannelsRequest(NextRequestID(client)), LoadStats::CHANNELS);
+}
+
+common::Error LoadHandler::HandleChannelsResponce(LoadClient* client, int argc, char* argv[]) {
+  if (argc < 3 || !argv[2]) {
+    return common::make_error_inval();
+  }
+
+  json_object* obj = json_tokener_parse(argv[2]);
+  if (!obj) {
+    return common::make_error_inval();
+  }
+
+  ChannelsInfo chan;
+  common::Error err = ChannelsInfo::DeSerialize(obj, &chan);
+  json_object_put(obj);
+  if (err) {
+    return err;
+  }
+
+  LoadClient::channels_t channels;
+  for (const ChannelInfo& info : chan.GetChannels()) {
+    channels.push_back(info.GetId());
+  }
+  client->SetChannels(channels);
+
+  // tune in right away, then act on own schedule
+  const uint64_t now = LoadStats::NowUsec();
+  client->SetNextAction(LoadClient::ZAP, now);
+  client->SetNextAction(LoadClient::CHAT, NextDeadline(now, config_.chat_interval));
+  client->SetNextAction(LoadClient::PING, now + ping_interval * 1000000ULL);
+  return common::Error();
+}
+
+}  // namespace load
+}  // namespace fastotv
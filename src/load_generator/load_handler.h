@@ -0,0 +1,142 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>      // for uint64_t
+#include <sys/socket.h>  // for sockaddr_storage, socklen_t
+
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <common/libev/io_loop_observer.h>  // for IoLoopObserver
+#include <common/net/types.h>               // for HostAndPort
+
+#include "inner/inner_server_command_seq_parser.h"  // for InnerServerCommandSeqParser
+
+#include "load_generator/load_stats.h"  // for LoadStats
+
+namespace fastotv {
+namespace load {
+
+class LoadClient;
+
+struct LoadConfig {
+  LoadConfig();
+
+  common::net::HostAndPort server_host;
+  size_t clients;        // total, split between loops
+  size_t loops;          // worker threads
+  size_t users;          // distinct logins, other clients are extra devices of the same users
+  double ramp_up_rate;   // new connections per second of all loops, 0 connects everything at once
+  double zap_interval;   // mean seconds between channel switches of one client, 0 disables
+  double chat_interval;  // mean seconds between chat messages of one client, 0 disables
+};
+
+// Drives a slice of simulated clients in one loop: client indexes first, first + step, ...
+// Speaks the protocol as the player does and records answer latencies into shared LoadStats.
+class LoadHandler : public fastotv::inner::InnerServerCommandSeqParser, public common::libev::IoLoopObserver {
+ public:
+  enum {
+    tick_msec = 100,
+    ping_interval = 30,     // sec, like player
+    request_timeout = 30,   // sec, unanswered commands and unfinished connects are counted as failed
+    max_connects_per_tick = 256
+  };
+
+  LoadHandler(const LoadConfig& config, size_t first_client, size_t step, LoadStats* stats);
+  virtual ~LoadHandler();
+
+  virtual void PreLooped(common::libev::IoLoop* server) override;
+  virtual void Accepted(common::libev::IoClient* client) override;
+  virtual void Moved(common::libev::IoLoop* server, common::libev::IoClient* client) override;
+  virtual void Closed(common::libev::IoClient* client) override;
+  virtual void DataReceived(common::libev::IoClient* client) override;
+  virtual void DataReadyToWrite(common::libev::IoClient* client) override;
+  virtual void PostLooped(common::libev::IoLoop* server) override;
+  virtual void TimerEmited(common::libev::IoLoop* server, common::libev::timer_id_t id) override;
+#if LIBEV_CHILD_ENABLE
+  virtual void ChildStatusChanged(common::libev::IoLoop* server, pid_t id, int status) override;
+#endif
+
+ private:
+  struct PendingCommand {
+    LoadClient* client;  // only compared, can be already deleted
+    LoadStats::sample_t kind;
+    uint64_t start_usec;
+  };
+  typedef std::unordered_map<common::protocols::three_way_handshake::cmd_seq_t, PendingCommand> pending_t;
+
+  common::Error ResolveServer() WARN_UNUSED_RESULT;
+  void RampUp(common::libev::IoLoop* server, uint64_t now);
+  void ConnectClient(common::libev::IoLoop* server, size_t index);
+  // completes non-blocking connect, false if it failed and client was closed
+  bool FinishConnect(LoadClient* client);
+  void ExpireConnecting(uint64_t now);
+  void RunActions(uint64_t now);
+  void ExpirePending(uint64_t now);
+  uint64_t NextDeadline(uint64_t now, double mean_interval);
+
+  void Zap(LoadClient* client);
+  void SendChat(LoadClient* client);
+  void SendPing(LoadClient* client);
+
+  // request which answer latency is recorded
+  void WriteTracked(LoadClient* client,
+                    const common::protocols::three_way_handshake::cmd_request_t& request,
+                    LoadStats::sample_t kind);
+  void FinishTracked(LoadClient* client, const common::protocols::three_way_handshake::cmd_seq_t& id, bool success);
+  template <typename T>
+  void WriteOrClose(LoadClient* client, const T& command);
+  void CloseClient(LoadClient* client);
+
+  virtual void HandleInnerRequestCommand(fastotv::inner::InnerClient* connection,
+                                         common::protocols::three_way_handshake::cmd_seq_t id,
+                                         int argc,
+                                         char* argv[]) override;
+  virtual void HandleInnerResponceCommand(fastotv::inner::InnerClient* connection,
+                                          common::protocols::three_way_handshake::cmd_seq_t id,
+                                          int argc,
+                                          char* argv[]) override;
+  virtual void HandleInnerApproveCommand(fastotv::inner::InnerClient* connection,
+                                         common::protocols::three_way_handshake::cmd_seq_t id,
+                                         int argc,
+                                         char* argv[]) override;
+
+  common::Error HandleChannelsResponce(LoadClient* client, int argc, char* argv[]) WARN_UNUSED_RESULT;
+
+  const LoadConfig config_;
+  const size_t first_client_;
+  const size_t step_;
+  LoadStats* const stats_;
+
+  struct sockaddr_storage server_addr_;  // resolved once, getaddrinfo blocks
+  socklen_t server_addr_len_;            // 0 if not resolved
+  size_t next_client_;                   // next index to connect
+  uint64_t ramp_start_usec_;
+  common::libev::timer_id_t tick_timer_;
+  std::vector<LoadClient*> clients_;
+  LoadClient* dispatching_client_;  // reset in Closed
+  pending_t pending_;
+  std::mt19937 random_;
+};
+
+}  // namespace load
+}  // namespace fastotv
@@ -0,0 +1,37 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "load_generator/load_loop.h"
+
+#include "load_generator/load_client.h"
+
+namespace fastotv {
+namespace load {
+
+LoadLoop::LoadLoop(common::libev::IoLoopObserver* observer) : IoLoop(new common::libev::LibEvLoop, observer) {}
+
+const char* LoadLoop::ClassName() const {
+  return "LoadLoop";
+}
+
+common::libev::IoClient* LoadLoop::CreateClient(const common::net::socket_info& info) {
+  return new LoadClient(this, info);
+}
+
+}  // namespace load
+}  // namespace fastotv
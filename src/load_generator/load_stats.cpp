@@ -0,0 +1,150 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "load_generator/load_stats.h"
+
+#include <algorithm>  // for max, sort
+#include <chrono>
+
+#include <common/sprintf.h>  // for MemSPrintf
+
+namespace fastotv {
+namespace load {
+namespace {
+const char* const samples_names[LoadStats::samples_count] = {"connect",      "get_server_info", "get_channels",
+                                                              "runtime_info", "chat",            "ping"};
+
+double percentile_msec(const std::vector<uint32_t>& sorted, double p) {
+  if (sorted.empty()) {
+    return 0;
+  }
+  size_t pos = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+  return sorted[pos] / 1000.0;
+}
+}  // namespace
+
+LoadStats::LoadStats()
+    : mutex_(),
+      samples_(),
+      random_(),
+      connected_(0),
+      answered_(0),
+      last_answered_(0),
+      last_wire_in_(0),
+      last_wire_out_(0),
+      traffic_() {
+  for (size_t i = 0; i < samples_count; ++i) {
+    samples_[i].max = 0;
+    samples_[i].seen = 0;
+    samples_[i].failures = 0;
+  }
+  traffic_.bytes_in = 0;
+  traffic_.bytes_out = 0;
+  traffic_.wire_bytes_in = 0;
+  traffic_.wire_bytes_out = 0;
+  traffic_.queued_bytes = 0;
+  traffic_.dropped_messages = 0;
+}
+
+uint64_t LoadStats::NowUsec() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void LoadStats::AddSample(sample_t kind, uint64_t usec) {
+  const uint32_t value = usec > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(usec);
+  std::lock_guard<std::mutex> lock(mutex_);
+  Samples& samples = samples_[kind];
+  samples.seen++;
+  samples.max = std::max(samples.max, value);
+  answered_++;
+  if (samples.values.size() < max_samples) {
+    samples.values.push_back(value);
+    return;
+  }
+
+  std::uniform_int_distribution<uint64_t> dist(0, samples.seen - 1);
+  const uint64_t pos = dist(random_);
+  if (pos < max_samples) {
+    samples.values[pos] = value;
+  }
+}
+
+void LoadStats::AddFailure(sample_t kind) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  samples_[kind].failures++;
+}
+
+void LoadStats::ClientConnected() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  connected_++;
+}
+
+void LoadStats::ClientDisconnected() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  connected_--;
+}
+
+fastotv::inner::InnerClient::TrafficStats* LoadStats::GetTrafficStats() {
+  return &traffic_;
+}
+
+std::string LoadStats::MakeProgressReport(uint64_t elapsed_usec) {
+  const uint64_t wire_in = traffic_.wire_bytes_in;
+  const uint64_t wire_out = traffic_.wire_bytes_out;
+  std::lock_guard<std::mutex> lock(mutex_);
+  const double sec = elapsed_usec ? elapsed_usec / 1000000.0 : 1;
+  const std::string line = common::MemSPrintf(
+      "clients: %lld, answered: %.0f cmd/s, in: %.1f KiB/s, out: %.1f KiB/s", static_cast<long long>(connected_),
+      (answered_ - last_answered_) / sec, (wire_in - last_wire_in_) / 1024.0 / sec,
+      (wire_out - last_wire_out_) / 1024.0 / sec);
+  last_answered_ = answered_;
+  last_wire_in_ = wire_in;
+  last_wire_out_ = wire_out;
+  return line;
+}
+
+std::string LoadStats::MakeFinalReport(uint64_t elapsed_usec) const {
+  const double sec = elapsed_usec ? elapsed_usec / 1000000.0 : 1;
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::string report =
+      common::MemSPrintf("%-16s %10s %8s %9s %9s %9s %9s\n", "command", "count", "failed", "p50 ms", "p90 ms",
+                         "p99 ms", "max ms");
+  for (size_t i = 0; i < samples_count; ++i) {
+    std::vector<uint32_t> sorted = samples_[i].values;
+    std::sort(sorted.begin(), sorted.end());
+    report += common::MemSPrintf("%-16s %10llu %8llu %9.2f %9.2f %9.2f %9.2f\n", samples_names[i],
+                                 static_cast<unsigned long long>(samples_[i].seen),
+                                 static_cast<unsigned long long>(samples_[i].failures), percentile_msec(sorted, 0.5),
+                                 percentile_msec(sorted, 0.9), percentile_msec(sorted, 0.99),
+                                 samples_[i].max / 1000.0);
+  }
+
+  const uint64_t bytes_in = traffic_.bytes_in;
+  const uint64_t wire_in = traffic_.wire_bytes_in;
+  const uint64_t bytes_out = traffic_.bytes_out;
+  const uint64_t wire_out = traffic_.wire_bytes_out;
+  report += common::MemSPrintf("throughput: %.0f cmd/s, received %.1f KiB/s (%.1f KiB/s decompressed), ",
+                               answered_ / sec, wire_in / 1024.0 / sec, bytes_in / 1024.0 / sec);
+  report += common::MemSPrintf("sent %.1f KiB/s (%.1f KiB/s before compression)\n", wire_out / 1024.0 / sec,
+                               bytes_out / 1024.0 / sec);
+  return report;
+}
+
+}  // namespace load
+}  // namespace fastotv
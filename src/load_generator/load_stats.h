@@ -0,0 +1,81 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>  // for uint64_t
+
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <common/macros.h>  // for DISALLOW_COPY_AND_ASSIGN
+
+#include "inner/inner_client.h"  // for InnerClient::TrafficStats
+
+namespace fastotv {
+namespace load {
+
+// Latency samples and counters shared by all load loops, thread-safe.
+// Every kind keeps at most max_samples values (reservoir sampling), enough for stable percentiles,
+// the maximum is tracked over all samples since a reservoir can miss the single worst one.
+class LoadStats {
+ public:
+  enum sample_t { CONNECT = 0, SERVER_INFO, CHANNELS, RUNTIME_INFO, CHAT, PING };
+  enum { samples_count = PING + 1, max_samples = 100000 };
+
+  LoadStats();
+
+  static uint64_t NowUsec();  // monotonic
+
+  void AddSample(sample_t kind, uint64_t usec);
+  void AddFailure(sample_t kind);
+  void ClientConnected();
+  void ClientDisconnected();
+
+  fastotv::inner::InnerClient::TrafficStats* GetTrafficStats();
+
+  // one line: connected clients, answered commands per second and traffic since previous call
+  std::string MakeProgressReport(uint64_t elapsed_usec);
+  // percentiles table of whole run
+  std::string MakeFinalReport(uint64_t elapsed_usec) const;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(LoadStats);
+
+  struct Samples {
+    std::vector<uint32_t> values;  // usec
+    uint32_t max;                  // usec
+    uint64_t seen;
+    uint64_t failures;
+  };
+
+  mutable std::mutex mutex_;
+  Samples samples_[samples_count];
+  std::mt19937 random_;
+  int64_t connected_;
+  uint64_t answered_;
+  uint64_t last_answered_;
+  uint64_t last_wire_in_;
+  uint64_t last_wire_out_;
+  fastotv::inner::InnerClient::TrafficStats traffic_;
+};
+
+}  // namespace load
+}  // namespace fastotv
@@ -0,0 +1,216 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include <signal.h>  // for signal, SIGINT
+#include <stdio.h>   // for fprintf, stderr
+#include <stdlib.h>  // for exit, EXIT_FAILURE
+#include <unistd.h>  // for getopt, optarg, sleep
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <common/convert2string.h>          // for ConvertFromString, ConvertToString
+#include <common/logger.h>                  // for INFO_LOG
+#include <common/threads/thread_manager.h>  // for THREAD_MANAGER
+
+#include "load_generator/load_handler.h"
+#include "load_generator/load_loop.h"
+#include "load_generator/load_stats.h"
+#include "load_generator/redis_stand_in.h"
+
+#define DEFAULT_SERVER_HOST "127.0.0.1"
+
+namespace {
+volatile sig_atomic_t stop_requested = 0;
+
+void stop_handler(int sig) {
+  UNUSED(sig);
+  stop_requested = 1;
+}
+
+void usage(const char* name) {
+  fprintf(stderr,
+          "Usage: %s [options]\n"
+          "  -s host:port  server address, default " DEFAULT_SERVER_HOST ":%d\n"
+          "  -n count      clients, default 1000\n"
+          "  -u count      distinct users, other clients are extra devices, default 100\n"
+          "  -r rate       new connections per second, 0 opens all at once, default 100\n"
+          "  -z sec        mean interval between channel switches of a client, 0 disables, default 60\n"
+          "  -m sec        mean interval between chat messages of a client, 0 disables, default 120\n"
+          "  -w count      worker loops, default 1\n"
+          "  -d sec        test duration, 0 runs until interrupted, default 60\n"
+          "  -p host:port  serve generated users as Redis on this address, point server redis_server here\n"
+          "  -c count      channels of generated users, default 50\n",
+          name, SERVICE_HOST_PORT);
+}
+
+template <typename T>
+T parse_arg(const char* name, const char* value) {
+  T result;
+  if (!common::ConvertFromString(std::string(value), &result)) {
+    fprintf(stderr, "Invalid value of %s: %s\n", name, value);
+    exit(EXIT_FAILURE);
+  }
+  return result;
+}
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  enum { report_interval = 5 };  // sec
+
+  fastotv::load::LoadConfig config;
+  config.server_host = common::net::HostAndPort(DEFAULT_SERVER_HOST, SERVICE_HOST_PORT);
+  size_t duration = 60;
+  size_t channels = 50;
+  bool redis_stand_in = false;
+  common::net::HostAndPort redis_host;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "s:n:u:r:z:m:w:d:p:c:")) != -1) {
+    switch (opt) {
+      case 's':
+        config.server_host = parse_arg<common::net::HostAndPort>("-s", optarg);
+        break;
+      case 'n':
+        config.clients = parse_arg<size_t>("-n", optarg);
+        break;
+      case 'u':
+        config.users = parse_arg<size_t>("-u", optarg);
+        break;
+      case 'r':
+        config.ramp_up_rate = parse_arg<double>("-r", optarg);
+        break;
+      case 'z':
+        config.zap_interval = parse_arg<double>("-z", optarg);
+        break;
+      case 'm':
+        config.chat_interval = parse_arg<double>("-m", optarg);
+        break;
+      case 'w':
+        config.loops = parse_arg<size_t>("-w", optarg);
+        break;
+      case 'd':
+        duration = parse_arg<size_t>("-d", optarg);
+        break;
+      case 'p':
+        redis_host = parse_arg<common::net::HostAndPort>("-p", optarg);
+        redis_stand_in = true;
+        break;
+      case 'c':
+        channels = parse_arg<size_t>("-c", optarg);
+        break;
+      default: /* '?' */
+        usage(argv[0]);
+        exit(EXIT_FAILURE);
+    }
+  }
+
+  if (config.clients == 0 || config.users == 0 || config.loops == 0) {
+    usage(argv[0]);
+    exit(EXIT_FAILURE);
+  }
+
+#if defined(NDEBUG)
+  common::logging::LOG_LEVEL level = common::logging::LOG_LEVEL_INFO;
+#else
+  common::logging::LOG_LEVEL level = common::logging::LOG_LEVEL_DEBUG;
+#endif
+  INIT_LOGGER(PROJECT_NAME_LOAD_GENERATOR_TITLE, level);
+
+  std::unique_ptr<fastotv::load::RedisStandIn> redis;
+  std::shared_ptr<common::threads::Thread<void>> redis_thread;
+  if (redis_stand_in) {
+    const size_t devices_per_user = (config.clients + config.users - 1) / config.users;
+    redis.reset(new fastotv::load::RedisStandIn(redis_host, config.users, devices_per_user, channels));
+    common::Error err = redis->Bind();
+    if (err) {
+      DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+      return EXIT_FAILURE;
+    }
+    redis_thread = THREAD_MANAGER()->CreateThread(&fastotv::load::RedisStandIn::Run, redis.get());
+    if (!redis_thread->Start()) {
+      WARNING_LOG() << "Can't start Redis stand-in thread";
+      return EXIT_FAILURE;
+    }
+  }
+
+  signal(SIGINT, stop_handler);
+  signal(SIGTERM, stop_handler);
+
+  fastotv::load::LoadStats stats;
+  std::vector<fastotv::load::LoadHandler*> handlers;
+  std::vector<fastotv::load::LoadLoop*> loops;
+  std::vector<std::shared_ptr<common::threads::Thread<int>>> threads;
+  bool started = true;
+  for (size_t i = 0; i < config.loops; ++i) {
+    fastotv::load::LoadHandler* handler = new fastotv::load::LoadHandler(config, i, config.loops, &stats);
+    fastotv::load::LoadLoop* loop = new fastotv::load::LoadLoop(handler);
+    loop->SetName("load_loop_" + common::ConvertToString(i));
+    auto thread = THREAD_MANAGER()->CreateThread(&fastotv::load::LoadLoop::Exec, loop);
+    if (!thread->Start()) {
+      // clients of this loop would never connect and the report would describe a smaller load than requested
+      fprintf(stderr, "Can't start thread for %s\n", loop->GetFormatedName().c_str());
+      delete loop;
+      delete handler;
+      started = false;
+      break;
+    }
+    handlers.push_back(handler);
+    loops.push_back(loop);
+    threads.push_back(thread);
+  }
+
+  const uint64_t start = fastotv::load::LoadStats::NowUsec();
+  uint64_t last_report = start;
+  while (started && !stop_requested) {
+    sleep(1);
+    const uint64_t now = fastotv::load::LoadStats::NowUsec();
+    if (duration && now - start >= duration * 1000000ULL) {
+      break;
+    }
+    if (now - last_report >= report_interval * 1000000ULL) {
+      INFO_LOG() << stats.MakeProgressReport(now - last_report);
+      last_report = now;
+    }
+  }
+
+  const uint64_t elapsed = fastotv::load::LoadStats::NowUsec() - start;
+  for (fastotv::load::LoadLoop* loop : loops) {
+    loop->Stop();
+  }
+  for (auto thread : threads) {
+    thread->Join();
+  }
+  for (size_t i = 0; i < loops.size(); ++i) {
+    delete loops[i];
+    delete handlers[i];
+  }
+
+  if (redis) {
+    redis->Stop();
+    redis_thread->Join();
+  }
+
+  if (!started) {
+    return EXIT_FAILURE;
+  }
+
+  fprintf(stdout, "%s", stats.MakeFinalReport(elapsed).c_str());
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,315 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "load_generator/redis_stand_in.h"
+
+#include <ctype.h>  // for toupper
+#include <errno.h>
+#include <poll.h>
+#include <stdlib.h>  // for strtoul
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <common/convert2string.h>  // for ConvertToString
+#include <common/logger.h>          // for WARNING_LOG
+#include <common/sprintf.h>         // for MemSPrintf
+
+#include "server/inner/inner_tcp_acceptor.h"  // for CreateReusePortListener
+#include "server/user_info.h"                 // for UserInfo
+
+#define LOAD_LOGIN_PREFIX "load"
+#define LOAD_LOGIN_SUFFIX "@fastotv.com"
+#define LOAD_PASSWORD "load"
+#define CHAT_CHANNELS_KEY "chat_channels"
+#define ID_FIELD "id"
+
+namespace fastotv {
+namespace load {
+namespace {
+bool write_all(int fd, const std::string& data) {
+  size_t offset = 0;
+  while (offset < data.size()) {
+    ssize_t res = send(fd, data.data() + offset, data.size() - offset, MSG_NOSIGNAL);
+    if (res < 0 && errno == EINTR) {
+      continue;
+    }
+    if (res <= 0) {
+      return false;
+    }
+    offset += res;
+  }
+  return true;
+}
+
+std::string make_bulk(const std::string& value) {
+  return "$" + common::ConvertToString(value.size()) + "\r\n" + value + "\r\n";
+}
+
+std::string make_login(size_t user) {
+  return common::MemSPrintf(LOAD_LOGIN_PREFIX "%llu" LOAD_LOGIN_SUFFIX, static_cast<unsigned long long>(user));
+}
+
+device_id_t make_device(size_t device) {
+  return common::MemSPrintf("load_device_%llu", static_cast<unsigned long long>(device));
+}
+
+bool read_line(const std::string& input, size_t* pos, std::string* line) {
+  const size_t end = input.find("\r\n", *pos);
+  if (end == std::string::npos) {
+    return false;
+  }
+
+  *line = input.substr(*pos, end - *pos);
+  *pos = end + 2;
+  return true;
+}
+
+// hiredis sends multibulk commands, inline form is accepted for manual checks with telnet
+// returns false if more data needed, *error on malformed input
+bool parse_command(const std::string& input, size_t* consumed, std::vector<std::string>* argv, bool* error) {
+  size_t pos = 0;
+  std::string line;
+  if (!read_line(input, &pos, &line)) {
+    return false;
+  }
+
+  std::vector<std::string> args;
+  if (line.empty() || line[0] != '*') {
+    size_t start = 0;
+    while (start < line.size()) {
+      size_t end = line.find(' ', start);
+      if (end == std::string::npos) {
+        end = line.size();
+      }
+      if (end > start) {
+        args.push_back(line.substr(start, end - start));
+      }
+      start = end + 1;
+    }
+    *consumed = pos;
+    argv->swap(args);
+    return true;
+  }
+
+  const unsigned long count = strtoul(line.c_str() + 1, NULL, 10);
+  for (unsigned long i = 0; i < count; ++i) {
+    if (!read_line(input, &pos, &line)) {
+      return false;
+    }
+    if (line.empty() || line[0] != '$') {
+      *error = true;
+      return false;
+    }
+
+    const size_t len = strtoul(line.c_str() + 1, NULL, 10);
+    if (input.size() < pos + len + 2) {
+      return false;
+    }
+    args.push_back(input.substr(pos, len));
+    pos += len + 2;
+  }
+
+  *consumed = pos;
+  argv->swap(args);
+  return true;
+}
+}  // namespace
+
+RedisStandIn::RedisStandIn(const common::net::HostAndPort& host,
+                           size_t users,
+                           size_t devices_per_user,
+                           size_t channels)
+    : host_(host),
+      users_(users),
+      devices_per_user_(devices_per_user),
+      channels_(),
+      chat_channels_reply_(),
+      listen_fd_(-1),
+      connections_(),
+      stop_(false) {
+  json_object* jchat = json_object_new_array();
+  for (size_t i = 0; i < channels; ++i) {
+    const stream_id sid = common::MemSPrintf("load_stream_%llu", static_cast<unsigned long long>(i));
+    const common::uri::Url url("http://localhost:8080/hls/" + sid + "/play.m3u8");
+    channels_.AddChannel(ChannelInfo(EpgInfo(sid, url, sid), true, true));
+    json_object_array_add(jchat, json_object_new_string(sid.c_str()));
+  }
+  chat_channels_reply_ = make_bulk(json_object_get_string(jchat));
+  json_object_put(jchat);
+}
+
+RedisStandIn::~RedisStandIn() {
+  for (const Connection& connection : connections_) {
+    close(connection.fd);
+  }
+  if (listen_fd_ != -1) {
+    close(listen_fd_);
+  }
+}
+
+AuthInfo RedisStandIn::MakeAuth(size_t client_index, size_t users) {
+  return AuthInfo(make_login(client_index % users), LOAD_PASSWORD, make_device(client_index / users));
+}
+
+common::Error RedisStandIn::Bind() {
+  if (listen_fd_ != -1) {
+    return common::Error();
+  }
+
+  return fastotv::server::inner::CreateReusePortListener(host_, SOMAXCONN, &listen_fd_);
+}
+
+void RedisStandIn::Run() {
+  std::vector<struct pollfd> pfds;
+  while (!stop_) {
+    pfds.resize(connections_.size() + 1);
+    pfds[0].fd = listen_fd_;
+    pfds[0].events = POLLIN;
+    pfds[0].revents = 0;
+    for (size_t i = 0; i < connections_.size(); ++i) {
+      pfds[i + 1].fd = connections_[i].fd;
+      pfds[i + 1].events = POLLIN;
+      pfds[i + 1].revents = 0;
+    }
+
+    int res = poll(pfds.data(), pfds.size(), poll_timeout_msec);
+    if (res <= 0) {
+      continue;
+    }
+
+    // connections are visited backward, closed ones are removed in place
+    for (size_t i = connections_.size(); i > 0; --i) {
+      if (!pfds[i].revents) {
+        continue;
+      }
+
+      Connection* connection = &connections_[i - 1];
+      char buff[4096];
+      ssize_t nread = recv(connection->fd, buff, sizeof(buff), 0);
+      if (nread < 0 && errno == EINTR) {
+        continue;
+      }
+      if (nread > 0) {
+        connection->input.append(buff, nread);
+      }
+      if (nread <= 0 || !ProcessInput(connection)) {
+        close(connection->fd);
+        connections_.erase(connections_.begin() + (i - 1));
+      }
+    }
+
+    if (pfds[0].revents & POLLIN) {
+      int cfd = accept(listen_fd_, NULL, NULL);
+      if (cfd != -1) {
+        Connection connection = {cfd, std::string()};
+        connections_.push_back(connection);
+      }
+    }
+  }
+}
+
+void RedisStandIn::Stop() {
+  stop_ = true;
+}
+
+bool RedisStandIn::ProcessInput(Connection* connection) {
+  while (true) {
+    size_t consumed = 0;
+    bool error = false;
+    std::vector<std::string> argv;
+    if (!parse_command(connection->input, &consumed, &argv, &error)) {
+      return !error && connection->input.size() < max_input_size;
+    }
+
+    connection->input.erase(0, consumed);
+    if (argv.empty()) {
+      continue;
+    }
+
+    if (!write_all(connection->fd, Execute(argv))) {
+      WARNING_LOG() << "Redis stand-in write failed: " << strerror(errno);
+      return false;
+    }
+  }
+}
+
+std::string RedisStandIn::Execute(const std::vector<std::string>& argv) const {
+  std::string command = argv[0];
+  for (char& c : command) {
+    c = toupper(c);
+  }
+
+  if (command == "PING") {
+    return "+PONG\r\n";
+  } else if (command == "GET" && argv.size() == 2) {
+    if (argv[1] == CHAT_CHANNELS_KEY) {
+      return chat_channels_reply_;
+    }
+    return MakeUserReply(argv[1]);
+  } else if (command == "SUBSCRIBE") {
+    std::string reply;
+    for (size_t i = 1; i < argv.size(); ++i) {
+      reply += "*3\r\n" + make_bulk("subscribe") + make_bulk(argv[i]) + ":" + common::ConvertToString(i) + "\r\n";
+    }
+    return reply;
+  } else if (command == "PUBLISH") {
+    return ":0\r\n";
+  } else if (command == "SELECT" || command == "AUTH") {
+    return "+OK\r\n";
+  }
+
+  return "-ERR unknown command '" + argv[0] + "'\r\n";
+}
+
+std::string RedisStandIn::MakeUserReply(const std::string& key) const {
+  static const std::string nil_reply = "$-1\r\n";
+  const size_t prefix_len = sizeof(LOAD_LOGIN_PREFIX) - 1;
+  const size_t suffix_len = sizeof(LOAD_LOGIN_SUFFIX) - 1;
+  if (key.size() <= prefix_len + suffix_len || key.compare(0, prefix_len, LOAD_LOGIN_PREFIX) != 0 ||
+      key.compare(key.size() - suffix_len, suffix_len, LOAD_LOGIN_SUFFIX) != 0) {
+    return nil_reply;
+  }
+
+  const size_t user = strtoul(key.c_str() + prefix_len, NULL, 10);
+  if (user >= users_ || make_login(user) != key) {
+    return nil_reply;
+  }
+
+  fastotv::server::UserInfo::devices_t devices;
+  for (size_t i = 0; i < devices_per_user_; ++i) {
+    devices.push_back(make_device(i));
+  }
+
+  const fastotv::server::UserInfo uinfo(key, LOAD_PASSWORD, channels_, devices);
+  json_object* juser = NULL;
+  common::Error err = uinfo.Serialize(&juser);
+  if (err) {
+    DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+    return nil_reply;
+  }
+
+  const std::string uid = common::MemSPrintf("load_user_%llu", static_cast<unsigned long long>(user));
+  json_object_object_add(juser, ID_FIELD, json_object_new_string(uid.c_str()));
+  const std::string reply = make_bulk(json_object_get_string(juser));
+  json_object_put(juser);
+  return reply;
+}
+
+}  // namespace load
+}  // namespace fastotv
@@ -0,0 +1,75 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <common/error.h>      // for Error
+#include <common/macros.h>     // for WARN_UNUSED_RESULT
+#include <common/net/types.h>  // for HostAndPort
+
+#include "auth_info.h"      // for AuthInfo
+#include "channels_info.h"  // for ChannelsInfo
+
+namespace fastotv {
+namespace load {
+
+// Answers the few Redis commands the server uses, so the server can be loaded without a real database:
+// GET <login> with generated users, GET chat_channels, SUBSCRIBE and PUBLISH (messages are dropped), PING.
+// All users have the same channels, every user has devices_per_user devices.
+class RedisStandIn {
+ public:
+  enum { poll_timeout_msec = 500, max_input_size = 1024 * 64 };
+
+  RedisStandIn(const common::net::HostAndPort& host, size_t users, size_t devices_per_user, size_t channels);
+  ~RedisStandIn();
+
+  // credentials of simulated client, client_index user and device are spread as in generated users
+  static AuthInfo MakeAuth(size_t client_index, size_t users);
+
+  common::Error Bind() WARN_UNUSED_RESULT;
+  void Run();  // until Stop
+  void Stop();
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(RedisStandIn);
+
+  struct Connection {
+    int fd;
+    std::string input;
+  };
+
+  bool ProcessInput(Connection* connection);  // false if connection should be closed
+  std::string Execute(const std::vector<std::string>& argv) const;
+  std::string MakeUserReply(const std::string& key) const;
+
+  const common::net::HostAndPort host_;
+  const size_t users_;
+  const size_t devices_per_user_;
+  ChannelsInfo channels_;
+  std::string chat_channels_reply_;
+  int listen_fd_;
+  std::vector<Connection> connections_;
+  std::atomic<bool> stop_;
+};
+
+}  // namespace load
+}  // namespace fastotv
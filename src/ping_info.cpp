@@ -27,6 +27,8 @@ namespace fastotv {
 
 ServerPingInfo::ServerPingInfo() : timestamp_(common::time::current_utc_mstime()) {}
 
+ServerPingInfo::ServerPingInfo(timestamp_t timestamp) : timestamp_(timestamp) {}
+
 common::Error ServerPingInfo::SerializeFields(json_object* obj) const {
   json_object_object_add(obj, SERVER_INFO_TIMESTAMP_FIELD, json_object_new_int64(timestamp_));
   return common::Error();
@@ -54,6 +56,8 @@ timestamp_t ServerPingInfo::GetTimeStamp() const {
 
 ClientPingInfo::ClientPingInfo() : timestamp_(common::time::current_utc_mstime()) {}
 
+ClientPingInfo::ClientPingInfo(timestamp_t timestamp) : timestamp_(timestamp) {}
+
 common::Error ClientPingInfo::SerializeFields(json_object* obj) const {
   json_object_object_add(obj, CLIENT_INFO_TIMESTAMP_FIELD, json_object_new_int64(timestamp_));
   return common::Error();
@@ -27,6 +27,7 @@ namespace fastotv {
 class ServerPingInfo : public JsonSerializerEx {
  public:
   ServerPingInfo();
+  explicit ServerPingInfo(timestamp_t timestamp);
 
   static common::Error DeSerialize(const serialize_type& serialized, ServerPingInfo* obj) WARN_UNUSED_RESULT;
 
@@ -42,6 +43,7 @@ class ServerPingInfo : public JsonSerializerEx {
 class ClientPingInfo : public JsonSerializerEx {
  public:
   ClientPingInfo();
+  explicit ClientPingInfo(timestamp_t timestamp);
 
   static common::Error DeSerialize(const serialize_type& serialized, ClientPingInfo* obj) WARN_UNUSED_RESULT;
 
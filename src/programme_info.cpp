@@ -18,6 +18,8 @@
 
 #include "programme_info.h"
 
+#include "serializer/json_reader.h"
+
 /*
 <programme start="20170613010000 +0000" stop="20170613020000 +0000" channel="FoxNews.us">
   <title lang="en">The Five</title>
@@ -94,6 +96,60 @@ common::Error ProgrammeInfo::DeSerialize(const serialize_type& serialized, Progr
   return common::Error();
 }
 
+common::Error ProgrammeInfo::DeSerialize(JsonReader* reader, ProgrammeInfo* obj) {
+  if (!reader || !obj) {
+    return common::make_error_inval();
+  }
+
+  common::Error err = reader->EnterObject();
+  if (err) {
+    return err;
+  }
+
+  stream_id channel;
+  int64_t start = 0;
+  int64_t stop = 0;
+  std::string title;
+  bool channel_exists = false, start_exists = false, stop_exists = false, title_exists = false;
+  std::string key;
+  bool has_next = false;
+  while (true) {
+    err = reader->NextField(&key, &has_next);
+    if (err) {
+      return err;
+    }
+    if (!has_next) {
+      break;
+    }
+
+    if (key == PROGRAMME_INFO_CHANNEL_FIELD) {
+      channel_exists = true;
+      err = reader->ReadString(&channel);
+    } else if (key == PROGRAMME_INFO_START_FIELD) {
+      start_exists = true;
+      err = reader->ReadInt64(&start);
+    } else if (key == PROGRAMME_INFO_STOP_FIELD) {
+      stop_exists = true;
+      err = reader->ReadInt64(&stop);
+    } else if (key == PROGRAMME_INFO_TITLE_FIELD) {
+      title_exists = true;
+      err = reader->ReadString(&title);
+    } else {
+      err = reader->SkipValue();
+    }
+    if (err) {
+      return err;
+    }
+  }
+
+  if (!channel_exists || !start_exists || !stop_exists || !title_exists) {
+    return common::make_error_inval();
+  }
+
+  *obj = fastotv::ProgrammeInfo(channel, start, stop, title);
+  return common::Error();
+}
+
 void ProgrammeInfo::SetChannel(stream_id channel) {
   channel_ = channel;
 }
@@ -44,6 +44,7 @@ class ProgrammeInfo : public JsonSerializerEx {
   std::string GetTitle() const;
 
   static common::Error DeSerialize(const serialize_type& serialized, ProgrammeInfo* obj) WARN_UNUSED_RESULT;
+  static common::Error DeSerialize(JsonReader* reader, ProgrammeInfo* obj) WARN_UNUSED_RESULT;
 
   bool Equals(const ProgrammeInfo& prog) const;
 
@@ -0,0 +1,114 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "programmes_info.h"
+
+#define PROGRAMMES_INFO_FROM_FIELD "from"
+#define PROGRAMMES_INFO_TO_FIELD "to"
+#define PROGRAMMES_INFO_PROGRAMMES_FIELD "programmes"
+
+namespace fastotv {
+
+ProgrammesInfo::ProgrammesInfo() : from_(0), to_(0), programmes_() {}
+
+ProgrammesInfo::ProgrammesInfo(timestamp_t from, timestamp_t to, const programmes_t& programmes)
+    : from_(from), to_(to), programmes_(programmes) {}
+
+timestamp_t ProgrammesInfo::GetFrom() const {
+  return from_;
+}
+
+timestamp_t ProgrammesInfo::GetTo() const {
+  return to_;
+}
+
+void ProgrammesInfo::AddProgramme(const ProgrammeInfo& programme) {
+  programmes_.push_back(programme);
+}
+
+ProgrammesInfo::programmes_t ProgrammesInfo::GetProgrammes() const {
+  return programmes_;
+}
+
+size_t ProgrammesInfo::GetSize() const {
+  return programmes_.size();
+}
+
+bool ProgrammesInfo::IsEmpty() const {
+  return programmes_.empty();
+}
+
+common::Error ProgrammesInfo::SerializeFields(json_object* obj) const {
+  json_object* jprogrammes = json_object_new_array();
+  for (size_t i = 0; i < programmes_.size(); ++i) {
+    serialize_type jprog = NULL;
+    common::Error err = programmes_[i].Serialize(&jprog);
+    if (err) {
+      continue;
+    }
+    json_object_array_add(jprogrammes, jprog);
+  }
+
+  json_object_object_add(obj, PROGRAMMES_INFO_FROM_FIELD, json_object_new_int64(from_));
+  json_object_object_add(obj, PROGRAMMES_INFO_TO_FIELD, json_object_new_int64(to_));
+  json_object_object_add(obj, PROGRAMMES_INFO_PROGRAMMES_FIELD, jprogrammes);
+  return common::Error();
+}
+
+common::Error ProgrammesInfo::DeSerialize(const serialize_type& serialized, ProgrammesInfo* obj) {
+  if (!serialized || !obj) {
+    return common::make_error_inval();
+  }
+
+  json_object* jfrom = NULL;
+  json_bool jfrom_exists = json_object_object_get_ex(serialized, PROGRAMMES_INFO_FROM_FIELD, &jfrom);
+  if (!jfrom_exists) {
+    return common::make_error_inval();
+  }
+
+  json_object* jto = NULL;
+  json_bool jto_exists = json_object_object_get_ex(serialized, PROGRAMMES_INFO_TO_FIELD, &jto);
+  if (!jto_exists) {
+    return common::make_error_inval();
+  }
+
+  programmes_t progs;
+  json_object* jprogrammes = NULL;
+  json_bool jprogrammes_exists = json_object_object_get_ex(serialized, PROGRAMMES_INFO_PROGRAMMES_FIELD, &jprogrammes);
+  if (jprogrammes_exists) {
+    size_t len = json_object_array_length(jprogrammes);
+    for (size_t i = 0; i < len; ++i) {
+      json_object* jprog = json_object_array_get_idx(jprogrammes, i);
+      ProgrammeInfo prog;
+      common::Error err = ProgrammeInfo::DeSerialize(jprog, &prog);
+      if (err) {
+        continue;
+      }
+      progs.push_back(prog);
+    }
+  }
+
+  *obj = ProgrammesInfo(json_object_get_int64(jfrom), json_object_get_int64(jto), progs);
+  return common::Error();
+}
+
+bool ProgrammesInfo::Equals(const ProgrammesInfo& progs) const {
+  return from_ == progs.from_ && to_ == progs.to_ && programmes_ == progs.programmes_;
+}
+
+}  // namespace fastotv
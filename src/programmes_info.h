@@ -0,0 +1,60 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <vector>  // for vector
+
+#include "programme_info.h"
+
+namespace fastotv {
+
+// Answer of get_programmes, programmes are grouped by channel and ordered by start time.
+class ProgrammesInfo : public JsonSerializerEx {
+ public:
+  typedef std::vector<ProgrammeInfo> programmes_t;
+  ProgrammesInfo();
+  ProgrammesInfo(timestamp_t from, timestamp_t to, const programmes_t& programmes = programmes_t());
+
+  timestamp_t GetFrom() const;
+  timestamp_t GetTo() const;
+
+  void AddProgramme(const ProgrammeInfo& programme);
+  programmes_t GetProgrammes() const;
+
+  size_t GetSize() const;
+  bool IsEmpty() const;
+
+  static common::Error DeSerialize(const serialize_type& serialized, ProgrammesInfo* obj) WARN_UNUSED_RESULT;
+
+  bool Equals(const ProgrammesInfo& progs) const;
+
+ protected:
+  virtual common::Error SerializeFields(json_object* obj) const override;
+
+ private:
+  timestamp_t from_;  // utc time
+  timestamp_t to_;    // utc time
+  programmes_t programmes_;
+};
+
+inline bool operator==(const ProgrammesInfo& lhs, const ProgrammesInfo& rhs) {
+  return lhs.Equals(rhs);
+}
+
+}  // namespace fastotv
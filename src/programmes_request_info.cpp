@@ -0,0 +1,130 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "programmes_request_info.h"
+
+#define PROGRAMMES_REQUEST_INFO_CHANNELS_FIELD "channels"
+#define PROGRAMMES_REQUEST_INFO_FROM_FIELD "from"
+#define PROGRAMMES_REQUEST_INFO_TO_FIELD "to"
+#define PROGRAMMES_REQUEST_INFO_LIMIT_FIELD "limit"
+
+namespace fastotv {
+
+ProgrammesRequestInfo::ProgrammesRequestInfo() : channels_(), from_(0), to_(0), limit_(0) {}
+
+ProgrammesRequestInfo::ProgrammesRequestInfo(const channels_t& channels,
+                                             timestamp_t from,
+                                             timestamp_t to,
+                                             size_t limit)
+    : channels_(channels), from_(from), to_(to), limit_(limit) {}
+
+bool ProgrammesRequestInfo::IsValid() const {
+  return !channels_.empty() && from_ < to_;
+}
+
+ProgrammesRequestInfo::channels_t ProgrammesRequestInfo::GetChannels() const {
+  return channels_;
+}
+
+timestamp_t ProgrammesRequestInfo::GetFrom() const {
+  return from_;
+}
+
+timestamp_t ProgrammesRequestInfo::GetTo() const {
+  return to_;
+}
+
+size_t ProgrammesRequestInfo::GetLimit() const {
+  return limit_;
+}
+
+common::Error ProgrammesRequestInfo::SerializeFields(json_object* obj) const {
+  if (!IsValid()) {
+    return common::make_error_inval();
+  }
+
+  json_object* jchannels = json_object_new_array();
+  for (size_t i = 0; i < channels_.size(); ++i) {
+    json_object_array_add(jchannels, json_object_new_string(channels_[i].c_str()));
+  }
+
+  json_object_object_add(obj, PROGRAMMES_REQUEST_INFO_CHANNELS_FIELD, jchannels);
+  json_object_object_add(obj, PROGRAMMES_REQUEST_INFO_FROM_FIELD, json_object_new_int64(from_));
+  json_object_object_add(obj, PROGRAMMES_REQUEST_INFO_TO_FIELD, json_object_new_int64(to_));
+  json_object_object_add(obj, PROGRAMMES_REQUEST_INFO_LIMIT_FIELD, json_object_new_int64(limit_));
+  return common::Error();
+}
+
+common::Error ProgrammesRequestInfo::DeSerialize(const serialize_type& serialized, ProgrammesRequestInfo* obj) {
+  if (!serialized || !obj) {
+    return common::make_error_inval();
+  }
+
+  json_object* jchannels = NULL;
+  json_bool jchannels_exists =
+      json_object_object_get_ex(serialized, PROGRAMMES_REQUEST_INFO_CHANNELS_FIELD, &jchannels);
+  if (!jchannels_exists || !json_object_is_type(jchannels, json_type_array)) {
+    return common::make_error_inval();
+  }
+
+  json_object* jfrom = NULL;
+  json_bool jfrom_exists = json_object_object_get_ex(serialized, PROGRAMMES_REQUEST_INFO_FROM_FIELD, &jfrom);
+  if (!jfrom_exists) {
+    return common::make_error_inval();
+  }
+
+  json_object* jto = NULL;
+  json_bool jto_exists = json_object_object_get_ex(serialized, PROGRAMMES_REQUEST_INFO_TO_FIELD, &jto);
+  if (!jto_exists) {
+    return common::make_error_inval();
+  }
+
+  int64_t limit = 0;
+  json_object* jlimit = NULL;
+  json_bool jlimit_exists = json_object_object_get_ex(serialized, PROGRAMMES_REQUEST_INFO_LIMIT_FIELD, &jlimit);
+  if (jlimit_exists) {
+    limit = json_object_get_int64(jlimit);
+    if (limit < 0) {
+      return common::make_error_inval();
+    }
+  }
+
+  channels_t channels;
+  size_t len = json_object_array_length(jchannels);
+  for (size_t i = 0; i < len; ++i) {
+    json_object* jchannel = json_object_array_get_idx(jchannels, i);
+    const char* channel = json_object_get_string(jchannel);
+    if (channel && *channel) {
+      channels.push_back(channel);
+    }
+  }
+
+  ProgrammesRequestInfo req(channels, json_object_get_int64(jfrom), json_object_get_int64(jto), limit);
+  if (!req.IsValid()) {
+    return common::make_error_inval();
+  }
+
+  *obj = req;
+  return common::Error();
+}
+
+bool ProgrammesRequestInfo::Equals(const ProgrammesRequestInfo& req) const {
+  return channels_ == req.channels_ && from_ == req.from_ && to_ == req.to_ && limit_ == req.limit_;
+}
+
+}  // namespace fastotv
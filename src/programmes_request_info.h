@@ -0,0 +1,61 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <vector>  // for vector
+
+#include "client_server_types.h"
+
+#include "serializer/json_serializer.h"
+
+namespace fastotv {
+
+// Argument of get_programmes: programmes of channels intersecting [from, to), at most limit per channel (0 - all).
+class ProgrammesRequestInfo : public JsonSerializerEx {
+ public:
+  typedef std::vector<stream_id> channels_t;
+  ProgrammesRequestInfo();
+  ProgrammesRequestInfo(const channels_t& channels, timestamp_t from, timestamp_t to, size_t limit);
+
+  bool IsValid() const;
+
+  channels_t GetChannels() const;
+  timestamp_t GetFrom() const;
+  timestamp_t GetTo() const;
+  size_t GetLimit() const;
+
+  static common::Error DeSerialize(const serialize_type& serialized, ProgrammesRequestInfo* obj) WARN_UNUSED_RESULT;
+
+  bool Equals(const ProgrammesRequestInfo& req) const;
+
+ protected:
+  virtual common::Error SerializeFields(json_object* obj) const override;
+
+ private:
+  channels_t channels_;
+  timestamp_t from_;  // utc time
+  timestamp_t to_;    // utc time
+  size_t limit_;
+};
+
+inline bool operator==(const ProgrammesRequestInfo& lhs, const ProgrammesRequestInfo& rhs) {
+  return lhs.Equals(rhs);
+}
+
+}  // namespace fastotv
@@ -87,6 +87,9 @@ bool RuntimeChannelInfo::IsChatReadOnly() const {
 }
 
 void RuntimeChannelInfo::AddMessage(const ChatMessage& msg) {
+  while (messages_.size() >= max_messages) {
+    messages_.pop_front();
+  }
   messages_.push_back(msg);
 }
 
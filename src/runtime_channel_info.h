@@ -18,6 +18,8 @@
 
 #pragma once
 
+#include <deque>
+
 #include "client_server_types.h"
 
 #include "chat_message.h"
@@ -28,7 +30,9 @@ namespace fastotv {
 
 class RuntimeChannelInfo : public JsonSerializerEx {
  public:
-  typedef std::vector<ChatMessage> messages_t;
+  typedef std::deque<ChatMessage> messages_t;
+  enum { max_messages = 256 };  // oldest are dropped by AddMessage
+
   RuntimeChannelInfo();
   RuntimeChannelInfo(stream_id channel_id,
                      size_t watchers,
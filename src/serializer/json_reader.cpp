@@ -0,0 +1,659 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "serializer/json_reader.h"
+
+#include <stdlib.h>  // for strtod
+#include <string.h>  // for strlen, memcmp
+
+#include <limits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+#include <common/sprintf.h>  // for MemSPrintf
+
+namespace fastotv {
+
+namespace {
+
+// first quote, backslash or control character in [pos, end), end if none
+const char* find_string_special(const char* pos, const char* end) {
+#if defined(__SSE2__)
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i control = _mm_set1_epi8(0x1F);
+  while (end - pos >= 16) {
+    const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+    const __m128i is_control = _mm_cmpeq_epi8(_mm_min_epu8(chunk, control), chunk);  // chunk <= 0x1F
+    const __m128i special =
+        _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)), is_control);
+    const int mask = _mm_movemask_epi8(special);
+    if (mask) {
+      return pos + __builtin_ctz(mask);
+    }
+    pos += 16;
+  }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+  const uint8x16_t quote = vdupq_n_u8('"');
+  const uint8x16_t backslash = vdupq_n_u8('\\');
+  const uint8x16_t control = vdupq_n_u8(0x20);
+  while (end - pos >= 16) {
+    const uint8x16_t chunk = vld1q_u8(reinterpret_cast<const uint8_t*>(pos));
+    const uint8x16_t special =
+        vorrq_u8(vorrq_u8(vceqq_u8(chunk, quote), vceqq_u8(chunk, backslash)), vcltq_u8(chunk, control));
+    // narrow every byte to a nibble, there is no movemask on neon
+    const uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(special), 4)), 0);
+    if (mask) {
+      return pos + (__builtin_ctzll(mask) >> 2);
+    }
+    pos += 16;
+  }
+#endif
+  for (; pos != end; ++pos) {
+    const unsigned char c = *pos;
+    if (c == '"' || c == '\\' || c < 0x20) {
+      return pos;
+    }
+  }
+  return end;
+}
+
+bool is_whitespace(char c) {
+  return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+bool is_digit(char c) {
+  return c >= '0' && c <= '9';
+}
+
+int hex_value(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+bool read_hex4(const char* pos, const char* end, uint32_t* out) {
+  if (end - pos < 4) {
+    return false;
+  }
+
+  uint32_t value = 0;
+  for (size_t i = 0; i < 4; ++i) {
+    const int digit = hex_value(pos[i]);
+    if (digit < 0) {
+      return false;
+    }
+    value = (value << 4) | digit;
+  }
+  *out = value;
+  return true;
+}
+
+void append_utf8(uint32_t code_point, std::string* out) {
+  if (code_point < 0x80) {
+    out->push_back(static_cast<char>(code_point));
+  } else if (code_point < 0x800) {
+    out->push_back(static_cast<char>(0xC0 | (code_point >> 6)));
+    out->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  } else if (code_point < 0x10000) {
+    out->push_back(static_cast<char>(0xE0 | (code_point >> 12)));
+    out->push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+    out->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  } else {
+    out->push_back(static_cast<char>(0xF0 | (code_point >> 18)));
+    out->push_back(static_cast<char>(0x80 | ((code_point >> 12) & 0x3F)));
+    out->push_back(static_cast<char>(0x80 | ((code_point >> 6) & 0x3F)));
+    out->push_back(static_cast<char>(0x80 | (code_point & 0x3F)));
+  }
+}
+
+// json-c saturates out of range integers
+int64_t parse_int64(const char* pos, const char* end) {
+  const bool negative = *pos == '-';
+  if (negative) {
+    ++pos;
+  }
+
+  const uint64_t limit =
+      negative ? static_cast<uint64_t>(std::numeric_limits<int64_t>::max()) + 1 : std::numeric_limits<int64_t>::max();
+  uint64_t value = 0;
+  for (; pos != end; ++pos) {
+    const uint64_t digit = *pos - '0';
+    if (value > (limit - digit) / 10) {
+      return negative ? std::numeric_limits<int64_t>::min() : std::numeric_limits<int64_t>::max();
+    }
+    value = value * 10 + digit;
+  }
+  return negative ? static_cast<int64_t>(0 - value) : static_cast<int64_t>(value);
+}
+
+int64_t double_to_int64(double value) {
+  if (value >= static_cast<double>(std::numeric_limits<int64_t>::max())) {
+    return std::numeric_limits<int64_t>::max();
+  }
+  if (value <= static_cast<double>(std::numeric_limits<int64_t>::min())) {
+    return std::numeric_limits<int64_t>::min();
+  }
+  return static_cast<int64_t>(value);
+}
+
+int64_t string_to_int64(const std::string& str) {
+  const char* pos = str.c_str();
+  const char* end = pos + str.size();
+  const char* digits = *pos == '-' ? pos + 1 : pos;
+  if (digits == end) {
+    return 0;
+  }
+  for (const char* it = digits; it != end; ++it) {
+    if (!is_digit(*it)) {
+      return 0;
+    }
+  }
+  return parse_int64(pos, end);
+}
+
+}  // namespace
+
+JsonReader::JsonReader(const char* data, size_t size)
+    : pos_(data), end_(data + size), begin_(data), first_(false), failed_(!data) {}
+
+JsonReader::JsonReader(const std::string& data) : JsonReader(data.data(), data.size()) {}
+
+bool JsonReader::IsFailed() const {
+  return failed_;
+}
+
+char JsonReader::Peek() {
+  SkipWhitespace();
+  return pos_ != end_ && !failed_ ? *pos_ : 0;
+}
+
+common::Error JsonReader::EnterObject() {
+  if (Peek() != '{') {
+    return SkipMismatched();
+  }
+
+  ++pos_;
+  first_ = true;
+  return common::Error();
+}
+
+common::Error JsonReader::NextField(std::string* key, bool* has_next) {
+  if (!key || !has_next) {
+    return common::make_error_inval();
+  }
+
+  const char c = Peek();
+  if (c == '}') {
+    ++pos_;
+    first_ = false;
+    *has_next = false;
+    return common::Error();
+  }
+
+  if (!first_) {
+    common::Error err = Expect(',');
+    if (err) {
+      return err;
+    }
+  }
+  first_ = false;
+
+  if (Peek() != '"') {
+    return Fail();
+  }
+  common::Error err = ScanString(key);
+  if (err) {
+    return err;
+  }
+
+  err = Expect(':');
+  if (err) {
+    return err;
+  }
+  *has_next = true;
+  return common::Error();
+}
+
+common::Error JsonReader::EnterArray() {
+  if (Peek() != '[') {
+    return SkipMismatched();
+  }
+
+  ++pos_;
+  first_ = true;
+  return common::Error();
+}
+
+common::Error JsonReader::NextElement(bool* has_next) {
+  if (!has_next) {
+    return common::make_error_inval();
+  }
+
+  const char c = Peek();
+  if (c == ']') {
+    ++pos_;
+    first_ = false;
+    *has_next = false;
+    return common::Error();
+  }
+
+  if (!first_) {
+    common::Error err = Expect(',');
+    if (err) {
+      return err;
+    }
+  }
+  first_ = false;
+  *has_next = true;
+  return common::Error();
+}
+
+common::Error JsonReader::ReadString(std::string* out) {
+  if (!out) {
+    return common::make_error_inval();
+  }
+
+  const char c = Peek();
+  if (c == '"') {
+    return ScanString(out);
+  }
+
+  // like json_object_get_string: text of other values, nothing for null
+  const char* start = pos_;
+  common::Error err = SkipValue();
+  if (err) {
+    return err;
+  }
+
+  if (c == 'n') {
+    out->clear();
+  } else {
+    out->assign(start, pos_ - start);
+  }
+  return common::Error();
+}
+
+common::Error JsonReader::ReadInt64(int64_t* out) {
+  if (!out) {
+    return common::make_error_inval();
+  }
+
+  const char c = Peek();
+  if (c == '-' || is_digit(c)) {
+    const char* start = pos_;
+    const char* number_end = NULL;
+    bool integer = false;
+    common::Error err = ScanNumber(&number_end, &integer);
+    if (err) {
+      return err;
+    }
+
+    *out = integer ? parse_int64(start, number_end)
+                   : double_to_int64(strtod(std::string(start, number_end).c_str(), NULL));
+    return common::Error();
+  }
+
+  if (c == '"') {
+    std::string str;
+    common::Error err = ScanString(&str);
+    if (err) {
+      return err;
+    }
+
+    *out = string_to_int64(str);
+    return common::Error();
+  }
+
+  *out = c == 't' ? 1 : 0;
+  return SkipValue();
+}
+
+common::Error JsonReader::ReadInt(int* out) {
+  if (!out) {
+    return common::make_error_inval();
+  }
+
+  int64_t value = 0;
+  common::Error err = ReadInt64(&value);
+  if (err) {
+    return err;
+  }
+
+  if (value > std::numeric_limits<int>::max()) {
+    *out = std::numeric_limits<int>::max();
+  } else if (value < std::numeric_limits<int>::min()) {
+    *out = std::numeric_limits<int>::min();
+  } else {
+    *out = static_cast<int>(value);
+  }
+  return common::Error();
+}
+
+common::Error JsonReader::ReadBool(bool* out) {
+  if (!out) {
+    return common::make_error_inval();
+  }
+
+  const char c = Peek();
+  if (c == 't') {
+    *out = true;
+    return ScanLiteral("true");
+  }
+  if (c == 'f') {
+    *out = false;
+    return ScanLiteral("false");
+  }
+
+  // like json_object_get_boolean: non zero numbers and non empty strings
+  if (c == '-' || is_digit(c)) {
+    const char* start = pos_;
+    const char* number_end = NULL;
+    bool integer = false;
+    common::Error err = ScanNumber(&number_end, &integer);
+    if (err) {
+      return err;
+    }
+
+    *out = strtod(std::string(start, number_end).c_str(), NULL) != 0;
+    return common::Error();
+  }
+
+  if (c == '"') {
+    std::string str;
+    common::Error err = ScanString(&str);
+    if (err) {
+      return err;
+    }
+
+    *out = !str.empty();
+    return common::Error();
+  }
+
+  *out = false;
+  return SkipValue();
+}
+
+common::Error JsonReader::SkipValue() {
+  const char c = Peek();
+  if (c != '{' && c != '[') {
+    return SkipScalar(c);
+  }
+
+  // containers are skipped without recursion: closing brackets are kept on stack, grammar by state
+  enum { EXPECT_VALUE, EXPECT_VALUE_OR_END, EXPECT_KEY, EXPECT_KEY_OR_END, EXPECT_COLON, EXPECT_COMMA_OR_END };
+  char stack[max_depth];
+  size_t depth = 0;
+  int state = EXPECT_VALUE;
+  while (true) {
+    const char cur = Peek();
+    if ((state == EXPECT_KEY_OR_END || state == EXPECT_VALUE_OR_END || state == EXPECT_COMMA_OR_END) && depth &&
+        cur == stack[depth - 1]) {
+      ++pos_;
+      if (--depth == 0) {
+        return common::Error();
+      }
+      state = EXPECT_COMMA_OR_END;
+      continue;
+    }
+
+    if (state == EXPECT_COMMA_OR_END) {
+      if (cur != ',') {
+        return Fail();
+      }
+      ++pos_;
+      state = stack[depth - 1] == '}' ? EXPECT_KEY : EXPECT_VALUE;
+    } else if (state == EXPECT_KEY || state == EXPECT_KEY_OR_END) {
+      if (cur != '"') {
+        return Fail();
+      }
+      common::Error err = ScanString(NULL);
+      if (err) {
+        return err;
+      }
+      state = EXPECT_COLON;
+    } else if (state == EXPECT_COLON) {
+      common::Error err = Expect(':');
+      if (err) {
+        return err;
+      }
+      state = EXPECT_VALUE;
+    } else if (cur == '{' || cur == '[') {
+      if (depth == max_depth) {
+        return Fail();
+      }
+      stack[depth++] = cur == '{' ? '}' : ']';
+      ++pos_;
+      state = cur == '{' ? EXPECT_KEY_OR_END : EXPECT_VALUE_OR_END;
+    } else {
+      common::Error err = SkipScalar(cur);
+      if (err) {
+        return err;
+      }
+      state = EXPECT_COMMA_OR_END;
+    }
+  }
+}
+
+common::Error JsonReader::Finish() {
+  if (failed_) {
+    return Fail();
+  }
+
+  SkipWhitespace();
+  if (pos_ != end_ && *pos_ != 0) {
+    return Fail();
+  }
+  return common::Error();
+}
+
+void JsonReader::SkipWhitespace() {
+  while (pos_ != end_ && is_whitespace(*pos_)) {
+    ++pos_;
+  }
+}
+
+common::Error JsonReader::Fail() {
+  failed_ = true;
+  return common::make_error(
+      common::MemSPrintf("Invalid json at offset %lu", static_cast<unsigned long>(pos_ - begin_)));
+}
+
+common::Error JsonReader::Expect(char c) {
+  if (Peek() != c) {
+    return Fail();
+  }
+
+  ++pos_;
+  return common::Error();
+}
+
+common::Error JsonReader::ScanString(std::string* out) {
+  ++pos_;  // opening quote
+  if (out) {
+    out->clear();
+  }
+
+  while (true) {
+    const char* special = find_string_special(pos_, end_);
+    if (special == end_ || (*special != '"' && *special != '\\')) {  // unterminated or raw control character
+      pos_ = special;
+      return Fail();
+    }
+
+    if (out) {
+      out->append(pos_, special - pos_);
+    }
+    pos_ = special + 1;
+    if (*special == '"') {
+      return common::Error();
+    }
+
+    if (pos_ == end_) {
+      return Fail();
+    }
+    const char escaped = *pos_++;
+    char decoded = 0;
+    switch (escaped) {
+      case '"':
+      case '\\':
+      case '/':
+        decoded = escaped;
+        break;
+      case 'b':
+        decoded = '\b';
+        break;
+      case 'f':
+        decoded = '\f';
+        break;
+      case 'n':
+        decoded = '\n';
+        break;
+      case 'r':
+        decoded = '\r';
+        break;
+      case 't':
+        decoded = '\t';
+        break;
+      case 'u': {
+        uint32_t code_point = 0;
+        if (!read_hex4(pos_, end_, &code_point)) {
+          return Fail();
+        }
+        pos_ += 4;
+        uint32_t low = 0;
+        if (code_point >= 0xD800 && code_point <= 0xDBFF && end_ - pos_ >= 6 && pos_[0] == '\\' && pos_[1] == 'u' &&
+            read_hex4(pos_ + 2, end_, &low) && low >= 0xDC00 && low <= 0xDFFF) {  // surrogate pair
+          code_point = 0x10000 + ((code_point - 0xD800) << 10) + (low - 0xDC00);
+          pos_ += 6;
+        }
+        if (out) {
+          append_utf8(code_point, out);
+        }
+        continue;
+      }
+      default:
+        return Fail();
+    }
+    if (out) {
+      out->push_back(decoded);
+    }
+  }
+}
+
+common::Error JsonReader::ScanNumber(const char** number_end, bool* integer) {
+  const char* pos = pos_;
+  if (pos != end_ && *pos == '-') {
+    ++pos;
+  }
+  if (pos == end_ || !is_digit(*pos)) {
+    return Fail();
+  }
+  if (*pos == '0') {
+    ++pos;
+  } else {
+    while (pos != end_ && is_digit(*pos)) {
+      ++pos;
+    }
+  }
+
+  bool is_integer = true;
+  if (pos != end_ && *pos == '.') {
+    is_integer = false;
+    ++pos;
+    if (pos == end_ || !is_digit(*pos)) {
+      return Fail();
+    }
+    while (pos != end_ && is_digit(*pos)) {
+      ++pos;
+    }
+  }
+  if (pos != end_ && (*pos == 'e' || *pos == 'E')) {
+    is_integer = false;
+    ++pos;
+    if (pos != end_ && (*pos == '+' || *pos == '-')) {
+      ++pos;
+    }
+    if (pos == end_ || !is_digit(*pos)) {
+      return Fail();
+    }
+    while (pos != end_ && is_digit(*pos)) {
+      ++pos;
+    }
+  }
+
+  pos_ = pos;
+  *number_end = pos;
+  *integer = is_integer;
+  return common::Error();
+}
+
+common::Error JsonReader::ScanLiteral(const char* literal) {
+  const size_t len = strlen(literal);
+  if (static_cast<size_t>(end_ - pos_) < len || memcmp(pos_, literal, len) != 0) {
+    return Fail();
+  }
+
+  pos_ += len;
+  return common::Error();
+}
+
+common::Error JsonReader::SkipScalar(char c) {
+  if (c == '"') {
+    return ScanString(NULL);
+  }
+  if (c == '-' || is_digit(c)) {
+    const char* number_end = NULL;
+    bool integer = false;
+    return ScanNumber(&number_end, &integer);
+  }
+  if (c == 't') {
+    return ScanLiteral("true");
+  }
+  if (c == 'f') {
+    return ScanLiteral("false");
+  }
+  if (c == 'n') {
+    return ScanLiteral("null");
+  }
+  return Fail();
+}
+
+common::Error JsonReader::SkipMismatched() {
+  if (failed_) {
+    return Fail();
+  }
+
+  common::Error err = SkipValue();
+  if (err) {
+    return err;
+  }
+  return common::make_error_inval();
+}
+
+}  // namespace fastotv
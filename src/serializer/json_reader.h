@@ -0,0 +1,108 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <stddef.h>  // for size_t
+#include <stdint.h>  // for int64_t
+
+#include <string>
+
+#include <json-c/json_object.h>
+#include <json-c/json_tokener.h>  // for json_tokener_parse
+
+#include <common/error.h>   // for Error
+#include <common/macros.h>  // for WARN_UNUSED_RESULT
+
+namespace fastotv {
+
+// Pull parser over contiguous json text: values are read in document order straight into model objects,
+// without building a json-c tree. Strings are scanned with SSE2/NEON where available.
+// Reader is a cursor into the buffer, the buffer must outlive it; copy the reader to look ahead.
+// Scalar reads convert like json-c getters do. Entering a container of other type skips that value and
+// fails without breaking the reader, only malformed json does (IsFailed), the rest of the document is lost then.
+class JsonReader {
+ public:
+  enum { max_depth = 256 };
+
+  JsonReader(const char* data, size_t size);
+  explicit JsonReader(const std::string& data);
+
+  bool IsFailed() const;
+  char Peek();  // first character of next value, 0 at the end
+
+  // after Enter*, Next* is called before every member; on false in *has_next closing bracket is consumed
+  common::Error EnterObject() WARN_UNUSED_RESULT;
+  common::Error NextField(std::string* key, bool* has_next) WARN_UNUSED_RESULT;  // value must be read or skipped
+  common::Error EnterArray() WARN_UNUSED_RESULT;
+  common::Error NextElement(bool* has_next) WARN_UNUSED_RESULT;
+
+  common::Error ReadString(std::string* out) WARN_UNUSED_RESULT;
+  common::Error ReadInt64(int64_t* out) WARN_UNUSED_RESULT;
+  common::Error ReadInt(int* out) WARN_UNUSED_RESULT;
+  common::Error ReadBool(bool* out) WARN_UNUSED_RESULT;
+  common::Error SkipValue() WARN_UNUSED_RESULT;
+
+  common::Error Finish() WARN_UNUSED_RESULT;  // only whitespace can be left
+
+ private:
+  void SkipWhitespace();
+  common::Error Fail();
+  common::Error Expect(char c) WARN_UNUSED_RESULT;
+  common::Error ScanString(std::string* out) WARN_UNUSED_RESULT;  // NULL skips
+  common::Error ScanNumber(const char** number_end, bool* integer) WARN_UNUSED_RESULT;
+  common::Error ScanLiteral(const char* literal) WARN_UNUSED_RESULT;
+  common::Error SkipScalar(char c) WARN_UNUSED_RESULT;
+  common::Error SkipMismatched() WARN_UNUSED_RESULT;
+
+  const char* pos_;
+  const char* end_;
+  const char* begin_;
+  bool first_;  // no member read yet in the entered container
+  bool failed_;
+};
+
+// parses data with the backend chosen at build time (USE_JSON_READER) into T
+template <typename T>
+common::Error DeSerializeFromString(const std::string& data, T* obj) WARN_UNUSED_RESULT;
+
+template <typename T>
+common::Error DeSerializeFromString(const std::string& data, T* obj) {
+  if (!obj) {
+    return common::make_error_inval();
+  }
+
+#if defined(USE_JSON_READER)
+  JsonReader reader(data);
+  common::Error err = T::DeSerialize(&reader, obj);
+  if (err) {
+    return err;
+  }
+  return reader.Finish();
+#else
+  json_object* jobj = json_tokener_parse(data.c_str());
+  if (!jobj) {
+    return common::make_error_inval();
+  }
+
+  common::Error err = T::DeSerialize(jobj, obj);
+  json_object_put(jobj);
+  return err;
+#endif
+}
+
+}  // namespace fastotv
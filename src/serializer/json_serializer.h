@@ -25,6 +25,8 @@
 
 namespace fastotv {
 
+class JsonReader;  // alternative DeSerialize backend
+
 class JsonSerializer : public common::serializer::ISerializer<struct json_object*> {
  public:
   typedef common::serializer::ISerializer<struct json_object*> base_class;
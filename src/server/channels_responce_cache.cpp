@@ -0,0 +1,214 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "server/channels_responce_cache.h"
+
+#include <algorithm>  // for max
+#include <utility>    // for move
+
+#include "channels_delta_info.h"  // for ChannelsDeltaInfo
+
+#include "server/epg_store.h"  // for EpgStore
+
+namespace fastotv {
+namespace server {
+namespace {
+const size_t min_users_prune_size = 1024;
+}
+
+ChannelsResponceCache::ChannelsResponceCache()
+    : mutex_(),
+      users_(),
+      users_prune_size_(min_users_prune_size),
+      entries_(),
+      lru_(),
+      max_entries_(default_max_entries) {}
+
+void ChannelsResponceCache::SetLimit(size_t max_entries) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  max_entries_ = max_entries;
+  while (entries_.size() > max_entries_ && !lru_.empty()) {
+    entries_.erase(lru_.back());
+    lru_.pop_back();
+  }
+}
+
+common::Error ChannelsResponceCache::Get(user_info_ptr_t user, bool without_programmes, body_ptr_t* body) {
+  if (!user || !body) {
+    return common::make_error_inval();
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto it = users_.find(user.get());
+    if (it != users_.end() && it->second.user.lock() == user) {
+      const body_ptr_t& cached = without_programmes ? it->second.stripped_body : it->second.body;
+      if (cached) {
+        *body = cached;
+        return common::Error();
+      }
+    }
+  }
+
+  ChannelsInfo channels =
+      without_programmes ? EpgStore::StripProgrammes(user->GetChannelInfo()) : user->GetChannelInfo();
+  std::shared_ptr<Body> lbody = std::make_shared<Body>();
+  std::shared_ptr<ChannelsVersions::snapshot_t> snapshot = std::make_shared<ChannelsVersions::snapshot_t>();
+  lbody->version = ChannelsVersions::MakeSnapshot(channels, snapshot.get());
+  lbody->snapshot = snapshot;
+  body_ptr_t shared;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    shared = FindBody(lbody->version);
+  }
+
+  if (!shared) {  // new channel list, serialize outside of lock
+    std::string channels_str;
+    common::Error err = channels.SerializeToString(&channels_str);
+    if (err) {
+      return err;
+    }
+
+    err = fastotv::inner::InnerClient::CompressPart(channels_str, &lbody->channels);
+    if (err) {
+      return err;
+    }
+    lbody->list = std::move(channels);
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (!shared) {
+    shared = FindBody(lbody->version);  // can be added by other thread meanwhile
+  }
+  if (!shared) {
+    shared = lbody;
+    if (max_entries_ != 0) {
+      lru_.push_front(lbody->version);
+      Entry ent = {shared, lru_.begin()};
+      entries_[lbody->version] = ent;
+      while (entries_.size() > max_entries_) {
+        entries_.erase(lru_.back());
+        lru_.pop_back();
+      }
+    }
+  }
+
+  UserEntry& uent = users_[user.get()];
+  if (uent.user.lock() != user) {  // new or reused address
+    UserEntry empty = {user, body_ptr_t(), body_ptr_t()};
+    uent = empty;
+  }
+  if (without_programmes) {
+    uent.stripped_body = shared;
+  } else {
+    uent.body = shared;
+  }
+  if (users_.size() >= users_prune_size_) {
+    PruneUsers();
+  }
+  *body = shared;
+  return common::Error();
+}
+
+void ChannelsResponceCache::Clear() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  users_.clear();
+  users_prune_size_ = min_users_prune_size;
+  entries_.clear();
+  lru_.clear();
+}
+
+size_t ChannelsResponceCache::GetSize() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+std::string ChannelsResponceCache::MakeChannelsTemplate() {
+  return "\"" CHANNELS_RESPONCE_PLACEHOLDER "\"";
+}
+
+common::Error ChannelsResponceCache::MakeFullDeltaTemplate(const channels_version_t& version, std::string* out) {
+  if (!out) {
+    return common::make_error_inval();
+  }
+
+  json_object* jdelta = NULL;
+  common::Error err = ChannelsDeltaInfo::MakeFull(version, ChannelsInfo()).Serialize(&jdelta);
+  if (err) {
+    return err;
+  }
+
+  json_object_object_add(jdelta, CHANNELS_DELTA_INFO_ADDED_FIELD,
+                         json_object_new_string(CHANNELS_RESPONCE_PLACEHOLDER));
+  *out = json_object_get_string(jdelta);
+  json_object_put(jdelta);
+  return common::Error();
+}
+
+common::Error ChannelsResponceCache::SerializeDelta(const ChannelsDeltaInfo& delta, std::string* out, bool* templated) {
+  if (!out || !templated) {
+    return common::make_error_inval();
+  }
+
+  const bool full = delta.GetType() == ChannelsDeltaInfo::FULL;
+  common::Error err = full ? MakeFullDeltaTemplate(delta.GetVersion(), out) : delta.SerializeToString(out);
+  if (err) {
+    return err;
+  }
+
+  *templated = full;
+  return common::Error();
+}
+
+common::Error ChannelsResponceCache::MakeFrame(const std::string& command,
+                                               const Body& body,
+                                               bool allow_chunked,
+                                               fastotv::inner::InnerClient::frame_t* frame) {
+  const std::string placeholder = MakeChannelsTemplate();
+  const size_t pos = command.find(placeholder);
+  if (pos == std::string::npos) {
+    return common::make_error_inval();
+  }
+
+  return fastotv::inner::InnerClient::MakeFrame(command.substr(0, pos), body.channels,
+                                                command.substr(pos + placeholder.size()), allow_chunked, frame);
+}
+
+ChannelsResponceCache::body_ptr_t ChannelsResponceCache::FindBody(const channels_version_t& version) {
+  auto it = entries_.find(version);
+  if (it == entries_.end()) {
+    return body_ptr_t();
+  }
+
+  lru_.splice(lru_.begin(), lru_, it->second.lru_pos);
+  return it->second.body;
+}
+
+void ChannelsResponceCache::PruneUsers() {
+  for (auto it = users_.begin(); it != users_.end();) {
+    if (it->second.user.expired()) {
+      it = users_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  users_prune_size_ = std::max(users_.size() * 2, min_users_prune_size);
+}
+
+}  // namespace server
+}  // namespace fastotv
@@ -0,0 +1,108 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <list>
+#include <memory>  // for shared_ptr
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include <common/error.h>   // for Error
+#include <common/macros.h>  // for WARN_UNUSED_RESULT, DISALLOW_COPY_AND_ASSIGN
+
+#include "inner/inner_client.h"  // for InnerClient::CompressedPart
+
+#include "server/channels_versions.h"  // for ChannelsVersions::snapshot_ptr_t
+#include "server/user_info.h"          // for user_info_ptr_t
+
+#define CHANNELS_RESPONCE_PLACEHOLDER "$channels$"  // json string in answer template replaced by channels
+
+namespace fastotv {
+class ChannelsDeltaInfo;
+namespace server {
+
+// Thread-safe cache of get_channels answers: every distinct channel list is serialized and compressed once
+// and shared by all users with that list, sending it costs a copy into the frame.
+// Users are bound to lists by user info object, so reloaded (invalidated) user data is looked up again.
+class ChannelsResponceCache {
+ public:
+  enum { default_max_entries = 256 };  // distinct channel lists
+
+  struct Body {
+    channels_version_t version;  // content hash, as in ChannelsVersions
+    ChannelsVersions::snapshot_ptr_t snapshot;  // hashed once per list, shared by versions of its users
+    fastotv::inner::InnerClient::CompressedPart channels;  // serialized ChannelsInfo
+    ChannelsInfo list;  // as serialized, without programmes in stripped bodies, base of deltas
+  };
+  typedef std::shared_ptr<const Body> body_ptr_t;
+
+  ChannelsResponceCache();
+
+  void SetLimit(size_t max_entries);
+
+  // serializes channels of user on first call,
+  // without_programmes answers clients which fetch programmes by get_programmes
+  common::Error Get(user_info_ptr_t user, bool without_programmes, body_ptr_t* body) WARN_UNUSED_RESULT;
+  void Clear();
+
+  size_t GetSize() const;
+
+  // answer templates, placeholder is replaced by serialized channels in MakeFrame
+  static std::string MakeChannelsTemplate();
+  static common::Error MakeFullDeltaTemplate(const channels_version_t& version, std::string* out) WARN_UNUSED_RESULT;
+  // channels argument of get_channels answer to client which sent its channels version: only FULL delta carries
+  // channels and is a template for MakeFrame (templated is set), UNCHANGED and DELTA ones are written as they are
+  static common::Error SerializeDelta(const ChannelsDeltaInfo& delta,
+                                      std::string* out,
+                                      bool* templated) WARN_UNUSED_RESULT;
+  static common::Error MakeFrame(const std::string& command,
+                                 const Body& body,
+                                 bool allow_chunked,
+                                 fastotv::inner::InnerClient::frame_t* frame) WARN_UNUSED_RESULT;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ChannelsResponceCache);
+
+  struct UserEntry {
+    std::weak_ptr<const UserInfo> user;  // address of expired user can be reused by new one
+    body_ptr_t body;
+    body_ptr_t stripped_body;  // without programmes
+  };
+  typedef std::unordered_map<const UserInfo*, UserEntry> users_t;
+  typedef std::list<channels_version_t> lru_list_t;
+  struct Entry {
+    body_ptr_t body;
+    lru_list_t::iterator lru_pos;
+  };
+  typedef std::unordered_map<channels_version_t, Entry> entries_t;
+
+  body_ptr_t FindBody(const channels_version_t& version);  // under lock
+  void PruneUsers();                                       // under lock
+
+  mutable std::mutex mutex_;
+  users_t users_;
+  size_t users_prune_size_;  // users count when expired ones are dropped next time
+  entries_t entries_;
+  lru_list_t lru_;  // front is most recently used
+  size_t max_entries_;
+};
+
+}  // namespace server
+}  // namespace fastotv
@@ -0,0 +1,189 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "server/channels_versions.h"
+
+#include <unordered_set>
+
+namespace {
+
+const uint64_t fnv_offset_basis = 14695981039346656037ULL;
+const uint64_t fnv_prime = 1099511628211ULL;
+
+uint64_t fnv1a(const std::string& data, uint64_t hash = fnv_offset_basis) {
+  for (unsigned char c : data) {
+    hash ^= c;
+    hash *= fnv_prime;
+  }
+  return hash;
+}
+
+std::string hash_to_string(uint64_t hash) {
+  static const char digits[] = "0123456789abcdef";
+  std::string result(sizeof(hash) * 2, '0');
+  for (size_t i = result.size(); i > 0; --i) {
+    result[i - 1] = digits[hash & 0xF];
+    hash >>= 4;
+  }
+  return result;
+}
+
+}  // namespace
+
+namespace fastotv {
+namespace server {
+
+ChannelsVersions::ChannelsVersions() : mutex_(), entries_(), lru_(), max_versions_(default_max_versions) {}
+
+void ChannelsVersions::SetLimit(size_t max_versions) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  max_versions_ = max_versions;
+  while (entries_.size() > max_versions_ && !lru_.empty()) {
+    entries_.erase(lru_.back());
+    lru_.pop_back();
+  }
+}
+
+ChannelsDeltaInfo ChannelsVersions::MakeDelta(const login_t& owner,
+                                              const channels_version_t& base,
+                                              const ChannelsInfo& channels) {
+  std::shared_ptr<snapshot_t> current = std::make_shared<snapshot_t>();
+  const channels_version_t version = MakeSnapshot(channels, current.get());
+  return MakeDelta(owner, base, channels, version, current);
+}
+
+ChannelsDeltaInfo ChannelsVersions::MakeDelta(const login_t& owner,
+                                              const channels_version_t& base,
+                                              const ChannelsInfo& channels,
+                                              const channels_version_t& version,
+                                              snapshot_ptr_t snapshot) {
+  if (!snapshot) {
+    return ChannelsDeltaInfo::MakeFull(version, channels);
+  }
+
+  if (version == base) {
+    Remember(owner, version, snapshot, invalid_channels_version);
+    return ChannelsDeltaInfo::MakeUnchanged(version);
+  }
+
+  snapshot_ptr_t prev = Remember(owner, version, snapshot, base);
+  if (!prev) {
+    return ChannelsDeltaInfo::MakeFull(version, channels);
+  }
+
+  const snapshot_t& current = *snapshot;
+  std::unordered_map<stream_id, uint64_t> prev_hashes;
+  for (const auto& channel : *prev) {
+    prev_hashes[channel.first] = channel.second;
+  }
+
+  // client keeps cached order and appends added channels, so delta is possible only if it gives the same list
+  ChannelsInfo added;
+  ChannelsInfo modified;
+  std::unordered_set<stream_id> kept;
+  const ChannelsInfo::channels_t chans = channels.GetChannels();
+  for (size_t i = 0; i < chans.size(); ++i) {
+    auto it = prev_hashes.find(current[i].first);
+    if (it == prev_hashes.end()) {
+      added.AddChannel(chans[i]);
+      continue;
+    }
+
+    if (!added.IsEmpty()) {
+      return ChannelsDeltaInfo::MakeFull(version, channels);
+    }
+
+    kept.insert(current[i].first);
+    if (it->second != current[i].second) {
+      modified.AddChannel(chans[i]);
+    }
+  }
+
+  ChannelsDeltaInfo::removed_t removed;
+  size_t pos = 0;
+  for (const auto& channel : *prev) {
+    if (kept.find(channel.first) == kept.end()) {
+      removed.push_back(channel.first);
+      continue;
+    }
+
+    if (current[pos++].first != channel.first) {
+      return ChannelsDeltaInfo::MakeFull(version, channels);
+    }
+  }
+
+  return ChannelsDeltaInfo(ChannelsDeltaInfo::DELTA, version, added, modified, removed);
+}
+
+size_t ChannelsVersions::GetSize() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+channels_version_t ChannelsVersions::MakeSnapshot(const ChannelsInfo& channels, snapshot_t* snapshot) {
+  uint64_t version = fnv_offset_basis;
+  for (const ChannelInfo& channel : channels.GetChannels()) {
+    std::string channel_str;
+    common::Error err = channel.SerializeToString(&channel_str);
+    if (err) {
+      channel_str.clear();  // unserializable channel, hash by id only
+    }
+
+    const stream_id sid = channel.GetId();
+    const uint64_t hash = fnv1a(channel_str);
+    snapshot->push_back(std::make_pair(sid, hash));
+    version = fnv1a(sid, version);
+    version = fnv1a(hash_to_string(hash), version);
+  }
+  return hash_to_string(version);
+}
+
+ChannelsVersions::key_t ChannelsVersions::MakeKey(const login_t& owner, const channels_version_t& version) {
+  return version + ":" + owner;  // versions are hex, so keys of different owners can't collide
+}
+
+ChannelsVersions::snapshot_ptr_t ChannelsVersions::Remember(const login_t& owner,
+                                                            const channels_version_t& version,
+                                                            snapshot_ptr_t snapshot,
+                                                            const channels_version_t& base) {
+  const key_t key = MakeKey(owner, version);
+  std::unique_lock<std::mutex> lock(mutex_);
+  auto it = entries_.find(key);
+  if (it != entries_.end()) {
+    lru_.splice(lru_.begin(), lru_, it->second.lru_pos);
+  } else if (max_versions_ != 0) {
+    lru_.push_front(key);
+    Entry ent = {snapshot, lru_.begin()};
+    entries_[key] = ent;
+    while (entries_.size() > max_versions_) {
+      entries_.erase(lru_.back());
+      lru_.pop_back();
+    }
+  }
+
+  auto prev = entries_.find(MakeKey(owner, base));
+  if (prev == entries_.end()) {
+    return snapshot_ptr_t();
+  }
+
+  lru_.splice(lru_.begin(), lru_, prev->second.lru_pos);
+  return prev->second.snapshot;
+}
+
+}  // namespace server
+}  // namespace fastotv
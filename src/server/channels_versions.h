@@ -0,0 +1,89 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>  // for uint64_t
+
+#include <list>
+#include <memory>  // for shared_ptr
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>  // for pair
+#include <vector>
+
+#include <common/macros.h>  // for DISALLOW_COPY_AND_ASSIGN
+
+#include "channels_delta_info.h"  // for ChannelsDeltaInfo, channels_version_t
+
+namespace fastotv {
+namespace server {
+
+// Thread-safe LRU history of channel lists sent to clients, keeps per channel content hashes only.
+// Versions are remembered per owner (user), delta is made only from a version sent to the same owner,
+// so other users' channels can't be learned by sending their version. Owners of the same list share its snapshot.
+class ChannelsVersions {
+ public:
+  enum { default_max_versions = 64 * 1024 };  // owner and version pairs
+  typedef std::vector<std::pair<stream_id, uint64_t>> snapshot_t;  // per channel content hashes, ordered as sent
+  typedef std::shared_ptr<const snapshot_t> snapshot_ptr_t;
+
+  ChannelsVersions();
+
+  void SetLimit(size_t max_versions);
+
+  // remembers channels sent to owner and makes answer for its client which cached base version
+  ChannelsDeltaInfo MakeDelta(const login_t& owner, const channels_version_t& base, const ChannelsInfo& channels);
+  // same with version and snapshot of channels made before (once per list) by MakeSnapshot
+  ChannelsDeltaInfo MakeDelta(const login_t& owner,
+                              const channels_version_t& base,
+                              const ChannelsInfo& channels,
+                              const channels_version_t& version,
+                              snapshot_ptr_t snapshot);
+
+  static channels_version_t MakeSnapshot(const ChannelsInfo& channels, snapshot_t* snapshot);
+
+  size_t GetSize() const;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ChannelsVersions);
+
+  typedef std::string key_t;  // version and owner
+  typedef std::list<key_t> lru_list_t;
+  struct Entry {
+    snapshot_ptr_t snapshot;
+    lru_list_t::iterator lru_pos;
+  };
+  typedef std::unordered_map<key_t, Entry> entries_t;
+
+  static key_t MakeKey(const login_t& owner, const channels_version_t& version);
+  // snapshot of base sent to owner, if remembered
+  snapshot_ptr_t Remember(const login_t& owner,
+                          const channels_version_t& version,
+                          snapshot_ptr_t snapshot,
+                          const channels_version_t& base);
+
+  mutable std::mutex mutex_;
+  entries_t entries_;
+  lru_list_t lru_;  // front is most recently used
+  size_t max_versions_;
+};
+
+}  // namespace server
+}  // namespace fastotv
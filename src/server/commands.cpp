@@ -18,6 +18,9 @@
 
 #include "server/commands.h"
 
+#include "inner/binary_commands.h"  // for MakeBinaryResponce
+#include "inner/inner_client.h"     // for InnerClient
+
 // requests
 // ping
 #define SERVER_PING_REQ GENERATE_REQUEST_FMT(SERVER_PING)
@@ -27,7 +30,7 @@
 // who_are_you
 #define SERVER_WHO_ARE_YOU_REQ GENERATE_REQUEST_FMT(SERVER_WHO_ARE_YOU)
 #define SERVER_WHO_ARE_YOU_APPROVE_FAIL_1E GENEATATE_FAIL_FMT(SERVER_WHO_ARE_YOU, "'%s'")
-#define SERVER_WHO_ARE_YOU_APPROVE_SUCCESS GENEATATE_SUCCESS_FMT(SERVER_WHO_ARE_YOU, "")
+#define SERVER_WHO_ARE_YOU_APPROVE_SUCCESS_1E GENEATATE_SUCCESS_FMT(SERVER_WHO_ARE_YOU, "%u")
 
 // system_info
 #define SERVER_GET_CLIENT_INFO_REQ GENERATE_REQUEST_FMT(SERVER_GET_CLIENT_INFO)
@@ -39,6 +42,9 @@
 #define SERVER_SEND_CHAT_MESSAGE_APPROVE_FAIL_1E GENEATATE_FAIL_FMT(SERVER_SEND_CHAT_MESSAGE, "'%s'")
 #define SERVER_SEND_CHAT_MESSAGE_APPROVE_SUCCESS GENEATATE_SUCCESS_FMT(SERVER_SEND_CHAT_MESSAGE, "")
 
+// external command with arguments
+#define SERVER_EXTERNAL_REQ_1E GENERATE_REQUEST_FMT("%s")
+
 // responces
 // get_server_info
 #define SERVER_GET_SERVER_INFO_RESP_FAIL_1E GENEATATE_FAIL_FMT(CLIENT_GET_SERVER_INFO, "'%s'")
@@ -52,6 +58,10 @@
 #define SERVER_GET_RUNTIME_CHANNEL_INFO_RESP_FAIL_1E GENEATATE_FAIL_FMT(CLIENT_GET_RUNTIME_CHANNEL_INFO, "'%s'")
 #define SERVER_GET_RUNTIME_CHANNEL_INFO_RESP_SUCCSESS_1E GENEATATE_SUCCESS_FMT(CLIENT_GET_RUNTIME_CHANNEL_INFO, "'%s'")
 
+// get_programmes
+#define SERVER_GET_PROGRAMMES_RESP_FAIL_1E GENEATATE_FAIL_FMT(CLIENT_GET_PROGRAMMES, "'%s'")
+#define SERVER_GET_PROGRAMMES_RESP_SUCCSESS_1E GENEATATE_SUCCESS_FMT(CLIENT_GET_PROGRAMMES, "'%s'")
+
 // send_chat_message
 #define SERVER_SEND_CHAT_MESSAGE_RESP_FAIL_1E GENEATATE_FAIL_FMT(CLIENT_SEND_CHAT_MESSAGE, "'%s'")
 #define SERVER_SEND_CHAT_MESSAGE_RESP_SUCCSESS_1E GENEATATE_SUCCESS_FMT(CLIENT_SEND_CHAT_MESSAGE, "'%s'")
@@ -68,8 +78,10 @@ common::protocols::three_way_handshake::cmd_request_t WhoAreYouRequest(
   return common::protocols::three_way_handshake::MakeRequest(id, SERVER_WHO_ARE_YOU_REQ);
 }
 common::protocols::three_way_handshake::cmd_approve_t WhoAreYouApproveResponceSuccsess(
-    common::protocols::three_way_handshake::cmd_seq_t id) {
-  return common::protocols::three_way_handshake::MakeApproveResponce(id, SERVER_WHO_ARE_YOU_APPROVE_SUCCESS);
+    common::protocols::three_way_handshake::cmd_seq_t id,
+    uint32_t features) {
+  return common::protocols::three_way_handshake::MakeApproveResponce(id, SERVER_WHO_ARE_YOU_APPROVE_SUCCESS_1E,
+                                                                     features);
 }
 common::protocols::three_way_handshake::cmd_approve_t WhoAreYouApproveResponceFail(
     common::protocols::three_way_handshake::cmd_seq_t id,
@@ -109,6 +121,12 @@ common::protocols::three_way_handshake::cmd_approve_t ServerSendChatMessageAppro
                                                                      error_text);
 }
 
+common::protocols::three_way_handshake::cmd_request_t ExternalRequest(
+    common::protocols::three_way_handshake::cmd_seq_t id,
+    const std::string& command) {
+  return common::protocols::three_way_handshake::MakeRequest(id, SERVER_EXTERNAL_REQ_1E, command);
+}
+
 common::protocols::three_way_handshake::cmd_request_t PingRequest(
     common::protocols::three_way_handshake::cmd_seq_t id) {
   return common::protocols::three_way_handshake::MakeRequest(id, SERVER_PING_REQ);
@@ -152,6 +170,80 @@ common::protocols::three_way_handshake::cmd_responce_t GetRuntimeChannelInfoResp
   return common::protocols::three_way_handshake::MakeResponce(id, SERVER_GET_RUNTIME_CHANNEL_INFO_RESP_SUCCSESS_1E,
                                                               rchannel_info);
 }
+
+namespace {
+// info with newest count messages of history, serialized as binary or json argument
+common::Error SerializeRuntimeChannelInfo(const RuntimeChannelInfo& rchannel_info,
+                                          const RuntimeChannelInfo::messages_t& history,
+                                          size_t count,
+                                          bool binary,
+                                          std::string* out) {
+  RuntimeChannelInfo info = rchannel_info;
+  for (size_t i = history.size() - count; i < history.size(); ++i) {
+    info.AddMessage(history[i]);
+  }
+
+  if (binary) {
+    out->clear();  // writer appends
+    inner::BinarySerialize(info, out);
+    return common::Error();
+  }
+  return info.SerializeToString(out);
+}
+
+common::protocols::three_way_handshake::cmd_responce_t MakeRuntimeChannelInfoResponce(
+    common::protocols::three_way_handshake::cmd_seq_t id,
+    const std::string& rchannel_info,
+    bool binary) {
+  if (binary) {
+    return inner::MakeBinaryResponce(id, SUCCESS_COMMAND, CLIENT_GET_RUNTIME_CHANNEL_INFO, rchannel_info);
+  }
+  return GetRuntimeChannelInfoResponceSuccsess(id, rchannel_info);
+}
+}  // namespace
+
+common::protocols::three_way_handshake::cmd_responce_t GetRuntimeChannelInfoResponce(
+    common::protocols::three_way_handshake::cmd_seq_t id,
+    const RuntimeChannelInfo& rchannel_info,
+    const RuntimeChannelInfo::messages_t& history,
+    bool binary,
+    bool allow_chunked) {
+  std::string serialized;
+  common::Error err = SerializeRuntimeChannelInfo(rchannel_info, history, history.size(), binary, &serialized);
+  if (err) {
+    return GetRuntimeChannelInfoResponceFail(id, err->GetDescription());
+  }
+
+  common::protocols::three_way_handshake::cmd_responce_t resp =
+      MakeRuntimeChannelInfoResponce(id, serialized, binary);
+  if (allow_chunked || history.empty() || inner::InnerClient::IsFitFrame(resp.GetCmd())) {
+    return resp;
+  }
+
+  // binary search of newest messages count which fits
+  size_t low = 0;
+  size_t high = history.size() - 1;
+  while (low < high) {
+    const size_t middle = (low + high + 1) / 2;
+    err = SerializeRuntimeChannelInfo(rchannel_info, history, middle, binary, &serialized);
+    if (err) {
+      return GetRuntimeChannelInfoResponceFail(id, err->GetDescription());
+    }
+
+    if (inner::InnerClient::IsFitFrame(MakeRuntimeChannelInfoResponce(id, serialized, binary).GetCmd())) {
+      low = middle;
+    } else {
+      high = middle - 1;
+    }
+  }
+
+  err = SerializeRuntimeChannelInfo(rchannel_info, history, low, binary, &serialized);
+  if (err) {
+    return GetRuntimeChannelInfoResponceFail(id, err->GetDescription());
+  }
+  return MakeRuntimeChannelInfoResponce(id, serialized, binary);
+}
+
 common::protocols::three_way_handshake::cmd_responce_t GetRuntimeChannelInfoResponceFail(
     common::protocols::three_way_handshake::cmd_seq_t id,
     const std::string& error_text) {
@@ -159,6 +251,18 @@ common::protocols::three_way_handshake::cmd_responce_t GetRuntimeChannelInfoResp
                                                               error_text);
 }
 
+common::protocols::three_way_handshake::cmd_responce_t GetProgrammesResponceSuccsess(
+    common::protocols::three_way_handshake::cmd_seq_t id,
+    const serializet_t& programmes_info) {
+  return common::protocols::three_way_handshake::MakeResponce(id, SERVER_GET_PROGRAMMES_RESP_SUCCSESS_1E,
+                                                              programmes_info);
+}
+common::protocols::three_way_handshake::cmd_responce_t GetProgrammesResponceFail(
+    common::protocols::three_way_handshake::cmd_seq_t id,
+    const std::string& error_text) {
+  return common::protocols::three_way_handshake::MakeResponce(id, SERVER_GET_PROGRAMMES_RESP_FAIL_1E, error_text);
+}
+
 common::protocols::three_way_handshake::cmd_responce_t SendChatMessageResponceSuccsess(
     common::protocols::three_way_handshake::cmd_seq_t id,
     const serializet_t& message) {
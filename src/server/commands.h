@@ -21,6 +21,7 @@
 #include <string>  // for string
 
 #include "client_server_types.h"
+#include "runtime_channel_info.h"  // for RuntimeChannelInfo
 
 #include "commands/commands.h"
 
@@ -40,7 +41,8 @@ common::protocols::three_way_handshake::cmd_approve_t PingApproveResponceFail(
 common::protocols::three_way_handshake::cmd_request_t WhoAreYouRequest(
     common::protocols::three_way_handshake::cmd_seq_t id);
 common::protocols::three_way_handshake::cmd_approve_t WhoAreYouApproveResponceSuccsess(
-    common::protocols::three_way_handshake::cmd_seq_t id);
+    common::protocols::three_way_handshake::cmd_seq_t id,
+    uint32_t features);  // server features, ignored by old clients
 common::protocols::three_way_handshake::cmd_approve_t WhoAreYouApproveResponceFail(
     common::protocols::three_way_handshake::cmd_seq_t id,
     const std::string& error_text);  // escaped
@@ -64,6 +66,11 @@ common::protocols::three_way_handshake::cmd_approve_t ServerSendChatMessageAppro
     common::protocols::three_way_handshake::cmd_seq_t id,
     const std::string& error_text);
 
+// external command published to redis, e.g. "ping"
+common::protocols::three_way_handshake::cmd_request_t ExternalRequest(
+    common::protocols::three_way_handshake::cmd_seq_t id,
+    const std::string& command);
+
 // responces
 // get_server_info
 common::protocols::three_way_handshake::cmd_responce_t GetServerInfoResponceSuccsess(
@@ -85,10 +92,26 @@ common::protocols::three_way_handshake::cmd_responce_t GetChannelsResponceFail(
 common::protocols::three_way_handshake::cmd_responce_t GetRuntimeChannelInfoResponceSuccsess(
     common::protocols::three_way_handshake::cmd_seq_t id,
     const serializet_t& rchannel_info);
+// info with newest messages of history (oldest first), peer without chunked support refuses reply bigger than
+// one frame, so oldest messages are left out until it fits; fail responce if info can't be serialized
+common::protocols::three_way_handshake::cmd_responce_t GetRuntimeChannelInfoResponce(
+    common::protocols::three_way_handshake::cmd_seq_t id,
+    const RuntimeChannelInfo& rchannel_info,
+    const RuntimeChannelInfo::messages_t& history,
+    bool binary,
+    bool allow_chunked);
 common::protocols::three_way_handshake::cmd_responce_t GetRuntimeChannelInfoResponceFail(
     common::protocols::three_way_handshake::cmd_seq_t id,
     const std::string& error_text);
 
+// get_programmes
+common::protocols::three_way_handshake::cmd_responce_t GetProgrammesResponceSuccsess(
+    common::protocols::three_way_handshake::cmd_seq_t id,
+    const serializet_t& programmes_info);
+common::protocols::three_way_handshake::cmd_responce_t GetProgrammesResponceFail(
+    common::protocols::three_way_handshake::cmd_seq_t id,
+    const std::string& error_text);
+
 // send_chat_message client
 common::protocols::three_way_handshake::cmd_responce_t SendChatMessageResponceSuccsess(
     common::protocols::three_way_handshake::cmd_seq_t id,
@@ -24,25 +24,56 @@
 
 #include "inih/ini.h"
 
+#include "inner/inner_server_command_seq_parser.h"  // for InnerServerCommandSeqParser::default_request_timeout
+
+#include "server/inner/chat_history.h"
+#include "server/user_info_cache.h"
+
 #define CHANNEL_COMMANDS_IN_NAME "COMMANDS_IN"
 #define CHANNEL_COMMANDS_OUT_NAME "COMMANDS_OUT"
 #define CHANNEL_CLIENTS_STATE_NAME "CLIENTS_STATE"
+#define CHANNEL_USERS_CHANGED_NAME "USERS_CHANGED"
+#define CHANNEL_EPG_CHANGED_NAME "EPG_CHANGED"
 
 #define CONFIG_SERVER_OPTIONS "server"
 #define CONFIG_SERVER_OPTIONS_HOST_FIELD "host"
+#define CONFIG_SERVER_OPTIONS_WORKERS_FIELD "workers"
 #define CONFIG_SERVER_OPTIONS_REDIS_SERVER_FIELD "redis_server"
 #define CONFIG_SERVER_OPTIONS_REDIS_UNIX_PATH_FIELD "redis_unix_path"
+#define CONFIG_SERVER_OPTIONS_REDIS_POOL_SIZE_FIELD "redis_pool_size"
+#define CONFIG_SERVER_OPTIONS_REDIS_PUBLISH_BUFFER_SIZE_FIELD "redis_publish_buffer_size"
 #define CONFIG_SERVER_OPTIONS_REDIS_CHANNEL_IN_FIELD "redis_channel_in_name"
 #define CONFIG_SERVER_OPTIONS_REDIS_CHANNEL_OUT_FIELD "redis_channel_out_name"
 #define CONFIG_SERVER_OPTIONS_REDIS_CHANNEL_STATUS_FIELD "redis_channel_clients_state_name"
+#define CONFIG_SERVER_OPTIONS_REDIS_CHANNEL_USERS_CHANGED_FIELD "redis_channel_users_changed_name"
+#define CONFIG_SERVER_OPTIONS_REDIS_CHANNEL_EPG_CHANGED_FIELD "redis_channel_epg_changed_name"
+#define CONFIG_SERVER_OPTIONS_USER_CACHE_SIZE_FIELD "user_cache_size"
+#define CONFIG_SERVER_OPTIONS_USER_CACHE_TTL_FIELD "user_cache_ttl"
 #define CONFIG_SERVER_OPTIONS_BANDWIDT_SERVER_FIELD "bandwidth_server"
+#define CONFIG_SERVER_OPTIONS_METRICS_SERVER_FIELD "metrics_server"
+#define CONFIG_SERVER_OPTIONS_EPG_FILE_FIELD "epg_file"
+#define CONFIG_SERVER_OPTIONS_XMLTV_FILE_FIELD "xmltv_file"
+#define CONFIG_SERVER_OPTIONS_CHAT_HISTORY_SIZE_FIELD "chat_history_size"
+#define CONFIG_SERVER_OPTIONS_CHAT_HISTORY_BUDGET_FIELD "chat_history_budget"
+#define CONFIG_SERVER_OPTIONS_REQUEST_TIMEOUT_FIELD "request_timeout"
 
 /*
   [server]
   host=fastotv.com:7040
+  workers=1
   redis_server=localhost:6379
   redis_unix_path=/var/run/redis/redis.sock
+  redis_pool_size=4
+  redis_publish_buffer_size=10000
   bandwidth_server=localhost:5544
+  metrics_server=127.0.0.1:9140
+  user_cache_size=10000
+  user_cache_ttl=600
+  epg_file=/var/lib/fastotv/guide.epg
+  xmltv_file=/var/lib/fastotv/guide.xml
+  chat_history_size=50
+  chat_history_budget=16777216
+  request_timeout=30
 */
 
 namespace fastotv {
@@ -70,9 +101,36 @@ int ini_handler_fasto(void* user_data, const char* section, const char* name, co
     }
     pconfig->server.host = hs;
     return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_WORKERS_FIELD)) {
+    size_t workers;
+    bool res = common::ConvertFromString(value, &workers);
+    if (!res || workers == 0) {
+      WARNING_LOG() << "Invalid " CONFIG_SERVER_OPTIONS_WORKERS_FIELD " value: " << value;
+      return 0;
+    }
+    pconfig->server.workers = workers;
+    return 1;
   } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_REDIS_UNIX_PATH_FIELD)) {
     pconfig->server.redis.redis_unix_socket = value;
     return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_REDIS_POOL_SIZE_FIELD)) {
+    size_t pool_size;
+    bool res = common::ConvertFromString(value, &pool_size);
+    if (!res || pool_size == 0) {
+      WARNING_LOG() << "Invalid " CONFIG_SERVER_OPTIONS_REDIS_POOL_SIZE_FIELD " value: " << value;
+      return 0;
+    }
+    pconfig->server.redis.pool_size = pool_size;
+    return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_REDIS_PUBLISH_BUFFER_SIZE_FIELD)) {
+    size_t buffer_size;
+    bool res = common::ConvertFromString(value, &buffer_size);
+    if (!res || buffer_size == 0) {
+      WARNING_LOG() << "Invalid " CONFIG_SERVER_OPTIONS_REDIS_PUBLISH_BUFFER_SIZE_FIELD " value: " << value;
+      return 0;
+    }
+    pconfig->server.redis.publish_buffer_size = buffer_size;
+    return 1;
   } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_REDIS_CHANNEL_IN_FIELD)) {
     pconfig->server.redis.channel_in = value;
     return 1;
@@ -82,6 +140,30 @@ int ini_handler_fasto(void* user_data, const char* section, const char* name, co
   } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_REDIS_CHANNEL_STATUS_FIELD)) {
     pconfig->server.redis.channel_clients_state = value;
     return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_REDIS_CHANNEL_USERS_CHANGED_FIELD)) {
+    pconfig->server.redis.channel_users_changed = value;
+    return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_REDIS_CHANNEL_EPG_CHANGED_FIELD)) {
+    pconfig->server.redis.channel_epg_changed = value;
+    return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_USER_CACHE_SIZE_FIELD)) {
+    size_t cache_size;
+    bool res = common::ConvertFromString(value, &cache_size);
+    if (!res) {
+      WARNING_LOG() << "Invalid " CONFIG_SERVER_OPTIONS_USER_CACHE_SIZE_FIELD " value: " << value;
+      return 0;
+    }
+    pconfig->server.user_cache_size = cache_size;
+    return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_USER_CACHE_TTL_FIELD)) {
+    size_t cache_ttl;
+    bool res = common::ConvertFromString(value, &cache_ttl);
+    if (!res) {
+      WARNING_LOG() << "Invalid " CONFIG_SERVER_OPTIONS_USER_CACHE_TTL_FIELD " value: " << value;
+      return 0;
+    }
+    pconfig->server.user_cache_ttl = cache_ttl;
+    return 1;
   } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_BANDWIDT_SERVER_FIELD)) {
     common::net::HostAndPort hs;
     bool res = common::ConvertFromString(value, &hs);
@@ -91,13 +173,67 @@ int ini_handler_fasto(void* user_data, const char* section, const char* name, co
     }
     pconfig->server.bandwidth_host = hs;
     return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_METRICS_SERVER_FIELD)) {
+    common::net::HostAndPort hs;
+    bool res = common::ConvertFromString(value, &hs);
+    if (!res) {
+      WARNING_LOG() << "Invalid " CONFIG_SERVER_OPTIONS_METRICS_SERVER_FIELD " value: " << value;
+      return 0;
+    }
+    pconfig->server.metrics_host = hs;
+    return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_EPG_FILE_FIELD)) {
+    pconfig->server.epg_path = value;
+    return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_XMLTV_FILE_FIELD)) {
+    pconfig->server.xmltv_path = value;
+    return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_CHAT_HISTORY_SIZE_FIELD)) {
+    size_t history_size;
+    bool res = common::ConvertFromString(value, &history_size);
+    if (!res) {
+      WARNING_LOG() << "Invalid " CONFIG_SERVER_OPTIONS_CHAT_HISTORY_SIZE_FIELD " value: " << value;
+      return 0;
+    }
+    pconfig->server.chat_history_size = history_size;
+    return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_CHAT_HISTORY_BUDGET_FIELD)) {
+    size_t history_budget;
+    bool res = common::ConvertFromString(value, &history_budget);
+    if (!res) {
+      WARNING_LOG() << "Invalid " CONFIG_SERVER_OPTIONS_CHAT_HISTORY_BUDGET_FIELD " value: " << value;
+      return 0;
+    }
+    pconfig->server.chat_history_budget = history_budget;
+    return 1;
+  } else if (MATCH(CONFIG_SERVER_OPTIONS, CONFIG_SERVER_OPTIONS_REQUEST_TIMEOUT_FIELD)) {
+    size_t request_timeout;
+    bool res = common::ConvertFromString(value, &request_timeout);
+    if (!res || request_timeout == 0) {
+      WARNING_LOG() << "Invalid " CONFIG_SERVER_OPTIONS_REQUEST_TIMEOUT_FIELD " value: " << value;
+      return 0;
+    }
+    pconfig->server.request_timeout = request_timeout;
+    return 1;
   } else {
     return 0; /* unknown section/name, error */
   }
 }
 }  // namespace
 
-ServerSettings::ServerSettings() : host(), redis(), bandwidth_host() {
+ServerSettings::ServerSettings()
+    : host(),
+      redis(),
+      bandwidth_host(),
+      metrics_host(),
+      user_cache_size(UserInfoCache::default_max_entries),
+      user_cache_ttl(UserInfoCache::default_ttl_sec),
+      workers(1),
+      epg_path(),
+      xmltv_path(),
+      chat_history_size(inner::ChatHistory::default_channel_capacity),
+      chat_history_budget(inner::ChatHistory::default_budget),
+      request_timeout(fastotv::inner::InnerServerCommandSeqParser::default_request_timeout) {  // ticks are seconds
   // in config by default
   // redis.redis_host = redis_default_host;
   // redis.redis_unix_socket = redis_default_unix_path;
@@ -105,6 +241,8 @@ ServerSettings::ServerSettings() : host(), redis(), bandwidth_host() {
   redis.channel_in = CHANNEL_COMMANDS_IN_NAME;
   redis.channel_out = CHANNEL_COMMANDS_OUT_NAME;
   redis.channel_clients_state = CHANNEL_CLIENTS_STATE_NAME;
+  redis.channel_users_changed = CHANNEL_USERS_CHANGED_NAME;
+  redis.channel_epg_changed = CHANNEL_EPG_CHANGED_NAME;
 
   // bandwidth_host = bandwidth_default_host;
 }
@@ -18,6 +18,8 @@
 
 #pragma once
 
+#include <stddef.h>  // for size_t
+
 #include <string>  // for string
 
 #include <common/error.h>      // for Error
@@ -35,6 +37,15 @@ struct ServerSettings {
   common::net::HostAndPort host;
   redis::RedisSubConfig redis;
   common::net::HostAndPort bandwidth_host;
+  common::net::HostAndPort metrics_host;  // prometheus endpoint, disabled if invalid
+  size_t user_cache_size;  // max cached users
+  size_t user_cache_ttl;   // sec
+  size_t workers;          // io loops, each with own listener
+  std::string epg_path;    // compact guide file, served for channels missing in redis guide, disabled if empty
+  std::string xmltv_path;  // guide ingested into epg_path on reload, optional
+  size_t chat_history_size;    // last messages kept per official channel, 0 - disabled
+  size_t chat_history_budget;  // bytes of chat history of all channels, shared by workers
+  size_t request_timeout;      // sec, requests to clients (external ones included) fail if not answered in time
 };
 
 struct Config {
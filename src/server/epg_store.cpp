@@ -0,0 +1,174 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "server/epg_store.h"
+
+#include <algorithm>  // for upper_bound, lower_bound
+
+#include "epg/epg_file.h"  // for EpgFile
+
+namespace fastotv {
+namespace server {
+
+EpgStore::EpgStore() : mutex_(), snapshot_(std::make_shared<Snapshot>()) {}
+
+void EpgStore::Load(const epgs_t& epgs) {
+  std::shared_ptr<channels_map_t> channels = std::make_shared<channels_map_t>();
+  for (const EpgInfo& epg : epgs) {
+    if (epg.GetChannelId() == invalid_stream_id) {
+      continue;
+    }
+
+    const EpgInfo::programs_t progs = epg.GetPrograms();  // sorted by start
+    ChannelProgrammes& chan = (*channels)[epg.GetChannelId()];
+    chan = ChannelProgrammes();
+    chan.starts.reserve(progs.size());
+    chan.stops.reserve(progs.size());
+    chan.titles_offsets.reserve(progs.size() + 1);
+    chan.titles_offsets.push_back(0);
+    for (size_t i = 0; i < progs.size(); ++i) {
+      const ProgrammeInfo& prog = progs[i];
+      timestamp_t stop = prog.GetStop();
+      if (i + 1 < progs.size() && progs[i + 1].GetStart() < stop) {
+        stop = progs[i + 1].GetStart();
+      }
+      if (stop <= prog.GetStart()) {  // broken or fully overlapped
+        continue;
+      }
+
+      chan.starts.push_back(prog.GetStart());
+      chan.stops.push_back(stop);
+      chan.titles += prog.GetTitle();
+      chan.titles_offsets.push_back(static_cast<uint32_t>(chan.titles.size()));
+    }
+    chan.titles.shrink_to_fit();
+  }
+  size_t programmes_count = 0;
+  for (const auto& chan : *channels) {  // last epg of channel wins
+    programmes_count += chan.second.starts.size();
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  std::shared_ptr<Snapshot> snapshot = std::make_shared<Snapshot>(*snapshot_);
+  snapshot->channels = channels;
+  snapshot->programmes_count = programmes_count;
+  snapshot_ = snapshot;
+}
+
+void EpgStore::SetFile(std::shared_ptr<const epg::EpgFile> file) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  std::shared_ptr<Snapshot> snapshot = std::make_shared<Snapshot>(*snapshot_);
+  snapshot->file = file;
+  snapshot_ = snapshot;
+}
+
+void EpgStore::Clear() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  snapshot_ = std::make_shared<Snapshot>();
+}
+
+bool EpgStore::IsEmpty() const {
+  const snapshot_ptr_t snapshot = GetSnapshot();
+  return snapshot->channels->empty() && (!snapshot->file || snapshot->file->GetChannelsCount() == 0);
+}
+
+size_t EpgStore::GetChannelsCount() const {
+  const snapshot_ptr_t snapshot = GetSnapshot();
+  size_t count = snapshot->channels->size();
+  if (snapshot->file) {
+    for (size_t i = 0; i < snapshot->file->GetChannelsCount(); ++i) {
+      count += snapshot->channels->count(snapshot->file->GetChannelId(i)) ? 0 : 1;
+    }
+  }
+  return count;
+}
+
+size_t EpgStore::GetProgrammesCount() const {
+  const snapshot_ptr_t snapshot = GetSnapshot();
+  return snapshot->programmes_count + (snapshot->file ? snapshot->file->GetProgrammesCount() : 0);
+}
+
+void EpgStore::FindProgrammes(const channels_t& channels,
+                              timestamp_t from,
+                              timestamp_t to,
+                              size_t limit,
+                              ProgrammesInfo::programmes_t* out) const {
+  if (!out || from >= to) {
+    return;
+  }
+
+  const snapshot_ptr_t snapshot = GetSnapshot();
+  for (const stream_id& sid : channels) {
+    auto it = snapshot->channels->find(sid);
+    if (it == snapshot->channels->end()) {
+      if (snapshot->file) {
+        snapshot->file->FindProgrammes(sid, from, to, limit, out);
+      }
+      continue;
+    }
+
+    const ChannelProgrammes& chan = it->second;
+    const size_t lo = std::upper_bound(chan.stops.begin(), chan.stops.end(), from) - chan.stops.begin();
+    size_t hi = std::lower_bound(chan.starts.begin() + lo, chan.starts.end(), to) - chan.starts.begin();
+    if (limit != 0 && hi - lo > limit) {
+      hi = lo + limit;
+    }
+    for (size_t i = lo; i < hi; ++i) {
+      const uint32_t offset = chan.titles_offsets[i];
+      out->push_back(ProgrammeInfo(sid, chan.starts[i], chan.stops[i],
+                                   chan.titles.substr(offset, chan.titles_offsets[i + 1] - offset)));
+    }
+  }
+}
+
+ProgrammesRequestInfo EpgStore::ClampRequest(const ProgrammesRequestInfo& req) {
+  channels_t channels = req.GetChannels();
+  if (channels.size() > max_request_channels) {
+    channels.resize(max_request_channels);
+  }
+
+  const timestamp_t from = req.GetFrom();
+  timestamp_t to = req.GetTo();
+  if (to > from && static_cast<uint64_t>(to) - static_cast<uint64_t>(from) > max_request_window) {
+    to = from + max_request_window;
+  }
+
+  size_t limit = req.GetLimit();
+  if (limit == 0 || limit > max_request_limit) {
+    limit = max_request_limit;
+  }
+  return ProgrammesRequestInfo(channels, from, to, limit);
+}
+
+ChannelsInfo EpgStore::StripProgrammes(const ChannelsInfo& channels) {
+  ChannelsInfo stripped;
+  for (const ChannelInfo& channel : channels.GetChannels()) {
+    EpgInfo epg = channel.GetEpg();
+    epg.SetPrograms(EpgInfo::programs_t());
+    stripped.AddChannel(ChannelInfo(epg, channel.IsEnableAudio(), channel.IsEnableVideo()));
+  }
+  return stripped;
+}
+
+EpgStore::snapshot_ptr_t EpgStore::GetSnapshot() const {
+  std::unique_lock<std::mutex> lock(mutex_);
+  return snapshot_;
+}
+
+}  // namespace server
+}  // namespace fastotv
@@ -0,0 +1,106 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>  // for uint32_t
+
+#include <memory>  // for shared_ptr
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <common/macros.h>  // for DISALLOW_COPY_AND_ASSIGN
+
+#include "channels_info.h"            // for ChannelsInfo
+#include "programmes_info.h"          // for ProgrammesInfo::programmes_t
+#include "programmes_request_info.h"  // for ProgrammesRequestInfo
+
+namespace fastotv {
+namespace epg {
+class EpgFile;
+}
+namespace server {
+
+// Thread-safe programme guide answering get_programmes.
+// Programmes of a channel are kept sorted by start in parallel arrays with titles packed into one string,
+// overlapping programmes are cut at the start of the next one, so stops are sorted too and a [from, to)
+// window is found by two binary searches. Load builds a new snapshot and swaps it, readers never wait for it.
+// Channels missing in the loaded guide are looked up in the mapped guide file set by SetFile, if any.
+class EpgStore {
+ public:
+  typedef std::vector<EpgInfo> epgs_t;
+  typedef std::vector<stream_id> channels_t;
+
+  // bounds of one get_programmes request, clients page through longer guides
+  enum {
+    max_request_channels = 256,
+    max_request_limit = 512,                   // programmes per channel
+    max_request_window = 7 * 24 * 3600 * 1000  // msec
+  };
+
+  EpgStore();
+
+  void Load(const epgs_t& epgs);
+  void SetFile(std::shared_ptr<const epg::EpgFile> file);  // NULL detaches
+  void Clear();
+
+  bool IsEmpty() const;
+  size_t GetChannelsCount() const;
+  size_t GetProgrammesCount() const;  // of both sources
+
+  // programmes intersecting [from, to) ordered by channels then start, at most limit per channel (0 - all)
+  void FindProgrammes(const channels_t& channels,
+                      timestamp_t from,
+                      timestamp_t to,
+                      size_t limit,
+                      ProgrammesInfo::programmes_t* out) const;
+
+  // request cut to the bounds above, the limit 0 (all) becomes max_request_limit
+  static ProgrammesRequestInfo ClampRequest(const ProgrammesRequestInfo& req);
+  // channel list for clients which fetch programmes by get_programmes
+  static ChannelsInfo StripProgrammes(const ChannelsInfo& channels);
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(EpgStore);
+
+  struct ChannelProgrammes {
+    std::vector<timestamp_t> starts;
+    std::vector<timestamp_t> stops;
+    std::vector<uint32_t> titles_offsets;  // starts.size() + 1 offsets into titles
+    std::string titles;
+  };
+  typedef std::unordered_map<stream_id, ChannelProgrammes> channels_map_t;
+  struct Snapshot {
+    Snapshot() : channels(std::make_shared<channels_map_t>()), programmes_count(0), file() {}
+
+    std::shared_ptr<const channels_map_t> channels;
+    size_t programmes_count;
+    std::shared_ptr<const epg::EpgFile> file;
+  };
+  typedef std::shared_ptr<const Snapshot> snapshot_ptr_t;
+
+  snapshot_ptr_t GetSnapshot() const;
+
+  mutable std::mutex mutex_;
+  snapshot_ptr_t snapshot_;
+};
+
+}  // namespace server
+}  // namespace fastotv
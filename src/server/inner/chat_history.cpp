@@ -0,0 +1,159 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+#include "server/inner/chat_history.h"
+
+#include <utility>  // for make_pair
+
+namespace fastotv {
+namespace server {
+namespace inner {
+
+ChatHistory::ChatHistory()
+    : channel_capacity_(default_channel_capacity),
+      budget_(default_budget),
+      size_(0),
+      rings_size_(0),
+      count_(0),
+      next_seq_(0),
+      channels_(),
+      ages_() {}
+
+void ChatHistory::SetLimits(size_t channel_capacity, size_t budget) {
+  channel_capacity_ = channel_capacity;
+  budget_ = budget;
+  size_ = 0;
+  rings_size_ = 0;
+  count_ = 0;
+  channels_.clear();
+  ages_.clear();
+}
+
+void ChatHistory::Add(const ChatMessage& msg) {
+  const size_t msg_size = MessageSize(msg);
+  if (channel_capacity_ == 0) {
+    return;
+  }
+
+  const stream_id sid = msg.GetChannelId();
+  channels_t::iterator it = channels_.find(sid);
+  const size_t ring_size = it == channels_.end() ? RingSize(sid) : 0;
+  if (rings_size_ + ring_size + msg_size > budget_) {  // would not fit even without other messages
+    return;
+  }
+
+  if (it == channels_.end()) {
+    it = channels_.insert(std::make_pair(sid, Channel())).first;
+    it->second.ring.resize(channel_capacity_);
+    rings_size_ += ring_size;
+    size_ += ring_size;
+  }
+
+  Channel& chan = it->second;
+  if (chan.count == channel_capacity_) {  // its age becomes stale
+    DropOldest(&chan);
+  }
+
+  Entry& entry = chan.ring[(chan.head + chan.count) % channel_capacity_];
+  entry.message = msg;
+  entry.seq = next_seq_++;
+  entry.size = msg_size;
+  chan.count++;
+  size_ += msg_size;
+  count_++;
+
+  Age age;
+  age.channel = &chan;
+  age.seq = entry.seq;
+  ages_.push_back(age);
+  while (size_ > budget_ && !ages_.empty()) {
+    EvictOldest();
+  }
+  if (ages_.size() > count_ * 2 + channel_capacity_) {
+    CompactAges();
+  }
+}
+
+ChatHistory::messages_t ChatHistory::GetMessages(stream_id sid) const {
+  messages_t msgs;
+  channels_t::const_iterator it = channels_.find(sid);
+  if (it == channels_.end()) {
+    return msgs;
+  }
+
+  const Channel& chan = it->second;
+  for (size_t i = 0; i < chan.count; ++i) {
+    msgs.push_back(chan.ring[(chan.head + i) % channel_capacity_].message);
+  }
+  return msgs;
+}
+
+size_t ChatHistory::GetMessagesCount() const {
+  return count_;
+}
+
+size_t ChatHistory::GetChannelsCount() const {
+  return channels_.size();
+}
+
+size_t ChatHistory::GetSize() const {
+  return size_;
+}
+
+size_t ChatHistory::MessageSize(const ChatMessage& msg) {
+  return sizeof(Age) + msg.GetChannelId().size() + msg.GetLogin().size() + msg.GetMessage().size();
+}
+
+size_t ChatHistory::RingSize(stream_id sid) const {
+  return sizeof(channels_t::value_type) + sid.size() + channel_capacity_ * sizeof(Entry);
+}
+
+void ChatHistory::DropOldest(Channel* chan) {
+  Entry& oldest = chan->ring[chan->head];
+  size_ -= oldest.size;
+  count_--;
+  oldest = Entry();
+  chan->head = (chan->head + 1) % channel_capacity_;
+  chan->count--;
+}
+
+void ChatHistory::EvictOldest() {
+  while (!ages_.empty()) {
+    const Age age = ages_.front();
+    ages_.pop_front();
+    Channel* chan = age.channel;
+    if (chan->count != 0 && chan->ring[chan->head].seq == age.seq) {
+      DropOldest(chan);
+      return;
+    }
+  }
+}
+
+void ChatHistory::CompactAges() {
+  std::deque<Age> live;
+  for (const Age& age : ages_) {
+    const Channel* chan = age.channel;
+    if (chan->count != 0 && age.seq >= chan->ring[chan->head].seq) {
+      live.push_back(age);
+    }
+  }
+  ages_.swap(live);
+}
+
+}  // namespace inner
+}  // namespace server
+}  // namespace fastotv
@@ -0,0 +1,97 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+#pragma once
+
+#include <stdint.h>  // for uint64_t
+
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+#include <common/macros.h>  // for DISALLOW_COPY_AND_ASSIGN
+
+#include "runtime_channel_info.h"  // for RuntimeChannelInfo::messages_t
+
+namespace fastotv {
+namespace server {
+namespace inner {
+
+// Last chat messages of channels, one per server shared by all workers (not thread-safe, ServerHost locks it).
+// Every channel has a ring of fixed capacity, a new message overwrites the oldest one of its channel.
+// Size of all kept messages and of allocated rings is capped by budget, when it is exceeded the oldest messages
+// of any channel are dropped, their age order is a queue next to rings, so adding stays O(1) amortized.
+// Rings are never freed, a channel whose ring does not fit into budget keeps no history.
+class ChatHistory {
+ public:
+  typedef RuntimeChannelInfo::messages_t messages_t;
+  enum { default_channel_capacity = 50, default_budget = 16 * 1024 * 1024 };
+
+  ChatHistory();
+
+  // capacity - messages per channel (0 disables history), budget - bytes of all channels; drops history
+  void SetLimits(size_t channel_capacity, size_t budget);
+
+  void Add(const ChatMessage& msg);
+  messages_t GetMessages(stream_id sid) const;  // oldest first
+
+  size_t GetMessagesCount() const;
+  size_t GetChannelsCount() const;
+  size_t GetSize() const;  // bytes accounted against budget, rings included
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ChatHistory);
+
+  struct Entry {
+    Entry() : message(), seq(0), size(0) {}
+
+    ChatMessage message;
+    uint64_t seq;
+    size_t size;
+  };
+  struct Channel {
+    Channel() : ring(), head(0), count(0) {}
+
+    std::vector<Entry> ring;  // allocated on first message
+    size_t head;              // oldest message
+    size_t count;
+  };
+  struct Age {
+    Channel* channel;
+    uint64_t seq;
+  };
+  typedef std::unordered_map<stream_id, Channel> channels_t;  // nodes are stable, channels are never erased
+
+  static size_t MessageSize(const ChatMessage& msg);  // its ring slot is accounted by RingSize
+  size_t RingSize(stream_id sid) const;
+  void DropOldest(Channel* chan);
+  void EvictOldest();
+  void CompactAges();  // removes ages of overwritten messages
+
+  size_t channel_capacity_;
+  size_t budget_;
+  size_t size_;
+  size_t rings_size_;
+  size_t count_;
+  uint64_t next_seq_;
+  channels_t channels_;
+  std::deque<Age> ages_;  // kept messages by age, also stale ones of overwritten messages
+};
+
+}  // namespace inner
+}  // namespace server
+}  // namespace fastotv
@@ -28,21 +28,26 @@ extern "C" {
 
 #include "inner/inner_server_command_seq_parser.h"  // for RequestCallback
 
-#include "server/inner/inner_tcp_client.h"
 #include "server/inner/inner_tcp_handler.h"
 
 #include "server/responce_info.h"  // for ResponceInfo
+#include "server/server_host.h"    // for ServerHost
 #include "server/user_info.h"      // for user_id_t
 
 // publish COMMANDS_IN 'user_id 0 1 ping' 0 => request
 // publish COMMANDS_OUT '1 [OK|FAIL] ping args...'
 // id cmd cause
+// publish USERS_CHANGED 'login' => drop cached user
+// publish EPG_CHANGED '' => reload programme guide
 
 namespace fastotv {
 namespace server {
 namespace inner {
 
-InnerSubHandler::InnerSubHandler(InnerTcpHandlerHost* parent) : parent_(parent) {}
+InnerSubHandler::InnerSubHandler(ServerHost* parent,
+                                 const std::string& users_changed_channel,
+                                 const std::string& epg_changed_channel)
+    : parent_(parent), users_changed_channel_(users_changed_channel), epg_changed_channel_(epg_changed_channel) {}
 
 InnerSubHandler::~InnerSubHandler() {}
 
@@ -61,6 +66,15 @@ void InnerSubHandler::HandleMessage(const std::string& channel, const std::strin
   // [user_id_t]login [device_id_t]device_id [cmd_id_t]seq [std::string]command args ...
   // [cmd_id_t]seq OK/FAIL [std::string]command args ..
   INFO_LOG() << "InnerSubHandler channel: " << channel << ", msg: " << msg;
+  if (!users_changed_channel_.empty() && channel == users_changed_channel_) {  // msg is login of changed user
+    parent_->InvalidateUser(msg);
+    return;
+  }
+  if (!epg_changed_channel_.empty() && channel == epg_changed_channel_) {
+    parent_->RequestEpgReload();
+    return;
+  }
+
   size_t space_pos = msg.find_first_of(' ');
   if (space_pos == std::string::npos) {
     const std::string resp = common::MemSPrintf("UNKNOWN COMMAND: %s", msg);
@@ -90,53 +104,47 @@ void InnerSubHandler::HandleMessage(const std::string& channel, const std::strin
     return;
   }
 
-  InnerTcpClient* fclient = parent_->FindInnerConnectionByUserIDAndDeviceID(uid, dev);
-  if (!fclient) {
-    int argc;
-    sds* argv = sdssplitargslong(cmd_str.c_str(), &argc);
-    char* command = argv[0];
-
-    ResponceInfo resp(id, FAIL_COMMAND, command, "{\"cause\": \"not connected\"}");
-    std::string resp_str;
-    common::Error err = resp.SerializeToString(&resp_str);
-    if (err) {
-      PublishResponce(resp);
-      sdsfreesplitres(argv, argc);
-      return;
-    }
-
-    WARNING_LOG() << resp_str;
-    PublishResponce(resp);
-    sdsfreesplitres(argv, argc);
+  // connection lives in the loop of some worker, request is written from there
+  InnerTcpHandlerHost* owner = parent_->FindDeviceOwner(uid, dev);
+  if (!owner) {
+    PublishFailResponce(id, cmd_str, "not connected");
     return;
   }
 
-  common::protocols::three_way_handshake::cmd_request_t req(id, input_command);
-  err = fclient->Write(req);
-  if (err) {
-    int argc;
-    sds* argv = sdssplitargslong(cmd_str.c_str(), &argc);
-    char* command = argv[0];
-
-    ResponceInfo resp(id, FAIL_COMMAND, command, "{\"cause\": \"not handled\"}");
-    std::string resp_str;
-    common::Error err = resp.SerializeToString(&resp_str);
-    if (err) {
-      PublishResponce(resp);
-      sdsfreesplitres(argv, argc);
-      return;
-    }
+  auto cb = std::bind(&InnerSubHandler::ProcessSubscribed, this, std::placeholders::_1, std::placeholders::_2,
+                      std::placeholders::_3);
+  int argc;
+  sds* argv = sdssplitargslong(cmd_str.c_str(), &argc);
+  const std::string command = argv && argc > 0 ? argv[0] : "null";
+  sdsfreesplitres(argv, argc);
+
+  fastotv::inner::RequestCallback rc(id, command, cb);
+  auto fail_cb = [this, id, cmd_str](const std::string& cause) { PublishFailResponce(id, cmd_str, cause); };
+  owner->PostExternalRequest(uid, dev, cmd_str, rc, fail_cb);
+}
+
+void InnerSubHandler::HandleResubscribed() {
+  // users and epg changed notifications could be missed
+  parent_->InvalidateUsers();
+  parent_->RequestEpgReload();
+}
 
+void InnerSubHandler::PublishFailResponce(common::protocols::three_way_handshake::cmd_seq_t request_id,
+                                          const std::string& cmd,
+                                          const std::string& cause) {
+  int argc;
+  sds* argv = sdssplitargslong(cmd.c_str(), &argc);
+  const char* command = argv && argc > 0 ? argv[0] : "null";
+
+  ResponceInfo resp(request_id, FAIL_COMMAND, command, common::MemSPrintf("{\"cause\": \"%s\"}", cause));
+  std::string resp_str;
+  common::Error err = resp.SerializeToString(&resp_str);
+  if (!err) {
     WARNING_LOG() << resp_str;
-    PublishResponce(resp);
-    sdsfreesplitres(argv, argc);
-    return;
   }
 
-  auto cb = std::bind(&InnerSubHandler::ProcessSubscribed, this, std::placeholders::_1, std::placeholders::_2,
-                      std::placeholders::_3);
-  fastotv::inner::RequestCallback rc(id, cb);
-  parent_->SubscribeRequest(rc);
+  PublishResponce(resp);
+  sdsfreesplitres(argv, argc);
 }
 
 void InnerSubHandler::PublishResponce(const ResponceInfo& resp) {
@@ -27,24 +27,29 @@
 namespace fastotv {
 namespace server {
 class ResponceInfo;
+class ServerHost;
 namespace inner {
 
-class InnerTcpHandlerHost;
-
 class InnerSubHandler : public redis::RedisSubHandler {
  public:
-  explicit InnerSubHandler(InnerTcpHandlerHost* parent);
+  InnerSubHandler(ServerHost* parent, const std::string& users_changed_channel, const std::string& epg_changed_channel);
   virtual ~InnerSubHandler();
 
  protected:
   virtual void HandleMessage(const std::string& channel, const std::string& msg) override;
+  virtual void HandleResubscribed() override;
 
  private:
   void ProcessSubscribed(common::protocols::three_way_handshake::cmd_seq_t request_id, int argc, char* argv[]);
 
+  void PublishFailResponce(common::protocols::three_way_handshake::cmd_seq_t request_id,
+                           const std::string& cmd,
+                           const std::string& cause);
   void PublishResponce(const ResponceInfo& resp);
 
-  InnerTcpHandlerHost* parent_;
+  ServerHost* parent_;
+  const std::string users_changed_channel_;
+  const std::string epg_changed_channel_;
 };
 
 }  // namespace inner
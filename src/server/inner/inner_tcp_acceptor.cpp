@@ -0,0 +1,130 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "server/inner/inner_tcp_acceptor.h"
+
+#include <errno.h>
+#include <netdb.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+
+#include <common/convert2string.h>            // for ConvertToString
+#include <common/file_system/file_system.h>  // for set_blocking_descriptor
+#include <common/sprintf.h>                   // for MemSPrintf
+
+namespace fastotv {
+namespace server {
+namespace inner {
+
+common::Error CreateListener(const common::net::HostAndPort& host, int backlog, bool reuse_port, int* fd) {
+  if (!host.IsValid() || !fd) {
+    return common::make_error_inval();
+  }
+
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_PASSIVE;
+
+  const std::string host_str = host.GetHost();
+  const std::string port_str = common::ConvertToString(host.GetPort());
+  struct addrinfo* result = NULL;
+  int res = getaddrinfo(host_str.c_str(), port_str.c_str(), &hints, &result);
+  if (res != 0) {
+    return common::make_error(common::MemSPrintf("getaddrinfo failed: %s", gai_strerror(res)));
+  }
+
+  common::Error err = common::make_error(common::MemSPrintf("Can't bind to %s:%u", host_str, host.GetPort()));
+  for (struct addrinfo* rp = result; rp != NULL; rp = rp->ai_next) {
+    int lfd = socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
+    if (lfd == -1) {
+      continue;
+    }
+
+    int on = 1;
+    setsockopt(lfd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+#ifdef SO_REUSEPORT
+    if (reuse_port && setsockopt(lfd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) == -1) {
+      err = common::make_error(common::MemSPrintf("setsockopt(SO_REUSEPORT) failed: %s", strerror(errno)));
+      close(lfd);
+      continue;
+    }
+#endif
+
+    if (bind(lfd, rp->ai_addr, rp->ai_addrlen) == -1 || listen(lfd, backlog) == -1) {
+      err = common::make_error(common::MemSPrintf("Can't listen %s:%u: %s", host_str, host.GetPort(), strerror(errno)));
+      close(lfd);
+      continue;
+    }
+
+    common::ErrnoError errn = common::file_system::set_blocking_descriptor(lfd, false);
+    if (errn) {
+      err = common::make_error(errn->GetDescription());
+      close(lfd);
+      continue;
+    }
+
+    freeaddrinfo(result);
+    *fd = lfd;
+    return common::Error();
+  }
+
+  freeaddrinfo(result);
+  return err;
+}
+
+InnerTcpAcceptor::InnerTcpAcceptor(common::libev::IoLoop* server, int fd) : base_class(server, fd) {}
+
+common::Error InnerTcpAcceptor::AcceptWithCallback(accept_callback_t cb) {
+  while (true) {
+    int cfd = accept(GetFd(), NULL, NULL);
+    if (cfd == -1) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        return common::Error();
+      }
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+      return common::make_error(common::MemSPrintf("accept failed: %s", strerror(errno)));
+    }
+
+    common::ErrnoError errn = common::file_system::set_blocking_descriptor(cfd, false);
+    if (errn) {
+      close(cfd);
+      continue;
+    }
+
+    if (cb) {
+      cb(common::net::socket_info(cfd));
+    } else {
+      close(cfd);
+    }
+  }
+}
+
+const char* InnerTcpAcceptor::ClassName() const {
+  return "InnerTcpAcceptor";
+}
+
+}  // namespace inner
+}  // namespace server
+}  // namespace fastotv
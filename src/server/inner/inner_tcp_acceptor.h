@@ -0,0 +1,61 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <functional>
+
+#include <common/libev/descriptor_client.h>  // for DescriptorClient
+#include <common/net/types.h>                // for HostAndPort, socket_info
+
+namespace common {
+namespace libev {
+class IoLoop;
+}
+}  // namespace common
+
+namespace fastotv {
+namespace server {
+namespace inner {
+
+// non blocking listening socket, with reuse_port it is shared with other workers through SO_REUSEPORT
+// and kernel balances incoming connections, without it bind fails if port is busy
+common::Error CreateListener(const common::net::HostAndPort& host,
+                             int backlog,
+                             bool reuse_port,
+                             int* fd) WARN_UNUSED_RESULT;
+
+class InnerTcpAcceptor : public common::libev::DescriptorClient {
+ public:
+  typedef common::libev::DescriptorClient base_class;
+  typedef std::function<void(const common::net::socket_info&)> accept_callback_t;
+
+  InnerTcpAcceptor(common::libev::IoLoop* server, int fd);
+
+  common::Error AcceptWithCallback(accept_callback_t cb) WARN_UNUSED_RESULT;
+
+  virtual const char* ClassName() const override;
+
+ private:
+  using base_class::Write;
+  using base_class::Read;
+};
+
+}  // namespace inner
+}  // namespace server
+}  // namespace fastotv
@@ -18,7 +18,7 @@
 
 #include "server/inner/inner_tcp_client.h"
 
-#include <common/libev/tcp/tcp_server.h>
+#include <common/libev/io_loop.h>  // for IoLoop
 
 namespace fastotv {
 namespace server {
@@ -26,8 +26,8 @@ namespace inner {
 
 const AuthInfo InnerTcpClient::anonim_user(USER_LOGIN, USER_PASSWORD, USER_DEVICE_ID);
 
-InnerTcpClient::InnerTcpClient(common::libev::tcp::TcpServer* server, const common::net::socket_info& info)
-    : InnerClient(server, info), hinfo_(), uid_(), current_stream_id_(invalid_stream_id) {}
+InnerTcpClient::InnerTcpClient(common::libev::IoLoop* server, const common::net::socket_info& info)
+    : InnerClient(server, info), hinfo_(), uid_(), uinf_(), current_stream_id_(invalid_stream_id) {}
 
 bool InnerTcpClient::IsAnonimUser() const {
   return anonim_user == hinfo_;
@@ -55,6 +55,14 @@ user_id_t InnerTcpClient::GetUid() const {
   return uid_;
 }
 
+void InnerTcpClient::SetUserInfo(user_info_ptr_t uinf) {
+  uinf_ = uinf;
+}
+
+user_info_ptr_t InnerTcpClient::GetUserInfo() const {
+  return uinf_;
+}
+
 void InnerTcpClient::SetCurrentStreamId(stream_id sid) {
   current_stream_id_ = sid;
 }
@@ -22,16 +22,14 @@
 
 #include "inner/inner_client.h"  // for InnerClient
 
-#include "server/user_info.h"  // for user_id_t
+#include "server/user_info.h"  // for user_id_t, user_info_ptr_t
 
 #include "chat_message.h"
 
 namespace common {
 namespace libev {
-namespace tcp {
-class TcpServer;
+class IoLoop;
 }
-}  // namespace libev
 }  // namespace common
 namespace common {
 namespace net {
@@ -47,7 +45,7 @@ class InnerTcpClient : public fastotv::inner::InnerClient {
  public:
   static const AuthInfo anonim_user;
 
-  InnerTcpClient(common::libev::tcp::TcpServer* server, const common::net::socket_info& info);
+  InnerTcpClient(common::libev::IoLoop* server, const common::net::socket_info& info);
   ~InnerTcpClient();
 
   virtual const char* ClassName() const override;
@@ -58,6 +56,10 @@ class InnerTcpClient : public fastotv::inner::InnerClient {
   void SetUid(user_id_t id);
   user_id_t GetUid() const;
 
+  // snapshot of user taken at authentication, reset on invalidation
+  void SetUserInfo(user_info_ptr_t uinf);
+  user_info_ptr_t GetUserInfo() const;
+
   void SetCurrentStreamId(stream_id sid);
   user_id_t GetCurrentStreamId() const;
 
@@ -66,6 +68,7 @@ class InnerTcpClient : public fastotv::inner::InnerClient {
  private:
   AuthInfo hinfo_;
   user_id_t uid_;
+  user_info_ptr_t uinf_;
   stream_id current_stream_id_;
 };
 
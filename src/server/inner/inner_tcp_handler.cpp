@@ -19,34 +19,43 @@
 #include "server/inner/inner_tcp_handler.h"
 
 #include <stddef.h>  // for NULL
-#include <string>    // for string
 
-#include <json-c/json_object.h>  // for json_object
+#include <algorithm>  // for remove
+#include <string>     // for string
 
-#include <common/libev/io_client.h>         // for IoClient
-#include <common/libev/io_loop.h>           // for IoLoop
-#include <common/logger.h>                  // for COMPACT_LOG_WARNING
-#include <common/threads/thread_manager.h>  // for THREAD_MANAGER
+#include <json-c/json_object.h>   // for json_object
+#include <json-c/json_tokener.h>  // for json_tokener_parse
 
-#include "auth_info.h"            // for AuthInfo
-#include "channels_info.h"        // for ChannelsInfo
-#include "client_info.h"          // for ClientInfo
-#include "client_server_types.h"  // for Encode
-#include "inner/inner_client.h"   // for InnerClient
-#include "ping_info.h"            // for ClientPingInfo
+#include <common/libev/io_client.h>  // for IoClient
+#include <common/libev/io_loop.h>    // for IoLoop
+#include <common/logger.h>           // for COMPACT_LOG_WARNING
+
+#include "auth_info.h"                // for AuthInfo
+#include "channels_info.h"            // for ChannelsInfo
+#include "client_info.h"              // for ClientInfo
+#include "client_server_types.h"      // for Encode
+#include "inner/inner_client.h"       // for InnerClient
+#include "ping_info.h"                // for ClientPingInfo
+#include "programmes_info.h"          // for ProgrammesInfo
+#include "programmes_request_info.h"  // for ProgrammesRequestInfo
 
 #include "server/commands.h"
 
-#include "server/redis/redis_pub_sub.h"
+#include "server/redis/redis_async_client.h"
+#include "server/redis/redis_connect.h"
 
-#include "server/inner/inner_external_notifier.h"  // for InnerSubHandler
-#include "server/inner/inner_tcp_client.h"         // for InnerTcpClient
+#include "server/inner/inner_tcp_acceptor.h"  // for InnerTcpAcceptor
+#include "server/inner/inner_tcp_client.h"    // for InnerTcpClient
+#include "server/inner/inner_tcp_server.h"    // for InnerTcpServer
 
 #include "runtime_channel_info.h"
-#include "server/server_host.h"      // for ServerHost
-#include "server/user_info.h"        // for user_id_t, UserInfo
-#include "server/user_state_info.h"  // for UserStateInfo
-#include "server_info.h"             // for ServerInfo
+#include "server/channels_responce_cache.h"  // for ChannelsResponceCache
+#include "server/epg_store.h"                // for EpgStore
+#include "server/server_host.h"              // for ServerHost
+#include "server/server_metrics.h"           // for ServerMetrics, ScopedCommandTimer
+#include "server/user_info.h"                // for user_id_t, UserInfo
+#include "server/user_state_info.h"          // for UserStateInfo
+#include "server_info.h"                     // for ServerInfo
 
 namespace fastotv {
 namespace server {
@@ -54,34 +63,38 @@ namespace inner {
 
 InnerTcpHandlerHost::InnerTcpHandlerHost(ServerHost* parent, const Config& config)
     : parent_(parent),
-      sub_commands_in_(NULL),
-      handler_(NULL),
+      loop_(NULL),
+      acceptor_(NULL),
+      redis_client_(NULL),
+      dispatching_client_(NULL),
       ping_client_id_timer_(INVALID_TIMER_ID),
       reread_cache_id_timer_(INVALID_TIMER_ID),
+      redis_reconnect_id_timer_(INVALID_TIMER_ID),
+      expire_requests_id_timer_(INVALID_TIMER_ID),
+      last_tick_usec_(0),
       config_(config),
-      chat_channels_() {
-  handler_ = new InnerSubHandler(this);
-  sub_commands_in_ = new redis::RedisPubSub(handler_);
-  redis_subscribe_command_in_thread_ = THREAD_MANAGER()->CreateThread(&redis::RedisPubSub::Listen, sub_commands_in_);
+      connections_(),
+      watchers_(),
+      chat_channels_(),
+      pending_tasks_() {}
 
-  sub_commands_in_->SetConfig(config.server.redis);
-  bool result = redis_subscribe_command_in_thread_->Start();
-  if (!result) {
-    WARNING_LOG() << "Don't started listen thread for external commands.";
-  }
-}
-
-InnerTcpHandlerHost::~InnerTcpHandlerHost() {
-  sub_commands_in_->Stop();
-  redis_subscribe_command_in_thread_->Join();
-  delete sub_commands_in_;
-  delete handler_;
-}
+InnerTcpHandlerHost::~InnerTcpHandlerHost() {}
 
 void InnerTcpHandlerHost::PreLooped(common::libev::IoLoop* server) {
+  loop_ = server;
+  InnerTcpServer* iserver = static_cast<InnerTcpServer*>(server);
+  acceptor_ = new InnerTcpAcceptor(server, iserver->GetListenFd());
+  acceptor_->SetName("acceptor");
+  server->RegisterClient(acceptor_);
+
+  ConnectToRedis(server);
   UpdateCache();
   ping_client_id_timer_ = server->CreateTimer(ping_timeout_clients, true);
   reread_cache_id_timer_ = server->CreateTimer(reread_cache_timeout, true);
+  redis_reconnect_id_timer_ = server->CreateTimer(redis_reconnect_timeout, true);
+  expire_requests_id_timer_ = server->CreateTimer(expire_requests_timeout, true);
+  SetRequestTimeout(config_.server.request_timeout / expire_requests_timeout);
+  last_tick_usec_ = ServerMetrics::NowUsec();
 }
 
 void InnerTcpHandlerHost::Moved(common::libev::IoLoop* server, common::libev::IoClient* client) {
@@ -90,6 +103,7 @@ void InnerTcpHandlerHost::Moved(common::libev::IoLoop* server, common::libev::Io
 }
 
 void InnerTcpHandlerHost::PostLooped(common::libev::IoLoop* server) {
+  loop_ = NULL;
   if (ping_client_id_timer_ != INVALID_TIMER_ID) {
     server->RemoveTimer(ping_client_id_timer_);
     ping_client_id_timer_ = INVALID_TIMER_ID;
@@ -99,16 +113,49 @@ void InnerTcpHandlerHost::PostLooped(common::libev::IoLoop* server) {
     server->RemoveTimer(reread_cache_id_timer_);
     reread_cache_id_timer_ = INVALID_TIMER_ID;
   }
+
+  if (redis_reconnect_id_timer_ != INVALID_TIMER_ID) {
+    server->RemoveTimer(redis_reconnect_id_timer_);
+    redis_reconnect_id_timer_ = INVALID_TIMER_ID;
+  }
+
+  if (expire_requests_id_timer_ != INVALID_TIMER_ID) {
+    server->RemoveTimer(expire_requests_id_timer_);
+    expire_requests_id_timer_ = INVALID_TIMER_ID;
+  }
+  FailAllRequests("shutdown");  // nothing answers them any more
+
+  if (redis_client_) {
+    redis::RedisAsyncClient* connection = redis_client_;
+    common::Error err = connection->Close();
+    DCHECK(!err);
+    delete connection;
+  }
+
+  if (acceptor_) {
+    InnerTcpAcceptor* connection = acceptor_;
+    common::Error err = connection->Close();
+    DCHECK(!err);
+    delete connection;
+  }
 }
 
 void InnerTcpHandlerHost::TimerEmited(common::libev::IoLoop* server, common::libev::timer_id_t id) {
   if (ping_client_id_timer_ == id) {
+    size_t queued_bytes = 0;
     std::vector<common::libev::IoClient*> online_clients = server->GetClients();
     for (size_t i = 0; i < online_clients.size(); ++i) {
       common::libev::IoClient* client = online_clients[i];
+      if (IsServiceClient(client)) {
+        continue;
+      }
+
       InnerTcpClient* iclient = static_cast<InnerTcpClient*>(client);
       if (iclient) {
-        const common::protocols::three_way_handshake::cmd_request_t ping_request = PingRequest(NextRequestID());
+        const common::protocols::three_way_handshake::cmd_request_t ping_request =
+            iclient->IsPeerSupport(fastotv::inner::InnerClient::BINARY_COMMANDS_FEATURE)
+                ? fastotv::inner::MakeBinaryRequest(NextRequestID(iclient), SERVER_PING)
+                : PingRequest(NextRequestID(iclient));
         common::Error err = iclient->Write(ping_request);
         if (err) {
           DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
@@ -116,13 +163,27 @@ void InnerTcpHandlerHost::TimerEmited(common::libev::IoLoop* server, common::lib
           DCHECK(!err);
           delete client;
         } else {
+          queued_bytes += iclient->GetWriteQueueSize();
           INFO_LOG() << "Pinged to client[" << client->GetFormatedName() << "], from server["
-                     << server->GetFormatedName() << "], " << online_clients.size() << " client(s) connected.";
+                     << server->GetFormatedName() << "], " << online_clients.size()
+                     << " client(s) connected, write queue: " << iclient->GetWriteQueueSize()
+                     << " bytes, dropped messages: " << iclient->GetDroppedMessagesCount();
         }
       }
     }
+    INFO_LOG() << "Server[" << server->GetFormatedName() << "] write queues: " << queued_bytes << " bytes.";
   } else if (reread_cache_id_timer_ == id) {
     UpdateCache();
+  } else if (redis_reconnect_id_timer_ == id) {
+    if (!redis_client_) {
+      ConnectToRedis(server);
+    }
+  } else if (expire_requests_id_timer_ == id) {
+    const uint64_t now_usec = ServerMetrics::NowUsec();
+    const uint64_t expected_usec = last_tick_usec_ + expire_requests_timeout * 1000000;
+    parent_->GetMetrics()->ObserveLoopLag(now_usec > expected_usec ? now_usec - expected_usec : 0);
+    last_tick_usec_ = now_usec;
+    ExpireRequests();
   }
 }
 
@@ -135,9 +196,16 @@ void InnerTcpHandlerHost::ChildStatusChanged(common::libev::IoLoop* server, pid_
 #endif
 
 void InnerTcpHandlerHost::Accepted(common::libev::IoClient* client) {
+  if (IsServiceClient(client)) {
+    return;
+  }
+
+  ServerMetrics* metrics = parent_->GetMetrics();
+  metrics->ClientConnected();
   common::protocols::three_way_handshake::cmd_request_t whoareyou = WhoAreYouRequest(NextRequestID());
   InnerTcpClient* iclient = static_cast<InnerTcpClient*>(client);
   if (iclient) {
+    iclient->SetTrafficStats(metrics->GetTrafficStats());
     common::Error err = iclient->Write(whoareyou);
     if (err) {
       DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
@@ -146,31 +214,76 @@ void InnerTcpHandlerHost::Accepted(common::libev::IoClient* client) {
 }
 
 void InnerTcpHandlerHost::Closed(common::libev::IoClient* client) {
+  if (client == redis_client_) {
+    WARNING_LOG() << "Redis connection closed.";
+    redis_client_ = NULL;
+    return;
+  }
+
+  if (client == acceptor_) {
+    acceptor_ = NULL;
+    return;
+  }
+
+  if (client == dispatching_client_) {
+    dispatching_client_ = NULL;
+  }
+
+  parent_->GetMetrics()->ClientDisconnected();
+  FailRequests(static_cast<InnerTcpClient*>(client), "not connected");
+
+  if (redis_client_) {  // skip lookups of this connection
+    redis_client_->CancelCallbacks(client);
+  }
+
   InnerTcpClient* iconnection = static_cast<InnerTcpClient*>(client);
   AuthInfo auth = iconnection->GetServerHostInfo();
   common::libev::IoLoop* server = client->GetServer();
-  SendLeaveChatMessage(server, iconnection->GetCurrentStreamId(), auth.GetLogin());
+  const stream_id sid = iconnection->GetCurrentStreamId();
+  SetCurrentStreamId(iconnection, invalid_stream_id);
+  SendLeaveChatMessage(server, sid, auth.GetLogin());
 
   if (iconnection->IsAnonimUser()) {  // anonim user
+    parent_->GetMetrics()->ClientUnauthenticated(true);
     INFO_LOG() << "Byu anonim user: " << auth.GetLogin();
     return;
   }
 
-  common::Error unreg_err = parent_->UnRegisterInnerConnectionByHost(client);
-  if (unreg_err) {
-    DNOTREACHED();
+  common::Error unreg_err = UnRegisterInnerConnectionByHost(iconnection);
+  if (unreg_err) {  // not authenticated
     return;
   }
 
+  parent_->GetMetrics()->ClientUnauthenticated(false);
+
   user_id_t uid = iconnection->GetUid();
+  unreg_err = parent_->UnRegisterDevice(uid, auth.GetDeviceID(), this);
+  if (unreg_err) {
+    DNOTREACHED();
+  }
   PublishUserStateInfo(UserStateInfo(uid, auth.GetDeviceID(), false));
   INFO_LOG() << "Byu registered user: " << auth.GetLogin();
 }
 
 void InnerTcpHandlerHost::DataReceived(common::libev::IoClient* client) {
-  std::string buff;
+  if (client == acceptor_) {
+    Accept(client->GetServer());
+    return;
+  }
+
+  if (client == redis_client_) {
+    common::Error err = redis_client_->ProcessRead();
+    if (err) {
+      DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+      err = client->Close();
+      DCHECK(!err);
+      delete client;
+    }
+    return;
+  }
+
   InnerTcpClient* iclient = static_cast<InnerTcpClient*>(client);
-  common::Error err = iclient->ReadCommand(&buff);
+  common::Error err = iclient->ReadData();
   if (err) {
     DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
     err = client->Close();
@@ -179,24 +292,193 @@ void InnerTcpHandlerHost::DataReceived(common::libev::IoClient* client) {
     return;
   }
 
-  HandleInnerDataReceived(iclient, buff);
+  // handle all received commands, client can be closed by any of them
+  dispatching_client_ = iclient;
+  while (dispatching_client_) {
+    const std::string* command = NULL;
+    err = iclient->NextCommand(&command);
+    if (err) {
+      DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+      err = client->Close();
+      DCHECK(!err);
+      delete client;
+      break;
+    }
+
+    if (!command) {
+      break;
+    }
+
+    HandleInnerDataReceived(iclient, *command);
+  }
+  dispatching_client_ = NULL;
 }
 
 void InnerTcpHandlerHost::DataReadyToWrite(common::libev::IoClient* client) {
-  UNUSED(client);
+  if (client == acceptor_) {
+    return;
+  }
+
+  if (client == redis_client_) {
+    common::Error err = redis_client_->ProcessWrite();
+    if (err) {
+      DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+      err = client->Close();
+      DCHECK(!err);
+      delete client;
+    }
+    return;
+  }
+
+  InnerTcpClient* iclient = static_cast<InnerTcpClient*>(client);
+  common::Error err = iclient->Flush();
+  if (err) {
+    DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+    err = client->Close();
+    DCHECK(!err);
+    delete client;
+  }
+}
+
+bool InnerTcpHandlerHost::IsServiceClient(common::libev::IoClient* client) const {
+  return client == redis_client_ || client == acceptor_;
+}
+
+void InnerTcpHandlerHost::Accept(common::libev::IoLoop* server) {
+  auto accept_cb = [server](const common::net::socket_info& info) {
+    InnerTcpClient* client = new InnerTcpClient(server, info);
+    server->RegisterClient(client);
+  };
+  common::Error err = acceptor_->AcceptWithCallback(accept_cb);
+  if (err) {
+    DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+  }
 }
 
-common::Error InnerTcpHandlerHost::PublishToChannelOut(const std::string& msg) {
-  return sub_commands_in_->PublishToChannelOut(msg);
+common::Error InnerTcpHandlerHost::RegisterInnerConnectionByUser(user_id_t user_id,
+                                                                 const AuthInfo& user,
+                                                                 InnerTcpClient* connection) {
+  CHECK(user.IsValid());
+  if (!connection) {
+    DNOTREACHED();
+    return common::make_error_inval();
+  }
+
+  connection->SetServerHostInfo(user);
+  connection->SetUid(user_id);
+
+  login_t login = user.GetLogin();
+  connections_[user_id].push_back(connection);
+  connection->SetName(login);
+  return common::Error();
+}
+
+common::Error InnerTcpHandlerHost::UnRegisterInnerConnectionByHost(InnerTcpClient* connection) {
+  if (!connection) {
+    DNOTREACHED();
+    return common::make_error_inval();
+  }
+
+  user_id_t uid = connection->GetUid();
+  if (uid.empty()) {
+    return common::make_error_inval();
+  }
+
+  inner_connections_type::iterator hs = connections_.find(uid);
+  if (hs == connections_.end()) {
+    return common::make_error_inval();
+  }
+
+  std::vector<InnerTcpClient*>& devices = hs->second;
+  devices.erase(std::remove(devices.begin(), devices.end(), connection), devices.end());
+  if (devices.empty()) {
+    connections_.erase(hs);
+  }
+  return common::Error();
 }
 
 void InnerTcpHandlerHost::UpdateCache() {
-  std::vector<stream_id> channels;
-  common::Error err = parent_->GetChatChannels(&channels);
+  if (!redis_client_) {
+    return;
+  }
+
+  auto channels_cb = [this](common::Error err, const std::vector<stream_id>& channels) {
+    if (err) {
+      DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_WARNING);
+      return;
+    }
+    chat_channels_ = channels;
+  };
+  common::Error err = parent_->GetChatChannelsAsync(redis_client_, this, channels_cb);
   if (err) {
+    DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_WARNING);
+  }
+}
+
+void InnerTcpHandlerHost::ConnectToRedis(common::libev::IoLoop* server) {
+  redisContext* context = NULL;
+  common::Error err = redis::redis_connect_nonblock(config_.server.redis, &context);
+  if (err) {
+    DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
     return;
   }
-  chat_channels_ = channels;
+
+  redis_client_ = new redis::RedisAsyncClient(server, context);
+  redis_client_->SetName("redis");
+  server->RegisterClient(redis_client_);
+}
+
+void InnerTcpHandlerHost::FindUser(InnerTcpClient* client, const AuthInfo& auth, ServerHost::find_user_callback_t cb) {
+  common::Error err = redis_client_ ? parent_->FindUserAsync(redis_client_, auth, client, cb)
+                                    : common::make_error("Database connection error");
+  if (err) {
+    cb(err, user_id_t(), user_info_ptr_t());
+  }
+}
+
+void InnerTcpHandlerHost::ResetUserInfo(const login_t& login) {
+  common::libev::IoLoop* server = loop_;
+  if (!server) {
+    return;
+  }
+
+  auto reset_cb = [this, server, login]() {
+    std::vector<common::libev::IoClient*> online_clients = server->GetClients();
+    for (size_t i = 0; i < online_clients.size(); ++i) {
+      common::libev::IoClient* client = online_clients[i];
+      if (IsServiceClient(client)) {
+        continue;
+      }
+
+      InnerTcpClient* iclient = static_cast<InnerTcpClient*>(client);
+      AuthInfo ainf = iclient->GetServerHostInfo();
+      if (ainf.GetLogin() == login) {
+        iclient->SetUserInfo(user_info_ptr_t());
+      }
+    }
+  };
+  PostTask(server, reset_cb);
+}
+
+void InnerTcpHandlerHost::PostTask(common::libev::IoLoop* server, loop_task_t task) {
+  if (pending_tasks_.PushAndCheckWakeup(task)) {  // one wakeup for all tasks queued until it fires
+    server->ExecInLoopThread([this]() { DrainTasks(); });
+  }
+}
+
+void InnerTcpHandlerHost::DrainTasks() {
+  pending_tasks_.ResetWakeup();
+  loop_task_t task;
+  size_t handled = 0;
+  while (handled < max_tasks_per_wakeup && pending_tasks_.Pop(&task)) {
+    task();
+    handled++;
+  }
+
+  common::libev::IoLoop* server = loop_;
+  if (handled == max_tasks_per_wakeup && server) {  // rest on next iteration, clients io runs in between
+    server->ExecInLoopThread([this]() { DrainTasks(); });
+  }
 }
 
 void InnerTcpHandlerHost::PublishUserStateInfo(const UserStateInfo& state) {
@@ -209,15 +491,75 @@ void InnerTcpHandlerHost::PublishUserStateInfo(const UserStateInfo& state) {
 
   std::string connected_resp = json_object_get_string(user_state_json);
   json_object_put(user_state_json);
-  err = sub_commands_in_->PublishStateToChannel(connected_resp);
+  err = parent_->PublishStateToChannel(connected_resp);
   if (err) {
     WARNING_LOG() << "Publish message: " << connected_resp << " to channel clients state failed.";
   }
 }
 
-inner::InnerTcpClient* InnerTcpHandlerHost::FindInnerConnectionByUserIDAndDeviceID(user_id_t user,
-                                                                                   device_id_t dev) const {
-  return parent_->FindInnerConnectionByUserIDAndDeviceID(user, dev);
+InnerTcpClient* InnerTcpHandlerHost::FindInnerConnectionByUserIDAndDeviceID(user_id_t user, device_id_t dev) const {
+  inner_connections_type::const_iterator hs = connections_.find(user);
+  if (hs == connections_.end()) {
+    return nullptr;
+  }
+
+  const std::vector<InnerTcpClient*>& devices = hs->second;
+  for (InnerTcpClient* connected_device : devices) {
+    AuthInfo uinf = connected_device->GetServerHostInfo();
+    if (uinf.GetDeviceID() == dev) {
+      return connected_device;
+    }
+  }
+  return nullptr;
+}
+
+void InnerTcpHandlerHost::PostChatMessage(const ChatMessage& msg,
+                                          const fastotv::inner::InnerClient::frame_t& frame,
+                                          const fastotv::inner::InnerClient::frame_t& binary_frame) {
+  common::libev::IoLoop* server = loop_;
+  if (!server) {
+    return;
+  }
+
+  auto send_cb = [this, msg, frame, binary_frame]() {
+    SendFrameToWatchers(msg.GetChannelId(), frame, binary_frame);
+  };
+  PostTask(server, send_cb);
+}
+
+void InnerTcpHandlerHost::PostExternalRequest(user_id_t uid,
+                                              device_id_t dev,
+                                              const std::string& command,
+                                              fastotv::inner::RequestCallback cb,
+                                              external_request_fail_callback_t fail_cb) {
+  common::libev::IoLoop* server = loop_;
+  if (!server) {
+    fail_cb("not connected");
+    return;
+  }
+
+  auto write_cb = [this, uid, dev, command, cb, fail_cb]() {
+    InnerTcpClient* fclient = FindInnerConnectionByUserIDAndDeviceID(uid, dev);
+    if (!fclient) {  // disconnected while request was queued
+      fail_cb("not connected");
+      return;
+    }
+
+    // external ids are arbitrary, they could be equal to ids of server requests to this device
+    const common::protocols::three_way_handshake::cmd_seq_t request_id = NextRequestID(fclient);
+    common::Error err = fclient->Write(ExternalRequest(request_id, command));
+    if (err) {
+      fail_cb("not handled");
+      return;
+    }
+
+    fastotv::inner::RequestCallback external = cb;
+    auto answer_cb = [external](common::protocols::three_way_handshake::cmd_seq_t, int argc, char* argv[]) mutable {
+      external.Execute(argc, argv);  // with external id
+    };
+    SubscribeRequest(fclient, fastotv::inner::RequestCallback(request_id, cb.GetCommand(), answer_cb));
+  };
+  PostTask(server, write_cb);
 }
 
 void InnerTcpHandlerHost::HandleInnerRequestCommand(fastotv::inner::InnerClient* connection,
@@ -228,6 +570,17 @@ void InnerTcpHandlerHost::HandleInnerRequestCommand(fastotv::inner::InnerClient*
   char* command = argv[0];
   if (IS_EQUAL_COMMAND(command, CLIENT_PING)) {
     ClientPingInfo ping;
+    if (IsBinaryCommand()) {
+      std::string ping_info_bin;
+      fastotv::inner::BinarySerialize(ping, &ping_info_bin);
+      common::Error err =
+          connection->Write(fastotv::inner::MakeBinaryResponce(id, SUCCESS_COMMAND, CLIENT_PING, ping_info_bin));
+      if (err) {
+        DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+      }
+      return;
+    }
+
     json_object* jping_info = NULL;
     common::Error err = ping.Serialize(&jping_info);
     if (err) {
@@ -251,72 +604,68 @@ void InnerTcpHandlerHost::HandleInnerRequestCommand(fastotv::inner::InnerClient*
     return;
   } else if (IS_EQUAL_COMMAND(command, CLIENT_GET_SERVER_INFO)) {
     inner::InnerTcpClient* client = static_cast<inner::InnerTcpClient*>(connection);
-    AuthInfo hinf = client->GetServerHostInfo();
-    UserInfo user;
-    user_id_t uid;
-    common::Error err = parent_->FindUser(hinf, &uid, &user);
-    if (err) {
-      common::protocols::three_way_handshake::cmd_responce_t resp =
-          GetServerInfoResponceFail(id, err->GetDescription());
-      common::Error err = connection->Write(resp);
+    user_info_ptr_t uinf = client->GetUserInfo();
+    if (uinf) {  // already authenticated
+      common::Error err = HandleGetServerInfoUser(client, id, common::Error(), uinf);
       if (err) {
         DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+        connection->Close();
+        delete connection;
       }
-      connection->Close();
-      delete connection;
       return;
     }
 
-    ServerInfo serv(config_.server.bandwidth_host);
-    json_object* jserver_info = NULL;
-    err = serv.Serialize(&jserver_info);
-    if (err) {
-      NOTREACHED();
-    }
-
-    serializet_t server_info_str = json_object_get_string(jserver_info);
-    json_object_put(jserver_info);
-
-    common::protocols::three_way_handshake::cmd_responce_t server_info_responce =
-        GetServerInfoResponceSuccsess(id, server_info_str);
-    err = connection->Write(server_info_responce);
-    if (err) {
-      DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
-    }
+    AuthInfo hinf = client->GetServerHostInfo();
+    auto find_user_cb = [this, client, id](common::Error err, const user_id_t& uid, user_info_ptr_t user) {
+      UNUSED(uid);
+      if (!err) {
+        client->SetUserInfo(user);
+      }
+      err = HandleGetServerInfoUser(client, id, err, user);
+      if (err) {
+        DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+        client->Close();
+        delete client;
+      }
+    };
+    FindUser(client, hinf, find_user_cb);
     return;
   } else if (IS_EQUAL_COMMAND(command, CLIENT_GET_CHANNELS)) {
+    const uint64_t start_usec = ServerMetrics::NowUsec();
     inner::InnerTcpClient* client = static_cast<inner::InnerTcpClient*>(connection);
-    AuthInfo hinf = client->GetServerHostInfo();
-    UserInfo user;
-    user_id_t uid;
-    common::Error err = parent_->FindUser(hinf, &uid, &user);
-    if (err) {
-      common::protocols::three_way_handshake::cmd_responce_t resp = GetChannelsResponceFail(id, err->GetDescription());
-      common::Error err = connection->Write(resp);
+    const bool versioned = argc > 1;  // old clients request without cached version
+    const channels_version_t client_version = versioned ? argv[1] : invalid_channels_version;
+    user_info_ptr_t uinf = client->GetUserInfo();
+    if (uinf) {  // already authenticated
+      common::Error err = HandleGetChannelsUser(client, id, versioned, client_version, common::Error(), uinf);
+      parent_->GetMetrics()->ObserveCommand(ServerMetrics::GET_CHANNELS_COMMAND, start_usec);
       if (err) {
         DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+        connection->Close();
+        delete connection;
       }
-      connection->Close();
-      delete connection;
-      return;
-    }
-
-    serializet_t channels_str;
-    ChannelsInfo chan = user.GetChannelInfo();
-    err = chan.SerializeToString(&channels_str);
-    if (err) {
-      DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
       return;
     }
 
-    common::protocols::three_way_handshake::cmd_responce_t channels_responce =
-        GetChannelsResponceSuccsess(id, channels_str);
-    err = connection->Write(channels_responce);
-    if (err) {
-      DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
-    }
+    AuthInfo hinf = client->GetServerHostInfo();
+    auto find_user_cb = [this, client, id, versioned, client_version, start_usec](
+                            common::Error err, const user_id_t& uid, user_info_ptr_t user) {
+      UNUSED(uid);
+      if (!err) {
+        client->SetUserInfo(user);
+      }
+      err = HandleGetChannelsUser(client, id, versioned, client_version, err, user);
+      parent_->GetMetrics()->ObserveCommand(ServerMetrics::GET_CHANNELS_COMMAND, start_usec);
+      if (err) {
+        DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+        client->Close();
+        delete client;
+      }
+    };
+    FindUser(client, hinf, find_user_cb);
     return;
   } else if (IS_EQUAL_COMMAND(command, CLIENT_GET_RUNTIME_CHANNEL_INFO)) {
+    ScopedCommandTimer timer(parent_->GetMetrics(), ServerMetrics::GET_RUNTIME_CHANNEL_INFO_COMMAND);
     inner::InnerTcpClient* client = static_cast<inner::InnerTcpClient*>(connection);
     if (argc > 1) {
       common::libev::IoLoop* server = client->GetServer();
@@ -326,8 +675,8 @@ void InnerTcpHandlerHost::HandleInnerRequestCommand(fastotv::inner::InnerClient*
       const stream_id channel = argv[1];
       const stream_id prev_channel = client->GetCurrentStreamId();
 
-      size_t watchers = GetOnlineUserByStreamId(server, channel);  // calc watchers
-      client->SetCurrentStreamId(channel);                         // add to watcher
+      size_t watchers = GetOnlineUserByStreamId(channel);  // calc watchers
+      SetCurrentStreamId(client, channel);                 // add to watcher
 
       RuntimeChannelInfo rinf;
       rinf.SetChannelId(channel);
@@ -350,17 +699,14 @@ void InnerTcpHandlerHost::HandleInnerRequestCommand(fastotv::inner::InnerClient*
         rinf.SetChatEnabled(true);
         rinf.SetChatReadOnly(true);
       }
-
-      serializet_t rchannel_str;
-      common::Error err = rinf.SerializeToString(&rchannel_str);
-      if (err) {
-        DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
-        return;
+      ChatHistory::messages_t history;
+      if (rinf.GetChannelType() == OFFICAL_CHANNEL) {  // viewer sees recent messages right after joining
+        history = parent_->GetChatHistory(channel);
       }
 
-      common::protocols::three_way_handshake::cmd_responce_t channels_responce =
-          GetRuntimeChannelInfoResponceSuccsess(id, rchannel_str);
-      err = connection->Write(channels_responce);
+      common::protocols::three_way_handshake::cmd_responce_t channels_responce = GetRuntimeChannelInfoResponce(
+          id, rinf, history, IsBinaryCommand(), client->IsPeerSupport(fastotv::inner::InnerClient::CHUNKED_FEATURE));
+      common::Error err = connection->Write(channels_responce);
       if (err) {
         DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
       } else {
@@ -385,26 +731,11 @@ void InnerTcpHandlerHost::HandleInnerRequestCommand(fastotv::inner::InnerClient*
       return;
     }
   } else if (IS_EQUAL_COMMAND(command, CLIENT_SEND_CHAT_MESSAGE)) {
+    ScopedCommandTimer timer(parent_->GetMetrics(), ServerMetrics::CHAT_COMMAND);
     if (argc > 1) {
       inner::InnerTcpClient* client = static_cast<inner::InnerTcpClient*>(connection);
-      serializet_t msg_str = argv[1];
-      json_object* jmsg = json_tokener_parse(argv[1]);
-      if (!jmsg) {
-        common::Error err = common::make_error_inval();
-        common::protocols::three_way_handshake::cmd_responce_t resp =
-            SendChatMessageResponceFail(id, err->GetDescription());
-        err = connection->Write(resp);
-        if (err) {
-          DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
-        }
-        connection->Close();
-        delete connection;
-        return;
-      }
-
       ChatMessage msg;
-      common::Error err = ChatMessage::DeSerialize(jmsg, &msg);
-      json_object_put(jmsg);
+      common::Error err = ParseArgument(argc, argv, 1, &msg);
       if (err) {
         common::protocols::three_way_handshake::cmd_responce_t resp =
             SendChatMessageResponceFail(id, err->GetDescription());
@@ -418,8 +749,15 @@ void InnerTcpHandlerHost::HandleInnerRequestCommand(fastotv::inner::InnerClient*
       }
 
       BrodcastChatMessage(client->GetServer(), msg);
-      common::protocols::three_way_handshake::cmd_responce_t resp = SendChatMessageResponceSuccsess(id, msg_str);
-      err = connection->Write(resp);
+      if (IsBinaryCommand()) {
+        std::string msg_bin;
+        fastotv::inner::BinarySerialize(msg, &msg_bin);
+        err = connection->Write(
+            fastotv::inner::MakeBinaryResponce(id, SUCCESS_COMMAND, CLIENT_SEND_CHAT_MESSAGE, msg_bin));
+      } else {
+        common::protocols::three_way_handshake::cmd_responce_t resp = SendChatMessageResponceSuccsess(id, argv[1]);
+        err = connection->Write(resp);
+      }
       if (err) {
         DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
       }
@@ -436,6 +774,48 @@ void InnerTcpHandlerHost::HandleInnerRequestCommand(fastotv::inner::InnerClient*
       delete connection;
       return;
     }
+  } else if (IS_EQUAL_COMMAND(command, CLIENT_GET_PROGRAMMES)) {
+    ScopedCommandTimer timer(parent_->GetMetrics(), ServerMetrics::GET_PROGRAMMES_COMMAND);
+    ProgrammesRequestInfo req;
+    json_object* jreq = argc > 1 ? json_tokener_parse(argv[1]) : NULL;  // json only, no binary encoding
+    common::Error err = jreq ? ProgrammesRequestInfo::DeSerialize(jreq, &req) : common::make_error_inval();
+    if (jreq) {
+      json_object_put(jreq);
+    }
+    if (err) {
+      common::protocols::three_way_handshake::cmd_responce_t resp =
+          GetProgrammesResponceFail(id, err->GetDescription());
+      err = connection->Write(resp);
+      if (err) {
+        DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+      }
+      connection->Close();
+      delete connection;
+      return;
+    }
+
+    // client asks, server decides how much: answer window tells what was covered
+    req = EpgStore::ClampRequest(req);
+    ProgrammesInfo::programmes_t programmes;
+    parent_->GetEpgStore()->FindProgrammes(req.GetChannels(), req.GetFrom(), req.GetTo(), req.GetLimit(),
+                                           &programmes);
+    serializet_t programmes_str;
+    err = ProgrammesInfo(req.GetFrom(), req.GetTo(), programmes).SerializeToString(&programmes_str);
+    if (!err) {
+      common::protocols::three_way_handshake::cmd_responce_t programmes_responce =
+          GetProgrammesResponceSuccsess(id, programmes_str);
+      err = connection->Write(programmes_responce);
+    }
+    if (err) {  // too big or not queued, client should not wait for the answer
+      DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+      common::protocols::three_way_handshake::cmd_responce_t resp =
+          GetProgrammesResponceFail(id, err->GetDescription());
+      err = connection->Write(resp);
+      if (err) {
+        DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+      }
+    }
+    return;
   }
 
   WARNING_LOG() << "UNKNOWN COMMAND: " << command;
@@ -479,34 +859,25 @@ common::Error InnerTcpHandlerHost::HandleInnerSuccsessResponceCommand(
     char* argv[]) {
   char* command = argv[1];
   if (IS_EQUAL_COMMAND(command, SERVER_PING)) {
-    json_object* obj = NULL;
-    common::Error parse_err = ParserResponceResponceCommand(argc, argv, &obj);
-    if (parse_err) {
-      common::protocols::three_way_handshake::cmd_approve_t resp =
-          PingApproveResponceFail(id, parse_err->GetDescription());
-      common::Error write_err = connection->Write(resp);
-      UNUSED(write_err);
-      return parse_err;
-    }
-
     ServerPingInfo ping_info;
-    common::Error err = ServerPingInfo::DeSerialize(obj, &ping_info);
-    json_object_put(obj);
+    common::Error err = ParseArgument(argc, argv, 2, &ping_info);
     if (err) {
-      common::protocols::three_way_handshake::cmd_approve_t resp =
-          PingApproveResponceFail(id, parse_err->GetDescription());
+      common::protocols::three_way_handshake::cmd_approve_t resp = PingApproveResponceFail(id, err->GetDescription());
       common::Error write_err = connection->Write(resp);
       UNUSED(write_err);
       return err;
     }
 
-    common::protocols::three_way_handshake::cmd_approve_t resp = PingApproveResponceSuccsess(id);
+    common::protocols::three_way_handshake::cmd_approve_t resp =
+        IsBinaryCommand() ? fastotv::inner::MakeBinaryApprove(id, SUCCESS_COMMAND, SERVER_PING)
+                          : PingApproveResponceSuccsess(id);
     err = connection->Write(resp);
     if (err) {
       return err;
     }
     return common::Error();
   } else if (IS_EQUAL_COMMAND(command, SERVER_WHO_ARE_YOU)) {
+    const uint64_t start_usec = ServerMetrics::NowUsec();
     json_object* obj = NULL;
     common::Error parse_err = ParserResponceResponceCommand(argc, argv, &obj);
     if (parse_err) {
@@ -519,6 +890,11 @@ common::Error InnerTcpHandlerHost::HandleInnerSuccsessResponceCommand(
 
     AuthInfo uauth;
     common::Error err = AuthInfo::DeSerialize(obj, &uauth);
+    json_object* jfeatures = NULL;
+    uint32_t features = 0;  // old clients don't send features
+    if (json_object_object_get_ex(obj, PROTOCOL_FEATURES_FIELD, &jfeatures)) {
+      features = json_object_get_int(jfeatures);
+    }
     json_object_put(obj);
     if (err) {
       const std::string error_str = err->GetDescription();
@@ -537,77 +913,23 @@ common::Error InnerTcpHandlerHost::HandleInnerSuccsessResponceCommand(
       return lerr;
     }
 
-    user_id_t uid;
-    UserInfo registered_user;
-    err = parent_->FindUser(uauth, &uid, &registered_user);
-    if (err) {
-      common::protocols::three_way_handshake::cmd_approve_t resp =
-          WhoAreYouApproveResponceFail(id, err->GetDescription());
-      common::Error write_err = connection->Write(resp);
-      UNUSED(write_err);
-      return err;
-    }
-
-    const device_id_t dev = uauth.GetDeviceID();
-    if (!registered_user.HaveDevice(dev)) {
-      const std::string error_str = "Unknown device reject";
-      common::protocols::three_way_handshake::cmd_approve_t resp = WhoAreYouApproveResponceFail(id, error_str);
-      common::Error write_err = connection->Write(resp);
-      UNUSED(write_err);
-      return err;
-    }
-
-    if (uauth == InnerTcpClient::anonim_user) {  // anonim user
-      common::protocols::three_way_handshake::cmd_approve_t resp = WhoAreYouApproveResponceSuccsess(id);
-      err = connection->Write(resp);
+    InnerTcpClient* client = static_cast<InnerTcpClient*>(connection);
+    client->SetPeerFeatures(features);
+    auto find_user_cb = [this, client, id, uauth, start_usec](common::Error err, const user_id_t& uid,
+                                                              user_info_ptr_t registered_user) {
+      err = HandleWhoAreYouUser(client, id, uauth, err, uid, registered_user);
+      parent_->GetMetrics()->ObserveCommand(ServerMetrics::WHO_ARE_YOU_COMMAND, start_usec);
       if (err) {
-        return err;
+        DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+        client->Close();
+        delete client;
       }
-
-      InnerTcpClient* inner_conn = static_cast<InnerTcpClient*>(connection);
-      inner_conn->SetServerHostInfo(uauth);
-      INFO_LOG() << "Welcome anonim user: " << uauth.GetLogin();
-      return common::Error();
-    }
-
-    // registered user
-    InnerTcpClient* fclient = parent_->FindInnerConnectionByUserIDAndDeviceID(uid, dev);
-    if (fclient) {
-      const std::string error_str = "Double connection reject";
-      common::protocols::three_way_handshake::cmd_approve_t resp = WhoAreYouApproveResponceFail(id, error_str);
-      common::Error write_err = connection->Write(resp);
-      UNUSED(write_err);
-      return err;
-    }
-
-    common::protocols::three_way_handshake::cmd_approve_t resp = WhoAreYouApproveResponceSuccsess(id);
-    err = connection->Write(resp);
-    if (err) {
-      return err;
-    }
-
-    err = parent_->RegisterInnerConnectionByUser(uid, uauth, connection);
-    if (err) {
-      return err;
-    }
-
-    PublishUserStateInfo(UserStateInfo(uid, dev, true));
-    INFO_LOG() << "Welcome registered user: " << uauth.GetLogin();
+    };
+    FindUser(client, uauth, find_user_cb);
     return common::Error();
   } else if (IS_EQUAL_COMMAND(command, SERVER_GET_CLIENT_INFO)) {
-    json_object* obj = NULL;
-    common::Error parse_err = ParserResponceResponceCommand(argc, argv, &obj);
-    if (parse_err) {
-      common::protocols::three_way_handshake::cmd_approve_t resp =
-          SystemInfoApproveResponceFail(id, parse_err->GetDescription());
-      common::Error write_err = connection->Write(resp);
-      UNUSED(write_err);
-      return parse_err;
-    }
-
     ClientInfo cinf;
-    common::Error err = ClientInfo::DeSerialize(obj, &cinf);
-    json_object_put(obj);
+    common::Error err = ParseArgument(argc, argv, 2, &cinf);
     if (err) {
       const std::string error_str = err->GetDescription();
       common::protocols::three_way_handshake::cmd_approve_t resp = SystemInfoApproveResponceFail(id, error_str);
@@ -625,35 +947,28 @@ common::Error InnerTcpHandlerHost::HandleInnerSuccsessResponceCommand(
       return lerr;
     }
 
-    common::protocols::three_way_handshake::cmd_approve_t resp = SystemInfoApproveResponceSuccsess(id);
+    common::protocols::three_way_handshake::cmd_approve_t resp =
+        IsBinaryCommand() ? fastotv::inner::MakeBinaryApprove(id, SUCCESS_COMMAND, SERVER_GET_CLIENT_INFO)
+                          : SystemInfoApproveResponceSuccsess(id);
     err = connection->Write(resp);
     if (err) {
       return err;
     }
     return common::Error();
   } else if (IS_EQUAL_COMMAND(command, SERVER_SEND_CHAT_MESSAGE)) {
-    json_object* obj = NULL;
-    common::Error parse_err = ParserResponceResponceCommand(argc, argv, &obj);
-    if (parse_err) {
-      common::protocols::three_way_handshake::cmd_approve_t resp =
-          ServerSendChatMessageApproveResponceFail(id, parse_err->GetDescription());
-      common::Error write_err = connection->Write(resp);
-      UNUSED(write_err);
-      return parse_err;
-    }
-
     ChatMessage msg;
-    common::Error err = ChatMessage::DeSerialize(obj, &msg);
-    json_object_put(obj);
+    common::Error err = ParseArgument(argc, argv, 2, &msg);
     if (err) {
       common::protocols::three_way_handshake::cmd_approve_t resp =
-          ServerSendChatMessageApproveResponceFail(id, parse_err->GetDescription());
+          ServerSendChatMessageApproveResponceFail(id, err->GetDescription());
       common::Error write_err = connection->Write(resp);
       UNUSED(write_err);
       return err;
     }
 
-    common::protocols::three_way_handshake::cmd_approve_t resp = ServerSendChatMessageApproveResponceSuccsess(id);
+    common::protocols::three_way_handshake::cmd_approve_t resp =
+        IsBinaryCommand() ? fastotv::inner::MakeBinaryApprove(id, SUCCESS_COMMAND, SERVER_SEND_CHAT_MESSAGE)
+                          : ServerSendChatMessageApproveResponceSuccsess(id);
     err = connection->Write(resp);
     if (err) {
       return err;
@@ -665,6 +980,182 @@ common::Error InnerTcpHandlerHost::HandleInnerSuccsessResponceCommand(
   return common::make_error(error_str);
 }
 
+common::Error InnerTcpHandlerHost::HandleWhoAreYouUser(InnerTcpClient* client,
+                                                       common::protocols::three_way_handshake::cmd_seq_t id,
+                                                       const AuthInfo& uauth,
+                                                       common::Error lookup_err,
+                                                       const user_id_t& uid,
+                                                       user_info_ptr_t registered_user) {
+  if (lookup_err) {
+    common::protocols::three_way_handshake::cmd_approve_t resp =
+        WhoAreYouApproveResponceFail(id, lookup_err->GetDescription());
+    common::Error write_err = client->Write(resp);
+    UNUSED(write_err);
+    return lookup_err;
+  }
+
+  const device_id_t dev = uauth.GetDeviceID();
+  if (!registered_user->HaveDevice(dev)) {
+    const std::string error_str = "Unknown device reject";
+    common::protocols::three_way_handshake::cmd_approve_t resp = WhoAreYouApproveResponceFail(id, error_str);
+    common::Error write_err = client->Write(resp);
+    UNUSED(write_err);
+    return common::Error();
+  }
+
+  if (uauth == InnerTcpClient::anonim_user) {  // anonim user
+    common::protocols::three_way_handshake::cmd_approve_t resp =
+        WhoAreYouApproveResponceSuccsess(id, fastotv::inner::InnerClient::supported_features);
+    common::Error err = client->Write(resp);
+    if (err) {
+      return err;
+    }
+
+    client->SetServerHostInfo(uauth);
+    client->SetUserInfo(registered_user);
+    parent_->GetMetrics()->ClientAuthenticated(true);
+    INFO_LOG() << "Welcome anonim user: " << uauth.GetLogin();
+    return common::Error();
+  }
+
+  // registered user, device can be connected to any worker
+  common::Error err = parent_->RegisterDevice(uid, dev, this);
+  if (err) {
+    const std::string error_str = err->GetDescription();
+    common::protocols::three_way_handshake::cmd_approve_t resp = WhoAreYouApproveResponceFail(id, error_str);
+    common::Error write_err = client->Write(resp);
+    UNUSED(write_err);
+    return common::Error();
+  }
+
+  common::protocols::three_way_handshake::cmd_approve_t resp =
+      WhoAreYouApproveResponceSuccsess(id, fastotv::inner::InnerClient::supported_features);
+  err = client->Write(resp);
+  if (err) {
+    common::Error unreg_err = parent_->UnRegisterDevice(uid, dev, this);
+    UNUSED(unreg_err);
+    return err;
+  }
+
+  err = RegisterInnerConnectionByUser(uid, uauth, client);
+  if (err) {
+    common::Error unreg_err = parent_->UnRegisterDevice(uid, dev, this);
+    UNUSED(unreg_err);
+    return err;
+  }
+
+  client->SetUserInfo(registered_user);
+  parent_->GetMetrics()->ClientAuthenticated(false);
+
+  PublishUserStateInfo(UserStateInfo(uid, dev, true));
+  INFO_LOG() << "Welcome registered user: " << uauth.GetLogin();
+  return common::Error();
+}
+
+common::Error InnerTcpHandlerHost::HandleGetServerInfoUser(InnerTcpClient* client,
+                                                           common::protocols::three_way_handshake::cmd_seq_t id,
+                                                           common::Error lookup_err,
+                                                           user_info_ptr_t user) {
+  UNUSED(user);
+  if (lookup_err) {
+    common::protocols::three_way_handshake::cmd_responce_t resp =
+        GetServerInfoResponceFail(id, lookup_err->GetDescription());
+    common::Error write_err = client->Write(resp);
+    UNUSED(write_err);
+    return lookup_err;
+  }
+
+  ServerInfo serv(config_.server.bandwidth_host);
+  json_object* jserver_info = NULL;
+  common::Error err = serv.Serialize(&jserver_info);
+  if (err) {
+    NOTREACHED();
+  }
+
+  serializet_t server_info_str = json_object_get_string(jserver_info);
+  json_object_put(jserver_info);
+
+  common::protocols::three_way_handshake::cmd_responce_t server_info_responce =
+      GetServerInfoResponceSuccsess(id, server_info_str);
+  err = client->Write(server_info_responce);
+  if (err) {
+    DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+  }
+  return common::Error();
+}
+
+common::Error InnerTcpHandlerHost::HandleGetChannelsUser(InnerTcpClient* client,
+                                                         common::protocols::three_way_handshake::cmd_seq_t id,
+                                                         bool versioned,
+                                                         const channels_version_t& client_version,
+                                                         common::Error lookup_err,
+                                                         user_info_ptr_t user) {
+  if (lookup_err) {
+    common::protocols::three_way_handshake::cmd_responce_t resp =
+        GetChannelsResponceFail(id, lookup_err->GetDescription());
+    common::Error write_err = client->Write(resp);
+    UNUSED(write_err);
+    return lookup_err;
+  }
+
+  // clients fetching programmes by get_programmes get channels without them, if there is a guide to fetch from
+  const bool without_programmes = client->IsPeerSupport(fastotv::inner::InnerClient::PROGRAMMES_FEATURE) &&
+                                  !parent_->GetEpgStore()->IsEmpty();
+  ChannelsResponceCache::body_ptr_t body;
+  common::Error err = parent_->GetChannelsResponce(user, without_programmes, &body);
+  if (err) {
+    WriteGetChannelsFail(client, id, err);
+    return common::Error();
+  }
+
+  // cached channels are spliced into the template, only small deltas are serialized per request
+  serializet_t channels_str = ChannelsResponceCache::MakeChannelsTemplate();
+  bool templated = true;
+  if (versioned) {
+    ChannelsDeltaInfo delta = parent_->MakeChannelsDelta(user->GetLogin(), client_version, *body);
+    err = ChannelsResponceCache::SerializeDelta(delta, &channels_str, &templated);
+  }
+  if (err) {
+    WriteGetChannelsFail(client, id, err);
+    return common::Error();
+  }
+
+  common::protocols::three_way_handshake::cmd_responce_t channels_responce =
+      GetChannelsResponceSuccsess(id, channels_str);
+  if (!templated) {  // unchanged or delta, nothing to splice
+    err = client->Write(channels_responce);
+    if (err) {
+      DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+    }
+    return common::Error();
+  }
+
+  fastotv::inner::InnerClient::frame_t frame;
+  err = ChannelsResponceCache::MakeFrame(channels_responce.GetCmd(), *body,
+                                         client->IsPeerSupport(fastotv::inner::InnerClient::CHUNKED_FEATURE), &frame);
+  if (err) {
+    WriteGetChannelsFail(client, id, err);
+    return common::Error();
+  }
+
+  err = client->WriteFrame(frame);
+  if (err) {
+    DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+  }
+  return common::Error();
+}
+
+void InnerTcpHandlerHost::WriteGetChannelsFail(InnerTcpClient* client,
+                                               common::protocols::three_way_handshake::cmd_seq_t id,
+                                               common::Error err) {
+  DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+  common::protocols::three_way_handshake::cmd_responce_t resp = GetChannelsResponceFail(id, err->GetDescription());
+  common::Error write_err = client->Write(resp);
+  if (write_err) {
+    DEBUG_MSG_ERROR(write_err, common::logging::LOG_LEVEL_ERR);
+  }
+}
+
 common::Error InnerTcpHandlerHost::HandleInnerFailedResponceCommand(
     fastotv::inner::InnerClient* connection,
     common::protocols::three_way_handshake::cmd_seq_t id,
@@ -696,6 +1187,7 @@ void InnerTcpHandlerHost::HandleInnerApproveCommand(fastotv::inner::InnerClient*
       } else if (IS_EQUAL_COMMAND(okrespcommand, CLIENT_GET_CHANNELS)) {
       } else if (IS_EQUAL_COMMAND(okrespcommand, CLIENT_GET_RUNTIME_CHANNEL_INFO)) {
       } else if (IS_EQUAL_COMMAND(okrespcommand, CLIENT_SEND_CHAT_MESSAGE)) {
+      } else if (IS_EQUAL_COMMAND(okrespcommand, CLIENT_GET_PROGRAMMES)) {
       }
     }
     return;
@@ -707,6 +1199,7 @@ void InnerTcpHandlerHost::HandleInnerApproveCommand(fastotv::inner::InnerClient*
       } else if (IS_EQUAL_COMMAND(failed_resp_command, CLIENT_GET_CHANNELS)) {
       } else if (IS_EQUAL_COMMAND(failed_resp_command, CLIENT_GET_RUNTIME_CHANNEL_INFO)) {
       } else if (IS_EQUAL_COMMAND(failed_resp_command, CLIENT_SEND_CHAT_MESSAGE)) {
+      } else if (IS_EQUAL_COMMAND(failed_resp_command, CLIENT_GET_PROGRAMMES)) {
       }
     }
     return;
@@ -743,6 +1236,7 @@ void InnerTcpHandlerHost::SendLeaveChatMessage(common::libev::IoLoop* server, st
 }
 
 void InnerTcpHandlerHost::BrodcastChatMessage(common::libev::IoLoop* server, const ChatMessage& msg) {
+  UNUSED(server);
   serializet_t msg_ser;
   common::Error err = msg.SerializeToString(&msg_ser);
   if (err) {
@@ -750,33 +1244,67 @@ void InnerTcpHandlerHost::BrodcastChatMessage(common::libev::IoLoop* server, con
     return;
   }
 
-  std::vector<common::libev::IoClient*> online_clients = server->GetClients();
-  for (size_t i = 0; i < online_clients.size(); ++i) {
-    common::libev::IoClient* client = online_clients[i];
-    InnerTcpClient* iclient = static_cast<InnerTcpClient*>(client);
-    if (iclient && iclient->GetCurrentStreamId() == msg.GetChannelId()) {
-      const common::protocols::three_way_handshake::cmd_request_t message_request =
-          ServerSendChatMessageRequest(NextRequestID(), msg_ser);
-      err = iclient->Write(message_request);
-      if (err) {
-        DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
-      }
+  // one request id for all recipients, server doesn't wait responces for chat messages,
+  // hex id because recipients may not support compact ids
+  const common::protocols::three_way_handshake::cmd_request_t message_request =
+      ServerSendChatMessageRequest(NextRequestID(), msg_ser);
+  fastotv::inner::InnerClient::frame_t frame;
+  err = fastotv::inner::InnerClient::MakeFrame(message_request, &frame);
+  if (err) {
+    DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+    return;
+  }
+
+  std::string msg_bin;
+  fastotv::inner::BinarySerialize(msg, &msg_bin);
+  fastotv::inner::InnerClient::frame_t binary_frame;
+  err = fastotv::inner::InnerClient::MakeFrame(
+      fastotv::inner::MakeBinaryRequest(message_request.GetId(), SERVER_SEND_CHAT_MESSAGE, msg_bin), &binary_frame);
+  if (err) {  // text frame for all
+    DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+  }
+
+  AddChatHistory(msg);
+  SendFrameToWatchers(msg.GetChannelId(), frame, binary_frame);
+  parent_->BroadcastChatMessage(this, msg, frame, binary_frame);
+}
+
+void InnerTcpHandlerHost::AddChatHistory(const ChatMessage& msg) {
+  if (msg.GetType() != ChatMessage::MESSAGE) {  // enter and leave notices are not history
+    return;
+  }
+
+  const stream_id sid = msg.GetChannelId();
+  for (size_t i = 0; i < chat_channels_.size(); ++i) {
+    if (chat_channels_[i] == sid) {
+      parent_->AddChatHistory(msg);
+      return;
     }
   }
 }
 
-size_t InnerTcpHandlerHost::GetOnlineUserByStreamId(common::libev::IoLoop* server, stream_id sid) const {
-  size_t total = 0;
-  std::vector<common::libev::IoClient*> online_clients = server->GetClients();
-  for (size_t i = 0; i < online_clients.size(); ++i) {
-    common::libev::IoClient* client = online_clients[i];
-    InnerTcpClient* iclient = static_cast<InnerTcpClient*>(client);
-    if (iclient && iclient->GetCurrentStreamId() == sid) {
-      total++;
+void InnerTcpHandlerHost::SendFrameToWatchers(stream_id sid,
+                                              const fastotv::inner::InnerClient::frame_t& frame,
+                                              const fastotv::inner::InnerClient::frame_t& binary_frame) {
+  const StreamWatchers::watchers_t& watchers = watchers_.GetWatchers(sid);
+  for (InnerTcpClient* iclient : watchers) {
+    const bool binary = binary_frame && iclient->IsPeerSupport(fastotv::inner::InnerClient::BINARY_COMMANDS_FEATURE);
+    common::Error err = iclient->WriteFrame(binary ? binary_frame : frame, fastotv::inner::InnerClient::LOW_PRIORITY);
+    if (err) {
+      DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
     }
   }
+}
+
+size_t InnerTcpHandlerHost::GetOnlineUserByStreamId(stream_id sid) const {
+  return parent_->GetStreamWatchersCount(sid);
+}
 
-  return total;
+void InnerTcpHandlerHost::SetCurrentStreamId(InnerTcpClient* client, stream_id sid) {
+  const stream_id prev = client->GetCurrentStreamId();
+  watchers_.Change(client, prev, sid);
+  parent_->ChangeStreamWatcher(prev, sid);
+  client->SetCurrentStreamId(sid);
 }
 
 }  // namespace inner
@@ -18,8 +18,11 @@
 
 #pragma once
 
-#include <memory>  // for shared_ptr
+#include <atomic>
+#include <functional>
 #include <string>  // for string
+#include <unordered_map>
+#include <vector>
 
 #include <json-c/json_object.h>  // for json_object
 
@@ -29,11 +32,16 @@
 #include <common/macros.h>                  // for WARN_UNUSED_RESULT
 
 #include "commands/commands.h"
+#include "inner/inner_client.h"                     // for InnerClient::frame_t
 #include "inner/inner_server_command_seq_parser.h"  // for InnerServerComman...
 
 #include "server/config.h"  // for Config
+#include "server/inner/stream_watchers.h"
+#include "server/mpsc_queue.h"
+#include "server/server_host.h"
 #include "server/user_info.h"
 
+#include "channels_delta_info.h"  // for channels_version_t
 #include "chat_message.h"
 
 namespace common {
@@ -46,34 +54,30 @@ namespace libev {
 class IoLoop;
 }
 }  // namespace common
-namespace common {
-namespace threads {
-template <typename RT>
-class Thread;
-}
-}  // namespace common
 
 namespace fastotv {
-namespace inner {
-class InnerClient;
-}
 namespace server {
 class UserStateInfo;
 class ServerHost;
 namespace redis {
-class RedisPubSub;
+class RedisAsyncClient;
 }
 namespace inner {
 
-class InnerSubHandler;
+class InnerTcpAcceptor;
 class InnerTcpClient;
 
 class InnerTcpHandlerHost : public fastotv::inner::InnerServerCommandSeqParser, public common::libev::IoLoopObserver {
  public:
   enum {
     ping_timeout_clients = 60,  // sec
-    reread_cache_timeout = 150
+    reread_cache_timeout = 150,
+    redis_reconnect_timeout = 5,
+    expire_requests_timeout = 1,  // tick of pending external requests
+    max_tasks_per_wakeup = 256
   };
+  typedef std::unordered_map<user_id_t, std::vector<InnerTcpClient*>> inner_connections_type;
+  typedef std::function<void(const std::string& cause)> external_request_fail_callback_t;
 
   explicit InnerTcpHandlerHost(ServerHost* parent, const Config& config);
 
@@ -93,14 +97,40 @@ class InnerTcpHandlerHost : public fastotv::inner::InnerServerCommandSeqParser,
 
   virtual ~InnerTcpHandlerHost();
 
-  common::Error PublishToChannelOut(const std::string& msg);
-  inner::InnerTcpClient* FindInnerConnectionByUserIDAndDeviceID(user_id_t user, device_id_t dev) const;
+  // cross worker entry points, thread-safe, executed in the loop thread of this handler
+  // calls from other threads are only queued, loop drains them in batches after one wakeup
+  // binary frame is sent to clients which support binary commands, can be null
+  void PostChatMessage(const ChatMessage& msg,
+                       const fastotv::inner::InnerClient::frame_t& frame,
+                       const fastotv::inner::InnerClient::frame_t& binary_frame);
+  // command is written with own request id, answer is passed to cb which reports it with external id
+  void PostExternalRequest(user_id_t uid,
+                           device_id_t dev,
+                           const std::string& command,
+                           fastotv::inner::RequestCallback cb,
+                           external_request_fail_callback_t fail_cb);
+  void ResetUserInfo(const login_t& login);
 
  private:
+  bool IsServiceClient(common::libev::IoClient* client) const;
+  void Accept(common::libev::IoLoop* server);
+
+  common::Error RegisterInnerConnectionByUser(user_id_t user_id,
+                                              const AuthInfo& user,
+                                              InnerTcpClient* connection) WARN_UNUSED_RESULT;
+  common::Error UnRegisterInnerConnectionByHost(InnerTcpClient* connection) WARN_UNUSED_RESULT;
+  InnerTcpClient* FindInnerConnectionByUserIDAndDeviceID(user_id_t user, device_id_t dev) const;
+
   void UpdateCache();
+  void ConnectToRedis(common::libev::IoLoop* server);
+  void FindUser(InnerTcpClient* client, const AuthInfo& auth, ServerHost::find_user_callback_t cb);
 
   void PublishUserStateInfo(const UserStateInfo& state);
 
+  typedef std::function<void()> loop_task_t;
+  void PostTask(common::libev::IoLoop* server, loop_task_t task);
+  void DrainTasks();
+
   virtual void HandleInnerRequestCommand(fastotv::inner::InnerClient* connection,
                                          common::protocols::three_way_handshake::cmd_seq_t id,
                                          int argc,
@@ -126,21 +156,54 @@ class InnerTcpHandlerHost : public fastotv::inner::InnerServerCommandSeqParser,
 
   common::Error ParserResponceResponceCommand(int argc, char* argv[], json_object** out) WARN_UNUSED_RESULT;
 
+  // continuations of user lookups
+  common::Error HandleWhoAreYouUser(InnerTcpClient* client,
+                                    common::protocols::three_way_handshake::cmd_seq_t id,
+                                    const AuthInfo& uauth,
+                                    common::Error lookup_err,
+                                    const user_id_t& uid,
+                                    user_info_ptr_t registered_user) WARN_UNUSED_RESULT;
+  common::Error HandleGetServerInfoUser(InnerTcpClient* client,
+                                        common::protocols::three_way_handshake::cmd_seq_t id,
+                                        common::Error lookup_err,
+                                        user_info_ptr_t user) WARN_UNUSED_RESULT;
+  common::Error HandleGetChannelsUser(InnerTcpClient* client,
+                                      common::protocols::three_way_handshake::cmd_seq_t id,
+                                      bool versioned,
+                                      const channels_version_t& client_version,
+                                      common::Error lookup_err,
+                                      user_info_ptr_t user) WARN_UNUSED_RESULT;
+  void WriteGetChannelsFail(InnerTcpClient* client,
+                            common::protocols::three_way_handshake::cmd_seq_t id,
+                            common::Error err);  // channels can't be answered, connection is kept
+
   void SendEnterChatMessage(common::libev::IoLoop* server, stream_id sid, login_t login);
   void SendLeaveChatMessage(common::libev::IoLoop* server, stream_id sid, login_t login);
   void BrodcastChatMessage(common::libev::IoLoop* server, const ChatMessage& msg);
-  size_t GetOnlineUserByStreamId(common::libev::IoLoop* server, stream_id sid) const;
+  void AddChatHistory(const ChatMessage& msg);  // user messages of official channels, into shared history
+  void SendFrameToWatchers(stream_id sid,
+                           const fastotv::inner::InnerClient::frame_t& frame,
+                           const fastotv::inner::InnerClient::frame_t& binary_frame);  // this worker only
+  size_t GetOnlineUserByStreamId(stream_id sid) const;
+  void SetCurrentStreamId(InnerTcpClient* client, stream_id sid);
 
   ServerHost* const parent_;
+  std::atomic<common::libev::IoLoop*> loop_;
 
-  redis::RedisPubSub* sub_commands_in_;
-  InnerSubHandler* handler_;
-  std::shared_ptr<common::threads::Thread<void>> redis_subscribe_command_in_thread_;
+  InnerTcpAcceptor* acceptor_;
+  redis::RedisAsyncClient* redis_client_;
+  InnerTcpClient* dispatching_client_;  // reset if closed while its commands are handled
   common::libev::timer_id_t ping_client_id_timer_;
   common::libev::timer_id_t reread_cache_id_timer_;
+  common::libev::timer_id_t redis_reconnect_id_timer_;
+  common::libev::timer_id_t expire_requests_id_timer_;
+  uint64_t last_tick_usec_;  // loop lag is measured on expire requests timer
   const Config config_;
 
+  inner_connections_type connections_;  // registered users of this worker
+  StreamWatchers watchers_;
   mutable std::vector<stream_id> chat_channels_;
+  MpscQueue<loop_task_t> pending_tasks_;
 };
 
 }  // namespace inner
@@ -18,24 +18,49 @@
 
 #include "server/inner/inner_tcp_server.h"
 
+#include <unistd.h>  // for close
+
+#include "server/inner/inner_tcp_acceptor.h"  // for CreateListener
 #include "server/inner/inner_tcp_client.h"
 
 namespace fastotv {
 namespace server {
 namespace inner {
 
-InnerTcpServer::InnerTcpServer(const common::net::HostAndPort& host,
-                               bool is_default,
-                               common::libev::IoLoopObserver* observer)
-    : TcpServer(host, is_default, observer) {}
+InnerTcpServer::InnerTcpServer(const common::net::HostAndPort& host, common::libev::IoLoopObserver* observer)
+    : IoLoop(new common::libev::LibEvLoop, observer), host_(host), listen_fd_(INVALID_DESCRIPTOR) {}
 
 const char* InnerTcpServer::ClassName() const {
   return "InnerTcpServer";
 }
 
-common::libev::tcp::TcpClient* InnerTcpServer::CreateClient(const common::net::socket_info& info) {
-  InnerTcpClient* client = new InnerTcpClient(this, info);
-  return client;
+common::Error InnerTcpServer::Listen(int backlog) {
+  if (listen_fd_ != INVALID_DESCRIPTOR) {
+    return common::Error();
+  }
+
+  return CreateListener(host_, backlog, true, &listen_fd_);
+}
+
+void InnerTcpServer::CloseListener() {
+  if (listen_fd_ == INVALID_DESCRIPTOR) {
+    return;
+  }
+
+  close(listen_fd_);
+  listen_fd_ = INVALID_DESCRIPTOR;
+}
+
+int InnerTcpServer::GetListenFd() const {
+  return listen_fd_;
+}
+
+common::net::HostAndPort InnerTcpServer::GetHost() const {
+  return host_;
+}
+
+common::libev::IoClient* InnerTcpServer::CreateClient(const common::net::socket_info& info) {
+  return new InnerTcpClient(this, info);
 }
 
 }  // namespace inner
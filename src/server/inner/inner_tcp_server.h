@@ -18,36 +18,38 @@
 
 #pragma once
 
-#include <common/libev/tcp/tcp_client.h>  // for TcpClient
-#include <common/libev/tcp/tcp_server.h>  // for TcpServer
+#include <common/error.h>          // for Error
+#include <common/libev/io_loop.h>  // for IoLoop
+#include <common/macros.h>         // for WARN_UNUSED_RESULT
+#include <common/net/types.h>      // for HostAndPort
 
 namespace common {
 namespace libev {
 class IoLoopObserver;
 }
 }  // namespace common
-namespace common {
-namespace net {
-class socket_info;
-}
-}  // namespace common
-namespace common {
-namespace net {
-struct HostAndPort;
-}
-}  // namespace common
 
 namespace fastotv {
 namespace server {
 namespace inner {
 
-class InnerTcpServer : public common::libev::tcp::TcpServer {
+// one per worker, all workers listen the same host (SO_REUSEPORT)
+class InnerTcpServer : public common::libev::IoLoop {
  public:
-  InnerTcpServer(const common::net::HostAndPort& host, bool is_default, common::libev::IoLoopObserver* observer);
+  InnerTcpServer(const common::net::HostAndPort& host, common::libev::IoLoopObserver* observer);
   virtual const char* ClassName() const override;
 
+  common::Error Listen(int backlog) WARN_UNUSED_RESULT;
+  void CloseListener();  // only before loop started, otherwise acceptor owns descriptor
+  int GetListenFd() const;
+  common::net::HostAndPort GetHost() const;
+
+ protected:
+  virtual common::libev::IoClient* CreateClient(const common::net::socket_info& info) override;
+
  private:
-  virtual common::libev::tcp::TcpClient* CreateClient(const common::net::socket_info& info) override;
+  const common::net::HostAndPort host_;
+  int listen_fd_;
 };
 
 }  // namespace inner
@@ -0,0 +1,75 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "server/inner/stream_watchers.h"
+
+namespace fastotv {
+namespace server {
+namespace inner {
+
+StreamWatchers::StreamWatchers() : streams_(), empty_() {}
+
+void StreamWatchers::Change(InnerTcpClient* client, stream_id prev, stream_id next) {
+  if (prev == next) {
+    return;
+  }
+
+  Remove(client, prev);
+  if (!client || next == invalid_stream_id) {
+    return;
+  }
+
+  streams_[next].insert(client);
+}
+
+void StreamWatchers::Remove(InnerTcpClient* client, stream_id sid) {
+  if (!client || sid == invalid_stream_id) {
+    return;
+  }
+
+  streams_t::iterator it = streams_.find(sid);
+  if (it == streams_.end()) {
+    return;
+  }
+
+  it->second.erase(client);
+  if (it->second.empty()) {
+    streams_.erase(it);
+  }
+}
+
+const StreamWatchers::watchers_t& StreamWatchers::GetWatchers(stream_id sid) const {
+  streams_t::const_iterator it = streams_.find(sid);
+  if (it == streams_.end()) {
+    return empty_;
+  }
+
+  return it->second;
+}
+
+size_t StreamWatchers::GetWatchersCount(stream_id sid) const {
+  return GetWatchers(sid).size();
+}
+
+size_t StreamWatchers::GetStreamsCount() const {
+  return streams_.size();
+}
+
+}  // namespace inner
+}  // namespace server
+}  // namespace fastotv
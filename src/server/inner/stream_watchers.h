@@ -0,0 +1,60 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <unordered_map>
+#include <unordered_set>
+
+#include <common/macros.h>  // for DISALLOW_COPY_AND_ASSIGN
+
+#include "client_server_types.h"  // for stream_id
+
+namespace fastotv {
+namespace server {
+namespace inner {
+
+class InnerTcpClient;
+
+// Index of connections by watched stream, belongs to one loop (not thread-safe).
+class StreamWatchers {
+ public:
+  typedef std::unordered_set<InnerTcpClient*> watchers_t;
+
+  StreamWatchers();
+
+  // moves client from prev to next stream, invalid_stream_id means none
+  void Change(InnerTcpClient* client, stream_id prev, stream_id next);
+  void Remove(InnerTcpClient* client, stream_id sid);
+
+  const watchers_t& GetWatchers(stream_id sid) const;
+  size_t GetWatchersCount(stream_id sid) const;
+  size_t GetStreamsCount() const;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(StreamWatchers);
+
+  typedef std::unordered_map<stream_id, watchers_t> streams_t;
+
+  streams_t streams_;
+  const watchers_t empty_;
+};
+
+}  // namespace inner
+}  // namespace server
+}  // namespace fastotv
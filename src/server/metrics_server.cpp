@@ -0,0 +1,151 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "server/metrics_server.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+
+#include <common/convert2string.h>  // for ConvertToString
+#include <common/logger.h>          // for WARNING_LOG
+
+#include "server/inner/inner_tcp_acceptor.h"  // for CreateListener
+#include "server/server_metrics.h"
+
+#define METRICS_PATH "/metrics"
+
+namespace fastotv {
+namespace server {
+namespace {
+bool write_all(int fd, const std::string& data) {
+  size_t offset = 0;
+  while (offset < data.size()) {
+    ssize_t res = send(fd, data.data() + offset, data.size() - offset, MSG_NOSIGNAL);
+    if (res < 0 && errno == EINTR) {
+      continue;
+    }
+    if (res <= 0) {
+      return false;
+    }
+    offset += res;
+  }
+  return true;
+}
+
+std::string make_http_responce(const std::string& status, const std::string& body) {
+  return "HTTP/1.0 " + status +
+         "\r\n"
+         "Content-Type: text/plain; version=0.0.4\r\n"
+         "Content-Length: " +
+         common::ConvertToString(body.size()) +
+         "\r\n"
+         "Connection: close\r\n\r\n" +
+         body;
+}
+}  // namespace
+
+MetricsServer::MetricsServer(const common::net::HostAndPort& host, const ServerMetrics* metrics)
+    : host_(host), metrics_(metrics), listen_fd_(-1), stop_(false) {}
+
+MetricsServer::~MetricsServer() {
+  if (listen_fd_ != -1) {
+    close(listen_fd_);
+  }
+}
+
+common::Error MetricsServer::Bind() {
+  if (listen_fd_ != -1) {
+    return common::Error();
+  }
+
+  // without SO_REUSEPORT, so second instance on the same port fails instead of taking part of scrapes
+  return inner::CreateListener(host_, SOMAXCONN, false, &listen_fd_);
+}
+
+void MetricsServer::Run() {
+  while (!stop_) {
+    struct pollfd pfd;
+    pfd.fd = listen_fd_;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    int res = poll(&pfd, 1, poll_timeout_msec);
+    if (res <= 0) {
+      continue;
+    }
+
+    int cfd = accept(listen_fd_, NULL, NULL);
+    if (cfd == -1) {
+      continue;
+    }
+
+    ServeClient(cfd);
+    close(cfd);
+  }
+}
+
+void MetricsServer::Stop() {
+  stop_ = true;
+}
+
+void MetricsServer::ServeClient(int fd) {
+  struct timeval tv;
+  tv.tv_sec = io_timeout_sec;
+  tv.tv_usec = 0;
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+  std::string request;
+  char buff[1024];
+  while (request.find("\r\n\r\n") == std::string::npos && request.size() < max_request_size) {
+    ssize_t nread = recv(fd, buff, sizeof(buff), 0);
+    if (nread < 0 && errno == EINTR) {
+      continue;
+    }
+    if (nread <= 0) {
+      return;
+    }
+    request.append(buff, nread);
+  }
+
+  const std::string line = request.substr(0, request.find("\r\n"));  // GET /metrics HTTP/1.1
+  const size_t path_start = line.find(' ');
+  const size_t path_end = path_start == std::string::npos ? path_start : line.find_first_of(" ?", path_start + 1);
+  const std::string method = line.substr(0, path_start);
+  const std::string path = path_start == std::string::npos ? std::string()
+                                                            : line.substr(path_start + 1, path_end - path_start - 1);
+  std::string responce;
+  if (method != "GET") {
+    responce = make_http_responce("405 Method Not Allowed", std::string());
+  } else if (path != METRICS_PATH) {
+    responce = make_http_responce("404 Not Found", std::string());
+  } else {
+    responce = make_http_responce("200 OK", metrics_->RenderPrometheus());
+  }
+
+  if (!write_all(fd, responce)) {
+    WARNING_LOG() << "Metrics responce write failed: " << strerror(errno);
+  }
+}
+
+}  // namespace server
+}  // namespace fastotv
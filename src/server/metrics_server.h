@@ -0,0 +1,57 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <atomic>
+
+#include <common/error.h>      // for Error
+#include <common/macros.h>     // for WARN_UNUSED_RESULT
+#include <common/net/types.h>  // for HostAndPort
+
+namespace fastotv {
+namespace server {
+
+class ServerMetrics;
+
+// Minimal HTTP/1.0 endpoint for scrapers: GET /metrics answers ServerMetrics in Prometheus text format.
+// Requests are served one by one on the Run thread, it is meant for a local collector only.
+class MetricsServer {
+ public:
+  enum { poll_timeout_msec = 500, io_timeout_sec = 2, max_request_size = 4096 };
+
+  MetricsServer(const common::net::HostAndPort& host, const ServerMetrics* metrics);
+  ~MetricsServer();
+
+  common::Error Bind() WARN_UNUSED_RESULT;
+  void Run();  // until Stop
+  void Stop();
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(MetricsServer);
+
+  void ServeClient(int fd);
+
+  const common::net::HostAndPort host_;
+  const ServerMetrics* const metrics_;
+  int listen_fd_;
+  std::atomic<bool> stop_;
+};
+
+}  // namespace server
+}  // namespace fastotv
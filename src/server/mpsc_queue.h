@@ -0,0 +1,117 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stddef.h>  // for NULL
+
+#include <atomic>
+#include <utility>  // for move
+
+#include <common/macros.h>  // for DISALLOW_COPY_AND_ASSIGN
+
+namespace fastotv {
+namespace server {
+
+// Unbounded lock-free queue for many producers and one consumer (intrusive list of D. Vyukov).
+// Push is wait-free and callable from any thread, Pop only from the consumer thread.
+// Pop can return false while a concurrent Push is half done, the producer still sees its own push completed,
+// so a consumer woken after Push (see PushAndCheckWakeup) always finds the value.
+template <typename T>
+class MpscQueue {
+ public:
+  MpscQueue() : stub_(), head_(&stub_), tail_(&stub_), wakeup_pending_(false) { stub_.next = NULL; }
+
+  ~MpscQueue() {
+    T value;
+    while (Pop(&value)) {
+    }
+  }
+
+  void Push(T value) {
+    Node* node = new Node;
+    node->value = std::move(value);
+    node->next = NULL;
+    Enqueue(node);
+  }
+
+  // returns true if consumer should be woken, only first push after ResetWakeup does it
+  bool PushAndCheckWakeup(T value) {
+    Push(std::move(value));
+    return !wakeup_pending_.exchange(true);
+  }
+
+  // consumer calls it before draining, pushes made after will request a new wakeup
+  void ResetWakeup() { wakeup_pending_.exchange(false); }  // RMW, sees links of pushes which skipped wakeup
+
+  bool Pop(T* value) {
+    Node* tail = tail_;
+    Node* next = tail->next.load(std::memory_order_acquire);
+    if (tail == &stub_) {
+      if (!next) {
+        return false;
+      }
+      tail_ = next;
+      tail = next;
+      next = next->next.load(std::memory_order_acquire);
+    }
+
+    if (next) {
+      tail_ = next;
+      *value = std::move(tail->value);
+      delete tail;
+      return true;
+    }
+
+    if (tail != head_.load(std::memory_order_acquire)) {  // producer between exchange and link
+      return false;
+    }
+
+    stub_.next = NULL;
+    Enqueue(&stub_);
+    next = tail->next.load(std::memory_order_acquire);
+    if (next) {
+      tail_ = next;
+      *value = std::move(tail->value);
+      delete tail;
+      return true;
+    }
+    return false;
+  }
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(MpscQueue);
+
+  struct Node {
+    std::atomic<Node*> next;
+    T value;
+  };
+
+  void Enqueue(Node* node) {
+    Node* prev = head_.exchange(node, std::memory_order_acq_rel);
+    prev->next.store(node, std::memory_order_release);
+  }
+
+  Node stub_;
+  std::atomic<Node*> head_;  // last pushed, touched by producers
+  Node* tail_;               // next to pop, consumer only
+  std::atomic<bool> wakeup_pending_;
+};
+
+}  // namespace server
+}  // namespace fastotv
@@ -0,0 +1,151 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "server/redis/redis_async_client.h"
+
+#include <stdarg.h>  // for va_list
+#include <stddef.h>  // for NULL
+
+#include <hiredis/hiredis.h>  // for redisBufferRead, redisBufferWrite
+
+#include <common/libev/io_loop.h>  // for IoLoop
+
+namespace fastotv {
+namespace server {
+namespace redis {
+
+RedisAsyncClient::RedisAsyncClient(common::libev::IoLoop* server, redisContext* context)
+    : base_class(server, context->fd, EV_READ | EV_WRITE), context_(context), pending_() {}
+
+RedisAsyncClient::~RedisAsyncClient() {
+  pending_.clear();  // owners may be gone already, callbacks are not invoked from destructor
+  if (context_) {
+    redisFree(context_);
+    context_ = NULL;
+  }
+}
+
+common::Error RedisAsyncClient::ExecCommand(const void* owner, callback_t cb, const char* format, ...) {
+  if (!context_ || !format) {
+    return common::make_error_inval();
+  }
+
+  va_list ap;
+  va_start(ap, format);
+  int res = redisvAppendCommand(context_, format, ap);
+  va_end(ap);
+  if (res != REDIS_OK) {
+    return common::make_error(context_->errstr);
+  }
+
+  PendingCommand command = {owner, cb};
+  pending_.push_back(command);
+  SetFlags(EV_READ | EV_WRITE);  // flush on next loop iteration
+  return common::Error();
+}
+
+void RedisAsyncClient::CancelCallbacks(const void* owner) {
+  for (auto it = pending_.begin(); it != pending_.end(); ++it) {
+    if (it->owner == owner) {
+      it->cb = callback_t();
+    }
+  }
+}
+
+size_t RedisAsyncClient::GetPendingCommandsCount() const {
+  return pending_.size();
+}
+
+common::Error RedisAsyncClient::ProcessRead() {
+  if (!context_) {
+    return common::make_error_inval();
+  }
+
+  if (redisBufferRead(context_) != REDIS_OK) {
+    return common::make_error(context_->errstr);
+  }
+
+  while (true) {
+    void* reply = NULL;
+    if (redisGetReplyFromReader(context_, &reply) != REDIS_OK) {
+      return common::make_error(context_->errstr);
+    }
+
+    if (!reply) {
+      break;
+    }
+
+    if (pending_.empty()) {  // unexpected reply
+      freeReplyObject(reply);
+      continue;
+    }
+
+    PendingCommand command = pending_.front();
+    pending_.pop_front();
+    if (command.cb) {
+      command.cb(static_cast<redisReply*>(reply));
+    }
+    freeReplyObject(reply);
+  }
+
+  return common::Error();
+}
+
+common::Error RedisAsyncClient::ProcessWrite() {
+  if (!context_) {
+    return common::make_error_inval();
+  }
+
+  int done = 0;
+  if (redisBufferWrite(context_, &done) != REDIS_OK) {
+    return common::make_error(context_->errstr);
+  }
+
+  if (done) {
+    SetFlags(EV_READ);
+  }
+  return common::Error();
+}
+
+const char* RedisAsyncClient::ClassName() const {
+  return "RedisAsyncClient";
+}
+
+common::Error RedisAsyncClient::DoClose() {
+  FailPendingCommands();
+  if (context_) {
+    redisFreeKeepFd(context_);
+    context_ = NULL;
+  }
+  return base_class::DoClose();
+}
+
+void RedisAsyncClient::FailPendingCommands() {
+  // pop one by one, callback can close its owner and CancelCallbacks must still see the rest of the queue
+  while (!pending_.empty()) {
+    PendingCommand command = pending_.front();
+    pending_.pop_front();
+    if (command.cb) {
+      command.cb(NULL);
+    }
+  }
+}
+
+}  // namespace redis
+}  // namespace server
+}  // namespace fastotv
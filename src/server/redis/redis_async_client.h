@@ -0,0 +1,77 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <deque>
+#include <functional>
+
+#include <common/libev/descriptor_client.h>  // for DescriptorClient
+
+struct redisContext;
+struct redisReply;
+
+namespace common {
+namespace libev {
+class IoLoop;
+}
+}  // namespace common
+
+namespace fastotv {
+namespace server {
+namespace redis {
+
+// Redis connection driven by IoLoop, replies are delivered into callbacks in order of commands.
+// Loop observer should forward DataReceived/DataReadyToWrite events of this client into ProcessRead/ProcessWrite.
+class RedisAsyncClient : public common::libev::DescriptorClient {
+ public:
+  typedef common::libev::DescriptorClient base_class;
+  typedef std::function<void(redisReply* reply)> callback_t;  // reply is NULL if command failed
+
+  RedisAsyncClient(common::libev::IoLoop* server, redisContext* context);  // takes ownership of context
+  virtual ~RedisAsyncClient();
+
+  common::Error ExecCommand(const void* owner, callback_t cb, const char* format, ...) WARN_UNUSED_RESULT;
+  // pending replies for owner will be skipped
+  void CancelCallbacks(const void* owner);
+  size_t GetPendingCommandsCount() const;
+
+  common::Error ProcessRead() WARN_UNUSED_RESULT;
+  common::Error ProcessWrite() WARN_UNUSED_RESULT;
+
+  virtual const char* ClassName() const override;
+
+ private:
+  struct PendingCommand {
+    const void* owner;
+    callback_t cb;
+  };
+
+  virtual common::Error DoClose() override;
+  void FailPendingCommands();
+
+  using base_class::Write;
+  using base_class::Read;
+
+  redisContext* context_;
+  std::deque<PendingCommand> pending_;
+};
+
+}  // namespace redis
+}  // namespace server
+}  // namespace fastotv
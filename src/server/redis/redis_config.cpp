@@ -18,10 +18,8 @@
 
 #include "server/redis/redis_config.h"
 
-namespace fasto {
 namespace fastotv {
 namespace server {
 namespace redis {}
 }  // namespace server
 }  // namespace fastotv
-}  // namespace fasto
@@ -18,6 +18,8 @@
 
 #pragma once
 
+#include <stddef.h>  // for size_t
+
 #include <string>  // for string
 
 #include <common/net/types.h>  // for HostAndPort
@@ -27,8 +29,13 @@ namespace server {
 namespace redis {
 
 struct RedisConfig {
+  enum { default_pool_size = 4 };
+
+  RedisConfig() : redis_host(), redis_unix_socket(), pool_size(default_pool_size) {}
+
   common::net::HostAndPort redis_host;
   std::string redis_unix_socket;
+  size_t pool_size;  // max opened connections per pool
 };
 
 }  // namespace redis
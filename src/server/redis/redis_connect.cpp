@@ -21,7 +21,7 @@
 #include <stddef.h>  // for NULL
 #include <string>    // for string
 
-#include <hiredis/hiredis.h>  // for redisFree, redisContext
+#include <hiredis/hiredis.h>  // for redisFree, redisContext, redisSetTimeout
 
 #include <common/error.h>
 #include <common/net/types.h>  // for HostAndPort
@@ -115,6 +115,64 @@ common::Error redis_connect(const RedisConfig& config, redisContext** conn) {
   return common::Error();
 }
 
+common::Error redis_connect_nonblock(const RedisConfig& config, redisContext** conn) {
+  if (!conn) {
+    return common::make_error_inval();
+  }
+
+  const common::net::HostAndPort redis_host = config.redis_host;
+  const std::string unix_path = config.redis_unix_socket;
+
+  if (!redis_host.IsValid() && unix_path.empty()) {
+    return common::make_error_inval();
+  }
+
+  struct redisContext* redis = NULL;
+  if (!unix_path.empty()) {
+    redis = redisConnectUnixNonBlock(unix_path.c_str());
+    if (redis && redis->err && redis_host.IsValid()) {
+      redisFree(redis);
+      redis = NULL;
+    }
+  }
+
+  if (!redis && redis_host.IsValid()) {
+    const std::string host_str = redis_host.GetHost();
+    redis = redisConnectNonBlock(host_str.c_str(), redis_host.GetPort());
+  }
+
+  if (!redis) {
+    return common::make_error("Could not connect to Redis: no context");
+  }
+
+  if (redis->err) {
+    common::Error err = common::make_error(redis->errstr);
+    redisFree(redis);
+    return err;
+  }
+
+  *conn = redis;
+  return common::Error();
+}
+
+common::Error redis_set_io_timeout(redisContext* context, uint32_t timeout_msec) {
+  if (!context || timeout_msec == 0) {
+    return common::make_error_inval();
+  }
+
+  struct timeval tv;
+  tv.tv_sec = timeout_msec / 1000;
+  tv.tv_usec = (timeout_msec % 1000) * 1000;
+  if (redisSetTimeout(context, tv) != REDIS_OK) {
+    return common::make_error(context->errstr);
+  }
+
+  if (context->connection_type == REDIS_CONN_TCP && redisEnableKeepAlive(context) != REDIS_OK) {
+    return common::make_error(context->errstr);
+  }
+  return common::Error();
+}
+
 }  // namespace redis
 }  // namespace server
 }  // namespace fastotv
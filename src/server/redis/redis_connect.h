@@ -18,6 +18,8 @@
 
 #pragma once
 
+#include <stdint.h>  // for uint32_t
+
 #include <common/error.h>
 
 #include "server/redis/redis_config.h"
@@ -32,6 +34,12 @@ common::Error redis_tcp_connect(const common::net::HostAndPort& host, redisConte
 common::Error redis_unix_connect(const std::string& unix_path, redisContext** conn);
 
 common::Error redis_connect(const RedisConfig& config, redisContext** conn);
+// connection established in background, context should be driven by event loop
+common::Error redis_connect_nonblock(const RedisConfig& config, redisContext** conn);
+
+// blocking reads and writes of context fail after timeout_msec, tcp connections also get keep alive probes,
+// so half-open connection is detected instead of blocking forever
+common::Error redis_set_io_timeout(redisContext* context, uint32_t timeout_msec);
 
 }  // namespace redis
 }  // namespace server
@@ -0,0 +1,209 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "server/redis/redis_pool.h"
+
+#include <stddef.h>  // for NULL
+
+#include <hiredis/hiredis.h>  // for redisFree, redisvCommand
+
+#include <common/logger.h>  // for WARNING_LOG
+#include <common/time.h>    // for current_mstime
+
+#include "server/redis/redis_connect.h"
+
+namespace fastotv {
+namespace server {
+namespace redis {
+
+RedisPool::RedisPool() : mutex_(), free_cond_(), idle_(), opened_(0), generation_(0), config_() {}
+
+RedisPool::~RedisPool() {
+  Clear();
+}
+
+void RedisPool::SetConfig(const RedisConfig& config) {
+  Clear();
+  std::lock_guard<std::mutex> lock(mutex_);
+  config_ = config;
+}
+
+void RedisPool::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (size_t i = 0; i < idle_.size(); ++i) {
+    redisFree(idle_[i].context);
+  }
+  idle_.clear();
+  opened_ = 0;
+  generation_++;  // borrowed connections will be closed on release
+  free_cond_.notify_all();
+}
+
+size_t RedisPool::GetOpenedConnectionsCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return opened_;
+}
+
+common::Error RedisPool::ExecCommand(redisReply** reply, const char* format, ...) {
+  va_list ap;
+  va_start(ap, format);
+  common::Error err = ExecCommandV(reply, format, ap);
+  va_end(ap);
+  return err;
+}
+
+common::Error RedisPool::ExecCommandV(redisReply** reply, const char* format, va_list ap) {
+  if (!reply || !format) {
+    return common::make_error_inval();
+  }
+
+  Connection conn;
+  common::Error err = Acquire(&conn);
+  if (err) {
+    return err;
+  }
+
+  va_list aq;
+  va_copy(aq, ap);
+  void* rreply = redisvCommand(conn.context, format, aq);
+  va_end(aq);
+  if (!rreply) {  // connection was dropped by server, reopen it and try again
+    WARNING_LOG() << "Redis connection error: " << conn.context->errstr << ", reconnecting.";
+    err = Reconnect(&conn);
+    if (err) {
+      Release(conn, true);
+      return err;
+    }
+
+    va_copy(aq, ap);
+    rreply = redisvCommand(conn.context, format, aq);
+    va_end(aq);
+    if (!rreply) {
+      err = common::make_error(conn.context->errstr);
+      Release(conn, true);
+      return err;
+    }
+  }
+
+  Release(conn, false);
+  *reply = static_cast<redisReply*>(rreply);
+  return common::Error();
+}
+
+common::Error RedisPool::Acquire(Connection* conn) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (idle_.empty() && opened_ >= config_.pool_size) {
+    free_cond_.wait(lock);
+  }
+
+  if (!idle_.empty()) {
+    Connection lconn = idle_.back();
+    idle_.pop_back();
+    lock.unlock();
+
+    const common::time64_t cur_time = common::time::current_mstime();
+    if (cur_time - lconn.last_used_msec > health_check_interval_msec && !IsAlive(lconn.context)) {
+      common::Error err = Reconnect(&lconn);
+      if (err) {
+        Release(lconn, true);
+        return err;
+      }
+    }
+
+    *conn = lconn;
+    return common::Error();
+  }
+
+  opened_++;
+  const RedisConfig config = config_;
+  const size_t generation = generation_;
+  lock.unlock();
+
+  redisContext* context = NULL;
+  common::Error err = redis_connect(config, &context);
+  if (err) {
+    Connection broken = {NULL, 0, generation};
+    Release(broken, true);
+    return err;
+  }
+
+  Connection lconn = {context, common::time::current_mstime(), generation};
+  *conn = lconn;
+  return common::Error();
+}
+
+void RedisPool::Release(Connection conn, bool broken) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (conn.generation != generation_) {
+    if (conn.context) {
+      redisFree(conn.context);
+    }
+    return;
+  }
+
+  if (broken || !conn.context) {
+    if (conn.context) {
+      redisFree(conn.context);
+    }
+    opened_--;
+    free_cond_.notify_one();
+    return;
+  }
+
+  conn.last_used_msec = common::time::current_mstime();
+  idle_.push_back(conn);
+  free_cond_.notify_one();
+}
+
+common::Error RedisPool::Reconnect(Connection* conn) {
+  if (conn->context) {
+    redisFree(conn->context);
+    conn->context = NULL;
+  }
+
+  RedisConfig config;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    config = config_;
+  }
+
+  redisContext* context = NULL;
+  common::Error err = redis_connect(config, &context);
+  if (err) {
+    return err;
+  }
+
+  conn->context = context;
+  conn->last_used_msec = common::time::current_mstime();
+  return common::Error();
+}
+
+bool RedisPool::IsAlive(redisContext* context) {
+  redisReply* reply = static_cast<redisReply*>(redisCommand(context, "PING"));
+  if (!reply) {
+    return false;
+  }
+
+  bool alive = reply->type == REDIS_REPLY_STATUS;
+  freeReplyObject(reply);
+  return alive;
+}
+
+}  // namespace redis
+}  // namespace server
+}  // namespace fastotv
@@ -0,0 +1,82 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdarg.h>  // for va_list
+
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+#include <common/error.h>   // for Error
+#include <common/macros.h>  // for WARN_UNUSED_RESULT, DISALLOW_COPY_...
+#include <common/types.h>   // for time64_t
+
+#include "server/redis/redis_config.h"
+
+struct redisContext;
+struct redisReply;
+
+namespace fastotv {
+namespace server {
+namespace redis {
+
+// Thread-safe pool of long-lived connections, commands borrow a connection for one round trip.
+// Connections idle longer than health_check_interval_msec are pinged before reuse,
+// broken connections are reopened and the command is retried once.
+class RedisPool {
+ public:
+  enum { health_check_interval_msec = 30000 };
+
+  RedisPool();
+  ~RedisPool();
+
+  void SetConfig(const RedisConfig& config);  // drops opened connections
+  void Clear();
+
+  common::Error ExecCommand(redisReply** reply, const char* format, ...) WARN_UNUSED_RESULT;
+  common::Error ExecCommandV(redisReply** reply, const char* format, va_list ap) WARN_UNUSED_RESULT;
+
+  size_t GetOpenedConnectionsCount() const;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(RedisPool);
+
+  struct Connection {
+    redisContext* context;
+    common::time64_t last_used_msec;
+    size_t generation;
+  };
+
+  common::Error Acquire(Connection* conn) WARN_UNUSED_RESULT;
+  void Release(Connection conn, bool broken);
+  common::Error Reconnect(Connection* conn) WARN_UNUSED_RESULT;
+  static bool IsAlive(redisContext* context);
+
+  mutable std::mutex mutex_;
+  std::condition_variable free_cond_;
+  std::vector<Connection> idle_;
+  size_t opened_;
+  size_t generation_;
+  RedisConfig config_;
+};
+
+}  // namespace redis
+}  // namespace server
+}  // namespace fastotv
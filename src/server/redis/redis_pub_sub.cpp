@@ -18,11 +18,18 @@
 
 #include "server/redis/redis_pub_sub.h"
 
+#include <errno.h>
+#include <poll.h>
 #include <stddef.h>  // for NULL
+#include <string.h>  // for strerror
 
-#include <hiredis/hiredis.h>  // for redisFree, freeReplyObject, redisCommand
+#include <algorithm>  // for min
+#include <chrono>
 
-#include <common/logger.h>  // for COMPACT_LOG_WARNING, WARNING_LOG
+#include <hiredis/hiredis.h>  // for redisFree, freeReplyObject, redisGetReplyFromReader
+
+#include <common/logger.h>  // for COMPACT_LOG_WARNING, WARNING_LOG, INFO_LOG
+#include <common/time.h>    // for current_mstime
 #include <common/utils.h>
 
 #include "server/redis/redis_connect.h"
@@ -31,44 +38,146 @@ namespace fastotv {
 namespace server {
 namespace redis {
 
-RedisPubSub::RedisPubSub(RedisSubHandler* handler) : handler_(handler), stop_(false) {}
+RedisPubSub::SubscriberStats::SubscriberStats() : subscribed(false), lost_intervals(0), downtime_msec(0) {}
+
+RedisPubSub::RedisPubSub(RedisSubHandler* handler)
+    : handler_(handler),
+      config_(),
+      publisher_(),
+      state_mutex_(),
+      stop_cond_(),
+      stop_(false),
+      down_since_msec_(common::time::current_mstime()),
+      stats_() {}
 
 void RedisPubSub::SetConfig(const RedisSubConfig& config) {
   config_ = config;
+  publisher_.SetConfig(config);
+  publisher_.SetMaxBufferedMessages(config.publish_buffer_size);
 }
 
 void RedisPubSub::Listen() {
+  uint32_t backoff_msec = min_reconnect_timeout_msec;
+  bool subscribed_before = false;
+  while (!IsStopped()) {
+    redisContext* redis_sub = NULL;
+    common::Error err = Subscribe(&redis_sub);
+    if (err) {
+      WARNING_LOG() << "REDIS PUB/SUB CONNECTION ERROR: " << err->GetDescription() << ", next try in "
+                    << backoff_msec << " msec.";
+      WaitReconnect(backoff_msec);
+      backoff_msec = std::min<uint32_t>(backoff_msec * 2, max_reconnect_timeout_msec);
+      continue;
+    }
+
+    backoff_msec = min_reconnect_timeout_msec;
+    MarkUp();
+    if (subscribed_before && handler_) {  // messages published while we were down are lost
+      handler_->HandleResubscribed();
+    }
+    subscribed_before = true;
+
+    ReadMessages(redis_sub);
+    redisFree(redis_sub);
+    MarkDown();
+  }
+}
+
+common::Error RedisPubSub::Subscribe(redisContext** sub) const {
   redisContext* redis_sub = NULL;
   common::Error err = redis_connect(config_, &redis_sub);
   if (err) {
-    WARNING_LOG() << "REDIS PUB/SUB CONNECTION ERROR: " << err->GetDescription();
-    return;
+    return err;
   }
 
-  const char* channel_str = config_.channel_in.c_str();
+  err = redis_set_io_timeout(redis_sub, ping_timeout_msec);  // bounds SUBSCRIBE and PING writes
+  if (err) {
+    redisFree(redis_sub);
+    return err;
+  }
 
-  void* reply = redisCommand(redis_sub, "SUBSCRIBE %s", channel_str);
+  const char* args[] = {"SUBSCRIBE", config_.channel_in.c_str(), NULL, NULL};
+  int argc = 2;
+  if (!config_.channel_users_changed.empty()) {
+    args[argc++] = config_.channel_users_changed.c_str();
+  }
+  if (!config_.channel_epg_changed.empty()) {
+    args[argc++] = config_.channel_epg_changed.c_str();
+  }
+
+  void* reply = redisCommandArgv(redis_sub, argc, args, NULL);
   if (!reply) {
+    err = common::make_error(redis_sub->errstr[0] ? redis_sub->errstr : "Subscribe failed");
     redisFree(redis_sub);
-    return;
+    return err;
   }
 
-  while (!stop_) {
+  freeReplyObject(reply);
+  *sub = redis_sub;
+  return common::Error();
+}
+
+void RedisPubSub::ReadMessages(redisContext* redis_sub) {
+  common::time64_t last_activity_msec = common::time::current_mstime();
+  common::time64_t ping_sent_msec = 0;
+  while (!IsStopped()) {
     redisReply* lreply = NULL;
     void** plreply = reinterpret_cast<void**>(&lreply);
-    if (redisGetReply(redis_sub, plreply) != REDIS_OK) {
+    if (redisGetReplyFromReader(redis_sub, plreply) != REDIS_OK) {
       WARNING_LOG() << "REDIS PUB/SUB GET REPLY ERROR: " << redis_sub->errstr;
       break;
     }
 
-    if (!lreply) {
-      break;
+    if (!lreply) {  // wait data in slices, so Stop and dead connection are noticed
+      const common::time64_t now = common::time::current_mstime();
+      if (ping_sent_msec && now - ping_sent_msec >= ping_timeout_msec) {
+        WARNING_LOG() << "REDIS PUB/SUB no answer to ping in " << ping_timeout_msec << " msec, reconnecting.";
+        break;
+      }
+
+      if (!ping_sent_msec && now - last_activity_msec >= ping_interval_msec) {
+        int done = 0;
+        if (redisAppendCommand(redis_sub, "PING") != REDIS_OK) {
+          WARNING_LOG() << "REDIS PUB/SUB PING ERROR: " << redis_sub->errstr;
+          break;
+        }
+        while (!done) {
+          if (redisBufferWrite(redis_sub, &done) != REDIS_OK) {
+            break;
+          }
+        }
+        if (!done) {
+          WARNING_LOG() << "REDIS PUB/SUB PING ERROR: " << redis_sub->errstr;
+          break;
+        }
+        ping_sent_msec = now;
+      }
+
+      struct pollfd pfd;
+      pfd.fd = redis_sub->fd;
+      pfd.events = POLLIN;
+      pfd.revents = 0;
+      int res = poll(&pfd, 1, stop_check_msec);
+      if (res < 0 && errno != EINTR) {
+        WARNING_LOG() << "REDIS PUB/SUB POLL ERROR: " << strerror(errno);
+        break;
+      }
+
+      if (res > 0 && redisBufferRead(redis_sub) != REDIS_OK) {
+        WARNING_LOG() << "REDIS PUB/SUB GET REPLY ERROR: " << redis_sub->errstr;
+        break;
+      }
+      continue;
     }
 
+    last_activity_msec = common::time::current_mstime();
+    ping_sent_msec = 0;  // any reply, pong included, proves connection is alive
+
     bool is_error_reply = lreply->type != REDIS_REPLY_ARRAY || lreply->elements != 3 ||
                           lreply->element[1]->type != REDIS_REPLY_STRING ||
                           lreply->element[2]->type != REDIS_REPLY_STRING;
-    if (is_error_reply) {
+    if (is_error_reply) {  // subscribe confirmations
+      freeReplyObject(lreply);
       continue;
     }
 
@@ -83,50 +192,81 @@ void RedisPubSub::Listen() {
 
     freeReplyObject(lreply);
   }
-
-  freeReplyObject(reply);
-  redisFree(redis_sub);
 }
 
-void RedisPubSub::Stop() {
-  stop_ = true;
+void RedisPubSub::WaitReconnect(uint32_t msec) {
+  std::unique_lock<std::mutex> lock(state_mutex_);
+  stop_cond_.wait_for(lock, std::chrono::milliseconds(msec), [this] { return stop_; });
 }
 
-common::Error RedisPubSub::PublishStateToChannel(const std::string& msg) {
-  return Publish(config_.channel_clients_state, msg);
+bool RedisPubSub::IsStopped() const {
+  std::lock_guard<std::mutex> lock(state_mutex_);
+  return stop_;
 }
 
-common::Error RedisPubSub::PublishToChannelOut(const std::string& msg) {
-  return Publish(config_.channel_out, msg);
+void RedisPubSub::MarkUp() {
+  std::lock_guard<std::mutex> lock(state_mutex_);
+  const common::time64_t now = common::time::current_mstime();
+  if (down_since_msec_) {
+    const common::time64_t lost = now - down_since_msec_;
+    stats_.downtime_msec += lost;
+    INFO_LOG() << "REDIS PUB/SUB resubscribed, external commands were not delivered for " << lost << " msec.";
+  }
+  down_since_msec_ = 0;
+  stats_.subscribed = true;
 }
 
-common::Error RedisPubSub::Publish(const std::string& channel, const std::string& msg) {
-  if (channel.empty() || msg.empty()) {
-    return common::make_error_inval();
+void RedisPubSub::MarkDown() {
+  std::lock_guard<std::mutex> lock(state_mutex_);
+  if (stop_) {
+    return;
   }
 
-  redisContext* redis_sub = NULL;
-  common::Error err = redis_connect(config_, &redis_sub);
-  if (err) {
-    return err;
-  }
+  down_since_msec_ = common::time::current_mstime();
+  stats_.subscribed = false;
+  stats_.lost_intervals++;
+}
 
-  if (channel.empty() || msg.empty()) {
-    return common::make_error_inval();
+RedisPubSub::SubscriberStats RedisPubSub::GetSubscriberStats() const {
+  std::lock_guard<std::mutex> lock(state_mutex_);
+  SubscriberStats stats = stats_;
+  if (down_since_msec_) {  // include current outage
+    stats.downtime_msec += common::time::current_mstime() - down_since_msec_;
   }
+  return stats;
+}
 
-  const char* chn = channel.c_str();
-  const char* m = msg.c_str();
-  void* rreply = redisCommand(redis_sub, "PUBLISH %s %s", chn, m);
-  if (!rreply) {
-    err = common::make_error(redis_sub->errstr);
-    redisFree(redis_sub);
-    return err;
+size_t RedisPubSub::GetPublishBufferedCount() const {
+  return publisher_.GetBufferedMessagesCount();
+}
+
+size_t RedisPubSub::GetPublishDroppedCount() const {
+  return publisher_.GetDroppedMessagesCount();
+}
+
+void RedisPubSub::Publishing() {
+  publisher_.Run();
+}
+
+void RedisPubSub::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(state_mutex_);
+    stop_ = true;
+    stop_cond_.notify_all();
   }
+  publisher_.Stop();
+}
 
-  freeReplyObject(rreply);
-  redisFree(redis_sub);
-  return common::Error();
+common::Error RedisPubSub::PublishStateToChannel(const std::string& msg) {
+  return Publish(config_.channel_clients_state, msg);
+}
+
+common::Error RedisPubSub::PublishToChannelOut(const std::string& msg) {
+  return Publish(config_.channel_out, msg);
+}
+
+common::Error RedisPubSub::Publish(const std::string& channel, const std::string& msg) {
+  return publisher_.Publish(channel, msg);
 }
 
 }  // namespace redis
@@ -18,31 +18,77 @@
 
 #pragma once
 
+#include <condition_variable>
+#include <mutex>
+
 #include <common/error.h>
+#include <common/types.h>  // for time64_t
 
+#include "server/redis/redis_publisher.h"
 #include "server/redis/redis_pub_sub_handler.h"
 #include "server/redis/redis_sub_config.h"
 
+struct redisContext;
+
 namespace fastotv {
 namespace server {
 namespace redis {
 
+// Listen keeps subscriber alive until Stop: broken connection is reopened with exponential backoff
+// and channels are subscribed again, time without subscription is accounted in SubscriberStats.
+// Idle subscription is checked with PING every ping_interval_msec, no answer in ping_timeout_msec
+// means half-open connection and it is reopened as broken one.
 class RedisPubSub {
  public:
+  enum {
+    min_reconnect_timeout_msec = 500,
+    max_reconnect_timeout_msec = 30000,
+    ping_interval_msec = 15000,
+    ping_timeout_msec = 5000,
+    stop_check_msec = 500
+  };
+
+  struct SubscriberStats {
+    SubscriberStats();
+
+    bool subscribed;
+    size_t lost_intervals;           // how many times subscription was broken
+    common::time64_t downtime_msec;  // total time without subscription, including startup
+  };
+
   explicit RedisPubSub(RedisSubHandler* handler);
 
   void SetConfig(const RedisSubConfig& config);
   void Listen();
+  void Publishing();  // body of publisher thread
   void Stop();
 
   common::Error PublishStateToChannel(const std::string& msg) WARN_UNUSED_RESULT;
   common::Error PublishToChannelOut(const std::string& msg) WARN_UNUSED_RESULT;
+  // queues message for publisher thread, thread-safe
   common::Error Publish(const std::string& channel, const std::string& msg) WARN_UNUSED_RESULT;
 
+  SubscriberStats GetSubscriberStats() const;  // thread-safe
+  size_t GetPublishBufferedCount() const;      // thread-safe
+  size_t GetPublishDroppedCount() const;       // thread-safe
+
  private:
+  common::Error Subscribe(redisContext** sub) const WARN_UNUSED_RESULT;
+  void ReadMessages(redisContext* redis_sub);
+  void WaitReconnect(uint32_t msec);
+  bool IsStopped() const;
+  void MarkUp();
+  void MarkDown();
+
   RedisSubHandler* const handler_;
   RedisSubConfig config_;
+  RedisPublisher publisher_;
+
+  mutable std::mutex state_mutex_;
+  std::condition_variable stop_cond_;
   bool stop_;
+  common::time64_t down_since_msec_;  // 0 while subscribed
+  SubscriberStats stats_;
 };
 
 }  // namespace redis
@@ -22,6 +22,8 @@ namespace fastotv {
 namespace server {
 namespace redis {
 
+void RedisSubHandler::HandleResubscribed() {}
+
 RedisSubHandler::~RedisSubHandler() {}
 
 }  // namespace redis
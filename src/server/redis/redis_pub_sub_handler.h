@@ -27,6 +27,8 @@ namespace redis {
 class RedisSubHandler {
  public:
   virtual void HandleMessage(const std::string& channel, const std::string& msg) = 0;
+  // subscription was restored after failure, messages published meanwhile were missed
+  virtual void HandleResubscribed();
   virtual ~RedisSubHandler();
 };
 
@@ -0,0 +1,217 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "server/redis/redis_publisher.h"
+
+#include <stddef.h>  // for NULL
+
+#include <chrono>
+
+#include <hiredis/hiredis.h>  // for redisAppendCommand, redisGetReply
+
+#include <common/logger.h>  // for WARNING_LOG
+
+#include "server/redis/redis_connect.h"
+
+namespace fastotv {
+namespace server {
+namespace redis {
+
+RedisPublisher::RedisPublisher()
+    : mutex_(),
+      queue_cond_(),
+      queue_(),
+      max_buffered_messages_(default_max_buffered_messages),
+      dropped_(0),
+      stop_(false),
+      config_(),
+      context_(NULL) {}
+
+RedisPublisher::~RedisPublisher() {
+  Disconnect();
+}
+
+void RedisPublisher::SetConfig(const RedisConfig& config) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  config_ = config;
+}
+
+void RedisPublisher::SetMaxBufferedMessages(size_t limit) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  max_buffered_messages_ = limit ? limit : 1;
+  DropOverflow();
+}
+
+common::Error RedisPublisher::Publish(const std::string& channel, const std::string& msg) {
+  if (channel.empty() || msg.empty()) {
+    return common::make_error_inval();
+  }
+
+  Message message = {channel, msg};
+  std::lock_guard<std::mutex> lock(mutex_);
+  queue_.push_back(message);
+  DropOverflow();
+  queue_cond_.notify_one();
+  return common::Error();
+}
+
+void RedisPublisher::Run() {
+  while (true) {
+    messages_t batch;
+    if (!TakeBatch(&batch)) {
+      break;
+    }
+
+    common::Error err = context_ ? common::Error() : Connect();
+    if (!err) {
+      err = SendBatch(&batch);
+    }
+
+    if (!err) {
+      continue;
+    }
+
+    WARNING_LOG() << "REDIS PUBLISH ERROR: " << err->GetDescription() << ", " << batch.size()
+                  << " not confirmed message(s) will be resent.";
+    Disconnect();
+    ReturnBatch(&batch);
+    std::unique_lock<std::mutex> lock(mutex_);
+    queue_cond_.wait_for(lock, std::chrono::milliseconds(reconnect_timeout_msec), [this] { return stop_; });
+  }
+
+  // last chance for messages queued before Stop
+  messages_t rest;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    rest.swap(queue_);
+  }
+  if (!context_ && !rest.empty()) {
+    WARNING_LOG() << "Redis publisher stopped without connection, " << rest.size() << " message(s) lost.";
+  }
+  while (context_ && !rest.empty()) {
+    messages_t batch;
+    while (!rest.empty() && batch.size() < max_batch_size) {
+      batch.push_back(rest.front());
+      rest.pop_front();
+    }
+    common::Error err = SendBatch(&batch);
+    if (err) {
+      WARNING_LOG() << "REDIS PUBLISH ERROR: " << err->GetDescription() << ", " << batch.size() + rest.size()
+                    << " message(s) lost on stop.";
+      break;
+    }
+  }
+  Disconnect();
+}
+
+void RedisPublisher::Stop() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  stop_ = true;
+  queue_cond_.notify_all();
+}
+
+size_t RedisPublisher::GetBufferedMessagesCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return queue_.size();
+}
+
+size_t RedisPublisher::GetDroppedMessagesCount() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return dropped_;
+}
+
+bool RedisPublisher::TakeBatch(messages_t* batch) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  queue_cond_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+  if (stop_) {
+    return false;
+  }
+
+  while (!queue_.empty() && batch->size() < max_batch_size) {
+    batch->push_back(queue_.front());
+    queue_.pop_front();
+  }
+  return true;
+}
+
+void RedisPublisher::ReturnBatch(messages_t* batch) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  queue_.insert(queue_.begin(), batch->begin(), batch->end());
+  batch->clear();
+  DropOverflow();
+}
+
+common::Error RedisPublisher::SendBatch(messages_t* batch) {
+  for (const Message& message : *batch) {
+    int res = redisAppendCommand(context_, "PUBLISH %b %b", message.channel.data(), message.channel.size(),
+                                 message.msg.data(), message.msg.size());
+    if (res != REDIS_OK) {
+      return common::make_error("Can't append publish command");
+    }
+  }
+
+  // first redisGetReply writes whole output buffer, replies come in order of commands
+  while (!batch->empty()) {
+    void* reply = NULL;
+    if (redisGetReply(context_, &reply) != REDIS_OK || !reply) {
+      return common::make_error(context_->errstr[0] ? context_->errstr : "Connection lost");
+    }
+
+    freeReplyObject(reply);
+    batch->pop_front();
+  }
+  return common::Error();
+}
+
+common::Error RedisPublisher::Connect() {
+  RedisConfig config;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    config = config_;
+  }
+
+  common::Error err = redis_connect(config, &context_);
+  if (err) {
+    return err;
+  }
+
+  err = redis_set_io_timeout(context_, io_timeout_msec);
+  if (err) {
+    Disconnect();
+    return err;
+  }
+  return common::Error();
+}
+
+void RedisPublisher::Disconnect() {
+  if (context_) {
+    redisFree(context_);
+    context_ = NULL;
+  }
+}
+
+void RedisPublisher::DropOverflow() {
+  while (queue_.size() > max_buffered_messages_) {
+    queue_.pop_front();
+    dropped_++;
+  }
+}
+
+}  // namespace redis
+}  // namespace server
+}  // namespace fastotv
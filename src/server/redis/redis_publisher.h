@@ -0,0 +1,97 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+
+#include <common/error.h>   // for Error
+#include <common/macros.h>  // for WARN_UNUSED_RESULT, DISALLOW_COPY_...
+
+#include "server/redis/redis_sub_config.h"  // for RedisConfig, RedisSubConfig
+
+struct redisContext;
+
+namespace fastotv {
+namespace server {
+namespace redis {
+
+// Thread-safe publisher over one dedicated connection, Publish only queues the message.
+// Run drains the queue on its own thread: everything queued since the previous flush is sent as one
+// pipelined batch of PUBLISH commands and the replies are read afterwards.
+// While Redis is unavailable messages are kept (oldest dropped above max_buffered_messages)
+// and the connection is reopened every reconnect_timeout_msec. If a batch fails midway only messages
+// without read reply are sent again. Socket operations time out after io_timeout_msec, so Stop is not
+// blocked by a hung server.
+class RedisPublisher {
+ public:
+  enum {
+    max_batch_size = 512,
+    default_max_buffered_messages = RedisSubConfig::default_publish_buffer_size,
+    reconnect_timeout_msec = 1000,
+    io_timeout_msec = 5000
+  };
+
+  RedisPublisher();
+  ~RedisPublisher();
+
+  void SetConfig(const RedisConfig& config);
+  void SetMaxBufferedMessages(size_t limit);
+
+  common::Error Publish(const std::string& channel, const std::string& msg) WARN_UNUSED_RESULT;
+
+  void Run();  // blocks until Stop, flushes queued messages on exit if connected
+  void Stop();
+
+  size_t GetBufferedMessagesCount() const;
+  size_t GetDroppedMessagesCount() const;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(RedisPublisher);
+
+  struct Message {
+    std::string channel;
+    std::string msg;
+  };
+  typedef std::deque<Message> messages_t;
+
+  bool TakeBatch(messages_t* batch);
+  void ReturnBatch(messages_t* batch);  // puts messages back in front of the queue
+  // messages are removed from batch as their replies are read, on error batch keeps not confirmed ones
+  common::Error SendBatch(messages_t* batch) WARN_UNUSED_RESULT;
+  common::Error Connect() WARN_UNUSED_RESULT;
+  void Disconnect();
+  void DropOverflow();
+
+  mutable std::mutex mutex_;
+  std::condition_variable queue_cond_;
+  messages_t queue_;
+  size_t max_buffered_messages_;
+  size_t dropped_;
+  bool stop_;
+  RedisConfig config_;
+
+  redisContext* context_;  // used only from Run thread
+};
+
+}  // namespace redis
+}  // namespace server
+}  // namespace fastotv
@@ -19,6 +19,7 @@
 #include "server/redis/redis_storage.h"
 
 #include <stddef.h>  // for NULL
+#include <string.h>  // for strlen
 #include <string>    // for string
 
 #include <hiredis/hiredis.h>  // for redisFree, freeR...
@@ -26,15 +27,17 @@
 #include <common/logger.h>  // for COMPACT_LOG_ERROR
 #include <common/utils.h>
 
-#include "auth_info.h"  // for AuthInfo
+#include "auth_info.h"                // for AuthInfo
+#include "serializer/json_reader.h"  // for JsonReader
+
+#include "server/redis/redis_async_client.h"
 
 #include <json-c/json_object.h>   // for json_object_put
 #include <json-c/json_tokener.h>  // for json_tokener_parse
 
-#include "server/redis/redis_connect.h"
-
 #define GET_USER_1E "GET %s"
 #define GET_CHAT_CHANNELS "GET chat_channels"
+#define GET_EPG "GET epg"
 #define ID_FIELD "id"
 
 namespace fastotv {
@@ -42,6 +45,48 @@ namespace server {
 
 namespace {
 
+#if defined(USE_JSON_READER)
+common::Error parse_user_json(const char* user_json, user_id_t* out_uid, UserInfo* out_info) {
+  if (!user_json || !out_uid || !out_info) {
+    return common::make_error_inval();
+  }
+
+  // mongodb id is not a part of UserInfo, it goes first in stored documents so look ahead is short
+  JsonReader reader(user_json, strlen(user_json));
+  JsonReader id_reader = reader;
+  user_id_t uid;
+  bool id_exists = false;
+  common::Error err = id_reader.EnterObject();
+  std::string key;
+  bool has_next = false;
+  while (!err && !id_exists) {
+    err = id_reader.NextField(&key, &has_next);
+    if (err || !has_next) {
+      break;
+    }
+
+    if (key == ID_FIELD) {
+      id_exists = true;
+      err = id_reader.ReadString(&uid);
+    } else {
+      err = id_reader.SkipValue();
+    }
+  }
+  if (err || !id_exists) {
+    return common::make_error("Can't parse database field");
+  }
+
+  UserInfo uinf;
+  err = UserInfo::DeSerialize(&reader, &uinf);
+  if (err) {
+    return reader.IsFailed() ? common::make_error("Can't parse database field") : err;
+  }
+
+  *out_uid = uid;
+  *out_info = uinf;
+  return common::Error();
+}
+#else
 common::Error parse_user_json(const char* user_json, user_id_t* out_uid, UserInfo* out_info) {
   if (!user_json || !out_uid || !out_info) {
     return common::make_error_inval();
@@ -71,6 +116,7 @@ common::Error parse_user_json(const char* user_json, user_id_t* out_uid, UserInf
   json_object_put(obj);
   return common::Error();
 }
+#endif
 
 common::Error parse_chat_channels_json(const char* channels_json, std::vector<stream_id>* out_info) {
   if (!out_info || !channels_json) {
@@ -94,14 +140,88 @@ common::Error parse_chat_channels_json(const char* channels_json, std::vector<st
   return common::Error();
 }
 
+common::Error parse_epg_json(const char* epg_json, std::vector<EpgInfo>* out_epg) {
+  if (!out_epg || !epg_json) {
+    return common::make_error_inval();
+  }
+
+  json_object* obj = json_tokener_parse(epg_json);
+  if (!obj) {
+    return common::make_error("Can't parse database field");
+  }
+
+  if (!json_object_is_type(obj, json_type_array)) {
+    json_object_put(obj);
+    return common::make_error("Can't parse database field");
+  }
+
+  std::vector<EpgInfo> lepg;
+  size_t len = json_object_array_length(obj);
+  for (size_t i = 0; i < len; ++i) {
+    json_object* jepg = json_object_array_get_idx(obj, i);
+    EpgInfo epg;
+    common::Error err = EpgInfo::DeSerialize(jepg, &epg);
+    if (err) {
+      continue;
+    }
+    lepg.push_back(epg);
+  }
+
+  out_epg->swap(lepg);
+  json_object_put(obj);
+  return common::Error();
+}
+
+common::Error parse_user_reply(const AuthInfo& user, redisReply* reply, user_id_t* out_uid, UserInfo* out_info) {
+  if (!reply) {
+    return common::make_error("Database connection error");
+  }
+
+  if (reply->type != REDIS_REPLY_STRING) {
+    return common::make_error("User not found");
+  }
+
+  UserInfo linfo;
+  user_id_t luid;
+  common::Error err = parse_user_json(reply->str, &luid, &linfo);
+  if (err) {
+    return err;
+  }
+
+  if (user.GetPassword() != linfo.GetPassword()) {
+    return common::make_error("Password missmatch");
+  }
+
+  *out_uid = luid;
+  *out_info = linfo;
+  return common::Error();
+}
+
+common::Error parse_chat_channels_reply(redisReply* reply, std::vector<stream_id>* out_info) {
+  if (!reply) {
+    return common::make_error("Database connection error");
+  }
+
+  if (reply->type == REDIS_REPLY_NIL) {  // no chat channels configured
+    out_info->clear();
+    return common::Error();
+  }
+
+  if (reply->type != REDIS_REPLY_STRING) {
+    return common::make_error("Chat channels not found");
+  }
+
+  return parse_chat_channels_json(reply->str, out_info);
+}
+
 }  // namespace
 
 namespace redis {
 
-RedisStorage::RedisStorage() : config_() {}
+RedisStorage::RedisStorage() : pool_() {}
 
 void RedisStorage::SetConfig(const RedisConfig& config) {
-  config_ = config;
+  pool_.SetConfig(config);
 }
 
 common::Error RedisStorage::FindUserAuth(const AuthInfo& user, user_id_t* uid) const {
@@ -114,74 +234,94 @@ common::Error RedisStorage::FindUser(const AuthInfo& user, user_id_t* uid, UserI
     return common::make_error_inval();
   }
 
-  redisContext* redis = NULL;
-  common::Error err = redis_connect(config_, &redis);
+  std::string login = user.GetLogin();
+  const char* login_str = login.c_str();
+  redisReply* reply = NULL;
+  common::Error err = pool_.ExecCommand(&reply, GET_USER_1E, login_str);
   if (err) {
     return err;
   }
 
-  std::string login = user.GetLogin();
-  const char* login_str = login.c_str();
-  redisReply* reply = reinterpret_cast<redisReply*>(redisCommand(redis, GET_USER_1E, login_str));
-  if (!reply) {
-    redisFree(redis);
-    return common::make_error("User not found");
+  err = parse_user_reply(user, reply, uid, uinf);
+  freeReplyObject(reply);
+  return err;
+}
+
+common::Error RedisStorage::GetChatChannels(std::vector<stream_id>* channels) const {
+  if (!channels) {
+    return common::make_error_inval();
   }
 
-  const char* user_json = reply->str;
-  UserInfo linfo;
-  user_id_t luid;
-  err = parse_user_json(user_json, &luid, &linfo);
+  redisReply* reply = NULL;
+  common::Error err = pool_.ExecCommand(&reply, GET_CHAT_CHANNELS);
   if (err) {
-    freeReplyObject(reply);
-    redisFree(redis);
     return err;
   }
 
-  std::string pass = linfo.GetPassword();
-  if (user.GetPassword() != pass) {
-    freeReplyObject(reply);
-    redisFree(redis);
-    return common::make_error("Password missmatch");
-  }
-
-  *uid = luid;
-  *uinf = linfo;
+  err = parse_chat_channels_reply(reply, channels);
   freeReplyObject(reply);
-  redisFree(redis);
-  return common::Error();
+  return err;
 }
 
-common::Error RedisStorage::GetChatChannels(std::vector<stream_id>* channels) const {
-  if (!channels) {
+common::Error RedisStorage::GetEpg(std::vector<EpgInfo>* epg) const {
+  if (!epg) {
     return common::make_error_inval();
   }
 
-  redisContext* redis = NULL;
-  common::Error err = redis_connect(config_, &redis);
+  redisReply* reply = NULL;
+  common::Error err = pool_.ExecCommand(&reply, GET_EPG);
   if (err) {
     return err;
   }
 
-  redisReply* reply = reinterpret_cast<redisReply*>(redisCommand(redis, GET_CHAT_CHANNELS));
-  if (!reply) {
-    redisFree(redis);
-    return common::make_error("User not found");
+  if (reply->type == REDIS_REPLY_NIL) {  // guide is served from file only
+    freeReplyObject(reply);
+    epg->clear();
+    return common::Error();
   }
 
-  const char* channels_json = reply->str;
-  std::vector<stream_id> lchannels;
-  err = parse_chat_channels_json(channels_json, &lchannels);
-  if (err) {
+  if (reply->type != REDIS_REPLY_STRING) {
     freeReplyObject(reply);
-    redisFree(redis);
-    return err;
+    return common::make_error("EPG not found");
   }
 
-  *channels = lchannels;
+  err = parse_epg_json(reply->str, epg);
   freeReplyObject(reply);
-  redisFree(redis);
-  return common::Error();
+  return err;
+}
+
+common::Error RedisStorage::FindUserAsync(RedisAsyncClient* client,
+                                          const AuthInfo& user,
+                                          const void* owner,
+                                          find_user_callback_t cb) const {
+  if (!client || !user.IsValid() || !cb) {
+    return common::make_error_inval();
+  }
+
+  std::string login = user.GetLogin();
+  const char* login_str = login.c_str();
+  auto reply_cb = [user, cb](redisReply* reply) {
+    user_id_t uid;
+    UserInfo uinf;
+    common::Error err = parse_user_reply(user, reply, &uid, &uinf);
+    cb(err, uid, uinf);
+  };
+  return client->ExecCommand(owner, reply_cb, GET_USER_1E, login_str);
+}
+
+common::Error RedisStorage::GetChatChannelsAsync(RedisAsyncClient* client,
+                                                 const void* owner,
+                                                 chat_channels_callback_t cb) const {
+  if (!client || !cb) {
+    return common::make_error_inval();
+  }
+
+  auto reply_cb = [cb](redisReply* reply) {
+    std::vector<stream_id> channels;
+    common::Error err = parse_chat_channels_reply(reply, &channels);
+    cb(err, channels);
+  };
+  return client->ExecCommand(owner, reply_cb, GET_CHAT_CHANNELS);
 }
 
 }  // namespace redis
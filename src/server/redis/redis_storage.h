@@ -18,22 +18,32 @@
 
 #pragma once
 
+#include <functional>
 #include <string>  // for string
 
 #include <common/error.h>      // for Error
 #include <common/net/types.h>  // for HostAndPort
 
 #include "auth_info.h"
+#include "epg_info.h"
 #include "server/user_info.h"  // for user_id_t, UserInfo (ptr only)
 
 #include "server/redis/redis_config.h"
+#include "server/redis/redis_pool.h"
+
+struct redisReply;
 
 namespace fastotv {
 namespace server {
 namespace redis {
 
+class RedisAsyncClient;
+
 class RedisStorage {
  public:
+  typedef std::function<void(common::Error err, const user_id_t& uid, const UserInfo& uinf)> find_user_callback_t;
+  typedef std::function<void(common::Error err, const std::vector<stream_id>& channels)> chat_channels_callback_t;
+
   RedisStorage();
   void SetConfig(const RedisConfig& config);
 
@@ -43,9 +53,20 @@ class RedisStorage {
                          UserInfo* uinf) const WARN_UNUSED_RESULT;  // check password
 
   common::Error GetChatChannels(std::vector<stream_id>* channels) const;
+  // json array of EpgInfo in "epg" key, empty if no key
+  common::Error GetEpg(std::vector<EpgInfo>* epg) const WARN_UNUSED_RESULT;
+
+  // non-blocking versions, callbacks are called from loop of client
+  common::Error FindUserAsync(RedisAsyncClient* client,
+                              const AuthInfo& user,
+                              const void* owner,
+                              find_user_callback_t cb) const WARN_UNUSED_RESULT;  // check password
+  common::Error GetChatChannelsAsync(RedisAsyncClient* client,
+                                     const void* owner,
+                                     chat_channels_callback_t cb) const WARN_UNUSED_RESULT;
 
  private:
-  RedisConfig config_;
+  mutable RedisPool pool_;
 };
 
 }  // namespace redis
@@ -27,9 +27,23 @@ namespace server {
 namespace redis {
 
 struct RedisSubConfig : public RedisConfig {
+  enum { default_publish_buffer_size = 10000 };
+
+  RedisSubConfig()
+      : RedisConfig(),
+        channel_in(),
+        channel_out(),
+        channel_clients_state(),
+        channel_users_changed(),
+        channel_epg_changed(),
+        publish_buffer_size(default_publish_buffer_size) {}
+
   std::string channel_in;
   std::string channel_out;
   std::string channel_clients_state;
+  std::string channel_users_changed;  // logins of updated users
+  std::string channel_epg_changed;    // programme guide was updated
+  size_t publish_buffer_size;         // messages kept while Redis is unavailable, oldest are dropped above
 };
 }  // namespace redis
 }  // namespace server
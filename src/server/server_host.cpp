@@ -22,89 +22,298 @@
 
 #include <string>  // for string
 
-#include <common/libev/tcp/tcp_server.h>    // for TcpServer
+#include <common/convert2string.h>          // for ConvertToString
 #include <common/logger.h>                  // for COMPACT_LOG_FILE_CRIT
 #include <common/threads/thread_manager.h>  // for THREAD_MANAGER
+#include <common/time.h>                    // for current_utc_mstime
 
-#include "inner/inner_tcp_client.h"  // for InnerTcpClient
+#include "epg/epg_file.h"  // for EpgFile, IngestXmltv
 
-#include "server/inner/inner_tcp_handler.h"  // for InnerTcpHandlerHost
+#include "server/inner/inner_external_notifier.h"  // for InnerSubHandler
+#include "server/inner/inner_tcp_handler.h"        // for InnerTcpHandlerHost
 #include "server/inner/inner_tcp_server.h"
 
-#define BUF_SIZE 4096
-#define UNKNOWN_CLIENT_NAME "Unknown"
+#include "server/metrics_server.h"
+#include "server/redis/redis_pub_sub.h"
+
+#define LISTEN_BACKLOG 128
+#define EPG_KEEP_HISTORY_MSEC (24 * 3600 * 1000)  // of previous guide on re-ingest
 
 namespace fastotv {
 namespace server {
 
-ServerHost::ServerHost(const Config& config) : handler_(nullptr), server_(nullptr), rstorage_(), config_(config) {
-  handler_ = new inner::InnerTcpHandlerHost(this, config);
-  server_ = new inner::InnerTcpServer(config.server.host, true, handler_);
-  server_->SetName("inner_server");
+ServerHost::ServerHost(const Config& config)
+    : handlers_(),
+      servers_(),
+      workers_threads_(),
+      sub_commands_in_(nullptr),
+      sub_handler_(nullptr),
+      redis_subscribe_command_in_thread_(),
+      redis_publish_thread_(),
+      metrics_(),
+      metrics_server_(nullptr),
+      metrics_thread_(),
+      devices_(),
+      devices_mutex_(),
+      watchers_(),
+      watchers_mutex_(),
+      chat_history_(),
+      chat_history_mutex_(),
+      rstorage_(),
+      user_cache_(),
+      channels_versions_(),
+      channels_responces_(),
+      epg_store_(),
+      epg_load_mutex_(),
+      epg_reload_thread_(),
+      epg_reload_mutex_(),
+      epg_reload_cond_(),
+      epg_reload_requested_(false),
+      epg_reload_stop_(false),
+      config_(config) {
+  chat_history_.SetLimits(config.server.chat_history_size, config.server.chat_history_budget);
+  const size_t workers = config.server.workers ? config.server.workers : 1;
+  for (size_t i = 0; i < workers; ++i) {
+    inner::InnerTcpHandlerHost* handler = new inner::InnerTcpHandlerHost(this, config);
+    inner::InnerTcpServer* server = new inner::InnerTcpServer(config.server.host, handler);
+    server->SetName("inner_server_" + common::ConvertToString(i));
+    handlers_.push_back(handler);
+    servers_.push_back(server);
+  }
 
   rstorage_.SetConfig(config.server.redis);
+  user_cache_.SetLimits(config.server.user_cache_size, config.server.user_cache_ttl);
+
+  // ingesting a guide takes seconds, it must not hold up the subscriber which requests it
+  epg_reload_thread_ = THREAD_MANAGER()->CreateThread(&ServerHost::EpgReloadLoop, this);
+  if (!epg_reload_thread_->Start()) {
+    WARNING_LOG() << "Don't started programme guide thread, guide is reloaded in place.";
+    epg_reload_thread_.reset();
+  }
+
+  sub_handler_ = new inner::InnerSubHandler(this, config.server.redis.channel_users_changed,
+                                            config.server.redis.channel_epg_changed);
+  sub_commands_in_ = new redis::RedisPubSub(sub_handler_);
+  sub_commands_in_->SetConfig(config.server.redis);
+  redis_subscribe_command_in_thread_ = THREAD_MANAGER()->CreateThread(&redis::RedisPubSub::Listen, sub_commands_in_);
+  bool result = redis_subscribe_command_in_thread_->Start();
+  if (!result) {
+    WARNING_LOG() << "Don't started listen thread for external commands.";
+  }
+
+  redis_publish_thread_ = THREAD_MANAGER()->CreateThread(&redis::RedisPubSub::Publishing, sub_commands_in_);
+  result = redis_publish_thread_->Start();
+  if (!result) {
+    WARNING_LOG() << "Don't started publish thread.";
+  }
+
+  if (config.server.metrics_host.IsValid()) {
+    redis::RedisPubSub* pub_sub = sub_commands_in_;
+    metrics_.AddSampledValue("fastotv_redis_publish_buffered_messages", "gauge",
+                             "Messages waiting for Redis publisher connection.",
+                             [pub_sub]() { return pub_sub->GetPublishBufferedCount(); });
+    metrics_.AddSampledValue("fastotv_redis_publish_dropped_messages_total", "counter",
+                             "Oldest messages dropped over redis_publish_buffer_size.",
+                             [pub_sub]() { return pub_sub->GetPublishDroppedCount(); });
+    metrics_.AddSampledValue("fastotv_redis_subscribed", "gauge", "1 while external commands channel is subscribed.",
+                             [pub_sub]() { return pub_sub->GetSubscriberStats().subscribed ? 1 : 0; });
+    metrics_.AddSampledValue("fastotv_redis_subscription_lost_total", "counter",
+                             "Times the subscription was broken and reopened.",
+                             [pub_sub]() { return pub_sub->GetSubscriberStats().lost_intervals; });
+    metrics_.AddSampledValue("fastotv_redis_subscription_downtime_milliseconds_total", "counter",
+                             "Time without subscription, external commands are lost meanwhile.",
+                             [pub_sub]() { return pub_sub->GetSubscriberStats().downtime_msec; });
+    metrics_server_ = new MetricsServer(config.server.metrics_host, &metrics_);
+    common::Error err = metrics_server_->Bind();
+    if (err) {
+      WARNING_LOG() << "Metrics endpoint disabled: " << err->GetDescription();
+    } else {
+      metrics_thread_ = THREAD_MANAGER()->CreateThread(&MetricsServer::Run, metrics_server_);
+      if (!metrics_thread_->Start()) {
+        WARNING_LOG() << "Don't started metrics thread.";
+        metrics_thread_.reset();
+      }
+    }
+  }
 }
 
 ServerHost::~ServerHost() {
-  destroy(&server_);
-  destroy(&handler_);
+  sub_commands_in_->Stop();
+  redis_subscribe_command_in_thread_->Join();
+  redis_publish_thread_->Join();
+  if (epg_reload_thread_) {
+    {
+      std::lock_guard<std::mutex> lock(epg_reload_mutex_);
+      epg_reload_stop_ = true;
+    }
+    epg_reload_cond_.notify_one();
+    epg_reload_thread_->Join();
+  }
+  if (metrics_server_) {
+    metrics_server_->Stop();
+    if (metrics_thread_) {
+      metrics_thread_->Join();
+    }
+    delete metrics_server_;
+  }
+  delete sub_commands_in_;
+  delete sub_handler_;
+
+  for (inner::InnerTcpServer* server : servers_) {
+    delete server;
+  }
+  for (inner::InnerTcpHandlerHost* handler : handlers_) {
+    delete handler;
+  }
 }
 
 void ServerHost::Stop() {
-  server_->Stop();
+  for (inner::InnerTcpServer* server : servers_) {
+    server->Stop();
+  }
 }
 
 int ServerHost::Exec() {
-  common::ErrnoError err = server_->Bind(true);
+  common::Error err = ReloadEpg();
   if (err) {
-    DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
-    return EXIT_FAILURE;
+    WARNING_LOG() << "Programme guide not loaded: " << err->GetDescription();
   }
 
-  err = server_->Listen(5);
-  if (err) {
-    DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
-    return EXIT_FAILURE;
+  for (inner::InnerTcpServer* server : servers_) {
+    err = server->Listen(LISTEN_BACKLOG);
+    if (err) {
+      DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_ERR);
+      return EXIT_FAILURE;
+    }
   }
 
-  return server_->Exec();
+  // first worker runs in the caller thread
+  for (size_t i = 1; i < servers_.size(); ++i) {
+    auto worker = THREAD_MANAGER()->CreateThread(&inner::InnerTcpServer::Exec, servers_[i]);
+    bool result = worker->Start();
+    if (!result) {
+      // kernel keeps balancing connections to every SO_REUSEPORT socket, nobody would accept on this one
+      WARNING_LOG() << "Can't start worker thread for " << servers_[i]->GetFormatedName() << ", closing its listener";
+      servers_[i]->CloseListener();
+      continue;
+    }
+    workers_threads_.push_back(worker);
+  }
+
+  int res = servers_[0]->Exec();
+  Stop();
+  for (auto worker : workers_threads_) {
+    worker->Join();
+  }
+  workers_threads_.clear();
+  return res;
 }
 
-common::Error ServerHost::UnRegisterInnerConnectionByHost(common::libev::IoClient* connection) {
-  inner::InnerTcpClient* iconnection = static_cast<inner::InnerTcpClient*>(connection);
-  if (!iconnection) {
-    DNOTREACHED();
+common::Error ServerHost::RegisterDevice(user_id_t user_id, device_id_t dev, inner::InnerTcpHandlerHost* owner) {
+  if (user_id.empty() || !owner) {
     return common::make_error_inval();
   }
 
-  user_id_t uid = iconnection->GetUid();
-  if (uid.empty()) {
-    return common::make_error_inval();
+  std::lock_guard<std::mutex> lock(devices_mutex_);
+  devices_owners_type& devices = devices_[user_id];
+  if (devices.find(dev) != devices.end()) {
+    return common::make_error("Double connection reject");
   }
 
-  connections_.erase(uid);
+  devices[dev] = owner;
   return common::Error();
 }
 
-common::Error ServerHost::RegisterInnerConnectionByUser(user_id_t user_id,
-                                                        const AuthInfo& user,
-                                                        common::libev::IoClient* connection) {
-  CHECK(user.IsValid());
-  inner::InnerTcpClient* iconnection = static_cast<inner::InnerTcpClient*>(connection);
-  if (!iconnection) {
-    DNOTREACHED();
+common::Error ServerHost::UnRegisterDevice(user_id_t user_id, device_id_t dev, inner::InnerTcpHandlerHost* owner) {
+  std::lock_guard<std::mutex> lock(devices_mutex_);
+  inner_devices_type::iterator hs = devices_.find(user_id);
+  if (hs == devices_.end()) {
     return common::make_error_inval();
   }
 
-  iconnection->SetServerHostInfo(user);
-  iconnection->SetUid(user_id);
+  devices_owners_type& devices = hs->second;
+  devices_owners_type::iterator it = devices.find(dev);
+  if (it == devices.end() || it->second != owner) {
+    return common::make_error_inval();
+  }
 
-  login_t login = user.GetLogin();
-  connections_[user_id].push_back(iconnection);
-  connection->SetName(login);
+  devices.erase(it);
+  if (devices.empty()) {
+    devices_.erase(hs);
+  }
   return common::Error();
 }
 
+inner::InnerTcpHandlerHost* ServerHost::FindDeviceOwner(user_id_t user_id, device_id_t dev) const {
+  std::lock_guard<std::mutex> lock(devices_mutex_);
+  inner_devices_type::const_iterator hs = devices_.find(user_id);
+  if (hs == devices_.end()) {
+    return nullptr;
+  }
+
+  devices_owners_type::const_iterator it = hs->second.find(dev);
+  if (it == hs->second.end()) {
+    return nullptr;
+  }
+  return it->second;
+}
+
+void ServerHost::ChangeStreamWatcher(stream_id prev, stream_id next) {
+  if (prev == next) {
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(watchers_mutex_);
+  if (prev != invalid_stream_id) {
+    auto it = watchers_.find(prev);
+    if (it != watchers_.end() && --it->second == 0) {
+      watchers_.erase(it);
+    }
+  }
+
+  if (next != invalid_stream_id) {
+    watchers_[next]++;
+  }
+}
+
+size_t ServerHost::GetStreamWatchersCount(stream_id sid) const {
+  std::lock_guard<std::mutex> lock(watchers_mutex_);
+  auto it = watchers_.find(sid);
+  if (it == watchers_.end()) {
+    return 0;
+  }
+  return it->second;
+}
+
+void ServerHost::BroadcastChatMessage(inner::InnerTcpHandlerHost* from,
+                                      const ChatMessage& msg,
+                                      const fastotv::inner::InnerClient::frame_t& frame,
+                                      const fastotv::inner::InnerClient::frame_t& binary_frame) {
+  for (inner::InnerTcpHandlerHost* handler : handlers_) {
+    if (handler != from) {
+      handler->PostChatMessage(msg, frame, binary_frame);
+    }
+  }
+}
+
+void ServerHost::AddChatHistory(const ChatMessage& msg) {
+  std::lock_guard<std::mutex> lock(chat_history_mutex_);
+  chat_history_.Add(msg);
+}
+
+inner::ChatHistory::messages_t ServerHost::GetChatHistory(stream_id sid) const {
+  std::lock_guard<std::mutex> lock(chat_history_mutex_);
+  return chat_history_.GetMessages(sid);
+}
+
+common::Error ServerHost::PublishToChannelOut(const std::string& msg) {
+  return sub_commands_in_->PublishToChannelOut(msg);
+}
+
+common::Error ServerHost::PublishStateToChannel(const std::string& msg) {
+  return sub_commands_in_->PublishStateToChannel(msg);
+}
+
 common::Error ServerHost::FindUserAuth(const AuthInfo& user, user_id_t* uid) const {
   return rstorage_.FindUserAuth(user, uid);
 }
@@ -117,20 +326,185 @@ common::Error ServerHost::GetChatChannels(std::vector<stream_id>* channels) cons
   return rstorage_.GetChatChannels(channels);
 }
 
-inner::InnerTcpClient* ServerHost::FindInnerConnectionByUserIDAndDeviceID(user_id_t user_id, device_id_t dev) const {
-  inner_connections_type::const_iterator hs = connections_.find(user_id);
-  if (hs == connections_.end()) {
-    return nullptr;
+common::Error ServerHost::FindUserAsync(redis::RedisAsyncClient* client,
+                                        const AuthInfo& auth,
+                                        const void* owner,
+                                        find_user_callback_t cb) {
+  if (!auth.IsValid() || !cb) {
+    return common::make_error_inval();
+  }
+
+  user_id_t uid;
+  user_info_ptr_t uinf;
+  if (user_cache_.Find(auth.GetLogin(), &uid, &uinf)) {
+    if (auth.GetPassword() == uinf->GetPassword()) {
+      cb(common::Error(), uid, uinf);
+      return common::Error();
+    }
+
+    user_cache_.Invalidate(auth.GetLogin());  // password can be changed, recheck in database
   }
 
-  auto devices = (*hs).second;
-  for (inner::InnerTcpClient* connected_device : devices) {
-    AuthInfo uinf = connected_device->GetServerHostInfo();
-    if (uinf.GetDeviceID() == dev) {
-      return connected_device;
+  return FindUserInStorage(client, auth, owner, cb, find_user_attempts);
+}
+
+common::Error ServerHost::FindUserInStorage(redis::RedisAsyncClient* client,
+                                            const AuthInfo& auth,
+                                            const void* owner,
+                                            find_user_callback_t cb,
+                                            size_t attempts) {
+  const UserInfoCache::epoch_t epoch = user_cache_.GetEpoch();
+  const uint64_t start_usec = ServerMetrics::NowUsec();
+  auto store_cb = [this, client, auth, owner, cb, attempts, start_usec, epoch](
+                      common::Error err, const user_id_t& uid, const UserInfo& uinf) {
+    metrics_.ObserveRedisCall(ServerMetrics::REDIS_FIND_USER, start_usec);
+    if (err) {
+      cb(err, uid, user_info_ptr_t());
+      return;
     }
+
+    user_info_ptr_t shared_uinf = std::make_shared<const UserInfo>(uinf);
+    if (user_cache_.Insert(uid, shared_uinf, epoch)) {
+      cb(err, uid, shared_uinf);
+      return;
+    }
+
+    // invalidated meanwhile, found user can be older than the change, read it again
+    err = attempts > 1 ? FindUserInStorage(client, auth, owner, cb, attempts - 1)
+                       : common::make_error("User was changed during lookup");
+    if (err) {
+      cb(err, uid, user_info_ptr_t());
+    }
+  };
+  return rstorage_.FindUserAsync(client, auth, owner, store_cb);
+}
+
+common::Error ServerHost::GetChatChannelsAsync(redis::RedisAsyncClient* client,
+                                               const void* owner,
+                                               redis::RedisStorage::chat_channels_callback_t cb) const {
+  if (!cb) {
+    return common::make_error_inval();
   }
-  return nullptr;
+
+  const uint64_t start_usec = ServerMetrics::NowUsec();
+  auto observe_cb = [this, cb, start_usec](common::Error err, const std::vector<stream_id>& channels) {
+    metrics_.ObserveRedisCall(ServerMetrics::REDIS_GET_CHAT_CHANNELS, start_usec);
+    cb(err, channels);
+  };
+  return rstorage_.GetChatChannelsAsync(client, owner, observe_cb);
+}
+
+void ServerHost::InvalidateUser(const login_t& login) {
+  user_cache_.Invalidate(login);
+  for (inner::InnerTcpHandlerHost* handler : handlers_) {
+    handler->ResetUserInfo(login);
+  }
+}
+
+ServerMetrics* ServerHost::GetMetrics() {
+  return &metrics_;
+}
+
+void ServerHost::InvalidateUsers() {
+  user_cache_.Clear();
+  channels_responces_.Clear();
+}
+
+common::Error ServerHost::GetChannelsResponce(user_info_ptr_t user,
+                                              bool without_programmes,
+                                              ChannelsResponceCache::body_ptr_t* body) {
+  return channels_responces_.Get(user, without_programmes, body);
+}
+
+ChannelsDeltaInfo ServerHost::MakeChannelsDelta(const login_t& login,
+                                                const channels_version_t& client_version,
+                                                const ChannelsResponceCache::Body& body) {
+  return channels_versions_.MakeDelta(login, client_version, body.list, body.version, body.snapshot);
+}
+
+common::Error ServerHost::ReloadEpg() {
+  std::lock_guard<std::mutex> lock(epg_load_mutex_);
+  if (!config_.server.epg_path.empty()) {
+    common::Error err = ReloadEpgFile();
+    if (err) {
+      WARNING_LOG() << "Programme guide file not loaded: " << err->GetDescription();
+    }
+  }
+
+  std::vector<EpgInfo> epg;
+  const uint64_t start_usec = ServerMetrics::NowUsec();
+  common::Error err = rstorage_.GetEpg(&epg);
+  metrics_.ObserveRedisCall(ServerMetrics::REDIS_GET_EPG, start_usec);
+  if (err) {
+    return err;
+  }
+
+  epg_store_.Load(epg);
+  INFO_LOG() << "Programme guide loaded, channels: " << epg_store_.GetChannelsCount()
+             << ", programmes: " << epg_store_.GetProgrammesCount();
+  return common::Error();
+}
+
+void ServerHost::RequestEpgReload() {
+  if (!epg_reload_thread_) {
+    common::Error err = ReloadEpg();
+    if (err) {
+      DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_WARNING);
+    }
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(epg_reload_mutex_);
+    epg_reload_requested_ = true;
+  }
+  epg_reload_cond_.notify_one();
+}
+
+void ServerHost::EpgReloadLoop() {
+  std::unique_lock<std::mutex> lock(epg_reload_mutex_);
+  while (true) {
+    epg_reload_cond_.wait(lock, [this] { return epg_reload_requested_ || epg_reload_stop_; });
+    if (epg_reload_stop_) {
+      return;
+    }
+
+    epg_reload_requested_ = false;
+    lock.unlock();
+    common::Error err = ReloadEpg();
+    if (err) {
+      DEBUG_MSG_ERROR(err, common::logging::LOG_LEVEL_WARNING);
+    }
+    lock.lock();
+  }
+}
+
+common::Error ServerHost::ReloadEpgFile() {
+  const std::string& epg_path = config_.server.epg_path;
+  const std::string& xmltv_path = config_.server.xmltv_path;
+  if (!xmltv_path.empty()) {
+    const timestamp_t keep_from = common::time::current_utc_mstime() - EPG_KEEP_HISTORY_MSEC;
+    bool updated = false;
+    common::Error err = epg::IngestXmltv(xmltv_path, epg_path, keep_from, &updated);
+    if (err) {  // previous file is still good
+      WARNING_LOG() << "XMLTV guide " << xmltv_path << " not ingested: " << err->GetDescription();
+    } else if (updated) {
+      INFO_LOG() << "XMLTV guide " << xmltv_path << " ingested into " << epg_path;
+    }
+  }
+
+  std::shared_ptr<epg::EpgFile> file = std::make_shared<epg::EpgFile>();
+  common::Error err = file->Open(epg_path);
+  if (err) {
+    return err;
+  }
+
+  epg_store_.SetFile(file);
+  return common::Error();
+}
+
+const EpgStore* ServerHost::GetEpgStore() const {
+  return &epg_store_;
 }
 
 }  // namespace server
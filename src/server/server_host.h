@@ -18,35 +18,60 @@
 
 #pragma once
 
+#include <condition_variable>
+#include <functional>
+#include <memory>  // for shared_ptr
+#include <mutex>
 #include <unordered_map>
+#include <vector>
 
 #include <common/error.h>   // for Error
 #include <common/macros.h>  // for WARN_UNUSED_RESULT, DISALLOW_COPY_...
 
+#include "inner/inner_client.h"  // for InnerClient::frame_t
+
 #include "redis/redis_storage.h"
 
-#include "server/config.h"     // for Config
-#include "server/user_info.h"  // for user_id_t, UserInfo (ptr only)
+#include "server/channels_responce_cache.h"  // for ChannelsResponceCache
+#include "server/channels_versions.h"         // for ChannelsVersions
+#include "server/config.h"              // for Config
+#include "server/epg_store.h"           // for EpgStore
+#include "server/inner/chat_history.h"  // for ChatHistory
+#include "server/server_metrics.h"      // for ServerMetrics
+#include "server/user_info.h"           // for user_id_t, UserInfo (ptr only)
+#include "server/user_info_cache.h"     // for UserInfoCache
+
+#include "chat_message.h"  // for ChatMessage
 
 namespace common {
-namespace libev {
-class IoClient;
+namespace threads {
+template <typename RT>
+class Thread;
 }
 }  // namespace common
 
 namespace fastotv {
 class AuthInfo;
 namespace server {
+namespace redis {
+class RedisPubSub;
+}
 namespace inner {
-class InnerTcpClient;
+class InnerSubHandler;
 class InnerTcpHandlerHost;
 class InnerTcpServer;
 }  // namespace inner
+class MetricsServer;
 
 class ServerHost {
  public:
-  enum { timeout_seconds = 1 };
-  typedef std::unordered_map<user_id_t, std::vector<inner::InnerTcpClient*>> inner_connections_type;
+  enum {
+    timeout_seconds = 1,
+    find_user_attempts = 3  // lookups of user changed meanwhile are repeated, then fail
+  };
+  typedef std::unordered_map<device_id_t, inner::InnerTcpHandlerHost*> devices_owners_type;
+  typedef std::unordered_map<user_id_t, devices_owners_type> inner_devices_type;
+  typedef std::function<void(common::Error err, const user_id_t& uid, user_info_ptr_t uinf)> find_user_callback_t;
 
   explicit ServerHost(const Config& config);
   ~ServerHost();
@@ -54,25 +79,105 @@ class ServerHost {
   void Stop();
   int Exec();
 
-  common::Error UnRegisterInnerConnectionByHost(common::libev::IoClient* connection) WARN_UNUSED_RESULT;
-  common::Error RegisterInnerConnectionByUser(user_id_t user_id,
-                                              const AuthInfo& user,
-                                              common::libev::IoClient* connection) WARN_UNUSED_RESULT;
+  // registry of connected devices across all workers, thread-safe
+  common::Error RegisterDevice(user_id_t user_id,
+                               device_id_t dev,
+                               inner::InnerTcpHandlerHost* owner) WARN_UNUSED_RESULT;  // fails if already connected
+  common::Error UnRegisterDevice(user_id_t user_id, device_id_t dev, inner::InnerTcpHandlerHost* owner) WARN_UNUSED_RESULT;
+  inner::InnerTcpHandlerHost* FindDeviceOwner(user_id_t user_id, device_id_t dev) const;
+
+  // watchers of streams summed over all workers, thread-safe
+  void ChangeStreamWatcher(stream_id prev, stream_id next);
+  size_t GetStreamWatchersCount(stream_id sid) const;
+
+  // delivers chat message already encoded as command to watchers of its stream on other workers
+  void BroadcastChatMessage(inner::InnerTcpHandlerHost* from,
+                            const ChatMessage& msg,
+                            const fastotv::inner::InnerClient::frame_t& frame,
+                            const fastotv::inner::InnerClient::frame_t& binary_frame);
+  // last chat messages of official channels shared by all workers, thread-safe
+  void AddChatHistory(const ChatMessage& msg);
+  inner::ChatHistory::messages_t GetChatHistory(stream_id sid) const;
+
+  common::Error PublishToChannelOut(const std::string& msg) WARN_UNUSED_RESULT;
+  common::Error PublishStateToChannel(const std::string& msg) WARN_UNUSED_RESULT;
+
   common::Error FindUserAuth(const AuthInfo& user, user_id_t* uid) const WARN_UNUSED_RESULT;
   common::Error FindUser(const AuthInfo& auth, user_id_t* uid, UserInfo* uinf) const WARN_UNUSED_RESULT;
 
   common::Error GetChatChannels(std::vector<stream_id>* channels) const WARN_UNUSED_RESULT;
 
-  inner::InnerTcpClient* FindInnerConnectionByUserIDAndDeviceID(user_id_t user_id, device_id_t dev) const;
+  // served from users cache if possible, callback never gets user which was invalidated during lookup
+  common::Error FindUserAsync(redis::RedisAsyncClient* client,
+                              const AuthInfo& auth,
+                              const void* owner,
+                              find_user_callback_t cb) WARN_UNUSED_RESULT;
+  common::Error GetChatChannelsAsync(redis::RedisAsyncClient* client,
+                                     const void* owner,
+                                     redis::RedisStorage::chat_channels_callback_t cb) const WARN_UNUSED_RESULT;
+  void InvalidateUser(const login_t& login);  // thread-safe
+  void InvalidateUsers();                     // thread-safe
+
+  ServerMetrics* GetMetrics();  // thread-safe
+
+  // serialized channels of user, shared by users with the same list, thread-safe
+  common::Error GetChannelsResponce(user_info_ptr_t user,
+                                    bool without_programmes,
+                                    ChannelsResponceCache::body_ptr_t* body) WARN_UNUSED_RESULT;
+  // answer on versioned get_channels of user with channels of body, thread-safe
+  ChannelsDeltaInfo MakeChannelsDelta(const login_t& login,
+                                      const channels_version_t& client_version,
+                                      const ChannelsResponceCache::Body& body);
+
+  // programme guide from "epg" key of redis and epg file (ingesting updated xmltv first), blocking,
+  // old guide is kept on errors
+  common::Error ReloadEpg() WARN_UNUSED_RESULT;
+  // ReloadEpg in background thread, requests made while it runs are coalesced into one, thread-safe
+  void RequestEpgReload();
+  const EpgStore* GetEpgStore() const;  // thread-safe
 
  private:
   DISALLOW_COPY_AND_ASSIGN(ServerHost);
 
-  inner::InnerTcpHandlerHost* handler_;
-  inner::InnerTcpServer* server_;
-
-  inner_connections_type connections_;
+  common::Error ReloadEpgFile() WARN_UNUSED_RESULT;
+  common::Error FindUserInStorage(redis::RedisAsyncClient* client,
+                                  const AuthInfo& auth,
+                                  const void* owner,
+                                  find_user_callback_t cb,
+                                  size_t attempts) WARN_UNUSED_RESULT;
+  void EpgReloadLoop();
+
+  std::vector<inner::InnerTcpHandlerHost*> handlers_;
+  std::vector<inner::InnerTcpServer*> servers_;
+  std::vector<std::shared_ptr<common::threads::Thread<int>>> workers_threads_;
+
+  redis::RedisPubSub* sub_commands_in_;
+  inner::InnerSubHandler* sub_handler_;
+  std::shared_ptr<common::threads::Thread<void>> redis_subscribe_command_in_thread_;
+  std::shared_ptr<common::threads::Thread<void>> redis_publish_thread_;
+
+  mutable ServerMetrics metrics_;  // redis latency is observed from const lookups
+  MetricsServer* metrics_server_;
+  std::shared_ptr<common::threads::Thread<void>> metrics_thread_;
+
+  inner_devices_type devices_;
+  mutable std::mutex devices_mutex_;
+
+  std::unordered_map<stream_id, size_t> watchers_;
+  mutable std::mutex watchers_mutex_;
+  inner::ChatHistory chat_history_;
+  mutable std::mutex chat_history_mutex_;
   redis::RedisStorage rstorage_;
+  UserInfoCache user_cache_;
+  ChannelsVersions channels_versions_;
+  ChannelsResponceCache channels_responces_;
+  EpgStore epg_store_;
+  std::mutex epg_load_mutex_;  // one ingest at a time
+  std::shared_ptr<common::threads::Thread<void>> epg_reload_thread_;
+  std::mutex epg_reload_mutex_;
+  std::condition_variable epg_reload_cond_;
+  bool epg_reload_requested_;
+  bool epg_reload_stop_;
   const Config config_;
 };
 
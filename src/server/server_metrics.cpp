@@ -0,0 +1,226 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "server/server_metrics.h"
+
+#include <algorithm>  // for max
+#include <chrono>
+
+#include <common/convert2string.h>  // for ConvertToString
+#include <common/sprintf.h>         // for MemSPrintf
+
+#include "commands/commands.h"
+
+namespace fastotv {
+namespace server {
+namespace {
+const char* const commands_names[ServerMetrics::commands_count] = {SERVER_WHO_ARE_YOU, CLIENT_GET_CHANNELS,
+                                                                    CLIENT_GET_RUNTIME_CHANNEL_INFO,
+                                                                    CLIENT_SEND_CHAT_MESSAGE, CLIENT_GET_PROGRAMMES};
+const char* const redis_calls_names[ServerMetrics::redis_calls_count] = {"find_user", "get_chat_channels",
+                                                                          "get_epg"};
+
+void render_value(const std::string& name, const std::string& type, const std::string& help, uint64_t value,
+                  std::string* out) {
+  *out += "# HELP " + name + " " + help + "\n";
+  *out += "# TYPE " + name + " " + type + "\n";
+  *out += name + " " + common::ConvertToString(value) + "\n";
+}
+
+void render_header(const std::string& name, const std::string& type, const std::string& help, std::string* out) {
+  *out += "# HELP " + name + " " + help + "\n";
+  *out += "# TYPE " + name + " " + type + "\n";
+}
+
+std::string usec_to_sec(uint64_t usec) {
+  return common::MemSPrintf("%llu.%06llu", static_cast<unsigned long long>(usec / 1000000),
+                            static_cast<unsigned long long>(usec % 1000000));
+}
+}  // namespace
+
+const uint64_t LatencyHistogram::bucket_bounds_usec[LatencyHistogram::buckets_count] = {
+    100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 250000, 500000, 1000000, 2500000};
+
+LatencyHistogram::LatencyHistogram() : sum_usec_(0), count_(0) {
+  for (size_t i = 0; i < buckets_count; ++i) {
+    buckets_[i] = 0;
+  }
+}
+
+void LatencyHistogram::Observe(uint64_t usec) {
+  for (size_t i = 0; i < buckets_count; ++i) {
+    if (usec <= bucket_bounds_usec[i]) {
+      buckets_[i].fetch_add(1, std::memory_order_relaxed);
+      break;
+    }
+  }
+  sum_usec_.fetch_add(usec, std::memory_order_relaxed);
+  count_.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::GetCount() const {
+  return count_.load(std::memory_order_relaxed);
+}
+
+void LatencyHistogram::Render(const std::string& name, const std::string& labels, std::string* out) const {
+  const std::string prefix = labels.empty() ? std::string() : labels + ",";
+  uint64_t cumulative = 0;
+  for (size_t i = 0; i < buckets_count; ++i) {
+    cumulative += buckets_[i].load(std::memory_order_relaxed);
+    *out += name + "_bucket{" + prefix + "le=\"" + usec_to_sec(bucket_bounds_usec[i]) + "\"} " +
+            common::ConvertToString(cumulative) + "\n";
+  }
+  // count is read last, so +Inf is never less than finite buckets
+  const uint64_t count = std::max(cumulative, count_.load(std::memory_order_relaxed));
+  const std::string braced_labels = labels.empty() ? std::string() : "{" + labels + "}";
+  *out += name + "_bucket{" + prefix + "le=\"+Inf\"} " + common::ConvertToString(count) + "\n";
+  *out += name + "_sum" + braced_labels + " " + usec_to_sec(sum_usec_.load(std::memory_order_relaxed)) + "\n";
+  *out += name + "_count" + braced_labels + " " + common::ConvertToString(count) + "\n";
+}
+
+ServerMetrics::ServerMetrics()
+    : connected_clients_(0),
+      authenticated_clients_(0),
+      anonim_clients_(0),
+      commands_(),
+      redis_calls_(),
+      loop_lag_(),
+      sampled_values_() {
+  traffic_.bytes_in = 0;
+  traffic_.bytes_out = 0;
+  traffic_.wire_bytes_in = 0;
+  traffic_.wire_bytes_out = 0;
+  traffic_.queued_bytes = 0;
+  traffic_.dropped_messages = 0;
+}
+
+uint64_t ServerMetrics::NowUsec() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void ServerMetrics::ClientConnected() {
+  connected_clients_++;
+}
+
+void ServerMetrics::ClientDisconnected() {
+  connected_clients_--;
+}
+
+void ServerMetrics::ClientAuthenticated(bool anonim) {
+  if (anonim) {
+    anonim_clients_++;
+  } else {
+    authenticated_clients_++;
+  }
+}
+
+void ServerMetrics::ClientUnauthenticated(bool anonim) {
+  if (anonim) {
+    anonim_clients_--;
+  } else {
+    authenticated_clients_--;
+  }
+}
+
+void ServerMetrics::ObserveCommand(command_t command, uint64_t start_usec) {
+  commands_[command].Observe(NowUsec() - start_usec);
+}
+
+void ServerMetrics::ObserveRedisCall(redis_call_t call, uint64_t start_usec) {
+  redis_calls_[call].Observe(NowUsec() - start_usec);
+}
+
+void ServerMetrics::ObserveLoopLag(uint64_t lag_usec) {
+  loop_lag_.Observe(lag_usec);
+}
+
+fastotv::inner::InnerClient::TrafficStats* ServerMetrics::GetTrafficStats() {
+  return &traffic_;
+}
+
+void ServerMetrics::AddSampledValue(const std::string& name,
+                                    const std::string& type,
+                                    const std::string& help,
+                                    sampler_t sampler) {
+  if (name.empty() || !sampler) {
+    return;
+  }
+
+  SampledValue value = {name, type, help, sampler};
+  sampled_values_.push_back(value);
+}
+
+std::string ServerMetrics::RenderPrometheus() const {
+  std::string out;
+  render_header("fastotv_clients", "gauge", "Connected clients by state.", &out);
+  const int64_t connected = connected_clients_;
+  const int64_t authenticated = authenticated_clients_;
+  const int64_t anonim = anonim_clients_;
+  out += "fastotv_clients{state=\"connected\"} " + common::ConvertToString(connected) + "\n";
+  out += "fastotv_clients{state=\"authenticated\"} " + common::ConvertToString(authenticated) + "\n";
+  out += "fastotv_clients{state=\"anonymous\"} " + common::ConvertToString(anonim) + "\n";
+
+  render_header("fastotv_commands_total", "counter", "Handled client commands.", &out);
+  for (size_t i = 0; i < commands_count; ++i) {
+    out += std::string("fastotv_commands_total{command=\"") + commands_names[i] + "\"} " +
+           common::ConvertToString(commands_[i].GetCount()) + "\n";
+  }
+
+  render_header("fastotv_command_duration_seconds", "histogram", "Time from command receipt to answer.", &out);
+  for (size_t i = 0; i < commands_count; ++i) {
+    commands_[i].Render("fastotv_command_duration_seconds", std::string("command=\"") + commands_names[i] + "\"",
+                        &out);
+  }
+
+  render_header("fastotv_redis_call_duration_seconds", "histogram", "Latency of Redis lookups.", &out);
+  for (size_t i = 0; i < redis_calls_count; ++i) {
+    redis_calls_[i].Render("fastotv_redis_call_duration_seconds", std::string("call=\"") + redis_calls_names[i] + "\"",
+                           &out);
+  }
+
+  render_header("fastotv_loop_lag_seconds", "histogram", "Delay of worker loop timers.", &out);
+  loop_lag_.Render("fastotv_loop_lag_seconds", std::string(), &out);
+
+  render_value("fastotv_received_bytes_total", "counter", "Decompressed bytes of received commands.",
+               traffic_.bytes_in, &out);
+  render_value("fastotv_sent_bytes_total", "counter", "Bytes of sent commands before compression.", traffic_.bytes_out,
+               &out);
+  render_value("fastotv_received_wire_bytes_total", "counter", "Bytes read from client sockets.",
+               traffic_.wire_bytes_in, &out);
+  render_value("fastotv_sent_wire_bytes_total", "counter", "Bytes written to client sockets.", traffic_.wire_bytes_out,
+               &out);
+  render_value("fastotv_write_queue_bytes", "gauge", "Bytes waiting in client write queues.", traffic_.queued_bytes,
+               &out);
+  render_value("fastotv_write_queue_dropped_messages_total", "counter",
+               "Low priority messages dropped over write queue high watermark.", traffic_.dropped_messages, &out);
+  for (const SampledValue& value : sampled_values_) {
+    render_value(value.name, value.type, value.help, value.sampler(), &out);
+  }
+  return out;
+}
+
+ScopedCommandTimer::ScopedCommandTimer(ServerMetrics* metrics, ServerMetrics::command_t command)
+    : metrics_(metrics), command_(command), start_usec_(ServerMetrics::NowUsec()) {}
+
+ScopedCommandTimer::~ScopedCommandTimer() {
+  metrics_->ObserveCommand(command_, start_usec_);
+}
+
+}  // namespace server
+}  // namespace fastotv
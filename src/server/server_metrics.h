@@ -0,0 +1,128 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>  // for uint64_t
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <common/macros.h>  // for DISALLOW_COPY_AND_ASSIGN
+
+#include "inner/inner_client.h"  // for InnerClient::TrafficStats
+
+namespace fastotv {
+namespace server {
+
+// Cumulative latency histogram with fixed buckets, values in microseconds, rendered in seconds.
+class LatencyHistogram {
+ public:
+  enum { buckets_count = 14 };
+  static const uint64_t bucket_bounds_usec[buckets_count];
+
+  LatencyHistogram();
+
+  void Observe(uint64_t usec);  // thread-safe
+  uint64_t GetCount() const;
+
+  // appends name_bucket/name_sum/name_count lines, labels are inserted as is (e.g. command="ping")
+  void Render(const std::string& name, const std::string& labels, std::string* out) const;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(LatencyHistogram);
+
+  std::atomic<uint64_t> buckets_[buckets_count];  // not cumulative, +Inf is count_
+  std::atomic<uint64_t> sum_usec_;
+  std::atomic<uint64_t> count_;
+};
+
+// Process wide counters updated lock free from worker loops, rendered in Prometheus text format.
+class ServerMetrics {
+ public:
+  enum command_t {
+    WHO_ARE_YOU_COMMAND = 0,
+    GET_CHANNELS_COMMAND,
+    GET_RUNTIME_CHANNEL_INFO_COMMAND,
+    CHAT_COMMAND,
+    GET_PROGRAMMES_COMMAND
+  };
+  enum { commands_count = GET_PROGRAMMES_COMMAND + 1 };
+  enum redis_call_t { REDIS_FIND_USER = 0, REDIS_GET_CHAT_CHANNELS, REDIS_GET_EPG };
+  enum { redis_calls_count = REDIS_GET_EPG + 1 };
+
+  ServerMetrics();
+
+  static uint64_t NowUsec();  // monotonic
+
+  void ClientConnected();
+  void ClientDisconnected();
+  void ClientAuthenticated(bool anonim);
+  void ClientUnauthenticated(bool anonim);
+
+  void ObserveCommand(command_t command, uint64_t start_usec);
+  void ObserveRedisCall(redis_call_t call, uint64_t start_usec);
+  void ObserveLoopLag(uint64_t lag_usec);
+
+  fastotv::inner::InnerClient::TrafficStats* GetTrafficStats();
+
+  // value owned by other component, sampler is called from rendering thread and must be thread-safe;
+  // not synchronized with rendering, register before metrics are served
+  typedef std::function<uint64_t()> sampler_t;
+  void AddSampledValue(const std::string& name, const std::string& type, const std::string& help, sampler_t sampler);
+
+  std::string RenderPrometheus() const;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ServerMetrics);
+
+  std::atomic<int64_t> connected_clients_;
+  std::atomic<int64_t> authenticated_clients_;
+  std::atomic<int64_t> anonim_clients_;
+  LatencyHistogram commands_[commands_count];
+  LatencyHistogram redis_calls_[redis_calls_count];
+  LatencyHistogram loop_lag_;
+  fastotv::inner::InnerClient::TrafficStats traffic_;
+
+  struct SampledValue {
+    std::string name;
+    std::string type;
+    std::string help;
+    sampler_t sampler;
+  };
+  std::vector<SampledValue> sampled_values_;
+};
+
+// observes command latency on scope exit, for commands answered synchronously
+class ScopedCommandTimer {
+ public:
+  ScopedCommandTimer(ServerMetrics* metrics, ServerMetrics::command_t command);
+  ~ScopedCommandTimer();
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(ScopedCommandTimer);
+
+  ServerMetrics* const metrics_;
+  const ServerMetrics::command_t command_;
+  const uint64_t start_usec_;
+};
+
+}  // namespace server
+}  // namespace fastotv
@@ -23,6 +23,8 @@
 
 #include <json-c/json_object.h>  // for json_object, json...
 
+#include "serializer/json_reader.h"  // for JsonReader
+
 #define USER_INFO_DEVICES_FIELD "devices"
 #define USER_INFO_CHANNELS_FIELD "channels"
 #define USER_INFO_LOGIN_FIELD "login"
@@ -109,6 +111,71 @@ common::Error UserInfo::DeSerialize(const serialize_type& serialized, UserInfo*
   return common::Error();
 }
 
+common::Error UserInfo::DeSerialize(JsonReader* reader, UserInfo* obj) {
+  if (!reader || !obj) {
+    return common::make_error_inval();
+  }
+
+  common::Error err = reader->EnterObject();
+  if (err) {
+    return err;
+  }
+
+  ChannelsInfo chan;
+  std::string login;
+  std::string password;
+  devices_t devices;
+  bool login_exists = false, password_exists = false;
+  std::string key;
+  bool has_next = false;
+  while (true) {
+    err = reader->NextField(&key, &has_next);
+    if (err) {
+      return err;
+    }
+    if (!has_next) {
+      break;
+    }
+
+    if (key == USER_INFO_CHANNELS_FIELD) {
+      err = ChannelsInfo::DeSerialize(reader, &chan);
+    } else if (key == USER_INFO_LOGIN_FIELD) {
+      login_exists = true;
+      err = reader->ReadString(&login);
+    } else if (key == USER_INFO_PASSWORD_FIELD) {
+      password_exists = true;
+      err = reader->ReadString(&password);
+    } else if (key == USER_INFO_DEVICES_FIELD) {
+      err = reader->EnterArray();
+      bool has_device = false;
+      while (!err) {
+        err = reader->NextElement(&has_device);
+        if (err || !has_device) {
+          break;
+        }
+
+        device_id_t dev;
+        err = reader->ReadString(&dev);
+        if (!err) {
+          devices.push_back(dev);
+        }
+      }
+    } else {
+      err = reader->SkipValue();
+    }
+    if (err) {
+      return err;
+    }
+  }
+
+  if (!login_exists || !password_exists) {
+    return common::make_error_inval();
+  }
+
+  *obj = UserInfo(login, password, chan, devices);
+  return common::Error();
+}
+
 bool UserInfo::HaveDevice(device_id_t dev) const {
   for (size_t i = 0; i < devices_.size(); ++i) {
     if (dev == devices_[i]) {
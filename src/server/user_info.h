@@ -18,6 +18,8 @@
 
 #pragma once
 
+#include <memory>  // for shared_ptr
+
 #include "channels_info.h"  // for ChannelsInfo
 
 namespace fastotv {
@@ -38,6 +40,7 @@ class UserInfo : public JsonSerializerEx {
   bool IsValid() const;
 
   static common::Error DeSerialize(const serialize_type& serialized, UserInfo* obj) WARN_UNUSED_RESULT;
+  static common::Error DeSerialize(JsonReader* reader, UserInfo* obj) WARN_UNUSED_RESULT;
 
   bool HaveDevice(device_id_t dev) const;
   devices_t GetDevices() const;
@@ -64,5 +67,7 @@ inline bool operator==(const UserInfo& lhs, const UserInfo& rhs) {
 inline bool operator!=(const UserInfo& x, const UserInfo& y) {
   return !(x == y);
 }
+
+typedef std::shared_ptr<const UserInfo> user_info_ptr_t;
 }  // namespace server
 }  // namespace fastotv
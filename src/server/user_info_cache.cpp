@@ -0,0 +1,141 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "server/user_info_cache.h"
+
+#include <functional>  // for hash
+
+#include <common/time.h>  // for current_mstime
+
+namespace fastotv {
+namespace server {
+
+UserInfoCache::UserInfoCache()
+    : mutex_(),
+      entries_(),
+      lru_(),
+      max_entries_(default_max_entries),
+      ttl_msec_(default_ttl_sec * 1000),
+      epoch_(0),
+      cleared_epoch_(0),
+      slots_(invalidation_slots, 0) {}
+
+void UserInfoCache::SetLimits(size_t max_entries, common::time64_t ttl_sec) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  max_entries_ = max_entries;
+  ttl_msec_ = ttl_sec * 1000;
+  while (entries_.size() > max_entries_) {
+    Remove(entries_.find(lru_.back()));
+  }
+}
+
+bool UserInfoCache::Find(const login_t& login, user_id_t* uid, user_info_ptr_t* uinf) {
+  if (!uid || !uinf) {
+    return false;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  entries_t::iterator it = entries_.find(login);
+  if (it == entries_.end()) {
+    return false;
+  }
+
+  if (it->second.expire_msec <= common::time::current_mstime()) {
+    Remove(it);
+    return false;
+  }
+
+  lru_.splice(lru_.begin(), lru_, it->second.lru_pos);
+  *uid = it->second.uid;
+  *uinf = it->second.uinf;
+  return true;
+}
+
+UserInfoCache::epoch_t UserInfoCache::GetEpoch() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return epoch_;
+}
+
+bool UserInfoCache::Insert(const user_id_t& uid, user_info_ptr_t uinf, epoch_t epoch) {
+  if (!uinf) {
+    return false;
+  }
+
+  const login_t login = uinf->GetLogin();
+  const common::time64_t cur_time = common::time::current_mstime();
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (cleared_epoch_ > epoch || slots_[GetSlot(login)] > epoch) {  // invalidated while loading
+    return false;
+  }
+
+  if (max_entries_ == 0) {
+    return false;
+  }
+
+  const common::time64_t expire_msec = cur_time + ttl_msec_;
+  entries_t::iterator it = entries_.find(login);
+  if (it != entries_.end()) {
+    it->second.uid = uid;
+    it->second.uinf = uinf;
+    it->second.expire_msec = expire_msec;
+    lru_.splice(lru_.begin(), lru_, it->second.lru_pos);
+    return true;
+  }
+
+  if (entries_.size() >= max_entries_) {
+    Remove(entries_.find(lru_.back()));
+  }
+
+  lru_.push_front(login);
+  Entry ent = {uid, uinf, expire_msec, lru_.begin()};
+  entries_.insert(std::make_pair(login, ent));
+  return true;
+}
+
+void UserInfoCache::Invalidate(const login_t& login) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  slots_[GetSlot(login)] = ++epoch_;
+  entries_t::iterator it = entries_.find(login);
+  if (it != entries_.end()) {
+    Remove(it);
+  }
+}
+
+void UserInfoCache::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  cleared_epoch_ = ++epoch_;
+  entries_.clear();
+  lru_.clear();
+}
+
+size_t UserInfoCache::GetSize() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+void UserInfoCache::Remove(entries_t::iterator it) {
+  lru_.erase(it->second.lru_pos);
+  entries_.erase(it);
+}
+
+size_t UserInfoCache::GetSlot(const login_t& login) const {
+  return std::hash<login_t>()(login) % slots_.size();
+}
+
+}  // namespace server
+}  // namespace fastotv
@@ -0,0 +1,84 @@
+/*  Copyright (C) 2014-2018 FastoGT. All right reserved.
+
+    This file is part of FastoTV.
+
+    FastoTV is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    FastoTV is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with FastoTV. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>  // for uint64_t
+
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <common/macros.h>  // for DISALLOW_COPY_AND_ASSIGN
+#include <common/types.h>   // for time64_t
+
+#include "server/user_info.h"  // for user_id_t, UserInfo
+
+namespace fastotv {
+namespace server {
+
+// Thread-safe LRU cache of users keyed by login, entries expire after ttl.
+// Lookups take an epoch before going to the database and pass it to Insert,
+// results that raced with an invalidation of the same login are not cached.
+class UserInfoCache {
+ public:
+  typedef uint64_t epoch_t;
+  enum { default_max_entries = 10000, default_ttl_sec = 600, invalidation_slots = 1024 };
+
+  UserInfoCache();
+
+  void SetLimits(size_t max_entries, common::time64_t ttl_sec);
+
+  bool Find(const login_t& login, user_id_t* uid, user_info_ptr_t* uinf);
+  epoch_t GetEpoch() const;
+  // returns false if login was invalidated after epoch
+  bool Insert(const user_id_t& uid, user_info_ptr_t uinf, epoch_t epoch);
+  void Invalidate(const login_t& login);
+  void Clear();
+
+  size_t GetSize() const;
+
+ private:
+  DISALLOW_COPY_AND_ASSIGN(UserInfoCache);
+
+  typedef std::list<login_t> lru_list_t;
+  struct Entry {
+    user_id_t uid;
+    user_info_ptr_t uinf;
+    common::time64_t expire_msec;
+    lru_list_t::iterator lru_pos;
+  };
+  typedef std::unordered_map<login_t, Entry> entries_t;
+
+  void Remove(entries_t::iterator it);
+  size_t GetSlot(const login_t& login) const;
+
+  mutable std::mutex mutex_;
+  entries_t entries_;
+  lru_list_t lru_;  // front is most recently used
+  size_t max_entries_;
+  common::time64_t ttl_msec_;
+
+  epoch_t epoch_;               // bumped on every invalidation
+  epoch_t cleared_epoch_;       // epoch of last Clear
+  std::vector<epoch_t> slots_;  // epoch of last invalidation per login hash
+};
+
+}  // namespace server
+}  // namespace fastotv
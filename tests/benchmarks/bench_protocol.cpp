@@ -0,0 +1,178 @@
+#include <benchmark/benchmark.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+
+#include <common/convert2string.h>
+#include <common/text_decoders/compress_snappy_edcoder.h>
+
+#include "sds.h"
+
+#include "channels_info.h"
+#include "chat_message.h"
+#include "client/commands.h"
+#include "inner/inner_client.h"
+
+namespace {
+
+common::protocols::three_way_handshake::cmd_request_t MakeChatRequest() {
+  const fastotv::ChatMessage msg("42", "user@fastotv.com", "Chat message with some realistic text",
+                                 fastotv::ChatMessage::MESSAGE);
+  std::string msg_ser;
+  common::Error err = msg.SerializeToString(&msg_ser);
+  if (err) {
+    msg_ser.clear();
+  }
+  return fastotv::client::SendChatMessageRequest("12345", msg_ser);
+}
+
+// channels list answer is the biggest regular message
+std::string MakeChannelsJson(size_t channels) {
+  fastotv::ChannelsInfo chan;
+  for (size_t i = 0; i < channels; ++i) {
+    const std::string sid = common::ConvertToString(i);
+    const common::uri::Url url("http://localhost:8080/hls/" + sid + "/play.m3u8");
+    chan.AddChannel(fastotv::ChannelInfo(fastotv::EpgInfo(sid, url, "Channel " + sid), true, true));
+  }
+  std::string out;
+  common::Error err = chan.SerializeToString(&out);
+  if (err) {
+    return std::string();
+  }
+  return out;
+}
+
+void BM_SdsSplitArgsLong(benchmark::State& state) {
+  const std::string cmd = MakeChatRequest().GetCmd();
+  for (auto _ : state) {
+    int argc = 0;
+    sds* argv = sdssplitargslong(cmd.c_str(), &argc);
+    benchmark::DoNotOptimize(argv);
+    sdsfreesplitres(argv, argc);
+  }
+  state.SetBytesProcessed(state.iterations() * cmd.size());
+}
+BENCHMARK(BM_SdsSplitArgsLong);
+
+void BM_ParseCommand(benchmark::State& state) {
+  const std::string cmd = MakeChatRequest().GetCmd();
+  for (auto _ : state) {
+    common::protocols::three_way_handshake::cmd_id_t seq;
+    common::protocols::three_way_handshake::cmd_seq_t id;
+    std::string cmd_str;
+    common::Error err = common::protocols::three_way_handshake::ParseCommand(cmd, &seq, &id, &cmd_str);
+    if (err) {
+      state.SkipWithError(err->GetDescription().c_str());
+      return;
+    }
+    benchmark::DoNotOptimize(cmd_str);
+  }
+  state.SetBytesProcessed(state.iterations() * cmd.size());
+}
+BENCHMARK(BM_ParseCommand);
+
+// arg: channels in encoded message
+void BM_SnappyEncode(benchmark::State& state) {
+  const std::string data = MakeChannelsJson(state.range(0));
+  common::CompressSnappyEDcoder compressor;
+  std::string out;
+  for (auto _ : state) {
+    common::Error err = compressor.Encode(data, &out);
+    if (err) {
+      state.SkipWithError(err->GetDescription().c_str());
+      return;
+    }
+    benchmark::DoNotOptimize(out);
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+  state.counters["ratio"] = out.empty() ? 0 : static_cast<double>(data.size()) / out.size();
+}
+BENCHMARK(BM_SnappyEncode)->Arg(1)->Arg(50)->Arg(500);
+
+void BM_SnappyDecode(benchmark::State& state) {
+  const std::string data = MakeChannelsJson(state.range(0));
+  common::CompressSnappyEDcoder compressor;
+  std::string encoded;
+  common::Error err = compressor.Encode(data, &encoded);
+  if (err) {
+    state.SkipWithError(err->GetDescription().c_str());
+    return;
+  }
+
+  std::string out;
+  for (auto _ : state) {
+    err = compressor.Decode(encoded, &out);
+    if (err) {
+      state.SkipWithError(err->GetDescription().c_str());
+      return;
+    }
+    benchmark::DoNotOptimize(out);
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_SnappyDecode)->Arg(1)->Arg(50)->Arg(500);
+
+void BM_InnerClientMakeFrame(benchmark::State& state) {
+  const common::protocols::three_way_handshake::cmd_request_t request = MakeChatRequest();
+  for (auto _ : state) {
+    fastotv::inner::InnerClient::frame_t frame;
+    common::Error err = fastotv::inner::InnerClient::MakeFrame(request, &frame);
+    if (err) {
+      state.SkipWithError(err->GetDescription().c_str());
+      return;
+    }
+    benchmark::DoNotOptimize(frame);
+  }
+  state.SetBytesProcessed(state.iterations() * request.GetCmd().size());
+}
+BENCHMARK(BM_InnerClientMakeFrame);
+
+// write and decode one command through a socket pair, arg: channels in message (chunked when big)
+void BM_InnerClientRoundTrip(benchmark::State& state) {
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+    state.SkipWithError("socketpair failed");
+    return;
+  }
+
+  {
+    fastotv::inner::InnerClient writer(nullptr, common::net::socket_info(fds[0]));
+    fastotv::inner::InnerClient reader(nullptr, common::net::socket_info(fds[1]));
+    writer.SetPeerFeatures(fastotv::inner::InnerClient::supported_features);
+    const common::protocols::three_way_handshake::cmd_request_t request =
+        fastotv::client::SendChatMessageRequest("12345", MakeChannelsJson(state.range(0)));
+    for (auto _ : state) {
+      common::Error err = writer.Write(request);
+      if (err) {
+        state.SkipWithError(err->GetDescription().c_str());
+        break;
+      }
+
+      const std::string* command = nullptr;
+      while (true) {
+        err = reader.NextCommand(&command);
+        if (err || command) {
+          break;
+        }
+        err = reader.ReadData();
+        if (err) {
+          break;
+        }
+      }
+      if (err) {
+        state.SkipWithError(err->GetDescription().c_str());
+        break;
+      }
+      benchmark::DoNotOptimize(command);
+    }
+    state.SetBytesProcessed(state.iterations() * request.GetCmd().size());
+  }
+
+  close(fds[0]);
+  close(fds[1]);
+}
+BENCHMARK(BM_InnerClientRoundTrip)->Arg(1)->Arg(50)->Arg(500);
+
+}  // namespace
@@ -0,0 +1,167 @@
+#include <benchmark/benchmark.h>
+
+#include <string>
+
+#include <common/convert2string.h>
+
+#include "channels_info.h"
+#include "chat_message.h"
+#include "epg_info.h"
+#include "runtime_channel_info.h"
+#include "serializer/json_reader.h"
+
+namespace {
+
+// one day of half-hour programmes, like parsed xmltv
+fastotv::EpgInfo MakeEpg(const fastotv::stream_id& sid, size_t programmes) {
+  const common::uri::Url url("http://localhost:8080/hls/" + sid + "/play.m3u8");
+  fastotv::EpgInfo epg(sid, url, "Channel " + sid);
+  fastotv::EpgInfo::programs_t progs;
+  const fastotv::timestamp_t start = 1514764800000;  // msec
+  const fastotv::timestamp_t duration = 30 * 60 * 1000;
+  for (size_t i = 0; i < programmes; ++i) {
+    progs.push_back(fastotv::ProgrammeInfo(sid, start + i * duration, start + (i + 1) * duration,
+                                           "Programme title number " + common::ConvertToString(i)));
+  }
+  epg.SetPrograms(progs);
+  return epg;
+}
+
+fastotv::ChannelsInfo MakeChannels(size_t channels, size_t programmes) {
+  fastotv::ChannelsInfo chan;
+  for (size_t i = 0; i < channels; ++i) {
+    chan.AddChannel(fastotv::ChannelInfo(MakeEpg(common::ConvertToString(i), programmes), true, true));
+  }
+  return chan;
+}
+
+fastotv::RuntimeChannelInfo MakeRuntimeInfo(size_t messages) {
+  fastotv::RuntimeChannelInfo::messages_t msgs;
+  for (size_t i = 0; i < messages; ++i) {
+    msgs.push_back(fastotv::ChatMessage("42", "user" + common::ConvertToString(i) + "@fastotv.com",
+                                        "Chat message with some realistic text", fastotv::ChatMessage::MESSAGE));
+  }
+  return fastotv::RuntimeChannelInfo("42", 1000, fastotv::OFFICAL_CHANNEL, true, false, msgs);
+}
+
+template <typename T>
+void BenchSerialize(benchmark::State& state, const T& obj) {
+  std::string out;
+  for (auto _ : state) {
+    common::Error err = obj.SerializeToString(&out);
+    if (err) {
+      state.SkipWithError(err->GetDescription().c_str());
+      return;
+    }
+    benchmark::DoNotOptimize(out);
+  }
+  state.SetBytesProcessed(state.iterations() * out.size());
+}
+
+template <typename T>
+void BenchDeSerialize(benchmark::State& state, const T& obj) {
+  std::string data;
+  common::Error err = obj.SerializeToString(&data);
+  if (err) {
+    state.SkipWithError(err->GetDescription().c_str());
+    return;
+  }
+
+  for (auto _ : state) {
+    typename T::serialize_type jobj = NULL;
+    err = obj.SerializeFromString(data, &jobj);
+    if (err) {
+      state.SkipWithError(err->GetDescription().c_str());
+      return;
+    }
+    T result;
+    err = T::DeSerialize(jobj, &result);
+    json_object_put(jobj);
+    if (err) {
+      state.SkipWithError(err->GetDescription().c_str());
+      return;
+    }
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+
+// same as BenchDeSerialize with JsonReader backend, objects are filled without json-c tree
+template <typename T>
+void BenchDeSerializeReader(benchmark::State& state, const T& obj) {
+  std::string data;
+  common::Error err = obj.SerializeToString(&data);
+  if (err) {
+    state.SkipWithError(err->GetDescription().c_str());
+    return;
+  }
+
+  for (auto _ : state) {
+    fastotv::JsonReader reader(data);
+    T result;
+    err = T::DeSerialize(&reader, &result);
+    if (err) {
+      state.SkipWithError(err->GetDescription().c_str());
+      return;
+    }
+    benchmark::DoNotOptimize(result);
+  }
+  state.SetBytesProcessed(state.iterations() * data.size());
+}
+
+// args: channels, programmes per channel
+void BM_ChannelsInfoSerialize(benchmark::State& state) {
+  BenchSerialize(state, MakeChannels(state.range(0), state.range(1)));
+}
+BENCHMARK(BM_ChannelsInfoSerialize)->Args({50, 0})->Args({500, 0})->Args({50, 48});
+
+void BM_ChannelsInfoDeSerialize(benchmark::State& state) {
+  BenchDeSerialize(state, MakeChannels(state.range(0), state.range(1)));
+}
+BENCHMARK(BM_ChannelsInfoDeSerialize)->Args({50, 0})->Args({500, 0})->Args({50, 48});
+
+void BM_ChannelsInfoDeSerializeReader(benchmark::State& state) {
+  BenchDeSerializeReader(state, MakeChannels(state.range(0), state.range(1)));
+}
+BENCHMARK(BM_ChannelsInfoDeSerializeReader)->Args({50, 0})->Args({500, 0})->Args({50, 48});
+
+// arg: programmes
+void BM_EpgInfoSerialize(benchmark::State& state) {
+  BenchSerialize(state, MakeEpg("42", state.range(0)));
+}
+BENCHMARK(BM_EpgInfoSerialize)->Arg(0)->Arg(48)->Arg(336);
+
+void BM_EpgInfoDeSerialize(benchmark::State& state) {
+  BenchDeSerialize(state, MakeEpg("42", state.range(0)));
+}
+BENCHMARK(BM_EpgInfoDeSerialize)->Arg(0)->Arg(48)->Arg(336);
+
+void BM_EpgInfoDeSerializeReader(benchmark::State& state) {
+  BenchDeSerializeReader(state, MakeEpg("42", state.range(0)));
+}
+BENCHMARK(BM_EpgInfoDeSerializeReader)->Arg(0)->Arg(48)->Arg(336);
+
+void BM_ChatMessageSerialize(benchmark::State& state) {
+  BenchSerialize(state, fastotv::ChatMessage("42", "user@fastotv.com", "Chat message with some realistic text",
+                                             fastotv::ChatMessage::MESSAGE));
+}
+BENCHMARK(BM_ChatMessageSerialize);
+
+void BM_ChatMessageDeSerialize(benchmark::State& state) {
+  BenchDeSerialize(state, fastotv::ChatMessage("42", "user@fastotv.com", "Chat message with some realistic text",
+                                               fastotv::ChatMessage::MESSAGE));
+}
+BENCHMARK(BM_ChatMessageDeSerialize);
+
+// arg: chat history size
+void BM_RuntimeChannelInfoSerialize(benchmark::State& state) {
+  BenchSerialize(state, MakeRuntimeInfo(state.range(0)));
+}
+BENCHMARK(BM_RuntimeChannelInfoSerialize)->Arg(0)->Arg(10)->Arg(100);
+
+void BM_RuntimeChannelInfoDeSerialize(benchmark::State& state) {
+  BenchDeSerialize(state, MakeRuntimeInfo(state.range(0)));
+}
+BENCHMARK(BM_RuntimeChannelInfoDeSerialize)->Arg(0)->Arg(10)->Arg(100);
+
+}  // namespace
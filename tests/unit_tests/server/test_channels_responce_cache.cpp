@@ -0,0 +1,157 @@
+#include <gtest/gtest.h>
+
+#include <common/convert2string.h>
+#include <common/sprintf.h>
+#include <common/text_decoders/compress_snappy_edcoder.h>
+
+#include "channels_delta_info.h"
+
+#include "server/channels_responce_cache.h"
+#include "server/channels_versions.h"
+#include "server/commands.h"
+#include "server/epg_store.h"
+
+namespace {
+
+fastotv::ChannelInfo MakeChannel(const fastotv::stream_id& sid, const std::string& name) {
+  const common::uri::Url url("http://localhost:8080/hls/" + sid + "/play.m3u8");
+  return fastotv::ChannelInfo(fastotv::EpgInfo(sid, url, name), true, true);
+}
+
+fastotv::server::user_info_ptr_t MakeUser(const std::string& login, const fastotv::ChannelsInfo& channels) {
+  return std::make_shared<const fastotv::server::UserInfo>(login, "1234", channels,
+                                                           fastotv::server::UserInfo::devices_t());
+}
+
+std::string DecodeFrame(const fastotv::inner::InnerClient::frame_t& frame) {
+  EXPECT_LE(frame->size(), static_cast<size_t>(fastotv::inner::InnerClient::MAX_COMMAND_SIZE));
+  common::CompressSnappyEDcoder compressor;
+  std::string decoded;
+  common::Error err = compressor.Decode(*frame, &decoded);
+  EXPECT_FALSE(err);
+  return decoded;
+}
+
+}  // namespace
+
+TEST(ChannelsResponceCache, shared_by_same_channels) {
+  fastotv::ChannelsInfo channels;
+  channels.AddChannel(MakeChannel("1", "first"));
+  channels.AddChannel(MakeChannel("2", "second"));
+  fastotv::ChannelsInfo other;
+  other.AddChannel(MakeChannel("3", "third"));
+
+  fastotv::server::user_info_ptr_t first = MakeUser("first@gmail.com", channels);
+  fastotv::server::user_info_ptr_t second = MakeUser("second@gmail.com", channels);
+  fastotv::server::user_info_ptr_t third = MakeUser("third@gmail.com", other);
+
+  fastotv::server::ChannelsResponceCache cache;
+  fastotv::server::ChannelsResponceCache::body_ptr_t first_body;
+  ASSERT_FALSE(cache.Get(first, false, &first_body));
+  fastotv::server::ChannelsResponceCache::body_ptr_t second_body;
+  ASSERT_FALSE(cache.Get(second, false, &second_body));
+  fastotv::server::ChannelsResponceCache::body_ptr_t third_body;
+  ASSERT_FALSE(cache.Get(third, false, &third_body));
+  ASSERT_EQ(first_body, second_body);
+  ASSERT_NE(first_body, third_body);
+  ASSERT_EQ(cache.GetSize(), 2u);
+
+  // reloaded user data is serialized again
+  fastotv::ChannelsInfo changed = channels;
+  changed.AddChannel(MakeChannel("4", "fourth"));
+  first = MakeUser("first@gmail.com", changed);
+  fastotv::server::ChannelsResponceCache::body_ptr_t changed_body;
+  ASSERT_FALSE(cache.Get(first, false, &changed_body));
+  ASSERT_NE(changed_body, second_body);
+  ASSERT_NE(changed_body->version, second_body->version);
+
+  cache.Clear();
+  ASSERT_EQ(cache.GetSize(), 0u);
+}
+
+TEST(ChannelsResponceCache, without_programmes) {
+  fastotv::ChannelInfo channel = MakeChannel("1", "first");
+  fastotv::EpgInfo epg = channel.GetEpg();
+  fastotv::EpgInfo::programs_t progs;
+  progs.push_back(fastotv::ProgrammeInfo("1", 1000, 2000, "news"));
+  epg.SetPrograms(progs);
+  fastotv::ChannelsInfo channels;
+  channels.AddChannel(fastotv::ChannelInfo(epg, true, true));
+  fastotv::server::user_info_ptr_t user = MakeUser("first@gmail.com", channels);
+
+  fastotv::server::ChannelsResponceCache cache;
+  fastotv::server::ChannelsResponceCache::body_ptr_t full_body;
+  ASSERT_FALSE(cache.Get(user, false, &full_body));
+  fastotv::server::ChannelsResponceCache::body_ptr_t stripped_body;
+  ASSERT_FALSE(cache.Get(user, true, &stripped_body));
+  ASSERT_NE(full_body->version, stripped_body->version);
+  ASSERT_LT(stripped_body->channels.size, full_body->channels.size);
+  ASSERT_EQ(full_body->list, channels);  // deltas are made from list of body
+  ASSERT_EQ(stripped_body->list, fastotv::server::EpgStore::StripProgrammes(channels));
+  ASSERT_EQ(cache.GetSize(), 2u);
+
+  // both answers stay bound to user
+  fastotv::server::ChannelsResponceCache::body_ptr_t body;
+  ASSERT_FALSE(cache.Get(user, false, &body));
+  ASSERT_EQ(body, full_body);
+  ASSERT_FALSE(cache.Get(user, true, &body));
+  ASSERT_EQ(body, stripped_body);
+}
+
+TEST(ChannelsResponceCache, frame_matches_serialized) {
+  fastotv::ChannelsInfo channels;
+  for (size_t i = 0; i < 64; ++i) {
+    const std::string sid = common::ConvertToString(i);
+    channels.AddChannel(MakeChannel(sid, "channel " + sid));
+  }
+
+  fastotv::server::ChannelsResponceCache cache;
+  fastotv::server::ChannelsResponceCache::body_ptr_t body;
+  ASSERT_FALSE(cache.Get(MakeUser("first@gmail.com", channels), false, &body));
+
+  std::string channels_str;
+  ASSERT_FALSE(channels.SerializeToString(&channels_str));
+  const std::string expected = common::MemSPrintf("2 17 ok get_channels '%s'\r\n", channels_str.c_str());
+  const std::string placeholder = fastotv::server::ChannelsResponceCache::MakeChannelsTemplate();
+  const std::string templ = common::MemSPrintf("2 17 ok get_channels '%s'\r\n", placeholder.c_str());
+
+  fastotv::inner::InnerClient::frame_t frame;
+  ASSERT_FALSE(fastotv::server::ChannelsResponceCache::MakeFrame(templ, *body, false, &frame));
+  ASSERT_EQ(DecodeFrame(frame), expected);
+
+  ASSERT_TRUE(fastotv::server::ChannelsResponceCache::MakeFrame("2 17 ok ping\r\n", *body, false, &frame));
+}
+
+TEST(ChannelsResponceCache, delta_answers) {
+  fastotv::ChannelsInfo channels;
+  channels.AddChannel(MakeChannel("1", "first"));
+  fastotv::server::ChannelsResponceCache cache;
+  fastotv::server::ChannelsResponceCache::body_ptr_t body;
+  ASSERT_FALSE(cache.Get(MakeUser("first@gmail.com", channels), false, &body));
+
+  // unknown version gets whole list spliced into the template
+  fastotv::server::ChannelsVersions versions;
+  std::string delta_str;
+  bool templated = false;
+  fastotv::ChannelsDeltaInfo full = versions.MakeDelta("first@gmail.com", fastotv::invalid_channels_version,
+                                                      body->list, body->version, body->snapshot);
+  ASSERT_EQ(full.GetType(), fastotv::ChannelsDeltaInfo::FULL);
+  ASSERT_FALSE(fastotv::server::ChannelsResponceCache::SerializeDelta(full, &delta_str, &templated));
+  ASSERT_TRUE(templated);
+  const std::string full_templ = fastotv::server::GetChannelsResponceSuccsess("17", delta_str).GetCmd();
+  fastotv::inner::InnerClient::frame_t frame;
+  ASSERT_FALSE(fastotv::server::ChannelsResponceCache::MakeFrame(full_templ, *body, false, &frame));
+
+  // client up to date gets a complete answer, there is no placeholder in it
+  fastotv::ChannelsDeltaInfo unchanged =
+      versions.MakeDelta("first@gmail.com", body->version, body->list, body->version, body->snapshot);
+  ASSERT_EQ(unchanged.GetType(), fastotv::ChannelsDeltaInfo::UNCHANGED);
+  ASSERT_FALSE(fastotv::server::ChannelsResponceCache::SerializeDelta(unchanged, &delta_str, &templated));
+  ASSERT_FALSE(templated);
+  std::string expected;
+  ASSERT_FALSE(unchanged.SerializeToString(&expected));
+  ASSERT_EQ(delta_str, expected);
+  const std::string unchanged_answer = fastotv::server::GetChannelsResponceSuccsess("17", delta_str).GetCmd();
+  ASSERT_EQ(unchanged_answer.find(CHANNELS_RESPONCE_PLACEHOLDER), std::string::npos);
+  ASSERT_TRUE(fastotv::server::ChannelsResponceCache::MakeFrame(unchanged_answer, *body, false, &frame));
+}
@@ -0,0 +1,116 @@
+#include <gtest/gtest.h>
+
+#include <json-c/json_tokener.h>
+
+#include "server/channels_versions.h"
+
+namespace {
+
+fastotv::ChannelInfo MakeChannel(const fastotv::stream_id& sid, const std::string& name) {
+  const common::uri::Url url("http://localhost:8080/hls/" + sid + "/play.m3u8");
+  return fastotv::ChannelInfo(fastotv::EpgInfo(sid, url, name), true, true);
+}
+
+const fastotv::login_t kOwner = "first@gmail.com";
+
+}  // namespace
+
+TEST(ChannelsVersions, unchanged_delta_full) {
+  fastotv::ChannelsInfo first;
+  first.AddChannel(MakeChannel("1", "first"));
+  first.AddChannel(MakeChannel("2", "second"));
+  first.AddChannel(MakeChannel("3", "third"));
+
+  fastotv::server::ChannelsVersions versions;
+  fastotv::ChannelsDeltaInfo full = versions.MakeDelta(kOwner, fastotv::invalid_channels_version, first);
+  ASSERT_EQ(full.GetType(), fastotv::ChannelsDeltaInfo::FULL);
+  ASSERT_TRUE(full.IsValid());
+
+  fastotv::ChannelsInfo cache;
+  full.ApplyTo(&cache);
+  ASSERT_EQ(cache, first);
+
+  fastotv::ChannelsDeltaInfo unchanged = versions.MakeDelta(kOwner, full.GetVersion(), first);
+  ASSERT_EQ(unchanged.GetType(), fastotv::ChannelsDeltaInfo::UNCHANGED);
+  ASSERT_EQ(unchanged.GetVersion(), full.GetVersion());
+
+  fastotv::ChannelsInfo second;
+  second.AddChannel(MakeChannel("1", "first"));
+  second.AddChannel(MakeChannel("3", "third renamed"));
+  second.AddChannel(MakeChannel("4", "fourth"));
+  fastotv::ChannelsDeltaInfo delta = versions.MakeDelta(kOwner, full.GetVersion(), second);
+  ASSERT_EQ(delta.GetType(), fastotv::ChannelsDeltaInfo::DELTA);
+  ASSERT_NE(delta.GetVersion(), full.GetVersion());
+  ASSERT_EQ(delta.GetAdded().GetSize(), 1u);
+  ASSERT_EQ(delta.GetModified().GetSize(), 1u);
+  ASSERT_EQ(delta.GetRemoved().size(), 1u);
+
+  fastotv::ChannelsInfo::serialize_type ser = NULL;
+  common::Error err = delta.Serialize(&ser);
+  ASSERT_TRUE(!err);
+  fastotv::ChannelsDeltaInfo ddelta;
+  err = fastotv::ChannelsDeltaInfo::DeSerialize(ser, &ddelta);
+  json_object_put(ser);
+  ASSERT_TRUE(!err);
+
+  ddelta.ApplyTo(&cache);
+  ASSERT_EQ(cache, second);
+
+  fastotv::ChannelsInfo reordered;
+  reordered.AddChannel(MakeChannel("3", "third renamed"));
+  reordered.AddChannel(MakeChannel("1", "first"));
+  reordered.AddChannel(MakeChannel("4", "fourth"));
+  fastotv::ChannelsDeltaInfo reorder = versions.MakeDelta(kOwner, delta.GetVersion(), reordered);
+  ASSERT_EQ(reorder.GetType(), fastotv::ChannelsDeltaInfo::FULL);
+
+  fastotv::ChannelsDeltaInfo unknown = versions.MakeDelta(kOwner, "unknown", first);
+  ASSERT_EQ(unknown.GetType(), fastotv::ChannelsDeltaInfo::FULL);
+  ASSERT_EQ(unknown.GetVersion(), full.GetVersion());
+}
+
+TEST(ChannelsVersions, delta_only_from_own_versions) {
+  fastotv::ChannelsInfo own;
+  own.AddChannel(MakeChannel("1", "first"));
+  fastotv::ChannelsInfo other;
+  other.AddChannel(MakeChannel("1", "first"));
+  other.AddChannel(MakeChannel("2", "private"));
+
+  fastotv::server::ChannelsVersions versions;
+  fastotv::ChannelsDeltaInfo other_full =
+      versions.MakeDelta("other@gmail.com", fastotv::invalid_channels_version, other);
+  ASSERT_EQ(other_full.GetType(), fastotv::ChannelsDeltaInfo::FULL);
+
+  // version of other user's list doesn't reveal its channels by "removed"
+  fastotv::ChannelsDeltaInfo full = versions.MakeDelta(kOwner, other_full.GetVersion(), own);
+  ASSERT_EQ(full.GetType(), fastotv::ChannelsDeltaInfo::FULL);
+  ASSERT_TRUE(full.GetRemoved().empty());
+
+  fastotv::ChannelsDeltaInfo unchanged = versions.MakeDelta(kOwner, full.GetVersion(), own);
+  ASSERT_EQ(unchanged.GetType(), fastotv::ChannelsDeltaInfo::UNCHANGED);
+
+  // same list of both users is one content version, but remembered for each of them
+  fastotv::ChannelsDeltaInfo same = versions.MakeDelta("other@gmail.com", other_full.GetVersion(), own);
+  ASSERT_EQ(same.GetType(), fastotv::ChannelsDeltaInfo::DELTA);
+  ASSERT_EQ(same.GetVersion(), full.GetVersion());
+  ASSERT_EQ(same.GetRemoved().size(), 1u);
+  ASSERT_EQ(versions.GetSize(), 3u);
+}
+
+TEST(ChannelsVersions, removed_must_be_array) {
+  fastotv::ChannelsDeltaInfo delta;
+  json_object* obj = json_tokener_parse("{\"version\":\"v1\",\"type\":1,\"removed\":\"1\"}");
+  ASSERT_TRUE(obj);
+  ASSERT_TRUE(fastotv::ChannelsDeltaInfo::DeSerialize(obj, &delta));
+  json_object_put(obj);
+
+  obj = json_tokener_parse("{\"version\":\"v1\",\"type\":1,\"removed\":[1]}");
+  ASSERT_TRUE(obj);
+  ASSERT_TRUE(fastotv::ChannelsDeltaInfo::DeSerialize(obj, &delta));
+  json_object_put(obj);
+
+  obj = json_tokener_parse("{\"version\":\"v1\",\"type\":1,\"removed\":[\"1\"]}");
+  ASSERT_TRUE(obj);
+  ASSERT_FALSE(fastotv::ChannelsDeltaInfo::DeSerialize(obj, &delta));
+  json_object_put(obj);
+  ASSERT_EQ(delta.GetRemoved().size(), 1u);
+}
@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+
+#include <common/convert2string.h>
+
+#include "server/inner/chat_history.h"
+
+using fastotv::ChatMessage;
+using fastotv::server::inner::ChatHistory;
+
+namespace {
+
+ChatMessage MakeMessage(const fastotv::stream_id& sid, size_t number) {
+  return ChatMessage(sid, "user@fastotv.com", "message " + common::ConvertToString(number), ChatMessage::MESSAGE);
+}
+
+}  // namespace
+
+TEST(ChatHistory, ring_per_channel) {
+  ChatHistory history;
+  history.SetLimits(3, 1024 * 1024);
+  ASSERT_TRUE(history.GetMessages("cnn").empty());
+  for (size_t i = 0; i < 5; ++i) {
+    history.Add(MakeMessage("cnn", i));
+  }
+  history.Add(MakeMessage("discovery", 0));
+  ASSERT_EQ(history.GetChannelsCount(), 2u);
+  ASSERT_EQ(history.GetMessagesCount(), 4u);
+
+  const ChatHistory::messages_t msgs = history.GetMessages("cnn");  // last ones, oldest first
+  ASSERT_EQ(msgs.size(), 3u);
+  ASSERT_EQ(msgs[0], MakeMessage("cnn", 2));
+  ASSERT_EQ(msgs[2], MakeMessage("cnn", 4));
+  ASSERT_EQ(history.GetMessages("discovery").size(), 1u);
+}
+
+TEST(ChatHistory, budget_drops_oldest_of_all_channels) {
+  ChatHistory history;
+  history.SetLimits(100, 1024 * 1024);
+  history.Add(MakeMessage("cnn", 0));
+  const size_t first_size = history.GetSize();
+  history.Add(MakeMessage("cnn", 2));
+  const size_t message_size = history.GetSize() - first_size;
+  const size_t ring_size = first_size - message_size;
+  const size_t budget = ring_size * 2 + message_size * 3;
+  history.SetLimits(100, budget);
+
+  history.Add(MakeMessage("cnn", 0));
+  history.Add(MakeMessage("bbc", 1));
+  history.Add(MakeMessage("cnn", 2));
+  history.Add(MakeMessage("bbc", 3));
+  ASSERT_EQ(history.GetMessagesCount(), 3u);
+  ASSERT_LE(history.GetSize(), budget);
+
+  ChatHistory::messages_t msgs = history.GetMessages("cnn");
+  ASSERT_EQ(msgs.size(), 1u);
+  ASSERT_EQ(msgs[0], MakeMessage("cnn", 2));
+  msgs = history.GetMessages("bbc");
+  ASSERT_EQ(msgs.size(), 2u);
+
+  history.Add(ChatMessage("cnn", "user", std::string(message_size * 3, 'a'), ChatMessage::MESSAGE));  // too big
+  ASSERT_EQ(history.GetMessagesCount(), 3u);
+}
+
+TEST(ChatHistory, rings_count_against_budget) {
+  ChatHistory history;
+  history.SetLimits(1000, 1024 * 1024);
+  history.Add(MakeMessage("cnn", 0));
+  const size_t first_size = history.GetSize();
+  ASSERT_GT(first_size, 1000u);  // slots of the whole ring are accounted
+  history.SetLimits(1000, first_size * 3 / 2);
+
+  history.Add(MakeMessage("cnn", 0));
+  history.Add(MakeMessage("bbc", 1));  // its ring does not fit
+  ASSERT_EQ(history.GetChannelsCount(), 1u);
+  ASSERT_EQ(history.GetMessagesCount(), 1u);
+  ASSERT_TRUE(history.GetMessages("bbc").empty());
+  ASSERT_LE(history.GetSize(), first_size * 3 / 2);
+}
+
+TEST(ChatHistory, long_running_channel) {
+  ChatHistory history;
+  history.SetLimits(10, 1024 * 1024);
+  size_t size = 0;
+  for (size_t i = 0; i < 100000; ++i) {
+    history.Add(MakeMessage(i % 2 ? "cnn" : "discovery", i));
+    if (i == 1000) {
+      size = history.GetSize();
+    }
+  }
+  ASSERT_EQ(history.GetMessagesCount(), 20u);
+  ASSERT_LE(history.GetSize(), size + 20 * 5);  // only numbers grew
+  ASSERT_EQ(history.GetMessages("cnn").back(), MakeMessage("cnn", 99999));
+
+  history.SetLimits(0, 1024 * 1024);  // disabled
+  history.Add(MakeMessage("cnn", 0));
+  ASSERT_EQ(history.GetMessagesCount(), 0u);
+  ASSERT_EQ(history.GetSize(), 0u);
+}
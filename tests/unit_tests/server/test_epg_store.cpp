@@ -0,0 +1,167 @@
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+
+#include <memory>
+
+#include <common/convert2string.h>
+
+#include "epg/epg_file.h"
+#include "server/epg_store.h"
+
+#define TEST_EPG_PATH "test_epg_store.epg"
+
+namespace {
+
+fastotv::EpgInfo MakeEpg(const fastotv::stream_id& sid, const fastotv::EpgInfo::programs_t& progs) {
+  const common::uri::Url url("http://localhost:8080/hls/" + sid + "/play.m3u8");
+  fastotv::EpgInfo epg(sid, url, "channel " + sid);
+  epg.SetPrograms(progs);
+  return epg;
+}
+
+}  // namespace
+
+TEST(EpgStore, find_in_window) {
+  fastotv::EpgInfo::programs_t first;
+  first.push_back(fastotv::ProgrammeInfo("1", 300, 400, "third"));
+  first.push_back(fastotv::ProgrammeInfo("1", 100, 200, "first"));
+  first.push_back(fastotv::ProgrammeInfo("1", 200, 300, "second"));
+  fastotv::EpgInfo::programs_t second;
+  second.push_back(fastotv::ProgrammeInfo("2", 0, 1000, "movie"));
+  fastotv::server::EpgStore::epgs_t epgs;
+  epgs.push_back(MakeEpg("1", first));
+  epgs.push_back(MakeEpg("2", second));
+
+  fastotv::server::EpgStore store;
+  ASSERT_TRUE(store.IsEmpty());
+  store.Load(epgs);
+  ASSERT_FALSE(store.IsEmpty());
+  ASSERT_EQ(store.GetChannelsCount(), 2u);
+  ASSERT_EQ(store.GetProgrammesCount(), 4u);
+
+  fastotv::server::EpgStore::channels_t channels;
+  channels.push_back("1");
+  fastotv::ProgrammesInfo::programmes_t progs;
+  store.FindProgrammes(channels, 150, 250, 0, &progs);  // intersecting, ordered by start
+  ASSERT_EQ(progs.size(), 2u);
+  ASSERT_EQ(progs[0], fastotv::ProgrammeInfo("1", 100, 200, "first"));
+  ASSERT_EQ(progs[1], fastotv::ProgrammeInfo("1", 200, 300, "second"));
+
+  progs.clear();
+  store.FindProgrammes(channels, 200, 300, 0, &progs);  // [from, to)
+  ASSERT_EQ(progs.size(), 1u);
+  ASSERT_EQ(progs[0].GetTitle(), "second");
+
+  progs.clear();
+  store.FindProgrammes(channels, 0, 1000, 2, &progs);  // now and next
+  ASSERT_EQ(progs.size(), 2u);
+  ASSERT_EQ(progs[1].GetTitle(), "second");
+
+  progs.clear();
+  store.FindProgrammes(channels, 400, 1000, 0, &progs);
+  ASSERT_TRUE(progs.empty());
+
+  channels.push_back("2");
+  channels.push_back("unknown");
+  progs.clear();
+  store.FindProgrammes(channels, 350, 360, 0, &progs);
+  ASSERT_EQ(progs.size(), 2u);
+  ASSERT_EQ(progs[0].GetTitle(), "third");
+  ASSERT_EQ(progs[1].GetTitle(), "movie");
+
+  store.Clear();
+  ASSERT_TRUE(store.IsEmpty());
+}
+
+TEST(EpgStore, file_fallback) {
+  fastotv::epg::EpgFileWriter writer;
+  writer.AddProgramme(fastotv::ProgrammeInfo("1", 100, 200, "from file"));
+  writer.AddProgramme(fastotv::ProgrammeInfo("2", 100, 200, "from file"));
+  common::Error err = writer.Write(TEST_EPG_PATH);
+  ASSERT_FALSE(err);
+  std::shared_ptr<fastotv::epg::EpgFile> file = std::make_shared<fastotv::epg::EpgFile>();
+  err = file->Open(TEST_EPG_PATH);
+  ASSERT_FALSE(err);
+
+  fastotv::server::EpgStore store;
+  store.SetFile(file);
+  ASSERT_FALSE(store.IsEmpty());
+  fastotv::EpgInfo::programs_t progs;
+  progs.push_back(fastotv::ProgrammeInfo("1", 100, 200, "from redis"));
+  fastotv::server::EpgStore::epgs_t epgs;
+  epgs.push_back(MakeEpg("1", progs));
+  store.Load(epgs);
+  ASSERT_EQ(store.GetChannelsCount(), 2u);
+
+  fastotv::server::EpgStore::channels_t channels;
+  channels.push_back("1");
+  channels.push_back("2");
+  fastotv::ProgrammesInfo::programmes_t found;
+  store.FindProgrammes(channels, 0, 1000, 0, &found);
+  ASSERT_EQ(found.size(), 2u);
+  ASSERT_EQ(found[0], fastotv::ProgrammeInfo("1", 100, 200, "from redis"));
+  ASSERT_EQ(found[1], fastotv::ProgrammeInfo("2", 100, 200, "from file"));
+
+  store.SetFile(nullptr);
+  ASSERT_EQ(store.GetChannelsCount(), 1u);
+  remove(TEST_EPG_PATH);
+}
+
+TEST(EpgStore, overlapped_programmes) {
+  fastotv::EpgInfo::programs_t progs;
+  progs.push_back(fastotv::ProgrammeInfo("1", 100, 250, "first"));
+  progs.push_back(fastotv::ProgrammeInfo("1", 200, 300, "second"));
+  progs.push_back(fastotv::ProgrammeInfo("1", 300, 300, "empty"));
+  progs.push_back(fastotv::ProgrammeInfo("1", 400, 350, "broken"));
+  fastotv::server::EpgStore::epgs_t epgs;
+  epgs.push_back(MakeEpg("1", progs));
+
+  fastotv::server::EpgStore store;
+  store.Load(epgs);
+  ASSERT_EQ(store.GetProgrammesCount(), 2u);
+
+  fastotv::server::EpgStore::channels_t channels;
+  channels.push_back("1");
+  fastotv::ProgrammesInfo::programmes_t found;
+  store.FindProgrammes(channels, 220, 230, 0, &found);  // first is cut at start of second
+  ASSERT_EQ(found.size(), 1u);
+  ASSERT_EQ(found[0], fastotv::ProgrammeInfo("1", 200, 300, "second"));
+}
+
+TEST(EpgStore, strip_programmes) {
+  fastotv::EpgInfo::programs_t progs;
+  progs.push_back(fastotv::ProgrammeInfo("1", 100, 200, "first"));
+  fastotv::ChannelsInfo channels;
+  channels.AddChannel(fastotv::ChannelInfo(MakeEpg("1", progs), true, false));
+
+  fastotv::ChannelsInfo stripped = fastotv::server::EpgStore::StripProgrammes(channels);
+  ASSERT_EQ(stripped.GetSize(), 1u);
+  const fastotv::ChannelInfo channel = stripped.GetChannels()[0];
+  ASSERT_EQ(channel.GetId(), "1");
+  ASSERT_TRUE(channel.IsEnableAudio());
+  ASSERT_FALSE(channel.IsEnableVideo());
+  ASSERT_TRUE(channel.GetEpg().GetPrograms().empty());
+}
+
+TEST(EpgStore, clamp_request) {
+  fastotv::ProgrammesRequestInfo::channels_t channels;
+  for (size_t i = 0; i < fastotv::server::EpgStore::max_request_channels + 10; ++i) {
+    channels.push_back(common::ConvertToString(i));
+  }
+  const fastotv::timestamp_t from = 1000;
+  const fastotv::timestamp_t to = from + fastotv::server::EpgStore::max_request_window * 2;
+  const fastotv::ProgrammesRequestInfo req(channels, from, to, 0);
+
+  const fastotv::ProgrammesRequestInfo clamped = fastotv::server::EpgStore::ClampRequest(req);
+  ASSERT_EQ(clamped.GetChannels().size(), static_cast<size_t>(fastotv::server::EpgStore::max_request_channels));
+  ASSERT_EQ(clamped.GetChannels()[0], "0");
+  ASSERT_EQ(clamped.GetFrom(), from);
+  ASSERT_EQ(clamped.GetTo(), from + fastotv::server::EpgStore::max_request_window);
+  ASSERT_EQ(clamped.GetLimit(), static_cast<size_t>(fastotv::server::EpgStore::max_request_limit));
+
+  // requests within bounds are kept
+  channels.resize(2);
+  const fastotv::ProgrammesRequestInfo small(channels, from, from + 3600 * 1000, 10);
+  ASSERT_EQ(fastotv::server::EpgStore::ClampRequest(small), small);
+}
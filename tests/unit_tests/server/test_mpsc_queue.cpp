@@ -0,0 +1,57 @@
+#include <gtest/gtest.h>
+
+#include <thread>
+#include <vector>
+
+#include "server/mpsc_queue.h"
+
+TEST(MpscQueue, fifo_and_wakeup) {
+  fastotv::server::MpscQueue<int> queue;
+  int value = 0;
+  ASSERT_FALSE(queue.Pop(&value));
+  ASSERT_TRUE(queue.PushAndCheckWakeup(1));
+  ASSERT_FALSE(queue.PushAndCheckWakeup(2));
+  queue.ResetWakeup();
+  ASSERT_TRUE(queue.Pop(&value));
+  ASSERT_EQ(value, 1);
+  ASSERT_TRUE(queue.PushAndCheckWakeup(3));
+  ASSERT_TRUE(queue.Pop(&value));
+  ASSERT_EQ(value, 2);
+  ASSERT_TRUE(queue.Pop(&value));
+  ASSERT_EQ(value, 3);
+  ASSERT_FALSE(queue.Pop(&value));
+}
+
+TEST(MpscQueue, many_producers) {
+  const int producers = 4;
+  const int per_producer = 10000;
+  fastotv::server::MpscQueue<int> queue;
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; ++p) {
+    threads.push_back(std::thread([&queue, p]() {
+      for (int i = 0; i < per_producer; ++i) {
+        queue.Push(p * per_producer + i);
+      }
+    }));
+  }
+
+  std::vector<int> last(producers, -1);
+  int received = 0;
+  while (received < producers * per_producer) {
+    int value = 0;
+    if (!queue.Pop(&value)) {
+      std::this_thread::yield();
+      continue;
+    }
+    const int producer = value / per_producer;
+    ASSERT_LT(last[producer], value);  // order of one producer is kept
+    last[producer] = value;
+    received++;
+  }
+
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  int value = 0;
+  ASSERT_FALSE(queue.Pop(&value));
+}
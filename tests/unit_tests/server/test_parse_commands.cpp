@@ -1,9 +1,53 @@
 #include <gtest/gtest.h>
 
+#include <stdlib.h>
+
+#include <algorithm>
+
+#include <json-c/json_object.h>
+
+#include "inner/inner_client.h"
 #include "server/commands.h"
 
 using namespace fastotv;
 
+namespace {
+
+// random letters hardly compress, like worst case chat messages
+std::string RandomText(size_t size) {
+  static const char letters[] = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+  std::string out(size, 0);
+  for (size_t i = 0; i < size; ++i) {
+    out[i] = letters[rand() % (sizeof(letters) - 1)];
+  }
+  return out;
+}
+
+RuntimeChannelInfo::messages_t MakeHistory(size_t count, size_t message_size) {
+  RuntimeChannelInfo::messages_t history;
+  for (size_t i = 0; i < count; ++i) {
+    history.push_back(ChatMessage("cnn", "user@fastotv.com", RandomText(message_size), ChatMessage::MESSAGE));
+  }
+  return history;
+}
+
+// json argument of text reply
+RuntimeChannelInfo::messages_t ReplyMessages(const common::protocols::three_way_handshake::cmd_responce_t& resp) {
+  const std::string cmd = resp.GetCmd();
+  const size_t start = cmd.find('\'');
+  const size_t end = cmd.rfind('\'');
+  RuntimeChannelInfo rinf;
+  json_object* obj = NULL;
+  common::Error err = rinf.SerializeFromString(cmd.substr(start + 1, end - start - 1), &obj);
+  EXPECT_FALSE(err);
+  err = RuntimeChannelInfo::DeSerialize(obj, &rinf);
+  EXPECT_FALSE(err);
+  json_object_put(obj);
+  return rinf.GetMessages();
+}
+
+}  // namespace
+
 void TestParseRequestComand(common::protocols::three_way_handshake::cmd_request_t req, const std::string& etalon_cmd) {
   common::protocols::three_way_handshake::cmd_seq_t id_seq = req.GetId();
   common::protocols::three_way_handshake::cmd_id_t cmd_id;
@@ -29,3 +73,37 @@ TEST(commands, parse_commands) {
   common::protocols::three_way_handshake::cmd_request_t ping_req = server::PingRequest(ping_id_seq);
   TestParseRequestComand(ping_req, SERVER_PING);
 }
+
+TEST(commands, runtime_channel_info_history_fits_frame) {
+  const RuntimeChannelInfo rinf("cnn", 3, OFFICAL_CHANNEL, true, false);
+  const RuntimeChannelInfo::messages_t history = MakeHistory(50, 1024);
+
+  // chunked peer gets whole history
+  common::protocols::three_way_handshake::cmd_responce_t resp =
+      server::GetRuntimeChannelInfoResponce("1", rinf, history, false, true);
+  ASSERT_FALSE(inner::InnerClient::IsFitFrame(resp.GetCmd()));
+  ASSERT_EQ(ReplyMessages(resp), history);
+
+  // others the newest messages which fit into one frame
+  resp = server::GetRuntimeChannelInfoResponce("1", rinf, history, false, false);
+  ASSERT_TRUE(inner::InnerClient::IsFitFrame(resp.GetCmd()));
+  const RuntimeChannelInfo::messages_t msgs = ReplyMessages(resp);
+  ASSERT_GT(msgs.size(), 0u);
+  ASSERT_LT(msgs.size(), history.size());
+  ASSERT_TRUE(std::equal(msgs.begin(), msgs.end(), history.end() - msgs.size()));
+
+  RuntimeChannelInfo::messages_t more = msgs;  // one more message doesn't fit
+  more.push_front(history[history.size() - msgs.size() - 1]);
+  const RuntimeChannelInfo bigger("cnn", 3, OFFICAL_CHANNEL, true, false, more);
+  serializet_t bigger_str;
+  common::Error err = bigger.SerializeToString(&bigger_str);
+  ASSERT_FALSE(err);
+  ASSERT_FALSE(inner::InnerClient::IsFitFrame(server::GetRuntimeChannelInfoResponceSuccsess("1", bigger_str).GetCmd()));
+
+  resp = server::GetRuntimeChannelInfoResponce("1", rinf, history, true, false);
+  ASSERT_TRUE(inner::InnerClient::IsFitFrame(resp.GetCmd()));
+
+  // message bigger than frame is never attached, info is still answered
+  resp = server::GetRuntimeChannelInfoResponce("1", rinf, MakeHistory(1, 16 * 1024), false, false);
+  ASSERT_TRUE(ReplyMessages(resp).empty());
+}
@@ -0,0 +1,201 @@
+#include <gtest/gtest.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "server/redis/redis_publisher.h"
+
+namespace {
+
+// Accepts connections one by one and answers every multibulk command with :1, PUBLISH messages are recorded,
+// connection number i is closed after replies_limits[i] replies, the last limit applies to later connections.
+class FakeRedis {
+ public:
+  explicit FakeRedis(const std::vector<size_t>& replies_limits)
+      : replies_limits_(replies_limits), listen_fd_(-1), port_(0), stop_(false), connections_(0) {
+    listen_fd_ = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    EXPECT_EQ(bind(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)), 0);
+    EXPECT_EQ(listen(listen_fd_, 8), 0);
+    socklen_t len = sizeof(addr);
+    getsockname(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr), &len);
+    port_ = ntohs(addr.sin_port);
+    thread_ = std::thread(&FakeRedis::Run, this);
+  }
+
+  ~FakeRedis() {
+    stop_ = true;
+    thread_.join();
+    close(listen_fd_);
+  }
+
+  uint16_t GetPort() const { return port_; }
+
+  size_t GetConnectionsCount() const { return connections_; }
+
+  // messages which got a reply, in order of arrival
+  std::vector<std::string> GetConfirmed() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return confirmed_;
+  }
+
+ private:
+  void Run() {
+    while (!stop_) {
+      struct pollfd pfd = {listen_fd_, POLLIN, 0};
+      if (poll(&pfd, 1, 50) <= 0) {
+        continue;
+      }
+
+      int fd = accept(listen_fd_, NULL, NULL);
+      if (fd == -1) {
+        continue;
+      }
+
+      const size_t index = connections_++;
+      const size_t limit = replies_limits_[std::min(index, replies_limits_.size() - 1)];
+      Serve(fd, limit);
+      close(fd);
+    }
+  }
+
+  void Serve(int fd, size_t limit) {
+    std::string input;
+    size_t replies = 0;
+    while (!stop_ && replies < limit) {
+      struct pollfd pfd = {fd, POLLIN, 0};
+      if (poll(&pfd, 1, 50) <= 0) {
+        continue;
+      }
+
+      char buff[4096];
+      ssize_t nread = recv(fd, buff, sizeof(buff), 0);
+      if (nread <= 0) {
+        return;
+      }
+      input.append(buff, nread);
+
+      std::vector<std::string> args;
+      while (replies < limit && ParseCommand(&input, &args)) {
+        if (args.size() == 3 && args[0] == "PUBLISH") {
+          std::lock_guard<std::mutex> lock(mutex_);
+          confirmed_.push_back(args[2]);
+        }
+        replies++;
+        const std::string reply = ":1\r\n";
+        if (send(fd, reply.data(), reply.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(reply.size())) {
+          return;
+        }
+      }
+    }
+  }
+
+  // *<argc>\r\n($<len>\r\n<arg>\r\n)*
+  static bool ParseCommand(std::string* input, std::vector<std::string>* args) {
+    args->clear();
+    size_t pos = input->find("\r\n");
+    if ((*input)[0] != '*' || pos == std::string::npos) {
+      return false;
+    }
+
+    const size_t argc = strtoul(input->c_str() + 1, NULL, 10);
+    pos += 2;
+    for (size_t i = 0; i < argc; ++i) {
+      const size_t line_end = input->find("\r\n", pos);
+      if (line_end == std::string::npos) {
+        return false;
+      }
+
+      const size_t len = strtoul(input->c_str() + pos + 1, NULL, 10);
+      pos = line_end + 2;
+      if (input->size() < pos + len + 2) {
+        return false;
+      }
+      args->push_back(input->substr(pos, len));
+      pos += len + 2;
+    }
+    input->erase(0, pos);
+    return true;
+  }
+
+  const std::vector<size_t> replies_limits_;
+  int listen_fd_;
+  uint16_t port_;
+  std::atomic<bool> stop_;
+  std::atomic<size_t> connections_;
+  mutable std::mutex mutex_;
+  std::vector<std::string> confirmed_;
+  std::thread thread_;
+};
+
+fastotv::server::redis::RedisConfig MakeConfig(uint16_t port) {
+  fastotv::server::redis::RedisConfig config;
+  config.redis_host = common::net::HostAndPort("127.0.0.1", port);
+  return config;
+}
+
+bool WaitFor(std::function<bool()> pred) {
+  for (int i = 0; i < 200; ++i) {
+    if (pred()) {
+      return true;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(25));
+  }
+  return pred();
+}
+
+}  // namespace
+
+TEST(RedisPublisher, drop_oldest_over_limit) {
+  fastotv::server::redis::RedisPublisher publisher;
+  publisher.SetMaxBufferedMessages(3);
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_FALSE(publisher.Publish("chan", "msg" + std::to_string(i)));
+  }
+  ASSERT_EQ(publisher.GetBufferedMessagesCount(), 3u);
+  ASSERT_EQ(publisher.GetDroppedMessagesCount(), 2u);
+
+  publisher.SetMaxBufferedMessages(1);
+  ASSERT_EQ(publisher.GetBufferedMessagesCount(), 1u);
+  ASSERT_EQ(publisher.GetDroppedMessagesCount(), 4u);
+}
+
+TEST(RedisPublisher, resend_only_not_confirmed_after_reconnect) {
+  FakeRedis redis({2, 100});  // first connection breaks after two replies
+  fastotv::server::redis::RedisPublisher publisher;
+  publisher.SetConfig(MakeConfig(redis.GetPort()));
+  std::vector<std::string> messages;
+  for (int i = 0; i < 5; ++i) {
+    messages.push_back("msg" + std::to_string(i));
+    ASSERT_FALSE(publisher.Publish("chan", messages.back()));
+  }
+
+  std::thread runner(&fastotv::server::redis::RedisPublisher::Run, &publisher);
+  const bool delivered = WaitFor([&redis, &messages] { return redis.GetConfirmed().size() >= messages.size(); });
+  publisher.Stop();
+  runner.join();
+
+  ASSERT_TRUE(delivered);
+  ASSERT_EQ(redis.GetConnectionsCount(), 2u);
+  ASSERT_EQ(redis.GetConfirmed(), messages);  // confirmed messages are not published twice
+  ASSERT_EQ(publisher.GetBufferedMessagesCount(), 0u);
+  ASSERT_EQ(publisher.GetDroppedMessagesCount(), 0u);
+}
@@ -0,0 +1,51 @@
+#include <gtest/gtest.h>
+
+#include "server/server_metrics.h"
+
+TEST(ServerMetrics, histogram_buckets) {
+  fastotv::server::LatencyHistogram hist;
+  hist.Observe(50);
+  hist.Observe(1000);
+  hist.Observe(10000000);
+  ASSERT_EQ(hist.GetCount(), 3u);
+
+  std::string out;
+  hist.Render("lat", "command=\"ping\"", &out);
+  ASSERT_NE(out.find("lat_bucket{command=\"ping\",le=\"0.000100\"} 1\n"), std::string::npos);
+  ASSERT_NE(out.find("lat_bucket{command=\"ping\",le=\"0.001000\"} 2\n"), std::string::npos);
+  ASSERT_NE(out.find("lat_bucket{command=\"ping\",le=\"2.500000\"} 2\n"), std::string::npos);
+  ASSERT_NE(out.find("lat_bucket{command=\"ping\",le=\"+Inf\"} 3\n"), std::string::npos);
+  ASSERT_NE(out.find("lat_sum{command=\"ping\"} 10.001050\n"), std::string::npos);
+  ASSERT_NE(out.find("lat_count{command=\"ping\"} 3\n"), std::string::npos);
+}
+
+TEST(ServerMetrics, render_gauges) {
+  fastotv::server::ServerMetrics metrics;
+  metrics.ClientConnected();
+  metrics.ClientConnected();
+  metrics.ClientAuthenticated(false);
+  metrics.ClientAuthenticated(true);
+  metrics.ClientUnauthenticated(true);
+  metrics.GetTrafficStats()->wire_bytes_in += 10;
+  metrics.GetTrafficStats()->queued_bytes += 20;
+  metrics.GetTrafficStats()->dropped_messages += 1;
+
+  const std::string out = metrics.RenderPrometheus();
+  ASSERT_NE(out.find("fastotv_clients{state=\"connected\"} 2\n"), std::string::npos);
+  ASSERT_NE(out.find("fastotv_clients{state=\"authenticated\"} 1\n"), std::string::npos);
+  ASSERT_NE(out.find("fastotv_clients{state=\"anonymous\"} 0\n"), std::string::npos);
+  ASSERT_NE(out.find("fastotv_received_wire_bytes_total 10\n"), std::string::npos);
+  ASSERT_NE(out.find("fastotv_write_queue_bytes 20\n"), std::string::npos);
+  ASSERT_NE(out.find("fastotv_write_queue_dropped_messages_total 1\n"), std::string::npos);
+  ASSERT_NE(out.find("# TYPE fastotv_command_duration_seconds histogram\n"), std::string::npos);
+}
+
+TEST(ServerMetrics, sampled_values) {
+  fastotv::server::ServerMetrics metrics;
+  uint64_t dropped = 7;
+  metrics.AddSampledValue("fastotv_dropped_total", "counter", "Dropped.", [&dropped]() { return dropped; });
+  ASSERT_NE(metrics.RenderPrometheus().find("# TYPE fastotv_dropped_total counter\nfastotv_dropped_total 7\n"),
+            std::string::npos);
+  dropped = 9;
+  ASSERT_NE(metrics.RenderPrometheus().find("fastotv_dropped_total 9\n"), std::string::npos);
+}
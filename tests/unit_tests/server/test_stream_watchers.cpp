@@ -0,0 +1,33 @@
+#include <gtest/gtest.h>
+
+#include "server/inner/stream_watchers.h"
+
+using fastotv::server::inner::InnerTcpClient;
+using fastotv::server::inner::StreamWatchers;
+
+TEST(StreamWatchers, change_and_remove) {
+  InnerTcpClient* first = reinterpret_cast<InnerTcpClient*>(0x1);
+  InnerTcpClient* second = reinterpret_cast<InnerTcpClient*>(0x2);
+
+  StreamWatchers watchers;
+  watchers.Change(first, fastotv::invalid_stream_id, "discovery");
+  watchers.Change(second, fastotv::invalid_stream_id, "discovery");
+  ASSERT_EQ(watchers.GetWatchersCount("discovery"), 2u);
+  ASSERT_EQ(watchers.GetWatchersCount("cnn"), 0u);
+
+  watchers.Change(first, "discovery", "cnn");
+  ASSERT_EQ(watchers.GetWatchersCount("discovery"), 1u);
+  ASSERT_EQ(watchers.GetWatchersCount("cnn"), 1u);
+  ASSERT_EQ(watchers.GetWatchers("cnn").count(first), 1u);
+
+  watchers.Change(first, "cnn", "cnn");
+  ASSERT_EQ(watchers.GetWatchersCount("cnn"), 1u);
+
+  watchers.Remove(second, "discovery");
+  ASSERT_EQ(watchers.GetWatchersCount("discovery"), 0u);
+  ASSERT_EQ(watchers.GetStreamsCount(), 1u);
+
+  watchers.Change(first, "cnn", fastotv::invalid_stream_id);
+  ASSERT_EQ(watchers.GetStreamsCount(), 0u);
+  ASSERT_TRUE(watchers.GetWatchers("cnn").empty());
+}
@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+
+#include "server/user_info_cache.h"
+
+namespace {
+fastotv::server::user_info_ptr_t make_user(const std::string& login) {
+  return std::make_shared<const fastotv::server::UserInfo>(login, "1234", fastotv::ChannelsInfo(),
+                                                           fastotv::server::UserInfo::devices_t());
+}
+}  // namespace
+
+TEST(UserInfoCache, find_invalidate) {
+  fastotv::server::UserInfoCache cache;
+  fastotv::server::user_info_ptr_t user = make_user("atopilski@gmail.com");
+  cache.Insert("59106ed9457cd9f4c3c0b78f", user, cache.GetEpoch());
+  ASSERT_EQ(cache.GetSize(), 1u);
+
+  fastotv::server::user_id_t uid;
+  fastotv::server::user_info_ptr_t cached;
+  ASSERT_TRUE(cache.Find("atopilski@gmail.com", &uid, &cached));
+  ASSERT_EQ(uid, "59106ed9457cd9f4c3c0b78f");
+  ASSERT_EQ(cached, user);
+  ASSERT_FALSE(cache.Find("unknown@gmail.com", &uid, &cached));
+
+  cache.Invalidate("atopilski@gmail.com");
+  ASSERT_FALSE(cache.Find("atopilski@gmail.com", &uid, &cached));
+  ASSERT_EQ(cache.GetSize(), 0u);
+}
+
+TEST(UserInfoCache, lru_limit) {
+  fastotv::server::UserInfoCache cache;
+  cache.SetLimits(2, fastotv::server::UserInfoCache::default_ttl_sec);
+  cache.Insert("1", make_user("first"), cache.GetEpoch());
+  cache.Insert("2", make_user("second"), cache.GetEpoch());
+
+  fastotv::server::user_id_t uid;
+  fastotv::server::user_info_ptr_t cached;
+  ASSERT_TRUE(cache.Find("first", &uid, &cached));  // second is least recently used now
+
+  cache.Insert("3", make_user("third"), cache.GetEpoch());
+  ASSERT_EQ(cache.GetSize(), 2u);
+  ASSERT_TRUE(cache.Find("first", &uid, &cached));
+  ASSERT_FALSE(cache.Find("second", &uid, &cached));
+  ASSERT_TRUE(cache.Find("third", &uid, &cached));
+}
+
+TEST(UserInfoCache, ttl) {
+  fastotv::server::UserInfoCache cache;
+  cache.SetLimits(fastotv::server::UserInfoCache::default_max_entries, 0);
+  cache.Insert("1", make_user("first"), cache.GetEpoch());
+
+  fastotv::server::user_id_t uid;
+  fastotv::server::user_info_ptr_t cached;
+  ASSERT_FALSE(cache.Find("first", &uid, &cached));
+}
+
+TEST(UserInfoCache, invalidate_while_loading) {
+  fastotv::server::UserInfoCache cache;
+  const fastotv::server::UserInfoCache::epoch_t epoch = cache.GetEpoch();
+  cache.Invalidate("first");  // arrives before lookup result
+  ASSERT_FALSE(cache.Insert("1", make_user("first"), epoch));
+  ASSERT_TRUE(cache.Insert("2", make_user("second"), epoch));
+
+  fastotv::server::user_id_t uid;
+  fastotv::server::user_info_ptr_t cached;
+  ASSERT_FALSE(cache.Find("first", &uid, &cached));
+  ASSERT_TRUE(cache.Find("second", &uid, &cached));
+  ASSERT_TRUE(cache.Insert("1", make_user("first"), cache.GetEpoch()));
+
+  const fastotv::server::UserInfoCache::epoch_t before_clear = cache.GetEpoch();
+  cache.Clear();
+  ASSERT_FALSE(cache.Insert("3", make_user("third"), before_clear));
+  ASSERT_EQ(cache.GetSize(), 0u);
+}
@@ -0,0 +1,58 @@
+#include <gtest/gtest.h>
+
+#include "inner/binary_commands.h"
+
+TEST(BinaryCommands, encode_decode_command) {
+  const common::protocols::three_way_handshake::cmd_seq_t id = "42";
+  const std::string arg("with\0zero 'quotes'", 18);
+  common::protocols::three_way_handshake::cmd_responce_t resp =
+      fastotv::inner::MakeBinaryResponce(id, SUCCESS_COMMAND, CLIENT_GET_RUNTIME_CHANNEL_INFO, arg);
+  ASSERT_TRUE(fastotv::inner::IsBinaryEncoded(resp.GetCmd()));
+
+  common::protocols::three_way_handshake::cmd_id_t seq;
+  common::protocols::three_way_handshake::cmd_seq_t did;
+  std::vector<char> storage;
+  std::vector<char*> argv;
+  std::vector<size_t> args_size;
+  common::Error err = fastotv::inner::DecodeBinaryCommand(resp.GetCmd(), &seq, &did, &storage, &argv, &args_size);
+  ASSERT_TRUE(!err);
+  ASSERT_EQ(seq, RESPONCE_COMMAND);
+  ASSERT_EQ(did, id);
+  ASSERT_EQ(argv.size(), 3u);
+  ASSERT_STREQ(argv[0], SUCCESS_COMMAND);
+  ASSERT_STREQ(argv[1], CLIENT_GET_RUNTIME_CHANNEL_INFO);
+  ASSERT_EQ(std::string(argv[2], args_size[2]), arg);
+
+  const std::string truncated = resp.GetCmd().substr(0, resp.GetCmd().size() - 1);
+  err = fastotv::inner::DecodeBinaryCommand(truncated, &seq, &did, &storage, &argv, &args_size);
+  ASSERT_TRUE(err);
+}
+
+TEST(BinaryCommands, serialize_deserialize) {
+  fastotv::RuntimeChannelInfo rinf("123", 7, fastotv::OFFICAL_CHANNEL, true, false);
+  rinf.AddMessage(fastotv::ChatMessage("123", "alex", "hi", fastotv::ChatMessage::MESSAGE));
+  std::string rinf_bin;
+  fastotv::inner::BinarySerialize(rinf, &rinf_bin);
+  fastotv::RuntimeChannelInfo drinf;
+  common::Error err = fastotv::inner::BinaryDeSerialize(rinf_bin.data(), rinf_bin.size(), &drinf);
+  ASSERT_TRUE(!err);
+  ASSERT_EQ(rinf, drinf);
+
+  fastotv::ClientInfo cinf("alex", "Linux", "Intel", 8000, 4000, 1024);
+  std::string cinf_bin;
+  fastotv::inner::BinarySerialize(cinf, &cinf_bin);
+  fastotv::ClientInfo dcinf;
+  err = fastotv::inner::BinaryDeSerialize(cinf_bin.data(), cinf_bin.size(), &dcinf);
+  ASSERT_TRUE(!err);
+  ASSERT_EQ(cinf.GetLogin(), dcinf.GetLogin());
+  ASSERT_EQ(cinf.GetRamFree(), dcinf.GetRamFree());
+  ASSERT_EQ(cinf.GetBandwidth(), dcinf.GetBandwidth());
+
+  fastotv::ServerPingInfo ping;
+  std::string ping_bin;
+  fastotv::inner::BinarySerialize(ping, &ping_bin);
+  fastotv::ServerPingInfo dping;
+  err = fastotv::inner::BinaryDeSerialize(ping_bin.data(), ping_bin.size(), &dping);
+  ASSERT_TRUE(!err);
+  ASSERT_EQ(ping.GetTimeStamp(), dping.GetTimeStamp());
+}
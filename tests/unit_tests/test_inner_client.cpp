@@ -0,0 +1,276 @@
+#include <gtest/gtest.h>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include <common/convert2string.h>
+
+#include "inner/inner_client.h"
+
+namespace {
+
+std::string RandomBytes(size_t size) {
+  std::string out(size, 0);
+  for (size_t i = 0; i < size; ++i) {
+    out[i] = static_cast<char>(rand() & 0xFF);
+  }
+  return out;
+}
+
+// commands as written to socket by client to peer with features
+std::string WireBytes(const std::vector<std::string>& commands, uint32_t features) {
+  int fds[2];
+  EXPECT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  {
+    fastotv::inner::InnerClient writer(nullptr, common::net::socket_info(fds[0]));
+    writer.SetPeerFeatures(features);
+    for (size_t i = 0; i < commands.size(); ++i) {
+      const common::protocols::three_way_handshake::cmd_request_t request(common::ConvertToString(i), commands[i]);
+      EXPECT_FALSE(writer.Write(request));
+    }
+    EXPECT_EQ(writer.GetWriteQueueSize(), 0u);
+  }
+  shutdown(fds[0], SHUT_WR);
+
+  std::string wire;
+  char buff[4096];
+  ssize_t nread;
+  while ((nread = recv(fds[1], buff, sizeof(buff), 0)) > 0) {
+    wire.append(buff, nread);
+  }
+  close(fds[0]);
+  close(fds[1]);
+  return wire;
+}
+
+// small ones and one chunked message
+std::vector<std::string> MakeCommands() {
+  std::vector<std::string> commands;
+  for (size_t i = 0; i < 5; ++i) {
+    commands.push_back("0 " + common::ConvertToString(i) + " ping\r\n");
+  }
+  commands.push_back("0 5 big '" + RandomBytes(fastotv::inner::InnerClient::MAX_COMMAND_SIZE + 512) + "'\r\n");
+  commands.push_back("0 6 ping\r\n");
+  return commands;
+}
+
+// random payload whose compressed size is exactly target, frame of it allows chunks
+void MakeSizedPayload(size_t target, std::string* payload, fastotv::inner::InnerClient::frame_t* frame) {
+  const std::string data = RandomBytes(target);
+  size_t size = target - target / 64;  // from below, frames over limit are refused
+  for (size_t attempt = 0; attempt < 16; ++attempt) {
+    fastotv::inner::InnerClient::CompressedPart part;
+    ASSERT_FALSE(fastotv::inner::InnerClient::CompressPart(data.substr(0, size), &part));
+    ASSERT_FALSE(fastotv::inner::InnerClient::MakeFrame(std::string(), part, std::string(), true, frame));
+    if ((*frame)->size() == target) {
+      *payload = data.substr(0, size);
+      return;
+    }
+    size = size + target - (*frame)->size();  // compression overhead of incompressible data grows slowly
+  }
+  FAIL() << "no payload of compressed size " << target;
+}
+
+class SocketPair : public ::testing::Test {
+ protected:
+  virtual void SetUp() override {
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds_), 0);
+    ASSERT_EQ(fcntl(fds_[0], F_SETFL, fcntl(fds_[0], F_GETFL) | O_NONBLOCK), 0);  // client end, as in loop
+  }
+
+  virtual void TearDown() override {
+    close(fds_[0]);
+    close(fds_[1]);
+  }
+
+  // reads peer side until eof, false if nothing is received for a while
+  bool DrainToEof() {
+    char buff[65536];
+    while (true) {
+      struct timeval tv = {1, 0};
+      setsockopt(fds_[1], SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+      const ssize_t nread = recv(fds_[1], buff, sizeof(buff), 0);
+      if (nread == 0) {
+        return true;
+      }
+      if (nread < 0) {
+        return false;
+      }
+    }
+  }
+
+  void Send(const char* data, size_t size) {
+    while (size) {
+      const ssize_t nwrite = send(fds_[1], data, size, 0);
+      ASSERT_GT(nwrite, 0);
+      data += nwrite;
+      size -= nwrite;
+    }
+  }
+
+  // decodes all complete commands which are buffered now
+  static void DecodeAvailable(fastotv::inner::InnerClient* client, std::vector<std::string>* commands) {
+    const std::string* command = NULL;
+    while (true) {
+      ASSERT_FALSE(client->NextCommand(&command));
+      if (!command) {
+        return;
+      }
+      commands->push_back(*command);
+    }
+  }
+
+  // writes queued data of writer and decodes one command of reader
+  static void RoundTrip(fastotv::inner::InnerClient* writer,
+                        fastotv::inner::InnerClient* reader,
+                        std::string* decoded) {
+    const std::string* command = NULL;
+    while (true) {
+      ASSERT_FALSE(reader->NextCommand(&command));
+      if (command) {
+        *decoded = *command;
+        ASSERT_EQ(writer->GetWriteQueueSize(), 0u);
+        return;
+      }
+      ASSERT_FALSE(reader->ReadData());
+      ASSERT_FALSE(writer->Flush());
+    }
+  }
+
+  int fds_[2];
+};
+
+}  // namespace
+
+TEST_F(SocketPair, evict_client_over_write_queue_limit) {
+  fastotv::inner::InnerClient client(nullptr, common::net::socket_info(fds_[0]));
+  client.SetPeerFeatures(fastotv::inner::InnerClient::supported_features);
+  fastotv::inner::InnerClient::CompressedPart part;
+  ASSERT_FALSE(fastotv::inner::InnerClient::CompressPart(RandomBytes(1024 * 1024), &part));
+  fastotv::inner::InnerClient::frame_t frame;
+  ASSERT_FALSE(fastotv::inner::InnerClient::MakeFrame("0 1 big '", part, "'\r\n", true, &frame));
+
+  // peer doesn't read, socket buffer and then write queue are filled
+  common::Error err;
+  size_t written = 0;
+  for (; written < 16 && !err; ++written) {
+    err = client.WriteFrame(frame);
+  }
+  ASSERT_TRUE(err);
+  ASSERT_GT(written, 4u);
+  ASSERT_TRUE(client.IsEvicted());
+  ASSERT_EQ(client.GetWriteQueueSize(), 0u);
+
+  ASSERT_TRUE(client.WriteFrame(frame));  // evicted client doesn't accept writes
+  ASSERT_TRUE(client.ReadData());         // read path of loop closes it
+  ASSERT_TRUE(DrainToEof());              // peer is disconnected
+}
+
+TEST_F(SocketPair, decode_frames_split_at_every_byte) {
+  const std::vector<std::string> commands = MakeCommands();
+  const std::string wire = WireBytes(commands, fastotv::inner::InnerClient::supported_features);
+  ASSERT_GT(wire.size(), static_cast<size_t>(fastotv::inner::InnerClient::MAX_COMMAND_SIZE));
+
+  fastotv::inner::InnerClient client(nullptr, common::net::socket_info(fds_[0]));
+  for (size_t split = 1; split < wire.size(); ++split) {  // the same stream again and again, torn at next byte
+    std::vector<std::string> decoded;
+    Send(wire.data(), split);
+    ASSERT_FALSE(client.ReadData());
+    DecodeAvailable(&client, &decoded);
+    Send(wire.data() + split, wire.size() - split);
+    while (decoded.size() < commands.size()) {
+      ASSERT_FALSE(client.ReadData());
+      DecodeAvailable(&client, &decoded);
+    }
+    ASSERT_EQ(decoded, commands) << "split at " << split;
+  }
+}
+
+TEST_F(SocketPair, decode_glued_frames) {
+  const std::vector<std::string> commands = MakeCommands();
+  std::string wire;
+  for (size_t i = 0; i < 3; ++i) {
+    wire += WireBytes(commands, fastotv::inner::InnerClient::supported_features);
+  }
+  Send(wire.data(), wire.size());  // several frames arrive by one read
+
+  fastotv::inner::InnerClient client(nullptr, common::net::socket_info(fds_[0]));
+  std::vector<std::string> decoded;
+  while (decoded.size() < commands.size() * 3) {
+    ASSERT_FALSE(client.ReadData());
+    DecodeAvailable(&client, &decoded);
+  }
+  for (size_t i = 0; i < decoded.size(); ++i) {
+    ASSERT_EQ(decoded[i], commands[i % commands.size()]);
+  }
+
+  const std::string* command = NULL;  // nothing is decoded twice
+  ASSERT_FALSE(client.NextCommand(&command));
+  ASSERT_FALSE(command);
+}
+
+TEST_F(SocketPair, chunked_frames_round_trip) {
+  const int sndbuf = 4096;  // writes are partial, fragments and their size prefixes are torn
+  ASSERT_EQ(setsockopt(fds_[0], SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf)), 0);
+  fastotv::inner::InnerClient writer(nullptr, common::net::socket_info(fds_[0]));
+  fastotv::inner::InnerClient reader(nullptr, common::net::socket_info(fds_[1]));
+  fastotv::inner::InnerClient::TrafficStats stats;
+  stats.bytes_in = 0;
+  stats.bytes_out = 0;
+  stats.wire_bytes_in = 0;
+  stats.wire_bytes_out = 0;
+  stats.queued_bytes = 0;
+  stats.dropped_messages = 0;
+  reader.SetTrafficStats(&stats);
+
+  const size_t command_size = fastotv::inner::InnerClient::MAX_COMMAND_SIZE;
+  const size_t targets[] = {command_size - 1, command_size, command_size + 1,
+                            fastotv::inner::InnerClient::MAX_MESSAGE_SIZE};
+  for (size_t target : targets) {
+    std::string payload;
+    fastotv::inner::InnerClient::frame_t frame;
+    MakeSizedPayload(target, &payload, &frame);
+    if (HasFatalFailure()) {
+      return;
+    }
+
+    const size_t fragments = (target + command_size - 1) / command_size;
+    for (bool chunked : {false, true}) {
+      const uint32_t features = fastotv::inner::InnerClient::supported_features;
+      writer.SetPeerFeatures(chunked ? features : features & ~fastotv::inner::InnerClient::CHUNKED_FEATURE);
+      const common::protocols::three_way_handshake::cmd_request_t request("1", payload);
+      if (!chunked && target > command_size) {  // peer can't reassemble, nothing is sent
+        ASSERT_TRUE(writer.Write(request)) << target;
+        fastotv::inner::InnerClient::CompressedPart part;
+        ASSERT_FALSE(fastotv::inner::InnerClient::CompressPart(payload, &part));
+        fastotv::inner::InnerClient::frame_t refused;
+        ASSERT_TRUE(fastotv::inner::InnerClient::MakeFrame(std::string(), part, std::string(), false, &refused));
+        ASSERT_EQ(writer.GetWriteQueueSize(), 0u);
+        continue;
+      }
+
+      // compressed while written
+      const uint64_t wire_bytes = stats.wire_bytes_in;
+      ASSERT_FALSE(writer.Write(request)) << target;
+      std::string decoded;
+      RoundTrip(&writer, &reader, &decoded);
+      ASSERT_EQ(decoded, payload) << target;
+      ASSERT_EQ(stats.wire_bytes_in - wire_bytes, target + fragments * sizeof(uint32_t));
+
+      // prebuilt, size prefixes are produced while sending
+      ASSERT_FALSE(writer.WriteFrame(frame)) << target;
+      RoundTrip(&writer, &reader, &decoded);
+      ASSERT_EQ(decoded, payload) << target;
+    }
+  }
+
+  // chunked messages are limited too
+  std::string payload = RandomBytes(fastotv::inner::InnerClient::MAX_MESSAGE_SIZE + 1024);
+  writer.SetPeerFeatures(fastotv::inner::InnerClient::supported_features);
+  ASSERT_TRUE(writer.Write(common::protocols::three_way_handshake::cmd_request_t("1", payload)));
+}
@@ -0,0 +1,196 @@
+#include <gtest/gtest.h>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include <common/convert2string.h>
+
+#include "inner/inner_client.h"
+#include "inner/inner_server_command_seq_parser.h"
+
+namespace {
+
+class TestParser : public fastotv::inner::InnerServerCommandSeqParser {
+ public:
+  using fastotv::inner::InnerServerCommandSeqParser::HandleInnerDataReceived;
+
+  // fake clock, ExpireRequests is driven by loop timer in server
+  void Tick(size_t ticks = 1) {
+    for (size_t i = 0; i < ticks; ++i) {
+      ExpireRequests();
+    }
+  }
+
+  std::vector<std::string> requests;  // ids of peer requests
+
+ private:
+  virtual void HandleInnerRequestCommand(fastotv::inner::InnerClient* connection,
+                                         common::protocols::three_way_handshake::cmd_seq_t id,
+                                         int argc,
+                                         char* argv[]) override {
+    requests.push_back(id);
+  }
+  virtual void HandleInnerResponceCommand(fastotv::inner::InnerClient* connection,
+                                          common::protocols::three_way_handshake::cmd_seq_t id,
+                                          int argc,
+                                          char* argv[]) override {}
+  virtual void HandleInnerApproveCommand(fastotv::inner::InnerClient* connection,
+                                         common::protocols::three_way_handshake::cmd_seq_t id,
+                                         int argc,
+                                         char* argv[]) override {}
+};
+
+// answer is recorded as "name:state"
+fastotv::inner::RequestCallback MakeCallback(const std::string& id,
+                                             const std::string& name,
+                                             std::vector<std::string>* answers) {
+  auto cb = [name, answers](common::protocols::three_way_handshake::cmd_seq_t request_id, int argc, char* argv[]) {
+    answers->push_back(name + ":" + (argc > 0 ? argv[0] : ""));
+  };
+  return fastotv::inner::RequestCallback(id, "ping", cb);
+}
+
+// whole answer is recorded as "name:arg arg ..."
+fastotv::inner::RequestCallback MakeFullCallback(const std::string& id,
+                                                 const std::string& name,
+                                                 std::vector<std::string>* answers) {
+  auto cb = [name, answers](common::protocols::three_way_handshake::cmd_seq_t request_id, int argc, char* argv[]) {
+    std::string answer = name + ":";
+    for (int i = 0; i < argc; ++i) {
+      answer += (i ? " " : "") + std::string(argv[i]);
+    }
+    answers->push_back(answer);
+  };
+  return fastotv::inner::RequestCallback(id, "ping", cb);
+}
+
+class Connections : public ::testing::Test {
+ protected:
+  virtual void SetUp() override {
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, first_fds_), 0);
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, second_fds_), 0);
+    first_ = new fastotv::inner::InnerClient(nullptr, common::net::socket_info(first_fds_[0]));
+    second_ = new fastotv::inner::InnerClient(nullptr, common::net::socket_info(second_fds_[0]));
+  }
+
+  virtual void TearDown() override {
+    delete first_;
+    delete second_;
+    close(first_fds_[0]);
+    close(first_fds_[1]);
+    close(second_fds_[0]);
+    close(second_fds_[1]);
+  }
+
+  int first_fds_[2];
+  int second_fds_[2];
+  fastotv::inner::InnerClient* first_;
+  fastotv::inner::InnerClient* second_;
+};
+
+}  // namespace
+
+TEST_F(Connections, same_id_pending_on_two_connections) {
+  std::vector<std::string> answers;
+  TestParser parser;
+  parser.SubscribeRequest(first_, MakeCallback("1", "first", &answers));
+  parser.SubscribeRequest(second_, MakeCallback("1", "second", &answers));
+  ASSERT_EQ(parser.GetPendingRequestsCount(), 2u);
+
+  parser.HandleInnerDataReceived(first_, "0 1 get_server_info\r\n");  // request of peer with the same id
+  ASSERT_EQ(parser.requests.size(), 1u);
+  ASSERT_TRUE(answers.empty());
+
+  parser.HandleInnerDataReceived(second_, "1 1 OK ping\r\n");
+  ASSERT_EQ(answers, std::vector<std::string>({"second:OK"}));
+  ASSERT_EQ(parser.GetPendingRequestsCount(), 1u);
+
+  parser.HandleInnerDataReceived(second_, "1 1 OK ping\r\n");  // answered already
+  ASSERT_EQ(answers.size(), 1u);
+
+  parser.HandleInnerDataReceived(first_, "2 1 OK ping\r\n");  // approve
+  ASSERT_EQ(answers, std::vector<std::string>({"second:OK", "first:OK"}));
+  ASSERT_EQ(parser.GetPendingRequestsCount(), 0u);
+}
+
+TEST_F(Connections, fail_requests_of_closed_connection) {
+  std::vector<std::string> answers;  // outlives parser, it fails the rest on destruction
+  TestParser parser;
+  parser.SubscribeRequest(first_, MakeCallback("7", "first", &answers));
+  parser.SubscribeRequest(second_, MakeCallback("7", "second", &answers));
+
+  parser.FailRequests(first_, "not connected");
+  ASSERT_EQ(answers, std::vector<std::string>({"first:FAIL"}));
+  ASSERT_EQ(parser.GetPendingRequestsCount(), 1u);
+}
+
+TEST_F(Connections, timeout_answer) {
+  std::vector<std::string> answers;
+  TestParser parser;
+  parser.SubscribeRequest(first_, MakeFullCallback("1", "first", &answers));
+  parser.Tick(fastotv::inner::InnerServerCommandSeqParser::default_request_timeout - 1);
+  ASSERT_TRUE(answers.empty());
+
+  parser.Tick();
+  ASSERT_EQ(answers, std::vector<std::string>({"first:FAIL ping {\"cause\": \"timeout\"}"}));
+  ASSERT_EQ(parser.GetPendingRequestsCount(), 0u);
+
+  parser.Tick(fastotv::inner::InnerServerCommandSeqParser::default_request_timeout * 2);  // executed once
+  ASSERT_EQ(answers.size(), 1u);
+}
+
+TEST_F(Connections, timeout_slots_wrap) {
+  std::vector<std::string> answers;
+  TestParser parser;
+  parser.SetRequestTimeout(3);  // wheel of 4 slots
+  for (size_t tick = 0; tick < 10; ++tick) {  // every request waits 3 ticks, expire ticks wrap the wheel
+    const std::string id = common::ConvertToString(tick);
+    parser.SubscribeRequest(first_, MakeCallback(id, id, &answers));
+    parser.Tick();
+    if (tick >= 2) {
+      ASSERT_EQ(answers.size(), tick - 1);
+      ASSERT_EQ(answers.back(), common::ConvertToString(tick - 2) + ":FAIL");
+    } else {
+      ASSERT_TRUE(answers.empty());
+    }
+  }
+  ASSERT_EQ(parser.GetPendingRequestsCount(), 2u);
+}
+
+TEST_F(Connections, answer_after_timeout_ignored) {
+  std::vector<std::string> answers;
+  TestParser parser;
+  parser.SetRequestTimeout(2);
+  parser.SubscribeRequest(first_, MakeCallback("1", "first", &answers));
+  parser.Tick(2);
+  ASSERT_EQ(answers, std::vector<std::string>({"first:FAIL"}));
+
+  parser.HandleInnerDataReceived(first_, "1 1 OK ping\r\n");  // late responce
+  ASSERT_EQ(answers.size(), 1u);
+
+  // id answered in time and reused is expired by its own tick, not by stale slot entry of first one
+  parser.SubscribeRequest(first_, MakeCallback("2", "second", &answers));
+  parser.HandleInnerDataReceived(first_, "1 2 OK ping\r\n");
+  parser.Tick();
+  parser.SubscribeRequest(first_, MakeCallback("2", "third", &answers));
+  parser.Tick();  // slot of first subscription
+  ASSERT_EQ(answers, std::vector<std::string>({"first:FAIL", "second:OK"}));
+  parser.Tick();
+  ASSERT_EQ(answers, std::vector<std::string>({"first:FAIL", "second:OK", "third:FAIL"}));
+}
+
+TEST_F(Connections, fail_pending_requests_on_shutdown) {
+  std::vector<std::string> answers;
+  {
+    TestParser parser;
+    parser.SubscribeRequest(first_, MakeFullCallback("1", "first", &answers));
+    parser.SubscribeRequest(second_, MakeFullCallback("1", "second", &answers));
+  }
+  ASSERT_EQ(answers.size(), 2u);
+  for (const std::string& answer : answers) {
+    ASSERT_NE(answer.find(":FAIL ping {\"cause\": \"shutdown\"}"), std::string::npos);
+  }
+}
@@ -0,0 +1,192 @@
+#include <gtest/gtest.h>
+
+#include <common/convert2string.h>
+
+#include "channels_delta_info.h"
+#include "channels_info.h"
+#include "serializer/json_reader.h"
+
+namespace {
+
+fastotv::ChannelsInfo MakeChannels(size_t channels, size_t programmes) {
+  fastotv::ChannelsInfo chan;
+  for (size_t i = 0; i < channels; ++i) {
+    const fastotv::stream_id sid = common::ConvertToString(i);
+    fastotv::EpgInfo epg(sid, common::uri::Url("http://localhost:8080/hls/" + sid + "/play.m3u8"), "Канал " + sid);
+    fastotv::EpgInfo::programs_t progs;
+    for (size_t j = 0; j < programmes; ++j) {
+      progs.push_back(fastotv::ProgrammeInfo(sid, 1514764800000 + j * 1800000, 1514764800000 + (j + 1) * 1800000,
+                                             "Programme \"" + common::ConvertToString(j) + "\"\t/ news"));
+    }
+    epg.SetPrograms(progs);
+    chan.AddChannel(fastotv::ChannelInfo(epg, i % 2 == 0, true));
+  }
+  return chan;
+}
+
+}  // namespace
+
+TEST(JsonReader, scalars) {
+  const std::string json =
+      "{\"s\": \"a\\/b\\n\\u00e9\\ud83d\\ude00\", \"i\": -42, \"d\": 1.5e3, \"b\": true, \"n\": null,"
+      " \"nested\": [1, {\"x\": [2, \"]\"]}], \"num_str\": \"17\", \"zero\": 0}";
+  fastotv::JsonReader reader(json);
+  ASSERT_FALSE(reader.EnterObject());
+
+  std::string key;
+  bool has_next = false;
+  ASSERT_FALSE(reader.NextField(&key, &has_next));
+  ASSERT_TRUE(has_next);
+  ASSERT_EQ(key, "s");
+  std::string str;
+  ASSERT_FALSE(reader.ReadString(&str));
+  ASSERT_EQ(str, "a/b\n\xC3\xA9\xF0\x9F\x98\x80");
+
+  ASSERT_FALSE(reader.NextField(&key, &has_next));
+  ASSERT_EQ(key, "i");
+  int64_t i = 0;
+  ASSERT_FALSE(reader.ReadInt64(&i));
+  ASSERT_EQ(i, -42);
+
+  ASSERT_FALSE(reader.NextField(&key, &has_next));
+  ASSERT_EQ(key, "d");
+  ASSERT_FALSE(reader.ReadInt64(&i));
+  ASSERT_EQ(i, 1500);
+
+  ASSERT_FALSE(reader.NextField(&key, &has_next));
+  ASSERT_EQ(key, "b");
+  bool b = false;
+  ASSERT_FALSE(reader.ReadBool(&b));
+  ASSERT_TRUE(b);
+
+  ASSERT_FALSE(reader.NextField(&key, &has_next));
+  ASSERT_EQ(key, "n");
+  ASSERT_FALSE(reader.ReadString(&str));
+  ASSERT_EQ(str, "");
+
+  ASSERT_FALSE(reader.NextField(&key, &has_next));
+  ASSERT_EQ(key, "nested");
+  ASSERT_FALSE(reader.SkipValue());
+
+  ASSERT_FALSE(reader.NextField(&key, &has_next));
+  ASSERT_EQ(key, "num_str");
+  ASSERT_FALSE(reader.ReadInt64(&i));
+  ASSERT_EQ(i, 17);
+
+  ASSERT_FALSE(reader.NextField(&key, &has_next));
+  ASSERT_EQ(key, "zero");
+  ASSERT_FALSE(reader.ReadBool(&b));
+  ASSERT_FALSE(b);
+
+  ASSERT_FALSE(reader.NextField(&key, &has_next));
+  ASSERT_FALSE(has_next);
+  ASSERT_FALSE(reader.Finish());
+}
+
+TEST(JsonReader, strings_across_blocks) {
+  for (size_t len = 0; len < 70; ++len) {
+    for (size_t escape_pos = 0; escape_pos <= len; ++escape_pos) {
+      std::string expected(len, 'x');
+      std::string json = "\"" + expected + "\"";
+      if (escape_pos < len) {
+        expected[escape_pos] = '"';
+        json.replace(escape_pos + 1, 1, "\\\"");
+      }
+
+      fastotv::JsonReader reader(json);
+      std::string str;
+      ASSERT_FALSE(reader.ReadString(&str));
+      ASSERT_EQ(str, expected);
+      ASSERT_FALSE(reader.Finish());
+    }
+  }
+}
+
+TEST(JsonReader, mismatched_type_is_skipped) {
+  const std::string json = "[{\"a\": [1, 2]}, 3]";
+  fastotv::JsonReader reader(json);
+  ASSERT_FALSE(reader.EnterArray());
+  bool has_next = false;
+  ASSERT_FALSE(reader.NextElement(&has_next));
+  ASSERT_TRUE(has_next);
+  ASSERT_TRUE(reader.EnterArray());  // object
+  ASSERT_FALSE(reader.IsFailed());
+  ASSERT_FALSE(reader.NextElement(&has_next));
+  ASSERT_TRUE(has_next);
+  int64_t i = 0;
+  ASSERT_FALSE(reader.ReadInt64(&i));
+  ASSERT_EQ(i, 3);
+  ASSERT_FALSE(reader.NextElement(&has_next));
+  ASSERT_FALSE(has_next);
+  ASSERT_FALSE(reader.Finish());
+}
+
+TEST(JsonReader, malformed) {
+  const char* malformed[] = {"\"unterminated", "\"raw\ncontrol\"", "[1, 2}", "{\"a\" 1}", "tru", "-", "1.", "[1 2]",
+                             "{\"a\": [}", "\"\\x\"", "\"\\u12\"", "[1,]", "{\"a\": 1,}"};
+  for (const char* json : malformed) {
+    fastotv::JsonReader reader(json, strlen(json));
+    common::Error err = reader.SkipValue();
+    if (!err) {
+      err = reader.Finish();
+    }
+    ASSERT_TRUE(err) << json;
+    ASSERT_TRUE(reader.IsFailed()) << json;
+  }
+
+  const std::string deep(fastotv::JsonReader::max_depth + 1, '[');
+  fastotv::JsonReader reader(deep);
+  ASSERT_TRUE(reader.SkipValue());
+}
+
+TEST(JsonReader, channels_same_as_json_c) {
+  const fastotv::ChannelsInfo channels = MakeChannels(20, 10);
+  std::string data;
+  ASSERT_FALSE(channels.SerializeToString(&data));
+
+  fastotv::JsonReader reader(data);
+  fastotv::ChannelsInfo parsed;
+  ASSERT_FALSE(fastotv::ChannelsInfo::DeSerialize(&reader, &parsed));
+  ASSERT_FALSE(reader.Finish());
+  ASSERT_EQ(parsed, channels);
+
+  fastotv::ChannelsInfo::channels_t expected = channels.GetChannels();
+  fastotv::ChannelsInfo::channels_t actual = parsed.GetChannels();
+  for (size_t i = 0; i < expected.size(); ++i) {
+    ASSERT_EQ(actual[i].IsEnableAudio(), expected[i].IsEnableAudio());
+    ASSERT_EQ(actual[i].GetEpg().GetIconUrl(), expected[i].GetEpg().GetIconUrl());
+    ASSERT_EQ(actual[i].GetEpg().GetPrograms(), expected[i].GetEpg().GetPrograms());
+  }
+
+  fastotv::ChannelsInfo from_string;
+  ASSERT_FALSE(fastotv::DeSerializeFromString(data, &from_string));
+  ASSERT_EQ(from_string, channels);
+}
+
+TEST(JsonReader, invalid_channels_are_skipped) {
+  const std::string data =
+      "[{\"epg\": {\"id\": \"1\", \"url\": \"http://localhost/1.m3u8\", \"display_name\": \"first\"}},"
+      " {\"epg\": {\"id\": \"2\", \"url\": \"http://localhost/2.m3u8\"}, \"audio\": false},"
+      " \"not a channel\","
+      " {\"epg\": {\"id\": \"3\", \"url\": \"http://localhost/3.m3u8\", \"display_name\": \"third\"}, \"video\": 0}]";
+  fastotv::JsonReader reader(data);
+  fastotv::ChannelsInfo parsed;
+  ASSERT_FALSE(fastotv::ChannelsInfo::DeSerialize(&reader, &parsed));
+  ASSERT_FALSE(reader.Finish());
+  ASSERT_EQ(parsed.GetSize(), 2u);
+  ASSERT_FALSE(parsed.GetChannels()[1].IsEnableVideo());
+}
+
+TEST(JsonReader, channels_delta) {
+  const fastotv::ChannelsDeltaInfo full = fastotv::ChannelsDeltaInfo::MakeFull("v1", MakeChannels(3, 2));
+  std::string data;
+  ASSERT_FALSE(full.SerializeToString(&data));
+
+  fastotv::ChannelsDeltaInfo parsed;
+  fastotv::JsonReader reader(data);
+  ASSERT_FALSE(fastotv::ChannelsDeltaInfo::DeSerialize(&reader, &parsed));
+  ASSERT_EQ(parsed.GetType(), fastotv::ChannelsDeltaInfo::FULL);
+  ASSERT_EQ(parsed.GetVersion(), "v1");
+  ASSERT_EQ(parsed.GetAdded(), full.GetAdded());
+  ASSERT_TRUE(parsed.GetRemoved().empty());
+}
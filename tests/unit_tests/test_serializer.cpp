@@ -1,11 +1,14 @@
 #include <gtest/gtest.h>
 
+#include <limits>
+
 #include "auth_info.h"
 #include "channel_info.h"
 #include "channels_info.h"
 #include "client_info.h"
 #include "ping_info.h"
 #include "runtime_channel_info.h"
+#include "serializer/json_reader.h"
 #include "server_info.h"
 
 typedef fastotv::AuthInfo::serialize_type serialize_t;
@@ -48,6 +51,61 @@ TEST(ChannelInfo, serialize_deserialize) {
   ASSERT_EQ(http_uri, dhttp_uri);
 }
 
+TEST(EpgInfo, find_programme_by_time) {
+  fastotv::EpgInfo epg("1", common::uri::Url("http://localhost:8080/hls/1/play.m3u8"), "first");
+  fastotv::EpgInfo::programs_t progs;
+  progs.push_back(fastotv::ProgrammeInfo("1", 300, 400, "third"));
+  progs.push_back(fastotv::ProgrammeInfo("1", 100, 200, "first"));
+  progs.push_back(fastotv::ProgrammeInfo("1", 200, 250, "second"));
+  epg.SetPrograms(progs);
+  progs = epg.GetPrograms();  // sorted by start
+  ASSERT_EQ(progs.size(), 3u);
+  ASSERT_EQ(progs[0].GetTitle(), "first");
+  ASSERT_EQ(progs[2].GetTitle(), "third");
+
+  fastotv::ProgrammeInfo prog;
+  fastotv::timestamp_t until = 0;
+  ASSERT_FALSE(epg.FindProgrammeByTime(50, &prog, &until));
+  ASSERT_EQ(until, 100);
+  ASSERT_TRUE(epg.FindProgrammeByTime(100, &prog, &until));
+  ASSERT_EQ(prog.GetTitle(), "first");
+  ASSERT_EQ(until, 200);
+  ASSERT_TRUE(epg.FindProgrammeByTime(200, &prog, &until));  // [start, stop)
+  ASSERT_EQ(prog.GetTitle(), "second");
+  ASSERT_EQ(until, 250);
+  ASSERT_FALSE(epg.FindProgrammeByTime(260, &prog, &until));  // gap till next one
+  ASSERT_EQ(until, 300);
+  ASSERT_FALSE(epg.FindProgrammeByTime(400, &prog, &until));
+  ASSERT_EQ(until, std::numeric_limits<fastotv::timestamp_t>::max());
+  ASSERT_TRUE(epg.FindProgrammeByTime(399, &prog));
+
+  // nested programme is found while it lasts, the enclosing one before and after it
+  progs.clear();
+  progs.push_back(fastotv::ProgrammeInfo("1", 100, 500, "film"));
+  progs.push_back(fastotv::ProgrammeInfo("1", 200, 250, "news"));
+  epg.SetPrograms(progs);
+  ASSERT_TRUE(epg.FindProgrammeByTime(150, &prog, &until));
+  ASSERT_EQ(prog.GetTitle(), "film");
+  ASSERT_EQ(until, 200);
+  ASSERT_TRUE(epg.FindProgrammeByTime(220, &prog, &until));
+  ASSERT_EQ(prog.GetTitle(), "news");
+  ASSERT_EQ(until, 250);
+  ASSERT_TRUE(epg.FindProgrammeByTime(300, &prog, &until));
+  ASSERT_EQ(prog.GetTitle(), "film");
+  ASSERT_EQ(until, 500);
+  ASSERT_FALSE(epg.FindProgrammeByTime(500, &prog, &until));
+
+  const std::string json =
+      "{\"id\":\"1\",\"url\":\"http://localhost:8080/hls/1/play.m3u8\",\"display_name\":\"first\",\"programs\":["
+      "{\"channel\":\"1\",\"start\":300,\"stop\":400,\"title\":\"third\"},"
+      "{\"channel\":\"1\",\"start\":100,\"stop\":200,\"title\":\"first\"}]}";
+  fastotv::JsonReader reader(json);
+  fastotv::EpgInfo depg;
+  common::Error err = fastotv::EpgInfo::DeSerialize(&reader, &depg);
+  ASSERT_FALSE(err);
+  ASSERT_EQ(depg.GetPrograms()[0].GetTitle(), "first");
+}
+
 TEST(ServerInfo, serialize_deserialize) {
   const common::net::HostAndPort hs = common::net::HostAndPort::CreateLocalHost(3554);
 
@@ -165,7 +223,7 @@ TEST(RuntimeChannelInfo, serialize_deserialize) {
   const fastotv::ChannelType ct = fastotv::OFFICAL_CHANNEL;
   const bool chat_enabled = true;
   const bool chat_readonly = true;
-  const std::vector<fastotv::ChatMessage> msgs = {
+  const fastotv::RuntimeChannelInfo::messages_t msgs = {
       fastotv::ChatMessage("1234", "alex", "test", fastotv::ChatMessage::MESSAGE)};
   fastotv::RuntimeChannelInfo rinf_info(channel_id, watchers, ct, chat_enabled, chat_readonly, msgs);
   ASSERT_EQ(rinf_info.GetChannelId(), channel_id);
@@ -0,0 +1,216 @@
+#include <gtest/gtest.h>
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "epg/epg_file.h"
+#include "epg/xmltv_parser.h"
+
+#define TEST_XMLTV_PATH "test_guide.xml"
+#define TEST_EPG_PATH "test_guide.epg"
+
+namespace {
+
+const char kGuide[] =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+    "<!DOCTYPE tv SYSTEM \"xmltv.dtd\">\n"
+    "<tv generator-info-name=\"test\">\n"
+    "  <channel id=\"FoxNews.us\"><display-name>Fox News</display-name></channel>\n"
+    "  <!-- <programme start=\"20170613000000 +0000\" channel=\"FoxNews.us\"><title>commented</title> -->\n"
+    "  <programme start=\"20170613010000 +0000\" stop=\"20170613020000 +0000\" channel=\"FoxNews.us\">\n"
+    "    <title lang=\"en\">The Five &amp; &#x41;&#66; &quot;&lt;&gt;</title>\n"
+    "    <title lang=\"ru\">second title</title>\n"
+    "    <desc lang=\"en\">The Five covers the hot topics</desc>\n"
+    "  </programme>\n"
+    "  <programme channel='CNN.us' start='20170613030000 +0300'><title><![CDATA[a]]b & c]]></title></programme>\n"
+    "  <programme start=\"20170613040000 +0300\" channel=\"CNN.us\"><title>Next</title></programme>\n"
+    "  <programme start=\"broken\" channel=\"CNN.us\"><title>Broken</title></programme>\n"
+    "  <programme start=\"20170613050000 +0000\" channel=\"CNN.us\"></programme>\n"
+    "</tv>\n";
+
+std::vector<fastotv::ProgrammeInfo> ParseByChunks(const std::string& guide, size_t chunk, size_t* skipped) {
+  std::vector<fastotv::ProgrammeInfo> programmes;
+  fastotv::epg::XmltvParser parser(
+      [&programmes](const fastotv::ProgrammeInfo& programme) { programmes.push_back(programme); });
+  for (size_t i = 0; i < guide.size(); i += chunk) {
+    common::Error err = parser.Feed(guide.data() + i, std::min(chunk, guide.size() - i));
+    EXPECT_FALSE(err);
+  }
+  common::Error err = parser.Finish();
+  EXPECT_FALSE(err);
+  *skipped = parser.GetSkippedCount();
+  EXPECT_EQ(parser.GetProgrammesCount(), programmes.size());
+  return programmes;
+}
+
+void WriteFile(const std::string& path, const std::string& data) {
+  FILE* file = fopen(path.c_str(), "wb");
+  ASSERT_TRUE(file);
+  ASSERT_EQ(fwrite(data.data(), 1, data.size(), file), data.size());
+  fclose(file);
+}
+
+std::string MakeGuide(const std::string& programmes) {
+  return "<?xml version=\"1.0\"?>\n<tv>\n" + programmes + "</tv>\n";
+}
+
+std::string MakeProgramme(const std::string& channel, const std::string& start, const std::string& title) {
+  return "<programme start=\"" + start + " +0000\" channel=\"" + channel + "\"><title>" + title +
+         "</title></programme>\n";
+}
+
+}  // namespace
+
+TEST(XmltvParser, parse_time) {
+  fastotv::timestamp_t time = 0;
+  ASSERT_TRUE(fastotv::epg::XmltvParser::ParseTime("20170613010000 +0000", &time));
+  ASSERT_EQ(time, 1497315600000);
+  ASSERT_TRUE(fastotv::epg::XmltvParser::ParseTime("20170613040000 +0300", &time));
+  ASSERT_EQ(time, 1497315600000);
+  ASSERT_TRUE(fastotv::epg::XmltvParser::ParseTime("20170612213000 -0330", &time));
+  ASSERT_EQ(time, 1497315600000);
+  ASSERT_TRUE(fastotv::epg::XmltvParser::ParseTime("201706130100", &time));
+  ASSERT_EQ(time, 1497315600000);
+  ASSERT_TRUE(fastotv::epg::XmltvParser::ParseTime("19700101000000", &time));
+  ASSERT_EQ(time, 0);
+  ASSERT_TRUE(fastotv::epg::XmltvParser::ParseTime("2017061301", &time));
+  ASSERT_EQ(time, 1497315600000);
+  ASSERT_FALSE(fastotv::epg::XmltvParser::ParseTime("", &time));
+  ASSERT_FALSE(fastotv::epg::XmltvParser::ParseTime("20171313010000 +0000", &time));
+  ASSERT_FALSE(fastotv::epg::XmltvParser::ParseTime("20170613010000 +00", &time));
+  ASSERT_FALSE(fastotv::epg::XmltvParser::ParseTime("20170613010000 UTC", &time));
+}
+
+TEST(XmltvParser, programmes) {
+  for (size_t chunk = 1; chunk <= sizeof(kGuide); chunk += 7) {
+    size_t skipped = 0;
+    const std::vector<fastotv::ProgrammeInfo> programmes = ParseByChunks(kGuide, chunk, &skipped);
+    ASSERT_EQ(programmes.size(), 3u);
+    ASSERT_EQ(skipped, 2u);
+
+    ASSERT_EQ(programmes[0].GetChannel(), "FoxNews.us");
+    ASSERT_EQ(programmes[0].GetStart(), 1497315600000u);
+    ASSERT_EQ(programmes[0].GetStop(), 1497319200000u);
+    ASSERT_EQ(programmes[0].GetTitle(), "The Five & AB \"<>");
+
+    ASSERT_EQ(programmes[1].GetChannel(), "CNN.us");
+    ASSERT_EQ(programmes[1].GetStart(), 1497312000000u);
+    ASSERT_EQ(programmes[1].GetStop(), 0u);
+    ASSERT_EQ(programmes[1].GetTitle(), "a]]b & c");
+    ASSERT_EQ(programmes[2].GetTitle(), "Next");
+  }
+}
+
+TEST(XmltvParser, errors) {
+  fastotv::epg::XmltvParser parser([](const fastotv::ProgrammeInfo&) {});
+  const std::string truncated = "<tv><programme start=\"20170613010000\" channel=\"1\"><title>a</ti";
+  common::Error err = parser.Feed(truncated.data(), truncated.size());
+  ASSERT_FALSE(err);
+  err = parser.Finish();
+  ASSERT_TRUE(err);
+
+  fastotv::epg::XmltvParser huge_tag([](const fastotv::ProgrammeInfo&) {});
+  const std::string tag = "<programme channel=\"" + std::string(fastotv::epg::XmltvParser::max_tag_size, 'a');
+  err = huge_tag.Feed(tag.data(), tag.size());
+  ASSERT_TRUE(err);
+}
+
+TEST(EpgFile, write_and_find) {
+  fastotv::epg::EpgFileWriter writer;
+  writer.SetSource(100, 200);
+  writer.AddProgramme(fastotv::ProgrammeInfo("b", 300, 0, "news"));
+  writer.AddProgramme(fastotv::ProgrammeInfo("b", 100, 250, "news"));
+  writer.AddProgramme(fastotv::ProgrammeInfo("b", 200, 400, "movie"));
+  writer.AddProgramme(fastotv::ProgrammeInfo("a", 100, 200, "news"));
+  writer.AddProgramme(fastotv::ProgrammeInfo("c", 100, 0, "lost"));
+  ASSERT_EQ(writer.GetChannelsCount(), 3u);
+  ASSERT_EQ(writer.GetProgrammesCount(), 5u);
+  common::Error err = writer.Write(TEST_EPG_PATH);
+  ASSERT_FALSE(err);
+
+  fastotv::epg::EpgFile file;
+  ASSERT_FALSE(file.IsOpen());
+  err = file.Open(TEST_EPG_PATH);
+  ASSERT_FALSE(err);
+  ASSERT_TRUE(file.IsOpen());
+  ASSERT_EQ(file.GetSourceSize(), 100u);
+  ASSERT_EQ(file.GetSourceMtime(), 200u);
+  ASSERT_EQ(file.GetChannelsCount(), 2u);  // "c" has no programme with known stop
+  ASSERT_EQ(file.GetProgrammesCount(), 3u);
+  ASSERT_EQ(file.GetChannelId(0), "a");
+  ASSERT_EQ(file.GetChannelId(1), "b");
+  ASSERT_TRUE(file.HasChannel("b"));
+  ASSERT_FALSE(file.HasChannel("c"));
+  ASSERT_FALSE(file.HasChannel("bb"));
+
+  fastotv::epg::EpgFile::programmes_t found;
+  file.FindProgrammes("b", 0, 1000, 0, &found);
+  ASSERT_EQ(found.size(), 2u);  // last one has no stop
+  ASSERT_EQ(found[0], fastotv::ProgrammeInfo("b", 100, 200, "news"));
+  ASSERT_EQ(found[1], fastotv::ProgrammeInfo("b", 200, 300, "movie"));
+
+  found.clear();
+  file.FindProgrammes("b", 200, 201, 0, &found);
+  ASSERT_EQ(found.size(), 1u);
+  ASSERT_EQ(found[0].GetTitle(), "movie");
+
+  found.clear();
+  file.FindProgrammes("b", 0, 1000, 1, &found);
+  ASSERT_EQ(found.size(), 1u);
+  file.FindProgrammes("a", 200, 1000, 0, &found);
+  file.FindProgrammes("unknown", 0, 1000, 0, &found);
+  ASSERT_EQ(found.size(), 1u);
+
+  file.Close();
+  ASSERT_FALSE(file.IsOpen());
+  WriteFile(TEST_EPG_PATH, "FEPG broken");
+  err = file.Open(TEST_EPG_PATH);
+  ASSERT_TRUE(err);
+  remove(TEST_EPG_PATH);
+}
+
+TEST(EpgFile, incremental_ingest) {
+  remove(TEST_EPG_PATH);
+  WriteFile(TEST_XMLTV_PATH, MakeGuide(MakeProgramme("1", "20170613010000", "old 1") +
+                                       MakeProgramme("1", "20170613020000", "old 2") +
+                                       MakeProgramme("1", "20170613030000", "old 3") +
+                                       MakeProgramme("1", "20170613040000", "old end") +
+                                       MakeProgramme("2", "20170613020000", "gone") +
+                                       MakeProgramme("2", "20170613030000", "gone end")));
+  bool updated = false;
+  common::Error err = fastotv::epg::IngestXmltv(TEST_XMLTV_PATH, TEST_EPG_PATH, 0, &updated);
+  ASSERT_FALSE(err);
+  ASSERT_TRUE(updated);
+  err = fastotv::epg::IngestXmltv(TEST_XMLTV_PATH, TEST_EPG_PATH, 0, &updated);
+  ASSERT_FALSE(err);
+  ASSERT_FALSE(updated);
+
+  fastotv::timestamp_t keep_from = 0;
+  ASSERT_TRUE(fastotv::epg::XmltvParser::ParseTime("20170613020000", &keep_from));
+  WriteFile(TEST_XMLTV_PATH, MakeGuide(MakeProgramme("1", "20170613030000", "new 3") +
+                                       MakeProgramme("1", "20170613050000", "new end")));
+  err = fastotv::epg::IngestXmltv(TEST_XMLTV_PATH, TEST_EPG_PATH, keep_from, &updated);
+  ASSERT_FALSE(err);
+  ASSERT_TRUE(updated);
+
+  fastotv::epg::EpgFile file;
+  err = file.Open(TEST_EPG_PATH);
+  ASSERT_FALSE(err);
+  fastotv::epg::EpgFile::programmes_t found;
+  file.FindProgrammes("1", 0, std::numeric_limits<fastotv::timestamp_t>::max(), 0, &found);
+  ASSERT_EQ(found.size(), 2u);  // old 1 stops at keep_from, old 3 is replaced
+  ASSERT_EQ(found[0].GetTitle(), "old 2");
+  ASSERT_EQ(found[1].GetTitle(), "new 3");
+  found.clear();
+  file.FindProgrammes("2", 0, std::numeric_limits<fastotv::timestamp_t>::max(), 0, &found);
+  ASSERT_EQ(found.size(), 1u);
+  ASSERT_EQ(found[0].GetTitle(), "gone");
+
+  file.Close();
+  remove(TEST_XMLTV_PATH);
+  remove(TEST_EPG_PATH);
+}